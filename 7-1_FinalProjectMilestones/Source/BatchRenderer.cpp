@@ -0,0 +1,464 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.cpp
+// ============
+// render a list of scenes, camera poses and resolutions into image files
+// without showing a window, as described by a job file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+#include "SceneManager.h"
+#include "FrameCapture.h"
+#include "FrameArena.h"
+#include "JsonParser.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// the clip planes match the interactive camera
+	const float PERSPECTIVE_NEAR_PLANE = 0.1f;
+	const float PERSPECTIVE_FAR_PLANE = 100.0f;
+	const float ORTHOGRAPHIC_DEPTH = 250.0f;
+
+	typedef JsonParser::JSON_VALUE JSON_VALUE;
+
+	// read a string member, keeping the default when it is missing
+	std::string ReadString(const JSON_VALUE& object, const char* name, const char* defaultValue)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_STRING))
+		{
+			return(defaultValue);
+		}
+		return(pValue->text);
+	}
+
+	// read a number member, keeping the default when it is missing
+	float ReadFloat(const JSON_VALUE& object, const char* name, float defaultValue)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_NUMBER))
+		{
+			return(defaultValue);
+		}
+		return((float)pValue->number);
+	}
+
+	// read a bool member, keeping the default when it is missing
+	bool ReadBool(const JSON_VALUE& object, const char* name, bool defaultValue)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_BOOL))
+		{
+			return(defaultValue);
+		}
+		return(pValue->boolean);
+	}
+
+	// read an array of numbers into consecutive floats
+	void ReadFloats(const JSON_VALUE& object, const char* name, float* pValues, int count)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_ARRAY))
+		{
+			return;
+		}
+		for (int i = 0; (i < count) && (i < (int)pValue->elements.size()); i++)
+		{
+			if (pValue->elements[i].type == JsonParser::JSON_NUMBER)
+			{
+				pValues[i] = (float)pValue->elements[i].number;
+			}
+		}
+	}
+
+	// get an array member, which may be missing
+	const std::vector<JSON_VALUE>* GetArray(const JSON_VALUE& object, const char* name)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_ARRAY))
+		{
+			return(NULL);
+		}
+		return(&pValue->elements);
+	}
+
+	// get the name of a file without its folder and extension
+	std::string GetFileStem(const std::string& filename)
+	{
+		size_t start = filename.find_last_of("/\\");
+		start = (start == std::string::npos) ? 0 : start + 1;
+		size_t end = filename.find_last_of('.');
+		if ((end == std::string::npos) || (end < start))
+		{
+			end = filename.size();
+		}
+		return(filename.substr(start, end - start));
+	}
+}
+
+/***********************************************************
+ *  BatchRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BatchRenderer::BatchRenderer(SceneManager* pSceneManager)
+{
+	m_pSceneManager = pSceneManager;
+	m_frameCapture = NULL;
+	m_outputDirectory = ".";
+	m_frameBuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~BatchRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BatchRenderer::~BatchRenderer()
+{
+	if (NULL != m_frameCapture)
+	{
+		delete m_frameCapture;
+		m_frameCapture = NULL;
+	}
+	DestroyTarget();
+}
+
+/***********************************************************
+ *  LoadJobFile()
+ *
+ *  This method is used for reading the job file, which is
+ *  a JSON object with an output folder, a list of scene
+ *  files, a list of cameras and a list of [width, height]
+ *  resolutions.  A camera has a name, a position, a target,
+ *  an up direction and either a field of view or an
+ *  orthographic height, and turntableFrames makes it orbit
+ *  the target about the vertical axis.
+ ***********************************************************/
+bool BatchRenderer::LoadJobFile(const char* filename)
+{
+	std::ifstream jobFile(filename, std::ios::in | std::ios::binary);
+	if (!jobFile.is_open())
+	{
+		std::cout << "Could not open job file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream jobStream;
+	jobStream << jobFile.rdbuf();
+
+	JSON_VALUE root;
+	std::string error;
+	if (JsonParser::Parse(jobStream.str(), root, error) == false)
+	{
+		std::cout << "Could not parse job file:" << filename << ", " << error << std::endl;
+		return(false);
+	}
+	if (root.type != JsonParser::JSON_OBJECT)
+	{
+		std::cout << "Could not parse job file:" << filename << ", the root must be an object" << std::endl;
+		return(false);
+	}
+
+	m_outputDirectory = ReadString(root, "output", ".");
+	m_scenes.clear();
+	m_cameras.clear();
+	m_resolutions.clear();
+
+	const std::vector<JSON_VALUE>* pArray = GetArray(root, "scenes");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		if ((*pArray)[i].type == JsonParser::JSON_STRING)
+		{
+			m_scenes.push_back((*pArray)[i].text);
+		}
+	}
+
+	pArray = GetArray(root, "cameras");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		const JSON_VALUE& value = (*pArray)[i];
+
+		BATCH_CAMERA camera;
+		camera.name = ReadString(value, "name", "");
+		if (camera.name.empty())
+		{
+			camera.name = "camera" + std::to_string(i);
+		}
+		camera.position = glm::vec3(0.0f, 5.0f, 12.0f);
+		camera.target = glm::vec3(0.0f);
+		camera.up = glm::vec3(0.0f, 1.0f, 0.0f);
+		ReadFloats(value, "position", &camera.position.x, 3);
+		ReadFloats(value, "target", &camera.target.x, 3);
+		ReadFloats(value, "up", &camera.up.x, 3);
+		camera.fieldOfView = ReadFloat(value, "fieldOfView", 45.0f);
+		camera.bOrthographic = ReadBool(value, "orthographic", false);
+		camera.orthographicHeight = ReadFloat(value, "orthographicHeight", 20.0f);
+		camera.turntableFrames = (int)ReadFloat(value, "turntableFrames", 0.0f);
+		m_cameras.push_back(camera);
+	}
+
+	pArray = GetArray(root, "resolutions");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		const JSON_VALUE& value = (*pArray)[i];
+
+		BATCH_RESOLUTION resolution;
+		resolution.width = 0;
+		resolution.height = 0;
+		if ((value.type == JsonParser::JSON_ARRAY) && (value.elements.size() == 2) &&
+			(value.elements[0].type == JsonParser::JSON_NUMBER) &&
+			(value.elements[1].type == JsonParser::JSON_NUMBER))
+		{
+			resolution.width = (int)value.elements[0].number;
+			resolution.height = (int)value.elements[1].number;
+		}
+		if ((resolution.width <= 0) || (resolution.height <= 0))
+		{
+			std::cout << "INFO: skipping resolution " << i << " of the job file, it must be [width, height]" << std::endl;
+			continue;
+		}
+		m_resolutions.push_back(resolution);
+	}
+
+	if ((m_scenes.empty()) || (m_cameras.empty()) || (m_resolutions.empty()))
+	{
+		std::cout << "Could not parse job file:" << filename << ", it needs scenes, cameras and resolutions" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for allocating the offscreen target
+ *  that the jobs of one resolution are drawn into.  Its
+ *  color is only read back, so renderbuffers are used.
+ ***********************************************************/
+bool BatchRenderer::CreateTarget(int width, int height)
+{
+	if ((m_frameBuffer != 0) && (width == m_width) && (height == m_height))
+	{
+		return(true);
+	}
+
+	DestroyTarget();
+
+	glGenFramebuffers(1, &m_frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+
+	// the deferred path copies its depth into this format
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (bComplete == false)
+	{
+		DestroyTarget();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+
+	// the G-buffer of the deferred path follows the target
+	m_pSceneManager->ResizeRenderTargets(width, height);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the offscreen target.
+ ***********************************************************/
+void BatchRenderer::DestroyTarget()
+{
+	if (m_frameBuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_frameBuffer);
+		m_frameBuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  RenderJob()
+ *
+ *  This method is used for drawing the scene from one
+ *  camera pose into the target and starting its readback.
+ *  The frame is not waited for; it is written by the
+ *  encoders while the next jobs are drawn.
+ ***********************************************************/
+void BatchRenderer::RenderJob(const BATCH_CAMERA& camera, int frame, const std::string& filename)
+{
+	// the transient data of the job three jobs ago is released
+	m_pSceneManager->GetFrameArena()->BeginFrame();
+
+	// a turntable frame turns the position about the target
+	glm::vec3 position = camera.position;
+	if (camera.turntableFrames > 0)
+	{
+		float angle = glm::radians(360.0f * frame / camera.turntableFrames);
+		glm::vec3 offset = camera.position - camera.target;
+		position.x = camera.target.x + offset.x * cosf(angle) + offset.z * sinf(angle);
+		position.z = camera.target.z - offset.x * sinf(angle) + offset.z * cosf(angle);
+	}
+
+	float aspectRatio = (float)m_width / (float)m_height;
+	glm::mat4 view = glm::lookAt(position, camera.target, camera.up);
+	glm::mat4 projection;
+	if (camera.bOrthographic == true)
+	{
+		float halfHeight = camera.orthographicHeight * 0.5f;
+		float halfWidth = halfHeight * aspectRatio;
+		projection = glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, -ORTHOGRAPHIC_DEPTH, ORTHOGRAPHIC_DEPTH);
+	}
+	else
+	{
+		projection = glm::perspective(glm::radians(camera.fieldOfView), aspectRatio,
+			PERSPECTIVE_NEAR_PLANE, PERSPECTIVE_FAR_PLANE);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+	glViewport(0, 0, m_width, m_height);
+
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	m_pSceneManager->SetViewParameters(view, projection, m_width, m_height);
+	m_pSceneManager->RenderScene();
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_frameBuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	m_frameCapture->Capture(filename.c_str(), m_width, m_height);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// hand the copies the GPU has finished to the encoders
+	m_frameCapture->Update();
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering every job of the job
+ *  file.  The images are named after the scene, the camera
+ *  and the resolution, with the frame number added for a
+ *  turntable, and written to the output folder.
+ ***********************************************************/
+bool BatchRenderer::Run()
+{
+	if ((NULL == m_pSceneManager) || (m_scenes.empty()))
+	{
+		return(false);
+	}
+
+	FrameCapture::MakeDirectory(m_outputDirectory.c_str());
+
+	if (NULL == m_frameCapture)
+	{
+		m_frameCapture = new FrameCapture();
+		m_frameCapture->Initialize();
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	int jobCount = 0;
+	int skippedScenes = 0;
+
+	for (size_t scene = 0; scene < m_scenes.size(); scene++)
+	{
+		// only the meshes, textures and lights that differ from
+		// the previous scene are loaded
+		if (m_pSceneManager->LoadScene(m_scenes[scene].c_str()) == false)
+		{
+			std::cout << "INFO: skipping the jobs of scene file:" << m_scenes[scene] << std::endl;
+			skippedScenes++;
+			continue;
+		}
+		std::string sceneName = GetFileStem(m_scenes[scene]);
+
+		for (size_t resolution = 0; resolution < m_resolutions.size(); resolution++)
+		{
+			int width = m_resolutions[resolution].width;
+			int height = m_resolutions[resolution].height;
+			if (CreateTarget(width, height) == false)
+			{
+				std::cout << "INFO: skipping resolution " << width << "x" << height << ", the target could not be created" << std::endl;
+				continue;
+			}
+
+			for (size_t camera = 0; camera < m_cameras.size(); camera++)
+			{
+				const BATCH_CAMERA& batchCamera = m_cameras[camera];
+				int frameCount = (batchCamera.turntableFrames > 0) ? batchCamera.turntableFrames : 1;
+				for (int frame = 0; frame < frameCount; frame++)
+				{
+					char suffix[32];
+					if (batchCamera.turntableFrames > 0)
+					{
+						snprintf(suffix, sizeof(suffix), "_%dx%d_%03d.png", width, height, frame);
+					}
+					else
+					{
+						snprintf(suffix, sizeof(suffix), "_%dx%d.png", width, height);
+					}
+
+					std::string filename = m_outputDirectory + "/" + sceneName + "_" + batchCamera.name + suffix;
+					RenderJob(batchCamera, frame, filename);
+					jobCount++;
+				}
+			}
+		}
+	}
+
+	m_frameCapture->Finish();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	int encodedCount = m_frameCapture->GetEncodedCount();
+	int failedCount = m_frameCapture->GetFailedCount();
+
+	std::cout << "INFO: batch rendered " << encodedCount << " of " << jobCount << " images"
+		<< ", failed:" << failedCount
+		<< ", skipped scenes:" << skippedScenes
+		<< ", seconds:" << seconds << std::endl;
+
+	return((skippedScenes == 0) && (failedCount == 0) && (encodedCount == jobCount));
+}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.h
+// ============
+// render a list of scenes, camera poses and resolutions into image files
+// without showing a window, as described by a job file
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+class SceneManager;
+class FrameCapture;
+
+/***********************************************************
+ *  BatchRenderer
+ *
+ *  This class contains the render farm mode.  A JSON job
+ *  file lists the scenes, the cameras and the resolutions,
+ *  and every combination is drawn into an offscreen target
+ *  and written as a PNG file.  The jobs are ordered by
+ *  scene and then by resolution, so the meshes, textures
+ *  and programs loaded once are reused by every job, the
+ *  scenes only swap what differs, and the targets are only
+ *  allocated again when the resolution changes.  A camera
+ *  can also orbit its target over a number of frames for
+ *  a turntable sequence.
+ ***********************************************************/
+class BatchRenderer
+{
+public:
+	// constructor
+	BatchRenderer(SceneManager* pSceneManager);
+	// destructor
+	~BatchRenderer();
+
+private:
+	// one camera pose of the job file
+	struct BATCH_CAMERA
+	{
+		std::string name;
+		glm::vec3 position;
+		glm::vec3 target;
+		glm::vec3 up;
+		// vertical field of view in degrees
+		float fieldOfView;
+		bool bOrthographic;
+		// height of the orthographic view in world units
+		float orthographicHeight;
+		// frames of a turntable orbit about the target, or zero
+		// for a single still image
+		int turntableFrames;
+	};
+
+	// one output size of the job file
+	struct BATCH_RESOLUTION
+	{
+		int width;
+		int height;
+	};
+
+	SceneManager* m_pSceneManager;
+	FrameCapture* m_frameCapture;
+
+	// contents of the job file
+	std::string m_outputDirectory;
+	std::vector<std::string> m_scenes;
+	std::vector<BATCH_CAMERA> m_cameras;
+	std::vector<BATCH_RESOLUTION> m_resolutions;
+
+	// offscreen target and its size
+	GLuint m_frameBuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	int m_width;
+	int m_height;
+
+	// allocate the target for the passed in size
+	bool CreateTarget(int width, int height);
+	// free the target
+	void DestroyTarget();
+	// draw one frame of a camera and queue it for writing
+	void RenderJob(const BATCH_CAMERA& camera, int frame, const std::string& filename);
+
+public:
+	// read the scenes, cameras and resolutions of a job file
+	bool LoadJobFile(const char* filename);
+	// render every job, true when every image was written
+	bool Run();
+};
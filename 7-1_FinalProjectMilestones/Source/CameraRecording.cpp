@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerarecording.cpp
+// ============
+// store the camera input of every tick, so a camera flight can be saved to
+// a file and replayed exactly
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraRecording.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// "CREC" at the start of a recording file
+	const uint32_t RECORDING_MAGIC = 0x43455243;
+	// raised whenever the layout of the file changes
+	const uint32_t RECORDING_VERSION = 1;
+
+	// header at the start of a recording file
+	struct RECORDING_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t inputCount;
+		float tickLength;
+	};
+}
+
+/***********************************************************
+ *  CameraRecording()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraRecording::CameraRecording()
+{
+	m_tickLength = 0.0f;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every recorded tick and
+ *  setting the tick length of the next recording.
+ ***********************************************************/
+void CameraRecording::Clear(float tickLength)
+{
+	m_tickLength = tickLength;
+	m_inputs.clear();
+}
+
+/***********************************************************
+ *  AddInput()
+ *
+ *  This method is used for adding the input of the next
+ *  tick to the recording.
+ ***********************************************************/
+void CameraRecording::AddInput(const CAMERA_INPUT& input)
+{
+	m_inputs.push_back(input);
+}
+
+/***********************************************************
+ *  GetInputCount()
+ *
+ *  This method is used for getting the number of recorded
+ *  ticks.
+ ***********************************************************/
+int CameraRecording::GetInputCount() const
+{
+	return((int)m_inputs.size());
+}
+
+/***********************************************************
+ *  GetInput()
+ *
+ *  This method is used for getting the input of one tick.
+ ***********************************************************/
+const CameraRecording::CAMERA_INPUT& CameraRecording::GetInput(int tick) const
+{
+	return(m_inputs[tick]);
+}
+
+/***********************************************************
+ *  GetTickLength()
+ *
+ *  This method is used for getting the length in seconds of
+ *  the ticks the input was recorded at.
+ ***********************************************************/
+float CameraRecording::GetTickLength() const
+{
+	return(m_tickLength);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading a recording file.  The
+ *  current recording is only replaced when the whole file
+ *  could be read.
+ ***********************************************************/
+bool CameraRecording::Load(const char* filename)
+{
+	std::ifstream recordingFile(filename, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!recordingFile.is_open())
+	{
+		std::cout << "Could not open camera recording:" << filename << std::endl;
+		return(false);
+	}
+	uint64_t fileLength = (uint64_t)recordingFile.tellg();
+	recordingFile.seekg(0, std::ios::beg);
+
+	RECORDING_HEADER header;
+	memset(&header, 0, sizeof(header));
+	recordingFile.read((char*)&header, sizeof(header));
+	if ((recordingFile.gcount() != sizeof(header)) ||
+		(header.magic != RECORDING_MAGIC) ||
+		(header.version != RECORDING_VERSION) ||
+		(header.tickLength <= 0.0f))
+	{
+		std::cout << "Could not read camera recording, unknown format:" << filename << std::endl;
+		return(false);
+	}
+
+	// the count is checked against the file before anything is
+	// allocated, so a damaged header cannot ask for huge buffers
+	uint64_t inputLength = (uint64_t)header.inputCount * sizeof(CAMERA_INPUT);
+	if (sizeof(header) + inputLength > fileLength)
+	{
+		std::cout << "Could not read camera recording, file is truncated:" << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<CAMERA_INPUT> inputs(header.inputCount);
+	if (header.inputCount > 0)
+	{
+		std::streamsize size = (std::streamsize)inputLength;
+		recordingFile.read((char*)&inputs[0], size);
+		if (recordingFile.gcount() != size)
+		{
+			std::cout << "Could not read camera recording, file is truncated:" << filename << std::endl;
+			return(false);
+		}
+	}
+
+	m_tickLength = header.tickLength;
+	m_inputs.swap(inputs);
+
+	std::cout << "INFO: loaded camera recording:" << filename << ", ticks:" << m_inputs.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the recording to a file.
+ ***********************************************************/
+bool CameraRecording::Save(const char* filename) const
+{
+	RECORDING_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = RECORDING_MAGIC;
+	header.version = RECORDING_VERSION;
+	header.inputCount = (uint32_t)m_inputs.size();
+	header.tickLength = m_tickLength;
+
+	std::ofstream recordingFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!recordingFile.is_open())
+	{
+		std::cout << "Could not write camera recording:" << filename << std::endl;
+		return(false);
+	}
+
+	recordingFile.write((const char*)&header, sizeof(header));
+	if (m_inputs.size() > 0)
+	{
+		recordingFile.write((const char*)&m_inputs[0], m_inputs.size() * sizeof(CAMERA_INPUT));
+	}
+	recordingFile.close();
+
+	if (recordingFile.fail() == true)
+	{
+		std::cout << "Could not write camera recording:" << filename << std::endl;
+		return(false);
+	}
+
+	std::cout << "INFO: wrote camera recording:" << filename << ", ticks:" << m_inputs.size() << std::endl;
+
+	return(true);
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerarecording.h
+// ============
+// store the camera input of every tick, so a camera flight can be saved to
+// a file and replayed exactly
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  CameraRecording
+ *
+ *  This class contains the input that moved the camera in
+ *  each fixed tick, rather than the camera positions.  The
+ *  camera step only depends on this input and the tick
+ *  length, so feeding the same input back from the same
+ *  start moves the camera along the same path on every
+ *  machine, whatever its frame rate.
+ ***********************************************************/
+class CameraRecording
+{
+public:
+	// constructor
+	CameraRecording();
+
+	// keys held during a tick, combined into CAMERA_INPUT.keys
+	enum INPUT_KEY
+	{
+		INPUT_FORWARD = 1,
+		INPUT_BACKWARD = 2,
+		INPUT_LEFT = 4,
+		INPUT_RIGHT = 8,
+		INPUT_DOWN = 16,
+		INPUT_UP = 32,
+		INPUT_PERSPECTIVE = 64,
+		INPUT_ORTHOGRAPHIC = 128
+	};
+
+	// input applied to the camera in one tick
+	struct CAMERA_INPUT
+	{
+		uint32_t keys;
+		// mouse movement and scrolling since the last tick
+		float mouseX;
+		float mouseY;
+		float scroll;
+	};
+	static_assert(sizeof(CAMERA_INPUT) == 16, "the recording file layout depends on this size");
+
+private:
+	// length of the ticks the input was recorded at, in seconds
+	float m_tickLength;
+	std::vector<CAMERA_INPUT> m_inputs;
+
+public:
+	// remove every tick and set the tick length of the recording
+	void Clear(float tickLength);
+	// add the input of the next tick
+	void AddInput(const CAMERA_INPUT& input);
+
+	int GetInputCount() const;
+	const CAMERA_INPUT& GetInput(int tick) const;
+	float GetTickLength() const;
+
+	// read and write the recording file
+	bool Load(const char* filename);
+	bool Save(const char* filename) const;
+};
@@ -0,0 +1,889 @@
+///////////////////////////////////////////////////////////////////////////////
+// cullingmanager.cpp
+// ============
+// manage the GPU frustum and occlusion culling of the scene objects
+// and the compacted indirect draw commands that it produces
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CullingManager.h"
+#include "ShaderLoader.h"
+#include "RenderStats.h"
+#include "TextureUnits.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	const char* g_CullShaderFile = "shaders/cullingCompute.glsl";
+	const char* g_PyramidShaderFile = "shaders/depthPyramidCompute.glsl";
+
+	// must match local_size_x in the culling compute shader
+	const GLuint CULL_GROUP_SIZE = 64;
+	// must match local_size_x/y in the depth pyramid compute shader
+	const GLuint PYRAMID_GROUP_SIZE = 8;
+
+	// shader storage binding points used by the culling pass
+	const GLuint OBJECT_BINDING = 0;
+	const GLuint COMMAND_BINDING = 1;
+	const GLuint COUNT_BINDING = 2;
+	const GLuint STATS_BINDING = 10;
+
+	// level of an object that has not been drawn yet, which takes
+	// the level of its size without any hysteresis
+	const GLuint LOD_LEVEL_UNKNOWN = 0xFFFFFFFFu;
+}
+
+/***********************************************************
+ *  CullingManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CullingManager::CullingManager()
+{
+	m_cullProgramID = 0;
+	m_pyramidProgramID = 0;
+	m_objectBuffer = 0;
+	m_commandBuffer = 0;
+	m_countBuffer = 0;
+	m_depthTexture = 0;
+	m_pyramidTexture = 0;
+	m_pyramidWidth = 0;
+	m_pyramidHeight = 0;
+	m_pyramidLevels = 0;
+	m_pyramidViewProjection = glm::mat4(1.0f);
+	m_bSupported = false;
+	m_bUseOcclusion = false;
+	m_lodView.view = glm::mat4(1.0f);
+	m_lodView.pixelScale = 0.0f;
+	m_lodView.hysteresis = 0.0f;
+	m_lodView.bOrthographic = false;
+	m_bLayoutDirty = false;
+	m_dirtyBegin = 0;
+	m_dirtyEnd = 0;
+	m_objectBufferCapacity = 0;
+	m_commandBufferCapacity = 0;
+	m_groupBufferCapacity = 0;
+	m_statsBuffer = 0;
+	m_statsReadBuffer = 0;
+	m_pMappedStats = NULL;
+	for (int i = 0; i < STATS_FRAMES; i++)
+	{
+		m_statsFences[i] = 0;
+		m_statsViewCounts[i] = 0;
+	}
+	m_statsFrame = 0;
+}
+
+/***********************************************************
+ *  ~CullingManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CullingManager::~CullingManager()
+{
+	DestroyDepthPyramid();
+
+	if (m_cullProgramID != 0)
+	{
+		glDeleteProgram(m_cullProgramID);
+		m_cullProgramID = 0;
+	}
+	if (m_pyramidProgramID != 0)
+	{
+		glDeleteProgram(m_pyramidProgramID);
+		m_pyramidProgramID = 0;
+	}
+	if (m_objectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_objectBuffer);
+		glDeleteBuffers(1, &m_commandBuffer);
+		glDeleteBuffers(1, &m_countBuffer);
+		m_objectBuffer = 0;
+		m_commandBuffer = 0;
+		m_countBuffer = 0;
+	}
+	for (int i = 0; i < STATS_FRAMES; i++)
+	{
+		if (m_statsFences[i] != 0)
+		{
+			glDeleteSync(m_statsFences[i]);
+			m_statsFences[i] = 0;
+		}
+	}
+	if (m_statsReadBuffer != 0)
+	{
+		if (NULL != m_pMappedStats)
+		{
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_statsReadBuffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			m_pMappedStats = NULL;
+		}
+		glDeleteBuffers(1, &m_statsReadBuffer);
+		m_statsReadBuffer = 0;
+	}
+	if (m_statsBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_statsBuffer);
+		m_statsBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for checking that the context can
+ *  run the culling pass, then loading the compute programs
+ *  and creating the GPU buffers.  False is returned when
+ *  the caller needs to fall back to direct draw calls.
+ ***********************************************************/
+bool CullingManager::Initialize()
+{
+	// compute shaders and glMultiDrawElementsIndirectCount()
+	// both need the OpenGL 4.6 context requested on startup
+	if (!GLEW_VERSION_4_6)
+	{
+		std::cout << "INFO: GPU culling disabled, OpenGL 4.6 is not available" << std::endl;
+		return(false);
+	}
+
+	m_cullProgramID = ShaderLoader::LoadComputeProgram(g_CullShaderFile);
+	m_pyramidProgramID = ShaderLoader::LoadComputeProgram(g_PyramidShaderFile);
+	if ((m_cullProgramID == 0) || (m_pyramidProgramID == 0))
+	{
+		std::cout << "INFO: GPU culling disabled, compute programs failed to load" << std::endl;
+		return(false);
+	}
+
+	glGenBuffers(1, &m_objectBuffer);
+	glGenBuffers(1, &m_commandBuffer);
+	glGenBuffers(1, &m_countBuffer);
+
+	// the triangles of the kept commands are read back a few
+	// frames later, so counting them never waits for the GPU
+	glGenBuffers(1, &m_statsBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &m_statsReadBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_statsReadBuffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, STATS_FRAMES * sizeof(GLuint), NULL, flags);
+	m_pMappedStats = (const GLuint*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, STATS_FRAMES * sizeof(GLuint), flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	if (NULL == m_pMappedStats)
+	{
+		std::cout << "INFO: triangle count buffer could not be mapped, the culled draws are not counted" << std::endl;
+	}
+
+	m_bSupported = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the culling
+ *  pass was successfully initialized.
+ ***********************************************************/
+bool CullingManager::IsSupported() const
+{
+	return(m_bSupported);
+}
+
+/***********************************************************
+ *  CreateDrawGroup()
+ *
+ *  This method is used for adding a draw group.  All of the
+ *  objects in a group are drawn with a single indirect call,
+ *  so they must share the same shader state.
+ ***********************************************************/
+int CullingManager::CreateDrawGroup()
+{
+	m_groupCapacity.push_back(0);
+	m_groupOffset.push_back(0);
+	m_bLayoutDirty = true;
+
+	return((int)m_groupCapacity.size() - 1);
+}
+
+/***********************************************************
+ *  SetObjectLevels()
+ *
+ *  This method is used for filling the levels of detail of
+ *  an object.  Every level must belong to an existing draw
+ *  group, and a level without indices ends the list.
+ ***********************************************************/
+bool CullingManager::SetObjectLevels(CULL_OBJECT& object, const DRAW_LEVEL* pLevels, int levelCount)
+{
+	if ((levelCount < 0) || (levelCount > MAX_DRAW_LEVELS) ||
+		((levelCount > 0) && (NULL == pLevels)))
+	{
+		return(false);
+	}
+
+	object.levelCount = 0;
+	for (int i = 0; i < MAX_DRAW_LEVELS; i++)
+	{
+		object.indexCounts[i] = 0;
+		object.firstIndices[i] = 0;
+		object.baseVertices[i] = 0;
+		object.minScreenSizes[i] = 0.0f;
+		object.drawGroups[i] = 0;
+		object.commandOffsets[i] = 0;
+	}
+
+	for (int i = 0; i < levelCount; i++)
+	{
+		const DRAW_LEVEL& level = pLevels[i];
+		if ((level.drawGroup < 0) || (level.drawGroup >= (int)m_groupCapacity.size()))
+		{
+			return(false);
+		}
+		if (level.indexCount == 0)
+		{
+			break;
+		}
+
+		object.indexCounts[i] = level.indexCount;
+		object.firstIndices[i] = level.firstIndex;
+		object.baseVertices[i] = level.baseVertex;
+		object.minScreenSizes[i] = level.minScreenSize;
+		object.drawGroups[i] = (GLuint)level.drawGroup;
+		object.levelCount++;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReserveCommandSlots()
+ *
+ *  This method is used for adding or removing the command
+ *  slots of an object.  An object is drawn at one level at
+ *  a time, so it needs one slot in each group that any of
+ *  its levels belongs to, which is taken by the first level
+ *  in that group.
+ ***********************************************************/
+void CullingManager::ReserveCommandSlots(const CULL_OBJECT& object, int change)
+{
+	for (GLuint i = 0; i < object.levelCount; i++)
+	{
+		bool bCounted = false;
+		for (GLuint j = 0; (j < i) && (bCounted == false); j++)
+		{
+			bCounted = (object.drawGroups[j] == object.drawGroups[i]);
+		}
+		if (bCounted == false)
+		{
+			m_groupCapacity[object.drawGroups[i]] += change;
+		}
+	}
+	m_bLayoutDirty = true;
+}
+
+/***********************************************************
+ *  MarkObjectsDirty()
+ *
+ *  This method is used for growing the range of objects
+ *  that is uploaded before the next culling pass.
+ ***********************************************************/
+void CullingManager::MarkObjectsDirty(int begin, int end)
+{
+	if (m_dirtyBegin >= m_dirtyEnd)
+	{
+		m_dirtyBegin = begin;
+		m_dirtyEnd = end;
+	}
+	else
+	{
+		m_dirtyBegin = std::min(m_dirtyBegin, begin);
+		m_dirtyEnd = std::max(m_dirtyEnd, end);
+	}
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding an object with the bounds
+ *  of its mesh, which the culling pass moves by the world
+ *  matrix of the object.  The returned index is passed to
+ *  the shaders as the base instance of the object's command.
+ ***********************************************************/
+int CullingManager::AddObject(
+	const DRAW_LEVEL* pLevels,
+	int levelCount,
+	glm::vec3 center,
+	float radius)
+{
+	CULL_OBJECT object;
+	if (SetObjectLevels(object, pLevels, levelCount) == false)
+	{
+		return(-1);
+	}
+	object.boundingSphere = glm::vec4(center, radius);
+	object.lodLevel = LOD_LEVEL_UNKNOWN;
+	object.padding[0] = 0;
+	object.padding[1] = 0;
+
+	m_objects.push_back(object);
+	ReserveCommandSlots(object, 1);
+
+	int objectIndex = (int)m_objects.size() - 1;
+	MarkObjectsDirty(objectIndex, objectIndex + 1);
+
+	return(objectIndex);
+}
+
+/***********************************************************
+ *  SetObjectDraw()
+ *
+ *  This method is used for replacing the levels and the
+ *  bounds of an object, such as when its mesh or its
+ *  texture changed.  Only this object is uploaded again,
+ *  unless it moved to other draw groups, and nothing is
+ *  uploaded when it did not change.
+ ***********************************************************/
+void CullingManager::SetObjectDraw(
+	int objectIndex,
+	const DRAW_LEVEL* pLevels,
+	int levelCount,
+	glm::vec3 center,
+	float radius)
+{
+	if ((objectIndex < 0) || (objectIndex >= (int)m_objects.size()))
+	{
+		return;
+	}
+
+	CULL_OBJECT object;
+	if (SetObjectLevels(object, pLevels, levelCount) == false)
+	{
+		return;
+	}
+	object.boundingSphere = glm::vec4(center, radius);
+	object.lodLevel = LOD_LEVEL_UNKNOWN;
+	object.padding[0] = 0;
+	object.padding[1] = 0;
+
+	CULL_OBJECT& current = m_objects[objectIndex];
+	bool bSameGroups = (current.levelCount == object.levelCount);
+	for (GLuint i = 0; (i < object.levelCount) && (bSameGroups == true); i++)
+	{
+		bSameGroups = (current.drawGroups[i] == object.drawGroups[i]);
+	}
+
+	bool bSameDraw = (bSameGroups == true) && (current.boundingSphere == object.boundingSphere);
+	for (GLuint i = 0; (i < object.levelCount) && (bSameDraw == true); i++)
+	{
+		bSameDraw = (current.indexCounts[i] == object.indexCounts[i]) &&
+			(current.firstIndices[i] == object.firstIndices[i]) &&
+			(current.baseVertices[i] == object.baseVertices[i]) &&
+			(current.minScreenSizes[i] == object.minScreenSizes[i]);
+	}
+	if (bSameDraw == true)
+	{
+		return;
+	}
+
+	if (bSameGroups == true)
+	{
+		// the command slots stay where they are
+		for (GLuint i = 0; i < object.levelCount; i++)
+		{
+			object.commandOffsets[i] = current.commandOffsets[i];
+		}
+	}
+	else
+	{
+		ReserveCommandSlots(current, -1);
+		ReserveCommandSlots(object, 1);
+	}
+
+	current = object;
+	MarkObjectsDirty(objectIndex, objectIndex + 1);
+}
+
+/***********************************************************
+ *  ClearObjects()
+ *
+ *  This method is used for removing all of the objects and
+ *  draw groups from the culling pass.
+ ***********************************************************/
+void CullingManager::ClearObjects()
+{
+	m_objects.clear();
+	m_groupCapacity.clear();
+	m_groupOffset.clear();
+	m_bLayoutDirty = true;
+	m_dirtyBegin = 0;
+	m_dirtyEnd = 0;
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects
+ *  tested by the culling pass.
+ ***********************************************************/
+int CullingManager::GetObjectCount() const
+{
+	return((int)m_objects.size());
+}
+
+/***********************************************************
+ *  GetGroupObjectCount()
+ *
+ *  This method is used for getting the number of command
+ *  slots of a draw group, so empty groups are skipped.
+ ***********************************************************/
+int CullingManager::GetGroupObjectCount(int drawGroup) const
+{
+	if ((drawGroup < 0) || (drawGroup >= (int)m_groupCapacity.size()))
+	{
+		return(0);
+	}
+
+	return((int)m_groupCapacity[drawGroup]);
+}
+
+/***********************************************************
+ *  SetLodView()
+ *
+ *  This method is used for setting the view of the current
+ *  frame that the culling pass picks the levels of detail
+ *  against, the same way the LOD selector does.
+ ***********************************************************/
+void CullingManager::SetLodView(const LOD_VIEW& lodView)
+{
+	m_lodView = lodView;
+}
+
+/***********************************************************
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for enabling the occlusion test
+ *  against the depth pyramid of the previous frame.
+ ***********************************************************/
+void CullingManager::SetOcclusionCulling(bool bEnable)
+{
+	m_bUseOcclusion = bEnable;
+}
+
+/***********************************************************
+ *  UploadObjects()
+ *
+ *  This method is used for uploading the objects that were
+ *  added or changed since the last culling pass.  When the
+ *  draw groups changed size, their command slots are laid
+ *  out back to back again, which moves every object.  The
+ *  buffers are only reallocated when they need to grow,
+ *  which also uploads every object.
+ ***********************************************************/
+void CullingManager::UploadObjects()
+{
+	GLuint objectCount = (GLuint)m_objects.size();
+	GLuint groupCount = (GLuint)m_groupCapacity.size();
+
+	if (m_bLayoutDirty == true)
+	{
+		GLuint commandOffset = 0;
+		for (size_t i = 0; i < m_groupCapacity.size(); i++)
+		{
+			m_groupOffset[i] = commandOffset;
+			commandOffset += m_groupCapacity[i];
+		}
+
+		// the pass appends the visible objects of a group after its
+		// first slot, so every level starts at the offset of its group
+		for (size_t i = 0; i < m_objects.size(); i++)
+		{
+			CULL_OBJECT& object = m_objects[i];
+			for (GLuint level = 0; level < object.levelCount; level++)
+			{
+				object.commandOffsets[level] = m_groupOffset[object.drawGroups[level]];
+			}
+		}
+
+		if (commandOffset > m_commandBufferCapacity)
+		{
+			m_commandBufferCapacity = commandOffset;
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, commandOffset * sizeof(DRAW_COMMAND), NULL, GL_DYNAMIC_COPY);
+		}
+		if (groupCount > m_groupBufferCapacity)
+		{
+			m_groupBufferCapacity = groupCount;
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, groupCount * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+		}
+
+		MarkObjectsDirty(0, (int)objectCount);
+		m_bLayoutDirty = false;
+	}
+
+	if (objectCount > m_objectBufferCapacity)
+	{
+		m_objectBufferCapacity = objectCount;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, objectCount * sizeof(CULL_OBJECT), NULL, GL_DYNAMIC_DRAW);
+		MarkObjectsDirty(0, (int)objectCount);
+	}
+
+	// the levels the pass picked are lost for the uploaded objects,
+	// which pick their level again without hysteresis
+	int dirtyEnd = std::min(m_dirtyEnd, (int)objectCount);
+	if (m_dirtyBegin < dirtyEnd)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+			m_dirtyBegin * sizeof(CULL_OBJECT),
+			(dirtyEnd - m_dirtyBegin) * sizeof(CULL_OBJECT),
+			&m_objects[m_dirtyBegin]);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_dirtyBegin = 0;
+	m_dirtyEnd = 0;
+}
+
+/***********************************************************
+ *  ReadTriangleCount()
+ *
+ *  This method is used for counting the triangles of the
+ *  commands kept by an earlier culling pass, once the GPU
+ *  has copied them.  A copy that is not done yet is left
+ *  for the next frame, so the count never waits on the GPU
+ *  and is a few frames late.
+ ***********************************************************/
+void CullingManager::ReadTriangleCount()
+{
+	GLsync fence = m_statsFences[m_statsFrame];
+	if ((NULL == m_pMappedStats) || (fence == 0))
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+	{
+		return;
+	}
+	glDeleteSync(fence);
+	m_statsFences[m_statsFrame] = 0;
+
+	// every command is drawn into each of the views, either as
+	// instances or once per view
+	RenderStats::CountTriangles((int)m_pMappedStats[m_statsFrame] * m_statsViewCounts[m_statsFrame]);
+}
+
+/***********************************************************
+ *  CopyTriangleCount()
+ *
+ *  This method is used for copying the triangle count of
+ *  the culling pass into the next mapped copy, which is
+ *  skipped while that copy is still being read back.
+ ***********************************************************/
+void CullingManager::CopyTriangleCount(int viewCount)
+{
+	if ((NULL == m_pMappedStats) || (m_statsFences[m_statsFrame] != 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, m_statsBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_statsReadBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, m_statsFrame * sizeof(GLuint), sizeof(GLuint));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	m_statsFences[m_statsFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_statsViewCounts[m_statsFrame] = viewCount;
+	m_statsFrame = (m_statsFrame + 1) % STATS_FRAMES;
+}
+
+/***********************************************************
+ *  CullObjects()
+ *
+ *  This method is used for testing every object against the
+ *  frustum of each view, and optionally the depth pyramid,
+ *  on the GPU.  An object inside any of the views is
+ *  appended to the command range of its draw group, with
+ *  one instance per view that a draw fills at once, and
+ *  the group's draw count is bumped.  The depth pyramid
+ *  only covers the camera, so the occlusion test is only
+ *  used while there is a single view.
+ ***********************************************************/
+void CullingManager::CullObjects(const glm::mat4* pViewProjections, int viewCount, GLuint instanceCount)
+{
+	if ((m_bSupported == false) || (m_groupCapacity.size() == 0) ||
+		(NULL == pViewProjections) || (viewCount <= 0))
+	{
+		return;
+	}
+
+	if ((m_bLayoutDirty == true) || (m_dirtyBegin < m_dirtyEnd))
+	{
+		UploadObjects();
+	}
+
+	// the copy about to be written is counted first, when it is done
+	ReadTriangleCount();
+
+	// the planes are taken from the rows of each view projection
+	// matrix and normalized so the sphere radius can be compared
+	viewCount = std::min(viewCount, MAX_SCENE_VIEWS);
+	glm::vec4 frustumPlanes[MAX_SCENE_VIEWS * 6];
+	for (int view = 0; view < viewCount; view++)
+	{
+		const glm::mat4& viewProjection = pViewProjections[view];
+		glm::vec4* pPlanes = &frustumPlanes[view * 6];
+		glm::vec4 lastRow = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		for (int i = 0; i < 3; i++)
+		{
+			glm::vec4 row = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+			pPlanes[i * 2] = lastRow + row;
+			pPlanes[i * 2 + 1] = lastRow - row;
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			float length = glm::length(glm::vec3(pPlanes[i]));
+			pPlanes[i] = pPlanes[i] / length;
+		}
+	}
+
+	// the pyramid of a single view would hide what only the
+	// other views see, so it is captured again once they are gone
+	if (viewCount > 1)
+	{
+		DestroyDepthPyramid();
+	}
+
+	// reset the draw count of every group and the triangle count to zero
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the scene program is restored once the pass is dispatched
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_cullProgramID);
+
+	GLuint objectCount = (GLuint)m_objects.size();
+	bool bUseOcclusion = (m_bUseOcclusion == true) && (m_pyramidTexture != 0);
+
+	glUniform1ui(glGetUniformLocation(m_cullProgramID, "objectCount"), objectCount);
+	glUniform1i(glGetUniformLocation(m_cullProgramID, "viewCount"), viewCount);
+	glUniform1ui(glGetUniformLocation(m_cullProgramID, "instanceCount"), instanceCount);
+	glUniform4fv(glGetUniformLocation(m_cullProgramID, "frustumPlanes"), viewCount * 6, glm::value_ptr(frustumPlanes[0]));
+	glUniformMatrix4fv(glGetUniformLocation(m_cullProgramID, "lodView"), 1, GL_FALSE, glm::value_ptr(m_lodView.view));
+	glUniform1f(glGetUniformLocation(m_cullProgramID, "lodPixelScale"), m_lodView.pixelScale);
+	glUniform1f(glGetUniformLocation(m_cullProgramID, "lodHysteresis"), m_lodView.hysteresis);
+	glUniform1i(glGetUniformLocation(m_cullProgramID, "bLodOrthographic"), m_lodView.bOrthographic);
+	glUniform1i(glGetUniformLocation(m_cullProgramID, "bUseOcclusion"), bUseOcclusion);
+	if (bUseOcclusion == true)
+	{
+		glActiveTexture(GL_TEXTURE0 + PYRAMID_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+		RenderStats::CountTextureBinds(1);
+		glUniform1i(glGetUniformLocation(m_cullProgramID, "depthPyramid"), PYRAMID_TEXTURE_UNIT);
+		glUniformMatrix4fv(glGetUniformLocation(m_cullProgramID, "pyramidViewProjection"), 1, GL_FALSE, glm::value_ptr(m_pyramidViewProjection));
+		glUniform2f(glGetUniformLocation(m_cullProgramID, "pyramidSize"), (float)m_pyramidWidth, (float)m_pyramidHeight);
+		glUniform1i(glGetUniformLocation(m_cullProgramID, "pyramidLevels"), m_pyramidLevels);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, m_countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STATS_BINDING, m_statsBuffer);
+
+	glDispatchCompute((objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// the commands and counts are consumed as indirect parameters,
+	// and the triangle count is copied for the stats
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	CopyTriangleCount(viewCount);
+
+	// the pyramid is unbound, so no other pass samples it by accident
+	if (bUseOcclusion == true)
+	{
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  DrawGroup()
+ *
+ *  This method is used for drawing the visible objects of a
+ *  draw group with the currently bound VAO and program.  The
+ *  draw count is read on the GPU, so nothing is read back.
+ ***********************************************************/
+void CullingManager::DrawGroup(int drawGroup, GLenum indexType)
+{
+	if ((m_bSupported == false) || (drawGroup < 0) ||
+		(drawGroup >= (int)m_groupCapacity.size()) ||
+		(m_groupCapacity[drawGroup] == 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBindBuffer(GL_PARAMETER_BUFFER, m_countBuffer);
+
+	glMultiDrawElementsIndirectCount(
+		GL_TRIANGLES,
+		indexType,
+		(const void*)(m_groupOffset[drawGroup] * sizeof(DRAW_COMMAND)),
+		(GLintptr)(drawGroup * sizeof(GLuint)),
+		(GLsizei)m_groupCapacity[drawGroup],
+		sizeof(DRAW_COMMAND));
+	// the triangles of the kept draws are counted when the
+	// culling pass is read back
+	RenderStats::CountDraw(0);
+
+	glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  CreateDepthPyramid()
+ *
+ *  This method is used for allocating the depth copy and the
+ *  full mip chain of the depth pyramid.
+ ***********************************************************/
+void CullingManager::CreateDepthPyramid(int width, int height)
+{
+	DestroyDepthPyramid();
+
+	m_pyramidWidth = width;
+	m_pyramidHeight = height;
+	m_pyramidLevels = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// nearest filtering keeps the max depth of each texel exact
+	glGenTextures(1, &m_pyramidTexture);
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  DestroyDepthPyramid()
+ *
+ *  This method is used for freeing the depth pyramid.
+ ***********************************************************/
+void CullingManager::DestroyDepthPyramid()
+{
+	if (m_depthTexture != 0)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	if (m_pyramidTexture != 0)
+	{
+		glDeleteTextures(1, &m_pyramidTexture);
+		m_pyramidTexture = 0;
+	}
+	m_pyramidWidth = 0;
+	m_pyramidHeight = 0;
+	m_pyramidLevels = 0;
+}
+
+/***********************************************************
+ *  UpdateDepthPyramid()
+ *
+ *  This method is used for copying the depth buffer of the
+ *  finished frame and reducing it into a max-depth mip chain.
+ *  The next frame's occlusion test reads this pyramid with
+ *  the view projection that is passed in here.
+ ***********************************************************/
+void CullingManager::UpdateDepthPyramid(int width, int height, const glm::mat4& viewProjection)
+{
+	if ((m_bSupported == false) || (m_bUseOcclusion == false) ||
+		(width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	// the scene textures stay bound on the lower units, so the
+	// pyramid only ever binds its textures on its own unit
+	glActiveTexture(GL_TEXTURE0 + PYRAMID_TEXTURE_UNIT);
+
+	if ((width != m_pyramidWidth) || (height != m_pyramidHeight))
+	{
+		CreateDepthPyramid(width, height);
+	}
+
+	// copy the depth of the current read framebuffer, the copy
+	// stays bound for the first level of the pyramid
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	RenderStats::CountTextureBinds(1);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_pyramidProgramID);
+
+	glUniform1i(glGetUniformLocation(m_pyramidProgramID, "depthTexture"), PYRAMID_TEXTURE_UNIT);
+
+	GLint copyLocation = glGetUniformLocation(m_pyramidProgramID, "bCopyDepth");
+	GLint sourceSizeLocation = glGetUniformLocation(m_pyramidProgramID, "sourceSize");
+	GLint destinationSizeLocation = glGetUniformLocation(m_pyramidProgramID, "destinationSize");
+
+	int levelWidth = width;
+	int levelHeight = height;
+	for (int level = 0; level < m_pyramidLevels; level++)
+	{
+		int sourceWidth = levelWidth;
+		int sourceHeight = levelHeight;
+		if (level > 0)
+		{
+			levelWidth = std::max(1, levelWidth / 2);
+			levelHeight = std::max(1, levelHeight / 2);
+			glBindImageTexture(1, m_pyramidTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		}
+		glBindImageTexture(0, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		glUniform1i(copyLocation, (level == 0));
+		glUniform2i(sourceSizeLocation, sourceWidth, sourceHeight);
+		glUniform2i(destinationSizeLocation, levelWidth, levelHeight);
+
+		glDispatchCompute(
+			(levelWidth + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+			(levelHeight + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+			1);
+
+		// the next level reads what this level has written
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+
+	// the depth copy and the levels are unbound once they are built
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram((GLuint)previousProgram);
+
+	m_pyramidViewProjection = viewProjection;
+}
@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// cullingmanager.h
+// ============
+// manage the GPU frustum and occlusion culling of the scene objects
+// and the compacted indirect draw commands that it produces
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include "SceneView.h"
+
+#include <vector>
+
+/***********************************************************
+ *  CullingManager
+ *
+ *  This class contains the code for culling the scene
+ *  objects in a compute pass and writing the visible ones
+ *  into an indirect command buffer, together with a draw
+ *  count for glMultiDrawElementsIndirectCount().  The
+ *  objects stay in a GPU buffer between frames, and only
+ *  the entries that changed are uploaded again.  The pass
+ *  moves the bounds of each object by its world matrix in
+ *  the transform buffer and picks its level of detail, so
+ *  the CPU does no work per object each frame.  The index
+ *  of an object is passed to the shaders as the base
+ *  instance of its command, so it must match the index of
+ *  its world matrix and its shader values.
+ ***********************************************************/
+class CullingManager
+{
+public:
+	// constructor
+	CullingManager();
+	// destructor
+	~CullingManager();
+
+	// most levels of detail that one object can hold
+	static const int MAX_DRAW_LEVELS = 4;
+	// frames the triangle counts of the pass are read back after
+	static const int STATS_FRAMES = 3;
+
+	// layout of one indirect command for glMultiDrawElementsIndirect
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// one level of detail of an object, from the finest to the
+	// coarsest, with the smallest projected diameter in pixels
+	// where the level is still used
+	struct DRAW_LEVEL
+	{
+		int drawGroup;
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		float minScreenSize;
+	};
+
+	// view that the levels of detail are chosen against
+	struct LOD_VIEW
+	{
+		glm::mat4 view;
+		// pixels per unit of size at a distance of one unit
+		float pixelScale;
+		// fraction that a size must pass a threshold by to switch
+		float hysteresis;
+		bool bOrthographic;
+	};
+
+	// per-object data read by the culling pass - this must
+	// match the std430 layout of CullObject in the compute shader
+	struct CULL_OBJECT
+	{
+		// bounds in the space of the mesh
+		glm::vec4 boundingSphere;
+		GLuint indexCounts[MAX_DRAW_LEVELS];
+		GLuint firstIndices[MAX_DRAW_LEVELS];
+		GLint baseVertices[MAX_DRAW_LEVELS];
+		float minScreenSizes[MAX_DRAW_LEVELS];
+		GLuint drawGroups[MAX_DRAW_LEVELS];
+		GLuint commandOffsets[MAX_DRAW_LEVELS];
+		// zero for an object that draws nothing
+		GLuint levelCount;
+		// level drawn last time, kept by the pass for its hysteresis
+		GLuint lodLevel;
+		GLuint padding[2];
+	};
+
+private:
+	// compute program for the frustum and occlusion tests
+	GLuint m_cullProgramID;
+	// compute program for building the depth pyramid
+	GLuint m_pyramidProgramID;
+	// buffer holding the CULL_OBJECT entries
+	GLuint m_objectBuffer;
+	// buffer receiving the compacted DRAW_COMMAND entries
+	GLuint m_commandBuffer;
+	// buffer receiving one draw count per draw group
+	GLuint m_countBuffer;
+	// buffer counting the triangles of the commands, and the
+	// persistently mapped copies of it read back by the stats
+	GLuint m_statsBuffer;
+	GLuint m_statsReadBuffer;
+	const GLuint* m_pMappedStats;
+	// fence of each copy, and the views its commands were drawn to
+	GLsync m_statsFences[STATS_FRAMES];
+	int m_statsViewCounts[STATS_FRAMES];
+	// copy written by the next culling pass
+	int m_statsFrame;
+	// copy of the depth buffer used to seed the pyramid
+	GLuint m_depthTexture;
+	// max-depth mip chain used for the occlusion test
+	GLuint m_pyramidTexture;
+	// size of the depth pyramid base level
+	int m_pyramidWidth;
+	int m_pyramidHeight;
+	int m_pyramidLevels;
+	// view projection the depth pyramid was captured with
+	glm::mat4 m_pyramidViewProjection;
+	// view the levels of detail are chosen against
+	LOD_VIEW m_lodView;
+	// true when the context supports the culling pass
+	bool m_bSupported;
+	// true when the occlusion test should be applied
+	bool m_bUseOcclusion;
+	// true when the command slots of the groups must be laid out again
+	bool m_bLayoutDirty;
+	// range of objects that must be uploaded again, empty when
+	// the first one is not below the last one
+	int m_dirtyBegin;
+	int m_dirtyEnd;
+	// CPU copy of the objects tested by the culling pass
+	std::vector<CULL_OBJECT> m_objects;
+	// number of command slots and first command slot per draw group
+	std::vector<GLuint> m_groupCapacity;
+	std::vector<GLuint> m_groupOffset;
+	// allocated sizes of the GPU buffers in elements
+	GLuint m_objectBufferCapacity;
+	GLuint m_commandBufferCapacity;
+	GLuint m_groupBufferCapacity;
+
+	// fill an object from its levels, false when they are not valid
+	bool SetObjectLevels(CULL_OBJECT& object, const DRAW_LEVEL* pLevels, int levelCount);
+	// add or remove the command slots that an object reserves
+	void ReserveCommandSlots(const CULL_OBJECT& object, int change);
+	// mark a range of objects to be uploaded again
+	void MarkObjectsDirty(int begin, int end);
+	// lay out the command slots and upload the changed objects
+	void UploadObjects();
+	// count the triangles of an earlier pass once the GPU is done
+	void ReadTriangleCount();
+	// copy the triangle count of this pass for a later frame
+	void CopyTriangleCount(int viewCount);
+	// allocate the depth pyramid textures for the passed in size
+	void CreateDepthPyramid(int width, int height);
+	// free the depth pyramid textures
+	void DestroyDepthPyramid();
+
+public:
+	// create the compute programs and the GPU buffers
+	bool Initialize();
+	// true when GPU culling can be used on this context
+	bool IsSupported() const;
+
+	// add a group of objects that are drawn with the same state
+	int CreateDrawGroup();
+	// add an object with the bounds of its mesh and its levels of
+	// detail, an object without levels draws nothing
+	int AddObject(
+		const DRAW_LEVEL* pLevels,
+		int levelCount,
+		glm::vec3 center,
+		float radius);
+	// replace the levels and the bounds of a previously added object
+	void SetObjectDraw(
+		int objectIndex,
+		const DRAW_LEVEL* pLevels,
+		int levelCount,
+		glm::vec3 center,
+		float radius);
+	// remove all the objects and draw groups
+	void ClearObjects();
+	// get the number of objects tested by the culling pass
+	int GetObjectCount() const;
+	// get the number of command slots of a draw group
+	int GetGroupObjectCount(int drawGroup) const;
+
+	// set the view that the levels of detail are chosen against
+	void SetLodView(const LOD_VIEW& lodView);
+	// enable or disable the depth pyramid occlusion test
+	void SetOcclusionCulling(bool bEnable);
+	// capture the current depth buffer into the depth pyramid
+	void UpdateDepthPyramid(int width, int height, const glm::mat4& viewProjection);
+
+	// run the culling pass for the passed in views and write the
+	// compacted commands, each drawing the passed in instances,
+	// with the world matrices bound to the transform binding
+	void CullObjects(const glm::mat4* pViewProjections, int viewCount, GLuint instanceCount);
+	// draw the visible objects of a draw group with the bound VAO
+	void DrawGroup(int drawGroup, GLenum indexType);
+};
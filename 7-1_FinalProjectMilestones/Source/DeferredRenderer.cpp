@@ -0,0 +1,366 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.cpp
+// ============
+// manage the G-buffer and the full-screen lighting pass of the deferred
+// shading render path
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DeferredRenderer.h"
+#include "ShaderLoader.h"
+#include "RenderStats.h"
+#include "TextureUnits.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	const char* g_FullscreenVertexFile = "shaders/fullscreenVertex.glsl";
+	const char* g_LightingFragmentFile = "shaders/deferredLighting.glsl";
+
+	// shader storage binding point of the material table
+	const GLuint MATERIAL_BINDING = 6;
+}
+
+/***********************************************************
+ *  DeferredRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DeferredRenderer::DeferredRenderer()
+{
+	m_lightingProgramID = 0;
+	m_frameBuffer = 0;
+	m_albedoTexture = 0;
+	m_normalTexture = 0;
+	m_materialTexture = 0;
+	m_depthTexture = 0;
+	m_emptyVertexArray = 0;
+	m_materialBuffer = 0;
+	m_materialCount = 0;
+	m_width = 0;
+	m_height = 0;
+	m_targetFrameBuffer = 0;
+	m_viewportWidth = 0;
+	m_viewportHeight = 0;
+}
+
+/***********************************************************
+ *  ~DeferredRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DeferredRenderer::~DeferredRenderer()
+{
+	DestroyGBuffer();
+
+	if (m_lightingProgramID != 0)
+	{
+		glDeleteProgram(m_lightingProgramID);
+		m_lightingProgramID = 0;
+	}
+	if (m_emptyVertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArray);
+		m_emptyVertexArray = 0;
+	}
+	if (m_materialBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the lighting program and
+ *  creating the G-buffer.  False is returned when the caller
+ *  needs to fall back to the forward render path.
+ ***********************************************************/
+bool DeferredRenderer::Initialize(int width, int height)
+{
+	m_lightingProgramID = ShaderLoader::LoadProgram(g_FullscreenVertexFile, g_LightingFragmentFile);
+	if (m_lightingProgramID == 0)
+	{
+		std::cout << "INFO: deferred shading disabled, lighting program failed to load" << std::endl;
+		return(false);
+	}
+
+	if (CreateGBuffer(width, height) == false)
+	{
+		std::cout << "INFO: deferred shading disabled, G-buffer is not complete" << std::endl;
+		return(false);
+	}
+
+	glGenVertexArrays(1, &m_emptyVertexArray);
+	glGenBuffers(1, &m_materialBuffer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateGBuffer()
+ *
+ *  This method is used for allocating the G-buffer.  The
+ *  depth uses the same format as the default framebuffer so
+ *  it can be blitted across after the lighting pass.
+ ***********************************************************/
+bool DeferredRenderer::CreateGBuffer(int width, int height)
+{
+	DestroyGBuffer();
+
+	m_width = width;
+	m_height = height;
+
+	glGenFramebuffers(1, &m_frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+
+	// albedo and the alpha of the surface
+	glGenTextures(1, &m_albedoTexture);
+	glBindTexture(GL_TEXTURE_2D, m_albedoTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoTexture, 0);
+
+	// world space normal and the lighting flag
+	glGenTextures(1, &m_normalTexture);
+	glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normalTexture, 0);
+
+	// index into the material table
+	glGenTextures(1, &m_materialTexture);
+	glBindTexture(GL_TEXTURE_2D, m_materialTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16UI, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_materialTexture, 0);
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	GLenum drawBuffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	glDrawBuffers(3, drawBuffers);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return(bComplete);
+}
+
+/***********************************************************
+ *  DestroyGBuffer()
+ *
+ *  This method is used for freeing the G-buffer.
+ ***********************************************************/
+void DeferredRenderer::DestroyGBuffer()
+{
+	if (m_frameBuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_frameBuffer);
+		m_frameBuffer = 0;
+	}
+	if (m_albedoTexture != 0)
+	{
+		glDeleteTextures(1, &m_albedoTexture);
+		glDeleteTextures(1, &m_normalTexture);
+		glDeleteTextures(1, &m_materialTexture);
+		glDeleteTextures(1, &m_depthTexture);
+		m_albedoTexture = 0;
+		m_normalTexture = 0;
+		m_materialTexture = 0;
+		m_depthTexture = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for reallocating the G-buffer when
+ *  the size of the window has changed.
+ ***********************************************************/
+void DeferredRenderer::Resize(int width, int height)
+{
+	if ((m_frameBuffer == 0) || (width <= 0) || (height <= 0) ||
+		((width == m_width) && (height == m_height)))
+	{
+		return;
+	}
+
+	CreateGBuffer(width, height);
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method is used for uploading the material table.
+ *  The position of a material in the table is the ID that
+ *  the geometry pass writes into the G-buffer.
+ ***********************************************************/
+void DeferredRenderer::SetMaterials(const std::vector<MATERIAL_ENTRY>& materials)
+{
+	if ((m_materialBuffer == 0) || (materials.size() == 0))
+	{
+		return;
+	}
+
+	m_materialCount = (GLuint)materials.size();
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(MATERIAL_ENTRY), &materials[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for binding and clearing the
+ *  G-buffer, so the following scene draws fill it instead
+ *  of the bound framebuffer.  That framebuffer is lit into
+ *  later, and only the lower left corner of the G-buffer
+ *  the size of the current viewport is used, so a scaled
+ *  down frame does not need a smaller G-buffer.
+ ***********************************************************/
+void DeferredRenderer::BeginGeometryPass()
+{
+	if (m_frameBuffer == 0)
+	{
+		return;
+	}
+
+	GLint targetFrameBuffer = 0;
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFrameBuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_targetFrameBuffer = (GLuint)targetFrameBuffer;
+	m_viewportWidth = std::min((int)viewport[2], m_width);
+	m_viewportHeight = std::min((int)viewport[3], m_height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+	glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+
+	GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	GLuint clearMaterial[4] = { 0, 0, 0, 0 };
+	glClearBufferfv(GL_COLOR, 0, clearColor);
+	glClearBufferfv(GL_COLOR, 1, clearColor);
+	glClearBufferuiv(GL_COLOR, 2, clearMaterial);
+	glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  RenderLighting()
+ *
+ *  This method is used for lighting every pixel of the
+ *  G-buffer into the target framebuffer with a full-screen
+ *  triangle restricted to the viewport of each view.  Only
+ *  the first view is lit from the light clusters, which are
+ *  built for the camera.  The G-buffer depth is copied
+ *  across as well, so later forward draws are still depth
+ *  tested.
+ ***********************************************************/
+void DeferredRenderer::RenderLighting(
+	LightManager* pLightManager,
+	ShadowManager* pShadowManager,
+	const SCENE_VIEW* pViews,
+	int viewCount)
+{
+	if ((m_frameBuffer == 0) || (NULL == pLightManager) || (NULL == pViews))
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_frameBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_targetFrameBuffer);
+	glBlitFramebuffer(0, 0, m_viewportWidth, m_viewportHeight, 0, 0, m_viewportWidth, m_viewportHeight,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_targetFrameBuffer);
+
+	// the scene program is restored once the pass is drawn
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_lightingProgramID);
+
+	glUniform1ui(glGetUniformLocation(m_lightingProgramID, "materialCount"), m_materialCount);
+	pLightManager->SetProgramValues(m_lightingProgramID);
+	if (NULL != pShadowManager)
+	{
+		pShadowManager->SetProgramValues(m_lightingProgramID);
+	}
+
+	glActiveTexture(GL_TEXTURE0 + ALBEDO_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_albedoTexture);
+	glUniform1i(glGetUniformLocation(m_lightingProgramID, "albedoTexture"), ALBEDO_TEXTURE_UNIT);
+	glActiveTexture(GL_TEXTURE0 + NORMAL_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+	glUniform1i(glGetUniformLocation(m_lightingProgramID, "normalTexture"), NORMAL_TEXTURE_UNIT);
+	glActiveTexture(GL_TEXTURE0 + MATERIAL_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_materialTexture);
+	glUniform1i(glGetUniformLocation(m_lightingProgramID, "materialTexture"), MATERIAL_TEXTURE_UNIT);
+	glActiveTexture(GL_TEXTURE0 + DEPTH_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glUniform1i(glGetUniformLocation(m_lightingProgramID, "depthTexture"), DEPTH_TEXTURE_UNIT);
+	RenderStats::CountTextureBinds(4);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, m_materialBuffer);
+
+	// the full-screen triangle must not be rejected by the copied depth
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_emptyVertexArray);
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		const SCENE_VIEW& sceneView = pViews[i];
+		glm::ivec4 rect = GetViewportPixels(sceneView, m_viewportWidth, m_viewportHeight);
+		glm::mat4 inverseViewProjection = glm::inverse(sceneView.projection * sceneView.view);
+		glm::vec3 viewPosition = glm::vec3(glm::inverse(sceneView.view)[3]);
+
+		glUniformMatrix4fv(glGetUniformLocation(m_lightingProgramID, "view"), 1, GL_FALSE, glm::value_ptr(sceneView.view));
+		glUniformMatrix4fv(glGetUniformLocation(m_lightingProgramID, "inverseViewProjection"), 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+		glUniform3fv(glGetUniformLocation(m_lightingProgramID, "viewPosition"), 1, glm::value_ptr(viewPosition));
+		glUniform4f(glGetUniformLocation(m_lightingProgramID, "viewRect"),
+			(float)rect.x, (float)rect.y, (float)rect.z, (float)rect.w);
+		glUniform1i(glGetUniformLocation(m_lightingProgramID, "bClusterLights"), (i == 0));
+
+		glViewport(rect.x, rect.y, rect.z, rect.w);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		RenderStats::CountDraw(1);
+	}
+
+	glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for rebuilding the lighting program
+ *  when its files are edited.
+ ***********************************************************/
+void DeferredRenderer::WatchShaders(ShaderHotReload* pHotReload)
+{
+	if ((NULL == pHotReload) || (m_lightingProgramID == 0))
+	{
+		return;
+	}
+
+	pHotReload->WatchProgram(&m_lightingProgramID, g_FullscreenVertexFile, g_LightingFragmentFile);
+}
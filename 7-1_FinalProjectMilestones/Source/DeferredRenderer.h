@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.h
+// ============
+// manage the G-buffer and the full-screen lighting pass of the deferred
+// shading render path
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightManager.h"
+#include "ShadowManager.h"
+#include "ShaderHotReload.h"
+#include "SceneView.h"
+
+#include <GL/glew.h>        // GLEW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  DeferredRenderer
+ *
+ *  This class contains the code for the deferred render
+ *  path.  The scene is drawn once into the G-buffer, which
+ *  holds the albedo, the normal, the material ID and the
+ *  depth of every pixel, and a full-screen pass per view
+ *  then lights each pixel with the lights of its cluster.
+ ***********************************************************/
+class DeferredRenderer
+{
+public:
+	// constructor
+	DeferredRenderer();
+	// destructor
+	~DeferredRenderer();
+
+	// one entry of the material table - this must match the
+	// std430 layout of MaterialEntry in the lighting shader
+	struct MATERIAL_ENTRY
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float shininess;
+		glm::vec3 specularColor;
+		float padding;
+	};
+
+private:
+	// program of the full-screen lighting pass
+	GLuint m_lightingProgramID;
+	// G-buffer framebuffer and its attachments
+	GLuint m_frameBuffer;
+	GLuint m_albedoTexture;
+	GLuint m_normalTexture;
+	GLuint m_materialTexture;
+	GLuint m_depthTexture;
+	// empty VAO for drawing the full-screen triangle
+	GLuint m_emptyVertexArray;
+	// buffer holding the MATERIAL_ENTRY table
+	GLuint m_materialBuffer;
+	GLuint m_materialCount;
+	// size of the G-buffer attachments
+	int m_width;
+	int m_height;
+	// framebuffer the scene is drawn into and the size of the
+	// viewport used, which may be smaller than the G-buffer
+	GLuint m_targetFrameBuffer;
+	int m_viewportWidth;
+	int m_viewportHeight;
+
+	// allocate the G-buffer attachments for the passed in size
+	bool CreateGBuffer(int width, int height);
+	// free the G-buffer attachments
+	void DestroyGBuffer();
+
+public:
+	// load the lighting program and create the G-buffer
+	bool Initialize(int width, int height);
+	// reallocate the G-buffer when the window size changes
+	void Resize(int width, int height);
+
+	// upload the material table read by the lighting pass
+	void SetMaterials(const std::vector<MATERIAL_ENTRY>& materials);
+
+	// bind and clear the G-buffer for the scene draws, keeping
+	// the current framebuffer and viewport as the target
+	void BeginGeometryPass();
+	// light each view of the G-buffer into the target framebuffer,
+	// the shadow manager may be NULL when no light casts shadows
+	void RenderLighting(
+		LightManager* pLightManager,
+		ShadowManager* pShadowManager,
+		const SCENE_VIEW* pViews,
+		int viewCount);
+	// rebuild the lighting program when its files are edited
+	void WatchShaders(ShaderHotReload* pHotReload);
+};
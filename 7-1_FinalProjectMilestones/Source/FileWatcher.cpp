@@ -0,0 +1,253 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// report the files that were changed on disk since the last check
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <iostream>
+#include <chrono>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// seconds between two modification time checks
+	const double POLL_INTERVAL = 0.25;
+
+	// get the current time in seconds
+	double GetSeconds()
+	{
+		return(std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+	m_notifyDescriptor = -1;
+	m_lastPollTime = 0.0;
+
+#ifdef __linux__
+	m_notifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_notifyDescriptor < 0)
+	{
+		std::cout << "INFO: inotify unavailable, polling the watched files instead" << std::endl;
+	}
+#endif
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (m_notifyDescriptor >= 0)
+	{
+		close(m_notifyDescriptor);
+		m_notifyDescriptor = -1;
+	}
+#endif
+	m_files.clear();
+}
+
+/***********************************************************
+ *  GetModifiedTime()
+ *
+ *  This method is used for getting the time the passed in
+ *  file was last written.  Zero is returned when the file
+ *  does not exist, such as in the middle of a save.
+ ***********************************************************/
+time_t FileWatcher::GetModifiedTime(const std::string& path)
+{
+#ifdef _WIN32
+	struct _stat fileStatus;
+	if (_stat(path.c_str(), &fileStatus) != 0)
+	{
+		return(0);
+	}
+#else
+	struct stat fileStatus;
+	if (stat(path.c_str(), &fileStatus) != 0)
+	{
+		return(0);
+	}
+#endif
+
+	return(fileStatus.st_mtime);
+}
+
+/***********************************************************
+ *  AddChangedFile()
+ *
+ *  This method is used for adding a changed file to the
+ *  list, unless it is already there.
+ ***********************************************************/
+void FileWatcher::AddChangedFile(std::vector<std::string>& changedFiles, const std::string& path)
+{
+	for (size_t i = 0; i < changedFiles.size(); i++)
+	{
+		if (changedFiles[i] == path)
+		{
+			return;
+		}
+	}
+
+	changedFiles.push_back(path);
+}
+
+/***********************************************************
+ *  AddFile()
+ *
+ *  This method is used for starting to watch the passed in
+ *  file.  The folder is watched rather than the file, so
+ *  the watch survives the file being replaced.
+ ***********************************************************/
+bool FileWatcher::AddFile(const char* path)
+{
+	if (NULL == path)
+	{
+		return(false);
+	}
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].path == path)
+		{
+			return(true);
+		}
+	}
+
+	WATCHED_FILE file;
+	file.path = path;
+	file.modifiedTime = GetModifiedTime(file.path);
+
+	size_t separator = file.path.find_last_of("/\\");
+	if (separator == std::string::npos)
+	{
+		file.directory = ".";
+		file.name = file.path;
+	}
+	else
+	{
+		file.directory = file.path.substr(0, separator);
+		file.name = file.path.substr(separator + 1);
+	}
+
+#ifdef __linux__
+	if (m_notifyDescriptor >= 0)
+	{
+		bool bWatched = false;
+		for (size_t i = 0; i < m_watchDirectories.size(); i++)
+		{
+			if (m_watchDirectories[i] == file.directory)
+			{
+				bWatched = true;
+			}
+		}
+
+		if (bWatched == false)
+		{
+			int watchDescriptor = inotify_add_watch(m_notifyDescriptor, file.directory.c_str(),
+				IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (watchDescriptor < 0)
+			{
+				std::cout << "Could not watch folder:" << file.directory << std::endl;
+				return(false);
+			}
+			m_watchDescriptors.push_back(watchDescriptor);
+			m_watchDirectories.push_back(file.directory);
+		}
+	}
+#endif
+
+	m_files.push_back(file);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for getting the watched files that
+ *  were written since the last call.  It never blocks, so
+ *  it can be called once per frame.
+ ***********************************************************/
+bool FileWatcher::Poll(std::vector<std::string>& changedFiles)
+{
+	changedFiles.clear();
+
+#ifdef __linux__
+	if (m_notifyDescriptor >= 0)
+	{
+		// the buffer must be aligned for the event structures
+		alignas(struct inotify_event) char buffer[4096];
+		ssize_t length = read(m_notifyDescriptor, buffer, sizeof(buffer));
+
+		while (length > 0)
+		{
+			ssize_t offset = 0;
+			while (offset < length)
+			{
+				const struct inotify_event* pEvent = (const struct inotify_event*)(buffer + offset);
+				if (pEvent->len > 0)
+				{
+					for (size_t i = 0; i < m_watchDescriptors.size(); i++)
+					{
+						if (m_watchDescriptors[i] != pEvent->wd)
+						{
+							continue;
+						}
+						for (size_t j = 0; j < m_files.size(); j++)
+						{
+							if ((m_files[j].directory == m_watchDirectories[i]) &&
+								(m_files[j].name == pEvent->name))
+							{
+								AddChangedFile(changedFiles, m_files[j].path);
+							}
+						}
+					}
+				}
+				offset += sizeof(struct inotify_event) + pEvent->len;
+			}
+			length = read(m_notifyDescriptor, buffer, sizeof(buffer));
+		}
+
+		return(changedFiles.size() > 0);
+	}
+#endif
+
+	double currentTime = GetSeconds();
+	if (currentTime - m_lastPollTime < POLL_INTERVAL)
+	{
+		return(false);
+	}
+	m_lastPollTime = currentTime;
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		time_t modifiedTime = GetModifiedTime(m_files[i].path);
+		if ((modifiedTime != 0) && (modifiedTime != m_files[i].modifiedTime))
+		{
+			m_files[i].modifiedTime = modifiedTime;
+			AddChangedFile(changedFiles, m_files[i].path);
+		}
+	}
+
+	return(changedFiles.size() > 0);
+}
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// report the files that were changed on disk since the last check
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ctime>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class contains the code for noticing edited files.
+ *  On Linux the folders of the files are watched with
+ *  inotify, which also catches editors that save by
+ *  renaming a new file over the old one.  Elsewhere the
+ *  modification times are compared a few times a second.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// constructor
+	FileWatcher();
+	// destructor
+	~FileWatcher();
+
+private:
+	// one watched file
+	struct WATCHED_FILE
+	{
+		std::string path;
+		// folder and name, as reported by inotify
+		std::string directory;
+		std::string name;
+		time_t modifiedTime;
+	};
+
+	std::vector<WATCHED_FILE> m_files;
+	// inotify descriptor, -1 when the times are polled
+	int m_notifyDescriptor;
+	// inotify watch of each folder and the folder it watches
+	std::vector<int> m_watchDescriptors;
+	std::vector<std::string> m_watchDirectories;
+	// time of the last modification time check
+	double m_lastPollTime;
+
+	// get the modification time of a file, zero if it is missing
+	static time_t GetModifiedTime(const std::string& path);
+	// add a changed file to the list once
+	static void AddChangedFile(std::vector<std::string>& changedFiles, const std::string& path);
+
+public:
+	// start watching a file, which may be listed more than once
+	bool AddFile(const char* path);
+	// get the watched files that changed since the last call
+	bool Poll(std::vector<std::string>& changedFiles);
+};
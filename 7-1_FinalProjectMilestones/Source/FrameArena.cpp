@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// hand out the transient memory of a frame from a linear block that is
+// reset once per frame instead of freeing each allocation
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+// declaration of global variables
+namespace
+{
+	// alignment of each block, enough for any SIMD type
+	const size_t BLOCK_ALIGNMENT = 64;
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena()
+{
+	for (int i = 0; i < BUFFERED_FRAMES; i++)
+	{
+		m_blocks[i] = NULL;
+		m_blockCapacities[i] = 0;
+	}
+	m_capacity = 0;
+	m_block = 0;
+	m_offset = 0;
+	m_overflowBytes = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	for (int i = 0; i < BUFFERED_FRAMES; i++)
+	{
+		FreeOverflow(i);
+		free(m_blocks[i]);
+		m_blocks[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for allocating one block of the
+ *  passed in capacity per frame in flight.
+ ***********************************************************/
+bool FrameArena::Initialize(size_t capacity)
+{
+	m_capacity = capacity;
+	m_block = 0;
+	m_offset = 0;
+	m_stats.capacity = capacity;
+
+	for (int i = 0; i < BUFFERED_FRAMES; i++)
+	{
+		if (AllocateBlock(i, capacity) == false)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for raising the capacity of the
+ *  blocks, such as when a larger scene is loaded.  The
+ *  capacity never shrinks.  The current block may still be
+ *  handing out memory, so each block is only reallocated
+ *  once its frame comes around again.
+ ***********************************************************/
+void FrameArena::Reserve(size_t capacity)
+{
+	if (capacity <= m_capacity)
+	{
+		return;
+	}
+
+	m_capacity = capacity;
+	m_stats.capacity = capacity;
+}
+
+/***********************************************************
+ *  AllocateBlock()
+ *
+ *  This method is used for replacing a block with one of
+ *  the passed in capacity.  A block that cannot be
+ *  allocated is left empty, so its frame is served from
+ *  the heap.
+ ***********************************************************/
+bool FrameArena::AllocateBlock(int block, size_t capacity)
+{
+	// the blocks are over-allocated so they can be aligned by hand,
+	// since aligned allocation is not portable before C++17
+	free(m_blocks[block]);
+	m_blocks[block] = (unsigned char*)malloc(capacity + BLOCK_ALIGNMENT);
+	if (NULL == m_blocks[block])
+	{
+		std::cout << "Could not allocate the frame arena, bytes:" << capacity << std::endl;
+		m_blockCapacities[block] = 0;
+		return(false);
+	}
+
+	m_blockCapacities[block] = capacity;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FreeOverflow()
+ *
+ *  This method is used for freeing the heap allocations
+ *  made for a block after it ran out of space.
+ ***********************************************************/
+void FrameArena::FreeOverflow(int block)
+{
+	for (size_t i = 0; i < m_overflow[block].size(); i++)
+	{
+		free(m_overflow[block][i]);
+	}
+	m_overflow[block].clear();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for finishing the statistics of the
+ *  last frame and moving on to the next block.  Everything
+ *  allocated from that block BUFFERED_FRAMES frames ago is
+ *  released at once.
+ ***********************************************************/
+void FrameArena::BeginFrame()
+{
+	size_t frameBytes = m_offset + m_overflowBytes;
+	m_stats.lastFrameBytes = frameBytes;
+	m_stats.overflowBytes = m_overflowBytes;
+	if (frameBytes > m_stats.highWaterMark)
+	{
+		m_stats.highWaterMark = frameBytes;
+
+		// only reported when the mark rises, not every frame
+		if (m_overflowBytes > 0)
+		{
+			std::cout << "INFO: frame arena overflowed by " << m_overflowBytes
+				<< " bytes, high-water mark:" << m_stats.highWaterMark << std::endl;
+		}
+	}
+
+	m_block = (m_block + 1) % BUFFERED_FRAMES;
+	FreeOverflow(m_block);
+
+	// nothing of the block is in use anymore, so it can be moved
+	if (m_blockCapacities[m_block] < m_capacity)
+	{
+		AllocateBlock(m_block, m_capacity);
+	}
+	m_offset = 0;
+	m_overflowBytes = 0;
+	m_stats.frameBytes = 0;
+	m_stats.allocationCount = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for getting memory for the current
+ *  frame.  The alignment must be a power of two.  When the
+ *  block is full the memory is taken from the heap, and it
+ *  is still released with the block.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0)
+	{
+		return(NULL);
+	}
+
+	m_stats.allocationCount++;
+
+	if (NULL != m_blocks[m_block])
+	{
+		uintptr_t base = ((uintptr_t)m_blocks[m_block] + BLOCK_ALIGNMENT - 1) & ~(uintptr_t)(BLOCK_ALIGNMENT - 1);
+		uintptr_t address = (base + m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t end = (size_t)(address - base) + size;
+		if (end <= m_blockCapacities[m_block])
+		{
+			m_offset = end;
+			m_stats.frameBytes = m_offset + m_overflowBytes;
+			return((void*)address);
+		}
+	}
+
+	// malloc() is not aligned for the SIMD types, so the heap
+	// memory is over-allocated and aligned by hand like the blocks
+	void* pMemory = malloc(size + alignment);
+	if (NULL == pMemory)
+	{
+		return(NULL);
+	}
+	m_overflow[m_block].push_back(pMemory);
+	m_overflowBytes += size;
+	m_stats.frameBytes = m_offset + m_overflowBytes;
+
+	uintptr_t address = ((uintptr_t)pMemory + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+	return((void*)address);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the usage of the arena.
+ ***********************************************************/
+const FrameArena::ARENA_STATS& FrameArena::GetStats() const
+{
+	return(m_stats);
+}
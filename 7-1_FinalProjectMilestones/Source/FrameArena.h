@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// hand out the transient memory of a frame from a linear block that is
+// reset once per frame instead of freeing each allocation
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class contains one linear block per frame in flight.
+ *  Allocating only moves an offset forward, and the whole
+ *  block is reset when its frame comes around again, so the
+ *  draw packets, sort keys and other data built each frame
+ *  never touch the global heap.  A block is only reused
+ *  after BUFFERED_FRAMES frames, which matches the frames
+ *  the GPU may still be reading.  The capacity is raised
+ *  with the size of the scene, and each block is grown when
+ *  its frame comes around, so no live memory is moved.
+ *  When a frame still outgrows its block, the rest is taken
+ *  from the heap with the same alignment and reported.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena();
+	// destructor
+	~FrameArena();
+
+	// blocks in the ring, one per frame in flight
+	static const int BUFFERED_FRAMES = 3;
+
+	// usage of the arena, for tuning the capacity
+	struct ARENA_STATS
+	{
+		// bytes of each block
+		size_t capacity;
+		// bytes used by the current and the last finished frame
+		size_t frameBytes;
+		size_t lastFrameBytes;
+		// most bytes used by a single frame so far
+		size_t highWaterMark;
+		// bytes the last finished frame took from the heap
+		size_t overflowBytes;
+		// allocations made by the current frame
+		int allocationCount;
+	};
+
+private:
+	// linear blocks, one per frame in flight, and the bytes of
+	// each, which only reach the capacity when they are reused
+	unsigned char* m_blocks[BUFFERED_FRAMES];
+	size_t m_blockCapacities[BUFFERED_FRAMES];
+	size_t m_capacity;
+	// block and offset of the current frame
+	int m_block;
+	size_t m_offset;
+	// heap allocations of each block when it ran out of space
+	std::vector<void*> m_overflow[BUFFERED_FRAMES];
+	size_t m_overflowBytes;
+	ARENA_STATS m_stats;
+
+	// allocate a block of the passed in capacity
+	bool AllocateBlock(int block, size_t capacity);
+	// free the heap allocations made for a block
+	void FreeOverflow(int block);
+
+public:
+	// allocate the blocks
+	bool Initialize(size_t capacity);
+	// grow the blocks to at least the passed in capacity
+	void Reserve(size_t capacity);
+	// move on to the next block, releasing everything it held
+	void BeginFrame();
+
+	// get aligned memory that stays valid for BUFFERED_FRAMES frames
+	void* Allocate(size_t size, size_t alignment);
+
+	// get an uninitialized array, which must not need destructors
+	template <typename TYPE>
+	TYPE* AllocateArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<TYPE>::value,
+			"arena memory is released without calling destructors");
+		return((TYPE*)Allocate(sizeof(TYPE) * count, alignof(TYPE)));
+	}
+
+	// get the usage of the arena
+	const ARENA_STATS& GetStats() const;
+};
@@ -0,0 +1,402 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// read rendered frames back through pixel buffers and write them as PNG
+// files on a pool of encoder threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "PngEncoder.h"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// longest wait for the GPU to finish a copy
+	const GLuint64 FENCE_TIMEOUT = 1000000000;
+	// frames waiting for an encoder per encoder thread
+	const int QUEUED_JOBS_PER_THREAD = 2;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	for (int i = 0; i < READBACK_SLOTS; i++)
+	{
+		m_slots[i].buffer = 0;
+		m_slots[i].capacity = 0;
+		m_slots[i].fence = 0;
+		m_slots[i].width = 0;
+		m_slots[i].height = 0;
+		m_slots[i].bDropWhenBusy = false;
+	}
+	m_slot = 0;
+	m_pendingJobs = 0;
+	m_maxQueuedJobs = QUEUED_JOBS_PER_THREAD;
+	m_encodedCount = 0;
+	m_failedCount = 0;
+	m_droppedCount = 0;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Shutdown();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the pixel buffers and
+ *  starting the encoder threads.  With a negative count,
+ *  one encoder is started for each core other than the
+ *  render thread's.
+ ***********************************************************/
+bool FrameCapture::Initialize(int encoderThreads)
+{
+	Shutdown();
+
+	if (encoderThreads < 0)
+	{
+		// hardware_concurrency() returns 0 when it is not known
+		encoderThreads = (int)std::thread::hardware_concurrency() - 1;
+	}
+	if (encoderThreads < 1)
+	{
+		encoderThreads = 1;
+	}
+
+	for (int i = 0; i < READBACK_SLOTS; i++)
+	{
+		glGenBuffers(1, &m_slots[i].buffer);
+	}
+
+	m_bStopping = false;
+	m_maxQueuedJobs = encoderThreads * QUEUED_JOBS_PER_THREAD;
+	for (int i = 0; i < encoderThreads; i++)
+	{
+		m_encoderThreads.push_back(std::thread(&FrameCapture::EncoderLoop, this));
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for writing the captures still in
+ *  flight, stopping the encoders and freeing the buffers.
+ *  It must be called on the thread that owns the context.
+ ***********************************************************/
+void FrameCapture::Shutdown()
+{
+	if (m_encoderThreads.empty())
+	{
+		return;
+	}
+
+	Finish();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_jobCondition.notify_all();
+	for (size_t i = 0; i < m_encoderThreads.size(); i++)
+	{
+		m_encoderThreads[i].join();
+	}
+	m_encoderThreads.clear();
+
+	for (int i = 0; i < READBACK_SLOTS; i++)
+	{
+		glDeleteBuffers(1, &m_slots[i].buffer);
+		m_slots[i].buffer = 0;
+		m_slots[i].capacity = 0;
+	}
+}
+
+/***********************************************************
+ *  EncoderLoop()
+ *
+ *  This method is used for encoding the queued frames on
+ *  an encoder thread.  The queue is emptied before the
+ *  thread stops, so no capture is lost on shutdown.
+ ***********************************************************/
+void FrameCapture::EncoderLoop()
+{
+	while (true)
+	{
+		ENCODE_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobCondition.wait(lock, [this]() { return((m_bStopping == true) || (m_jobs.size() > 0)); });
+			if (m_jobs.empty())
+			{
+				break;
+			}
+			job.filename.swap(m_jobs.front().filename);
+			job.width = m_jobs.front().width;
+			job.height = m_jobs.front().height;
+			job.pixels.swap(m_jobs.front().pixels);
+			m_jobs.pop_front();
+		}
+		m_doneCondition.notify_all();
+
+		bool bWritten = PngEncoder::WriteFile(
+			job.filename.c_str(),
+			&job.pixels[0],
+			job.width,
+			job.height,
+			true);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (bWritten == true)
+			{
+				m_encodedCount++;
+			}
+			else
+			{
+				m_failedCount++;
+			}
+			m_pendingJobs--;
+		}
+		m_doneCondition.notify_all();
+	}
+}
+
+/***********************************************************
+ *  ReadSlot()
+ *
+ *  This method is used for copying the pixels of a slot
+ *  whose fence has passed out of its buffer and queueing
+ *  them for the encoders.  When the encoders are behind,
+ *  the render thread waits for room in the queue rather
+ *  than holding any number of frames in memory, or drops
+ *  the frame when the capture allows it.
+ ***********************************************************/
+void FrameCapture::ReadSlot(READBACK_SLOT& slot)
+{
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	// only this thread adds jobs, so the queue cannot fill up
+	// again between this check and the push below
+	if (slot.bDropWhenBusy == true)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if ((int)m_jobs.size() >= m_maxQueuedJobs)
+		{
+			m_droppedCount++;
+			return;
+		}
+	}
+
+	ENCODE_JOB job;
+	job.filename = slot.filename;
+	job.width = slot.width;
+	job.height = slot.height;
+	job.pixels.resize((size_t)slot.width * slot.height * 4);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, job.pixels.size(), GL_MAP_READ_BIT);
+	bool bMapped = (NULL != pMapped);
+	if (bMapped == true)
+	{
+		memcpy(&job.pixels[0], pMapped, job.pixels.size());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (bMapped == false)
+	{
+		std::cout << "Could not read back the frame for:" << slot.filename << std::endl;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_failedCount++;
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_doneCondition.wait(lock, [this]() { return((int)m_jobs.size() < m_maxQueuedJobs); });
+		m_jobs.push_back(ENCODE_JOB());
+		m_jobs.back().filename.swap(job.filename);
+		m_jobs.back().width = job.width;
+		m_jobs.back().height = job.height;
+		m_jobs.back().pixels.swap(job.pixels);
+		m_pendingJobs++;
+	}
+	m_jobCondition.notify_one();
+}
+
+/***********************************************************
+ *  MakeDirectory()
+ *
+ *  This method is used for creating the folder that the
+ *  captures are written to, when it does not exist yet.
+ ***********************************************************/
+void FrameCapture::MakeDirectory(const char* directory)
+{
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used for starting the copy of a frame
+ *  from the bound read framebuffer into the next pixel
+ *  buffer.  The copy is queued on the GPU and the call
+ *  returns without waiting for it.  Only when every slot
+ *  is still in flight does it wait for the oldest one, or
+ *  drop the new frame when the capture allows it.
+ ***********************************************************/
+bool FrameCapture::Capture(const char* filename, int width, int height, bool bDropWhenBusy)
+{
+	if ((m_encoderThreads.empty()) || (NULL == filename) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	READBACK_SLOT& slot = m_slots[m_slot];
+	if (slot.fence != 0)
+	{
+		GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, bDropWhenBusy ? 0 : FENCE_TIMEOUT);
+		if ((bDropWhenBusy == true) && (result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_droppedCount++;
+			return(false);
+		}
+		ReadSlot(slot);
+	}
+
+	// the buffer only grows, so a run at one size never reallocates
+	int size = width * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	if (size > slot.capacity)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		slot.capacity = size;
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.filename = filename;
+	slot.width = width;
+	slot.height = height;
+	slot.bDropWhenBusy = bDropWhenBusy;
+
+	m_slot = (m_slot + 1) % READBACK_SLOTS;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for handing the copies the GPU has
+ *  finished to the encoders.  The fences are only polled,
+ *  so the call never waits for the GPU.  The slots are read
+ *  oldest first, keeping the files in capture order.
+ ***********************************************************/
+void FrameCapture::Update()
+{
+	for (int i = 0; i < READBACK_SLOTS; i++)
+	{
+		READBACK_SLOT& slot = m_slots[(m_slot + i) % READBACK_SLOTS];
+		if (slot.fence == 0)
+		{
+			continue;
+		}
+
+		GLenum result = glClientWaitSync(slot.fence, 0, 0);
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+		ReadSlot(slot);
+	}
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for waiting until every capture has
+ *  been read back and written to its file.
+ ***********************************************************/
+void FrameCapture::Finish()
+{
+	for (int i = 0; i < READBACK_SLOTS; i++)
+	{
+		READBACK_SLOT& slot = m_slots[(m_slot + i) % READBACK_SLOTS];
+		if (slot.fence != 0)
+		{
+			glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+			ReadSlot(slot);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this]() { return(m_pendingJobs == 0); });
+}
+
+/***********************************************************
+ *  GetEncodedCount()
+ *
+ *  This method is used for getting the number of images
+ *  written so far.
+ ***********************************************************/
+int FrameCapture::GetEncodedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_encodedCount);
+}
+
+/***********************************************************
+ *  GetFailedCount()
+ *
+ *  This method is used for getting the number of captures
+ *  that could not be read back or written.
+ ***********************************************************/
+int FrameCapture::GetFailedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_failedCount);
+}
+
+/***********************************************************
+ *  GetDroppedCount()
+ *
+ *  This method is used for getting the number of captures
+ *  dropped because the GPU or the encoders were behind.
+ ***********************************************************/
+int FrameCapture::GetDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_droppedCount);
+}
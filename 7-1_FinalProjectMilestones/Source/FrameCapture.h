@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// read rendered frames back through pixel buffers and write them as PNG
+// files on a pool of encoder threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class contains a ring of pixel pack buffers that
+ *  the frames are copied into by the GPU.  glReadPixels()
+ *  into a buffer returns at once, and a fence marks when
+ *  the copy is done, so the buffer is only mapped a frame
+ *  or two later when the pixels are already there.  The
+ *  pixels are then handed to the encoder threads, which
+ *  filter, compress and write them while the next frames
+ *  are drawn.  A capture taken while the window is shown
+ *  can be dropped instead of waiting when the GPU or the
+ *  encoders are behind, so it never holds up the frame.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+	// readbacks that can be in flight at once
+	static const int READBACK_SLOTS = 3;
+
+private:
+	// one pixel buffer and the frame copied into it
+	struct READBACK_SLOT
+	{
+		GLuint buffer;
+		int capacity;
+		// set while the GPU copy has not been read yet
+		GLsync fence;
+		std::string filename;
+		int width;
+		int height;
+		// true when the frame is dropped rather than waited for
+		bool bDropWhenBusy;
+	};
+
+	// one frame waiting for an encoder
+	struct ENCODE_JOB
+	{
+		std::string filename;
+		int width;
+		int height;
+		std::vector<unsigned char> pixels;
+	};
+
+	READBACK_SLOT m_slots[READBACK_SLOTS];
+	// slot the next frame is copied into
+	int m_slot;
+
+	std::vector<std::thread> m_encoderThreads;
+	std::mutex m_mutex;
+	// wakes the encoders when a job is queued
+	std::condition_variable m_jobCondition;
+	// wakes the render thread when a job is finished
+	std::condition_variable m_doneCondition;
+	std::deque<ENCODE_JOB> m_jobs;
+	// jobs queued or being encoded, and the most that are queued
+	// before the render thread waits, which bounds the memory
+	int m_pendingJobs;
+	int m_maxQueuedJobs;
+	int m_encodedCount;
+	int m_failedCount;
+	int m_droppedCount;
+	bool m_bStopping;
+
+	// encode the queued frames until the capture is shut down
+	void EncoderLoop();
+	// map a finished slot and queue its pixels for encoding
+	void ReadSlot(READBACK_SLOT& slot);
+
+public:
+	// start the encoder threads, one per extra core when negative
+	bool Initialize(int encoderThreads = -1);
+	// wait for every capture and free the buffers
+	void Shutdown();
+
+	// create the folder the captures are written to
+	static void MakeDirectory(const char* directory);
+
+	// copy the lower left corner of the bound read framebuffer
+	// into the next buffer, to be written to the passed in file,
+	// false when it was dropped because the capture was busy
+	bool Capture(const char* filename, int width, int height, bool bDropWhenBusy = false);
+	// queue the copies the GPU has finished, called once a frame
+	void Update();
+	// wait until every capture has been written
+	void Finish();
+
+	// get the number of images written, failed and dropped so far
+	int GetEncodedCount();
+	int GetFailedCount();
+	int GetDroppedCount();
+};
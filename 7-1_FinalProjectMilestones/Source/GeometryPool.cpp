@@ -0,0 +1,512 @@
+///////////////////////////////////////////////////////////////////////////////
+// geometrypool.cpp
+// ============
+// manage the shared vertex and index buffers that hold all of the meshes
+// drawn in the 3D scene behind a single vertex array object per format
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GeometryPool.h"
+#include "RenderStats.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include <glm/gtc/packing.hpp>
+
+// declaration of global variables
+namespace
+{
+	// compact vertex - the normal is packed as GL_INT_2_10_10_10_REV
+	// and the UV coordinates are stored as half floats
+	struct COMPACT_VERTEX
+	{
+		GLfloat position[3];
+		GLuint normal;
+		GLushort uv[2];
+	};
+
+	// size of one vertex in bytes for each vertex format
+	const GLuint STANDARD_VERTEX_SIZE = MeshGenerator::FLOATS_PER_VERTEX * sizeof(GLfloat);
+	const GLuint COMPACT_VERTEX_SIZE = sizeof(COMPACT_VERTEX);
+
+	// largest vertex count that 16-bit indices can address
+	const GLuint MAX_SHORT_INDEX_VERTICES = 65536;
+}
+
+/***********************************************************
+ *  GeometryPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GeometryPool::GeometryPool()
+{
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		m_vertexStores[i].vertexArray = 0;
+		m_vertexStores[i].vertexBuffer = 0;
+		m_vertexStores[i].vertexSize = 0;
+		m_vertexStores[i].capacity = 0;
+	}
+	m_vertexStores[VERTEX_FORMAT_STANDARD].vertexSize = STANDARD_VERTEX_SIZE;
+	m_vertexStores[VERTEX_FORMAT_COMPACT].vertexSize = COMPACT_VERTEX_SIZE;
+
+	m_indexBuffer = 0;
+	m_indexCapacity = 0;
+	m_boundFormat = -1;
+}
+
+/***********************************************************
+ *  ~GeometryPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GeometryPool::~GeometryPool()
+{
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		if (m_vertexStores[i].vertexArray != 0)
+		{
+			glDeleteVertexArrays(1, &m_vertexStores[i].vertexArray);
+			m_vertexStores[i].vertexArray = 0;
+		}
+		if (m_vertexStores[i].vertexBuffer != 0)
+		{
+			glDeleteBuffers(1, &m_vertexStores[i].vertexBuffer);
+			m_vertexStores[i].vertexBuffer = 0;
+		}
+	}
+	if (m_indexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+	m_meshes.clear();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating one VAO and vertex
+ *  buffer per vertex format, plus the shared index buffer.
+ *  The capacities are given in vertices and 32-bit indices,
+ *  and the buffers grow later on if more room is needed.
+ ***********************************************************/
+bool GeometryPool::Create(GLuint vertexCapacity, GLuint indexCapacity)
+{
+	m_indexCapacity = indexCapacity * sizeof(GLuint);
+
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, m_indexCapacity, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	// the whole of every buffer starts out unused
+	FREE_RANGE allIndices = { 0, m_indexCapacity };
+	m_freeIndices.push_back(allIndices);
+
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		VERTEX_STORE& store = m_vertexStores[i];
+		store.capacity = vertexCapacity;
+
+		glGenVertexArrays(1, &store.vertexArray);
+		glGenBuffers(1, &store.vertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, store.vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, store.capacity * store.vertexSize, NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		FREE_RANGE allVertices = { 0, store.capacity };
+		store.freeRanges.push_back(allVertices);
+
+		SetupVertexArray((VERTEX_FORMAT)i);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetupVertexArray()
+ *
+ *  This method is used for pointing the VAO of a vertex
+ *  format at its buffers.  The attribute locations match
+ *  the ones used by the ShapeMeshes primitives - position,
+ *  normal and UV - and the compact format is expanded back
+ *  to vec3/vec2 by the vertex fetch, so the shaders read
+ *  both formats the same way.
+ ***********************************************************/
+void GeometryPool::SetupVertexArray(VERTEX_FORMAT format)
+{
+	VERTEX_STORE& store = m_vertexStores[format];
+
+	glBindVertexArray(store.vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, store.vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+	if (format == VERTEX_FORMAT_COMPACT)
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, store.vertexSize, (void*)0);
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, store.vertexSize, (void*)(3 * sizeof(GLfloat)));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, store.vertexSize, (void*)(3 * sizeof(GLfloat) + sizeof(GLuint)));
+	}
+	else
+	{
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, store.vertexSize, (void*)0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, store.vertexSize, (void*)(3 * sizeof(GLfloat)));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, store.vertexSize, (void*)(6 * sizeof(GLfloat)));
+	}
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_boundFormat = -1;
+}
+
+/***********************************************************
+ *  PackVertices()
+ *
+ *  This method is used for converting the interleaved float
+ *  vertices of a generated mesh into the bytes of the passed
+ *  in vertex format.
+ ***********************************************************/
+void GeometryPool::PackVertices(
+	const MeshGenerator::MESH_DATA& mesh,
+	VERTEX_FORMAT format,
+	std::vector<unsigned char>& packedVertices)
+{
+	size_t vertexCount = mesh.vertices.size() / MeshGenerator::FLOATS_PER_VERTEX;
+
+	if (format != VERTEX_FORMAT_COMPACT)
+	{
+		const unsigned char* source = (const unsigned char*)&mesh.vertices[0];
+		packedVertices.assign(source, source + mesh.vertices.size() * sizeof(GLfloat));
+		return;
+	}
+
+	packedVertices.resize(vertexCount * sizeof(COMPACT_VERTEX));
+	COMPACT_VERTEX* destination = (COMPACT_VERTEX*)&packedVertices[0];
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* source = &mesh.vertices[i * MeshGenerator::FLOATS_PER_VERTEX];
+
+		destination[i].position[0] = source[0];
+		destination[i].position[1] = source[1];
+		destination[i].position[2] = source[2];
+		destination[i].normal = glm::packSnorm3x10_1x2(glm::vec4(source[3], source[4], source[5], 0.0f));
+		destination[i].uv[0] = glm::packHalf1x16(source[6]);
+		destination[i].uv[1] = glm::packHalf1x16(source[7]);
+	}
+}
+
+/***********************************************************
+ *  AllocateRange()
+ *
+ *  This method is used for taking the first unused range
+ *  that can hold the passed in number of elements, starting
+ *  on a multiple of the passed in alignment.
+ ***********************************************************/
+bool GeometryPool::AllocateRange(
+	std::vector<FREE_RANGE>& freeRanges,
+	GLuint count,
+	GLuint alignment,
+	GLuint& offset)
+{
+	for (size_t i = 0; i < freeRanges.size(); i++)
+	{
+		GLuint rangeEnd = freeRanges[i].offset + freeRanges[i].count;
+		GLuint alignedOffset = ((freeRanges[i].offset + alignment - 1) / alignment) * alignment;
+
+		if (alignedOffset + count <= rangeEnd)
+		{
+			offset = alignedOffset;
+
+			if (alignedOffset > freeRanges[i].offset)
+			{
+				// keep the padding in front of the range unused
+				freeRanges[i].count = alignedOffset - freeRanges[i].offset;
+				if (alignedOffset + count < rangeEnd)
+				{
+					FREE_RANGE remainder = { alignedOffset + count, rangeEnd - alignedOffset - count };
+					freeRanges.insert(freeRanges.begin() + i + 1, remainder);
+				}
+			}
+			else
+			{
+				freeRanges[i].offset += count;
+				freeRanges[i].count -= count;
+				if (freeRanges[i].count == 0)
+				{
+					freeRanges.erase(freeRanges.begin() + i);
+				}
+			}
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  ReleaseRange()
+ *
+ *  This method is used for returning a range to the unused
+ *  list, merging it with the ranges on either side.
+ ***********************************************************/
+void GeometryPool::ReleaseRange(std::vector<FREE_RANGE>& freeRanges, GLuint offset, GLuint count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// find the first unused range that comes after this one
+	size_t index = 0;
+	while ((index < freeRanges.size()) && (freeRanges[index].offset < offset))
+	{
+		index++;
+	}
+
+	FREE_RANGE range = { offset, count };
+	freeRanges.insert(freeRanges.begin() + index, range);
+
+	// merge with the following range
+	if ((index + 1 < freeRanges.size()) &&
+		(freeRanges[index].offset + freeRanges[index].count == freeRanges[index + 1].offset))
+	{
+		freeRanges[index].count += freeRanges[index + 1].count;
+		freeRanges.erase(freeRanges.begin() + index + 1);
+	}
+	// merge with the preceding range
+	if ((index > 0) &&
+		(freeRanges[index - 1].offset + freeRanges[index - 1].count == freeRanges[index].offset))
+	{
+		freeRanges[index - 1].count += freeRanges[index].count;
+		freeRanges.erase(freeRanges.begin() + index);
+	}
+}
+
+/***********************************************************
+ *  GrowBuffer()
+ *
+ *  This method is used for moving a shared buffer into a
+ *  larger one.  The existing meshes keep their offsets and
+ *  the new space is added to the unused list.
+ ***********************************************************/
+void GeometryPool::GrowBuffer(
+	GLuint& buffer,
+	GLuint& capacity,
+	GLuint requiredCapacity,
+	GLuint elementSize,
+	std::vector<FREE_RANGE>& freeRanges)
+{
+	GLuint newCapacity = std::max(capacity * 2, requiredCapacity);
+	GLuint newBuffer = 0;
+
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * elementSize, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * elementSize);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &buffer);
+	buffer = newBuffer;
+
+	ReleaseRange(freeRanges, capacity, newCapacity - capacity);
+	capacity = newCapacity;
+
+	std::cout << "INFO: Geometry pool buffer grown to " << newCapacity * elementSize << " bytes" << std::endl;
+
+	// the VAOs still reference the deleted buffer
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		SetupVertexArray((VERTEX_FORMAT)i);
+	}
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for copying the passed in mesh into
+ *  the shared buffers with the passed in vertex format.  The
+ *  returned mesh ID is used for drawing the mesh.
+ ***********************************************************/
+int GeometryPool::AddMesh(const MeshGenerator::MESH_DATA& mesh, VERTEX_FORMAT format)
+{
+	VERTEX_STORE& store = m_vertexStores[format];
+	GLuint vertexCount = (GLuint)(mesh.vertices.size() / MeshGenerator::FLOATS_PER_VERTEX);
+	GLuint indexCount = (GLuint)mesh.indices.size();
+	GLuint vertexOffset = 0;
+	GLuint indexByteOffset = 0;
+
+	if ((store.vertexArray == 0) || (vertexCount == 0) || (indexCount == 0))
+	{
+		return(-1);
+	}
+
+	// compact meshes also halve their index size when they can
+	GLenum indexType = GL_UNSIGNED_INT;
+	GLuint indexSize = sizeof(GLuint);
+	if ((format == VERTEX_FORMAT_COMPACT) && (vertexCount <= MAX_SHORT_INDEX_VERTICES))
+	{
+		indexType = GL_UNSIGNED_SHORT;
+		indexSize = sizeof(GLushort);
+	}
+
+	std::vector<unsigned char> packedVertices;
+	PackVertices(mesh, format, packedVertices);
+
+	std::vector<GLushort> shortIndices;
+	const void* indexData = &mesh.indices[0];
+	if (indexType == GL_UNSIGNED_SHORT)
+	{
+		shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+		indexData = &shortIndices[0];
+	}
+
+	// grow the shared buffers when no unused range is big enough
+	if (AllocateRange(store.freeRanges, vertexCount, 1, vertexOffset) == false)
+	{
+		GrowBuffer(store.vertexBuffer, store.capacity,
+			store.capacity + vertexCount, store.vertexSize, store.freeRanges);
+		AllocateRange(store.freeRanges, vertexCount, 1, vertexOffset);
+	}
+	if (AllocateRange(m_freeIndices, indexCount * indexSize, indexSize, indexByteOffset) == false)
+	{
+		GrowBuffer(m_indexBuffer, m_indexCapacity,
+			m_indexCapacity + indexCount * indexSize + indexSize, 1, m_freeIndices);
+		AllocateRange(m_freeIndices, indexCount * indexSize, indexSize, indexByteOffset);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, store.vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * store.vertexSize, packedVertices.size(), &packedVertices[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the indices stay relative to the mesh, the base vertex
+	// of the draw call moves them to the mesh's vertex range
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, indexByteOffset, indexCount * indexSize, indexData);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	MESH_RANGE range;
+	range.baseVertex = (GLint)vertexOffset;
+	range.vertexCount = vertexCount;
+	range.firstIndex = indexByteOffset / indexSize;
+	range.indexCount = indexCount;
+	range.indexType = indexType;
+	range.vertexFormat = format;
+	range.boundsCenter = mesh.boundsCenter;
+	range.boundsRadius = mesh.boundsRadius;
+	range.bInUse = true;
+	RenderStats::CountMeshRegeneration();
+
+	// reuse the ID of a removed mesh when there is one
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		if (m_meshes[i].bInUse == false)
+		{
+			m_meshes[i] = range;
+			return((int)i);
+		}
+	}
+
+	m_meshes.push_back(range);
+	return((int)m_meshes.size() - 1);
+}
+
+/***********************************************************
+ *  RemoveMesh()
+ *
+ *  This method is used for releasing the vertex and index
+ *  ranges of a mesh so that they can be reused.
+ ***********************************************************/
+void GeometryPool::RemoveMesh(int meshID)
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) ||
+		(m_meshes[meshID].bInUse == false))
+	{
+		return;
+	}
+
+	MESH_RANGE& range = m_meshes[meshID];
+	GLuint indexSize = (range.indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+	ReleaseRange(m_vertexStores[range.vertexFormat].freeRanges, (GLuint)range.baseVertex, range.vertexCount);
+	ReleaseRange(m_freeIndices, range.firstIndex * indexSize, range.indexCount * indexSize);
+	range.bInUse = false;
+}
+
+/***********************************************************
+ *  GetMesh()
+ *
+ *  This method is used for getting the location of a mesh
+ *  inside the shared buffers, or NULL for an unknown ID.
+ ***********************************************************/
+const GeometryPool::MESH_RANGE* GeometryPool::GetMesh(int meshID) const
+{
+	if ((meshID < 0) || (meshID >= (int)m_meshes.size()) ||
+		(m_meshes[meshID].bInUse == false))
+	{
+		return(NULL);
+	}
+
+	return(&m_meshes[meshID]);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the VAO of a vertex
+ *  format.  It needs to be called before drawing, since
+ *  other code may have bound a different VAO.
+ ***********************************************************/
+void GeometryPool::Bind(VERTEX_FORMAT format)
+{
+	glBindVertexArray(m_vertexStores[format].vertexArray);
+	m_boundFormat = format;
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing a mesh out of the shared
+ *  buffers using its base vertex and first index, once for
+ *  each instance.  The VAO is only switched when the mesh
+ *  uses a different format.
+ ***********************************************************/
+void GeometryPool::DrawMesh(int meshID, int instanceCount)
+{
+	const MESH_RANGE* range = GetMesh(meshID);
+
+	if (range != NULL)
+	{
+		if (m_boundFormat != range->vertexFormat)
+		{
+			Bind(range->vertexFormat);
+		}
+
+		GLuint indexSize = (range->indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+		glDrawElementsInstancedBaseVertex(
+			GL_TRIANGLES,
+			range->indexCount,
+			range->indexType,
+			(void*)((size_t)range->firstIndex * indexSize),
+			instanceCount,
+			range->baseVertex);
+		RenderStats::CountDraw((int)(range->indexCount / 3) * instanceCount);
+	}
+}
+
+/***********************************************************
+ *  GetVertexArray()
+ *
+ *  This method is used for getting the VAO of a vertex
+ *  format, for indirect draws over the shared buffers.
+ ***********************************************************/
+GLuint GeometryPool::GetVertexArray(VERTEX_FORMAT format) const
+{
+	return(m_vertexStores[format].vertexArray);
+}
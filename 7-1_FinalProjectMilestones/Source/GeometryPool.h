@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// geometrypool.h
+// ============
+// manage the shared vertex and index buffers that hold all of the meshes
+// drawn in the 3D scene behind a single vertex array object per format
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGenerator.h"
+
+#include <GL/glew.h>        // GLEW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  GeometryPool
+ *
+ *  This class contains the code for sub-allocating vertex
+ *  and index ranges for every mesh out of a few large
+ *  buffers.  All of the meshes with the same vertex format
+ *  share one VAO, so draws only differ by their offsets.
+ ***********************************************************/
+class GeometryPool
+{
+public:
+	// constructor
+	GeometryPool();
+	// destructor
+	~GeometryPool();
+
+	// layouts a mesh can be stored with
+	enum VERTEX_FORMAT
+	{
+		// float position, normal and UV - 32 bytes per vertex
+		VERTEX_FORMAT_STANDARD = 0,
+		// float position, 2_10_10_10 normal and half float UV -
+		// 20 bytes per vertex, with 16-bit indices when they fit
+		VERTEX_FORMAT_COMPACT,
+		VERTEX_FORMAT_COUNT
+	};
+
+	// location of a mesh inside the shared buffers
+	struct MESH_RANGE
+	{
+		GLint baseVertex;
+		GLuint vertexCount;
+		// first index in units of the index type
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLenum indexType;
+		VERTEX_FORMAT vertexFormat;
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+		bool bInUse;
+	};
+
+private:
+	// unused span of elements inside one of the shared buffers
+	struct FREE_RANGE
+	{
+		GLuint offset;
+		GLuint count;
+	};
+
+	// the VAO and vertex buffer shared by one vertex format
+	struct VERTEX_STORE
+	{
+		GLuint vertexArray;
+		GLuint vertexBuffer;
+		// size of one vertex in bytes
+		GLuint vertexSize;
+		// capacity of the vertex buffer in vertices
+		GLuint capacity;
+		// unused vertex ranges, sorted by offset
+		std::vector<FREE_RANGE> freeRanges;
+	};
+
+	// one vertex store per vertex format
+	VERTEX_STORE m_vertexStores[VERTEX_FORMAT_COUNT];
+	// index buffer shared by all of the vertex formats
+	GLuint m_indexBuffer;
+	// capacity of the index buffer in bytes
+	GLuint m_indexCapacity;
+	// unused byte ranges of the index buffer, sorted by offset
+	std::vector<FREE_RANGE> m_freeIndices;
+	// ranges of the added meshes, indexed by mesh ID
+	std::vector<MESH_RANGE> m_meshes;
+	// vertex format of the currently bound VAO, -1 if none
+	int m_boundFormat;
+
+	// take the first unused range that fits the passed in count
+	bool AllocateRange(
+		std::vector<FREE_RANGE>& freeRanges,
+		GLuint count,
+		GLuint alignment,
+		GLuint& offset);
+	// give a range back and merge it with its neighbors
+	void ReleaseRange(std::vector<FREE_RANGE>& freeRanges, GLuint offset, GLuint count);
+	// reallocate a shared buffer, keeping its current contents
+	void GrowBuffer(
+		GLuint& buffer,
+		GLuint& capacity,
+		GLuint requiredCapacity,
+		GLuint elementSize,
+		std::vector<FREE_RANGE>& freeRanges);
+	// point the VAO attributes of a vertex format at its buffers
+	void SetupVertexArray(VERTEX_FORMAT format);
+	// convert the interleaved float vertices to a vertex format
+	void PackVertices(
+		const MeshGenerator::MESH_DATA& mesh,
+		VERTEX_FORMAT format,
+		std::vector<unsigned char>& packedVertices);
+
+public:
+	// create the VAOs and the shared buffers
+	bool Create(GLuint vertexCapacity, GLuint indexCapacity);
+
+	// copy a generated mesh into the shared buffers
+	int AddMesh(
+		const MeshGenerator::MESH_DATA& mesh,
+		VERTEX_FORMAT format = VERTEX_FORMAT_STANDARD);
+	// release the ranges used by a mesh
+	void RemoveMesh(int meshID);
+	// get the location of a mesh inside the shared buffers
+	const MESH_RANGE* GetMesh(int meshID) const;
+
+	// bind the VAO of a vertex format for the following draw calls
+	void Bind(VERTEX_FORMAT format = VERTEX_FORMAT_STANDARD);
+	// draw a mesh, switching the VAO only if its format differs
+	void DrawMesh(int meshID, int instanceCount = 1);
+
+	// get the VAO that the meshes of a vertex format are drawn with
+	GLuint GetVertexArray(VERTEX_FORMAT format = VERTEX_FORMAT_STANDARD) const;
+};
@@ -0,0 +1,306 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// split the per-frame work into chunks that a pool of worker threads takes
+// from each other's queues
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <iostream>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// queue of the current thread, the main thread uses queue 0
+	thread_local int t_queueIndex = 0;
+
+	// longest time an idle worker sleeps before looking again,
+	// in case a wake-up was missed
+	const std::chrono::milliseconds IDLE_TIMEOUT(2);
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem()
+{
+	m_bRunning = false;
+	m_queuedJobs = 0;
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the queues and starting
+ *  the worker threads.  With a negative count, one worker
+ *  is started for each core other than the main thread's.
+ ***********************************************************/
+bool JobSystem::Initialize(int workerCount)
+{
+	Shutdown();
+
+	if (workerCount < 0)
+	{
+		// hardware_concurrency() returns 0 when it is not known
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+		if (workerCount < 0)
+		{
+			workerCount = 0;
+		}
+	}
+
+	for (int i = 0; i <= workerCount; i++)
+	{
+		JOB_QUEUE* pQueue = new JOB_QUEUE;
+		pQueue->head = 0;
+		pQueue->count = 0;
+		m_queues.push_back(pQueue);
+	}
+
+	m_bRunning = true;
+	for (int i = 1; i <= workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+
+	std::cout << "INFO: job system started with " << workerCount << " worker threads" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for stopping the worker threads and
+ *  freeing the queues.
+ ***********************************************************/
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bRunning = false;
+	}
+	m_wakeCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	for (size_t i = 0; i < m_queues.size(); i++)
+	{
+		delete m_queues[i];
+	}
+	m_queues.clear();
+	m_queuedJobs = 0;
+}
+
+/***********************************************************
+ *  GetWorkerCount()
+ *
+ *  This method is used for getting the number of worker
+ *  threads, not counting the main thread.
+ ***********************************************************/
+int JobSystem::GetWorkerCount() const
+{
+	return((int)m_workers.size());
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for running jobs on a worker thread
+ *  until the system is shut down.  A worker with nothing to
+ *  run or steal sleeps until new jobs are pushed.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	t_queueIndex = queueIndex;
+
+	while (m_bRunning == true)
+	{
+		if (RunOneJob(queueIndex) == false)
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wakeCondition.wait_for(lock, IDLE_TIMEOUT, [this]()
+			{
+				return((m_bRunning == false) || (m_queuedJobs > 0));
+			});
+		}
+	}
+}
+
+/***********************************************************
+ *  PushJob()
+ *
+ *  This method is used for adding a job to the back of a
+ *  queue.  False is returned when the queue is full.
+ ***********************************************************/
+bool JobSystem::PushJob(int queueIndex, const JOB& job)
+{
+	JOB_QUEUE* pQueue = m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(pQueue->mutex);
+
+	if (pQueue->count >= QUEUE_CAPACITY)
+	{
+		return(false);
+	}
+
+	pQueue->jobs[(pQueue->head + pQueue->count) % QUEUE_CAPACITY] = job;
+	pQueue->count++;
+	m_queuedJobs++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  PopJob()
+ *
+ *  This method is used for taking the newest job of a
+ *  thread's own queue, which is the one most likely to
+ *  still have its data in the cache.
+ ***********************************************************/
+bool JobSystem::PopJob(int queueIndex, JOB& job)
+{
+	JOB_QUEUE* pQueue = m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(pQueue->mutex);
+
+	if (pQueue->count == 0)
+	{
+		return(false);
+	}
+
+	pQueue->count--;
+	job = pQueue->jobs[(pQueue->head + pQueue->count) % QUEUE_CAPACITY];
+	m_queuedJobs--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StealJob()
+ *
+ *  This method is used for taking the oldest job of the
+ *  first other queue that has one.  The search starts at
+ *  the next queue so the thieves spread over the victims.
+ ***********************************************************/
+bool JobSystem::StealJob(int queueIndex, JOB& job)
+{
+	int queueCount = (int)m_queues.size();
+
+	for (int i = 1; i < queueCount; i++)
+	{
+		JOB_QUEUE* pQueue = m_queues[(queueIndex + i) % queueCount];
+
+		// the count is checked again under the lock
+		std::unique_lock<std::mutex> lock(pQueue->mutex, std::try_to_lock);
+		if ((lock.owns_lock() == false) || (pQueue->count == 0))
+		{
+			continue;
+		}
+
+		job = pQueue->jobs[pQueue->head];
+		pQueue->head = (pQueue->head + 1) % QUEUE_CAPACITY;
+		pQueue->count--;
+		m_queuedJobs--;
+
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RunOneJob()
+ *
+ *  This method is used for running one job from the own
+ *  queue, or one stolen from another thread.  False is
+ *  returned when there was nothing to run.
+ ***********************************************************/
+bool JobSystem::RunOneJob(int queueIndex)
+{
+	JOB job;
+
+	if ((PopJob(queueIndex, job) == false) && (StealJob(queueIndex, job) == false))
+	{
+		return(false);
+	}
+
+	job.function(job.pContext, job.begin, job.end);
+	job.pPending->fetch_sub(1, std::memory_order_release);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for splitting [0, count) into chunks
+ *  on the calling thread's queue and waking the workers.
+ *  The calling thread then runs jobs itself, its own or
+ *  stolen ones, until every chunk of this loop is done.  A
+ *  chunk that does not fit in the queue runs right away.
+ ***********************************************************/
+void JobSystem::Run(JOB_FUNCTION function, const void* pContext, int count, int chunkSize)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if (chunkSize < 1)
+	{
+		chunkSize = 1;
+	}
+
+	// without workers, or with a single chunk, there is nothing to share
+	if ((m_workers.size() == 0) || (count <= chunkSize))
+	{
+		function(pContext, 0, count);
+		return;
+	}
+
+	int queueIndex = t_queueIndex;
+	std::atomic<int> pending((count + chunkSize - 1) / chunkSize);
+
+	for (int begin = 0; begin < count; begin += chunkSize)
+	{
+		JOB job;
+		job.function = function;
+		job.pContext = pContext;
+		job.begin = begin;
+		job.end = (begin + chunkSize < count) ? begin + chunkSize : count;
+		job.pPending = &pending;
+
+		if (PushJob(queueIndex, job) == false)
+		{
+			function(pContext, job.begin, job.end);
+			pending.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	m_wakeCondition.notify_all();
+
+	// help while waiting, so the calling thread is never idle
+	while (pending.load(std::memory_order_acquire) > 0)
+	{
+		if (RunOneJob(queueIndex) == false)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
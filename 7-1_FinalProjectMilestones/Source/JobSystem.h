@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// split the per-frame work into chunks that a pool of worker threads takes
+// from each other's queues
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class contains one worker thread per extra core and
+ *  one job queue per thread, with queue 0 belonging to the
+ *  main thread.  A thread pushes and pops jobs at the back
+ *  of its own queue, and an idle thread steals from the
+ *  front of the others, so the chunks of a large loop are
+ *  spread over every core without a shared queue.  The
+ *  thread that starts a loop does not block while it waits;
+ *  it keeps running jobs from the queues until its chunks
+ *  are done.  Jobs are plain function pointers with a range,
+ *  so pushing work never allocates.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor
+	JobSystem();
+	// destructor
+	~JobSystem();
+
+	// jobs that one queue can hold before chunks run inline
+	static const int QUEUE_CAPACITY = 1024;
+
+	// function run by a job over the range [begin, end)
+	typedef void (*JOB_FUNCTION)(const void* pContext, int begin, int end);
+
+private:
+	// one chunk of a loop
+	struct JOB
+	{
+		JOB_FUNCTION function;
+		const void* pContext;
+		int begin;
+		int end;
+		// chunks of the loop that are not finished yet
+		std::atomic<int>* pPending;
+	};
+
+	// ring of jobs owned by one thread
+	struct JOB_QUEUE
+	{
+		std::mutex mutex;
+		JOB jobs[QUEUE_CAPACITY];
+		// index of the oldest job and the number of jobs
+		int head;
+		int count;
+	};
+
+	// queue 0 is the main thread's, the rest belong to the workers
+	std::vector<JOB_QUEUE*> m_queues;
+	std::vector<std::thread> m_workers;
+	std::atomic<bool> m_bRunning;
+	// jobs waiting in any queue, used to wake the idle workers
+	std::atomic<int> m_queuedJobs;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+
+	// loop of each worker thread
+	void WorkerLoop(int queueIndex);
+	// add a job to the back of a queue, false when it is full
+	bool PushJob(int queueIndex, const JOB& job);
+	// take the newest job of the thread's own queue
+	bool PopJob(int queueIndex, JOB& job);
+	// take the oldest job of another thread's queue
+	bool StealJob(int queueIndex, JOB& job);
+	// run one job from the own queue or a stolen one
+	bool RunOneJob(int queueIndex);
+	// split a range into jobs and help until they are done
+	void Run(JOB_FUNCTION function, const void* pContext, int count, int chunkSize);
+
+	// calls the function object of ParallelFor()
+	template <typename FUNCTION>
+	static void InvokeFunction(const void* pContext, int begin, int end)
+	{
+		(*(const FUNCTION*)pContext)(begin, end);
+	}
+
+public:
+	// start the workers, one per core after the main thread when
+	// the count is negative
+	bool Initialize(int workerCount = -1);
+	// stop and join the workers
+	void Shutdown();
+
+	int GetWorkerCount() const;
+
+	// call function(begin, end) over [0, count) in chunks of the
+	// passed in size, returning when every chunk has finished
+	template <typename FUNCTION>
+	void ParallelFor(int count, int chunkSize, const FUNCTION& function)
+	{
+		Run(&InvokeFunction<FUNCTION>, &function, count, chunkSize);
+	}
+};
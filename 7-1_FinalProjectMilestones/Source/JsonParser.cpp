@@ -0,0 +1,361 @@
+///////////////////////////////////////////////////////////////////////////////
+// jsonparser.cpp
+// ============
+// parse the JSON text used by the scene description files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JsonParser.h"
+
+#include <cstring>
+#include <cstdlib>
+
+// declaration of global variables
+namespace
+{
+	// deepest nesting accepted, which keeps bad files from
+	// exhausting the stack
+	const int MAX_JSON_DEPTH = 64;
+}
+
+/***********************************************************
+ *  JSON_VALUE()
+ *
+ *  The constructor for the value
+ ***********************************************************/
+JsonParser::JSON_VALUE::JSON_VALUE()
+{
+	type = JSON_NULL;
+	boolean = false;
+	number = 0.0;
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the member of an object
+ *  with the passed in name.
+ ***********************************************************/
+const JsonParser::JSON_VALUE* JsonParser::JSON_VALUE::Find(const char* name) const
+{
+	for (size_t i = 0; i < members.size(); i++)
+	{
+		if (members[i].first == name)
+		{
+			return(&members[i].second);
+		}
+	}
+
+	return(NULL);
+}
+
+/***********************************************************
+ *  Parse()
+ *
+ *  This method is used for parsing the passed in text.  On
+ *  failure the error holds the message and line number.
+ ***********************************************************/
+bool JsonParser::Parse(const std::string& text, JSON_VALUE& root, std::string& error)
+{
+	PARSE_STATE state;
+	state.pText = &text;
+	state.position = 0;
+	state.line = 1;
+
+	bool bSuccess = ParseValue(state, root, 0);
+	if (bSuccess == true)
+	{
+		SkipWhitespace(state);
+		if (state.position != text.size())
+		{
+			bSuccess = Fail(state, "unexpected text after the root value");
+		}
+	}
+
+	error = state.error;
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  SkipWhitespace()
+ *
+ *  This method is used for moving past whitespace while
+ *  counting the lines for the error messages.
+ ***********************************************************/
+void JsonParser::SkipWhitespace(PARSE_STATE& state)
+{
+	const std::string& text = *state.pText;
+
+	while (state.position < text.size())
+	{
+		char character = text[state.position];
+		if (character == '\n')
+		{
+			state.line++;
+		}
+		else if ((character != ' ') && (character != '\t') && (character != '\r'))
+		{
+			return;
+		}
+		state.position++;
+	}
+}
+
+/***********************************************************
+ *  Fail()
+ *
+ *  This method is used for recording the first error.
+ ***********************************************************/
+bool JsonParser::Fail(PARSE_STATE& state, const char* message)
+{
+	if (state.error.empty() == true)
+	{
+		state.error = std::string(message) + " on line " + std::to_string(state.line);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  ParseLiteral()
+ *
+ *  This method is used for matching true, false and null.
+ ***********************************************************/
+bool JsonParser::ParseLiteral(PARSE_STATE& state, const char* literal)
+{
+	size_t length = strlen(literal);
+	if (state.pText->compare(state.position, length, literal) != 0)
+	{
+		return(Fail(state, "unknown literal"));
+	}
+
+	state.position += length;
+	return(true);
+}
+
+/***********************************************************
+ *  ParseNumber()
+ *
+ *  This method is used for reading a number.  strtod()
+ *  accepts a superset of the JSON syntax, which is fine
+ *  for hand-edited scene files.
+ ***********************************************************/
+bool JsonParser::ParseNumber(PARSE_STATE& state, double& number)
+{
+	const char* start = state.pText->c_str() + state.position;
+	char* end = NULL;
+
+	number = strtod(start, &end);
+	if (end == start)
+	{
+		return(Fail(state, "invalid number"));
+	}
+
+	state.position += (size_t)(end - start);
+	return(true);
+}
+
+/***********************************************************
+ *  ParseString()
+ *
+ *  This method is used for reading a quoted string.  The
+ *  \u escapes are only kept for the ASCII range, which is
+ *  all the scene files use.
+ ***********************************************************/
+bool JsonParser::ParseString(PARSE_STATE& state, std::string& text)
+{
+	const std::string& source = *state.pText;
+
+	// skip the opening quote
+	state.position++;
+	text.clear();
+
+	while (state.position < source.size())
+	{
+		char character = source[state.position++];
+		if (character == '"')
+		{
+			return(true);
+		}
+		if (character == '\n')
+		{
+			return(Fail(state, "unterminated string"));
+		}
+		if (character != '\\')
+		{
+			text += character;
+			continue;
+		}
+
+		if (state.position >= source.size())
+		{
+			break;
+		}
+		char escape = source[state.position++];
+		switch (escape)
+		{
+		case '"': text += '"'; break;
+		case '\\': text += '\\'; break;
+		case '/': text += '/'; break;
+		case 'b': text += '\b'; break;
+		case 'f': text += '\f'; break;
+		case 'n': text += '\n'; break;
+		case 'r': text += '\r'; break;
+		case 't': text += '\t'; break;
+		case 'u':
+			if (state.position + 4 > source.size())
+			{
+				return(Fail(state, "invalid unicode escape"));
+			}
+			else
+			{
+				long code = strtol(source.substr(state.position, 4).c_str(), NULL, 16);
+				text += (code < 128) ? (char)code : '?';
+				state.position += 4;
+			}
+			break;
+		default:
+			return(Fail(state, "invalid escape"));
+		}
+	}
+
+	return(Fail(state, "unterminated string"));
+}
+
+/***********************************************************
+ *  ParseValue()
+ *
+ *  This method is used for reading any value, recursing
+ *  into the arrays and objects.
+ ***********************************************************/
+bool JsonParser::ParseValue(PARSE_STATE& state, JSON_VALUE& value, int depth)
+{
+	const std::string& text = *state.pText;
+
+	if (depth > MAX_JSON_DEPTH)
+	{
+		return(Fail(state, "values are nested too deeply"));
+	}
+
+	SkipWhitespace(state);
+	if (state.position >= text.size())
+	{
+		return(Fail(state, "unexpected end of file"));
+	}
+
+	char character = text[state.position];
+	if (character == '{')
+	{
+		value.type = JSON_OBJECT;
+		state.position++;
+		SkipWhitespace(state);
+		if ((state.position < text.size()) && (text[state.position] == '}'))
+		{
+			state.position++;
+			return(true);
+		}
+
+		while (true)
+		{
+			SkipWhitespace(state);
+			if ((state.position >= text.size()) || (text[state.position] != '"'))
+			{
+				return(Fail(state, "expected a member name"));
+			}
+
+			std::pair<std::string, JSON_VALUE> member;
+			if (ParseString(state, member.first) == false)
+			{
+				return(false);
+			}
+
+			SkipWhitespace(state);
+			if ((state.position >= text.size()) || (text[state.position] != ':'))
+			{
+				return(Fail(state, "expected ':' after the member name"));
+			}
+			state.position++;
+
+			if (ParseValue(state, member.second, depth + 1) == false)
+			{
+				return(false);
+			}
+			value.members.push_back(member);
+
+			SkipWhitespace(state);
+			if ((state.position < text.size()) && (text[state.position] == ','))
+			{
+				state.position++;
+			}
+			else if ((state.position < text.size()) && (text[state.position] == '}'))
+			{
+				state.position++;
+				return(true);
+			}
+			else
+			{
+				return(Fail(state, "expected ',' or '}' in the object"));
+			}
+		}
+	}
+	else if (character == '[')
+	{
+		value.type = JSON_ARRAY;
+		state.position++;
+		SkipWhitespace(state);
+		if ((state.position < text.size()) && (text[state.position] == ']'))
+		{
+			state.position++;
+			return(true);
+		}
+
+		while (true)
+		{
+			JSON_VALUE element;
+			if (ParseValue(state, element, depth + 1) == false)
+			{
+				return(false);
+			}
+			value.elements.push_back(element);
+
+			SkipWhitespace(state);
+			if ((state.position < text.size()) && (text[state.position] == ','))
+			{
+				state.position++;
+			}
+			else if ((state.position < text.size()) && (text[state.position] == ']'))
+			{
+				state.position++;
+				return(true);
+			}
+			else
+			{
+				return(Fail(state, "expected ',' or ']' in the array"));
+			}
+		}
+	}
+	else if (character == '"')
+	{
+		value.type = JSON_STRING;
+		return(ParseString(state, value.text));
+	}
+	else if (character == 't')
+	{
+		value.type = JSON_BOOL;
+		value.boolean = true;
+		return(ParseLiteral(state, "true"));
+	}
+	else if (character == 'f')
+	{
+		value.type = JSON_BOOL;
+		value.boolean = false;
+		return(ParseLiteral(state, "false"));
+	}
+	else if (character == 'n')
+	{
+		value.type = JSON_NULL;
+		return(ParseLiteral(state, "null"));
+	}
+
+	value.type = JSON_NUMBER;
+	return(ParseNumber(state, value.number));
+}
@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// jsonparser.h
+// ============
+// parse the JSON text used by the scene description files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+/***********************************************************
+ *  JsonParser
+ *
+ *  This class contains a small JSON reader that builds a
+ *  tree of values.  Errors are reported with the line they
+ *  were found on, and the whole parse fails on the first
+ *  one.
+ ***********************************************************/
+class JsonParser
+{
+public:
+	// kind of a parsed value
+	enum JSON_TYPE
+	{
+		JSON_NULL = 0,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// one parsed value and its children
+	struct JSON_VALUE
+	{
+		JSON_TYPE type;
+		bool boolean;
+		double number;
+		std::string text;
+		std::vector<JSON_VALUE> elements;
+		std::vector<std::pair<std::string, JSON_VALUE> > members;
+
+		JSON_VALUE();
+
+		// get a member of an object, NULL when it is missing
+		const JSON_VALUE* Find(const char* name) const;
+	};
+
+	// parse the passed in text into the root value
+	static bool Parse(const std::string& text, JSON_VALUE& root, std::string& error);
+
+private:
+	// position of the parser inside the text
+	struct PARSE_STATE
+	{
+		const std::string* pText;
+		size_t position;
+		int line;
+		std::string error;
+	};
+
+	static void SkipWhitespace(PARSE_STATE& state);
+	static bool Fail(PARSE_STATE& state, const char* message);
+	static bool ParseValue(PARSE_STATE& state, JSON_VALUE& value, int depth);
+	static bool ParseString(PARSE_STATE& state, std::string& text);
+	static bool ParseNumber(PARSE_STATE& state, double& number);
+	static bool ParseLiteral(PARSE_STATE& state, const char* literal);
+};
@@ -0,0 +1,579 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.cpp
+// ============
+// manage the light sources of the 3D scene and the clustered light lists
+// that the fragment shader loops over
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightManager.h"
+#include "ShaderLoader.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	const char* g_LightCullShaderFile = "shaders/lightCullingCompute.glsl";
+
+	// must match local_size_x in the light culling compute shader
+	const GLuint LIGHT_CULL_GROUP_SIZE = 64;
+
+	// shader storage binding points shared with the fragment shader
+	const GLuint LIGHT_BINDING = 3;
+	const GLuint CLUSTER_BINDING = 4;
+	const GLuint LIGHT_INDEX_BINDING = 5;
+
+	const int CLUSTER_COUNT =
+		LightManager::CLUSTER_COLUMNS * LightManager::CLUSTER_ROWS * LightManager::CLUSTER_SLICES;
+}
+
+/***********************************************************
+ *  LightManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightManager::LightManager()
+{
+	m_cullProgramID = 0;
+	m_lightBuffer = 0;
+	m_clusterBuffer = 0;
+	m_lightIndexBuffer = 0;
+	m_lightBufferCapacity = 0;
+	m_bSupported = false;
+	m_bLightsDirty = false;
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
+	m_viewportWidth = 1;
+	m_viewportHeight = 1;
+	m_clusterNear = 0.1f;
+	m_clusterFar = 100.0f;
+	m_bLogDepth = true;
+}
+
+/***********************************************************
+ *  ~LightManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightManager::~LightManager()
+{
+	if (m_cullProgramID != 0)
+	{
+		glDeleteProgram(m_cullProgramID);
+		m_cullProgramID = 0;
+	}
+	if (m_lightBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightBuffer);
+		glDeleteBuffers(1, &m_clusterBuffer);
+		glDeleteBuffers(1, &m_lightIndexBuffer);
+		m_lightBuffer = 0;
+		m_clusterBuffer = 0;
+		m_lightIndexBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the storage buffers of
+ *  the lights and the clusters, and loading the compute
+ *  program that fills the clusters.  When the program does
+ *  not load, the clusters are filled on the CPU instead.
+ ***********************************************************/
+bool LightManager::Initialize()
+{
+	// shader storage buffers need an OpenGL 4.3 context
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Could not create the light buffers, OpenGL 4.3 is not available" << std::endl;
+		return(false);
+	}
+
+	glGenBuffers(1, &m_lightBuffer);
+	glGenBuffers(1, &m_clusterBuffer);
+	glGenBuffers(1, &m_lightIndexBuffer);
+
+	// the light buffer always holds at least one light so that
+	// it can be bound before any lights are added
+	m_lightBufferCapacity = 1;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(LIGHT_SOURCE), NULL, GL_DYNAMIC_DRAW);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * 2 * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+
+	// the first element is the number of used light indices
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER,
+		(1 + CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_cullProgramID = ShaderLoader::LoadComputeProgram(g_LightCullShaderFile);
+	if (m_cullProgramID == 0)
+	{
+		std::cout << "INFO: light culling compute program failed to load, using the CPU" << std::endl;
+	}
+
+	m_bSupported = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light source to the
+ *  scene.  A range of zero keeps the light unattenuated and
+ *  places it in every cluster.
+ ***********************************************************/
+int LightManager::AddLight(
+	glm::vec3 position,
+	glm::vec3 ambientColor,
+	glm::vec3 diffuseColor,
+	glm::vec3 specularColor,
+	float focalStrength,
+	float specularIntensity,
+	float range)
+{
+	LIGHT_SOURCE light;
+	light.position = position;
+	light.range = range;
+	light.ambientColor = ambientColor;
+	light.focalStrength = focalStrength;
+	light.diffuseColor = diffuseColor;
+	light.specularIntensity = specularIntensity;
+	light.specularColor = specularColor;
+	light.shadowIndex = -1;
+
+	m_lights.push_back(light);
+	m_bLightsDirty = true;
+
+	return((int)m_lights.size() - 1);
+}
+
+/***********************************************************
+ *  SetLightPosition()
+ *
+ *  This method is used for moving a previously added light.
+ ***********************************************************/
+void LightManager::SetLightPosition(int lightIndex, glm::vec3 position)
+{
+	if ((lightIndex < 0) || (lightIndex >= (int)m_lights.size()))
+	{
+		return;
+	}
+
+	if (m_lights[lightIndex].position != position)
+	{
+		m_lights[lightIndex].position = position;
+		m_bLightsDirty = true;
+	}
+}
+
+/***********************************************************
+ *  SetLightShadow()
+ *
+ *  This method is used for setting which entry of the
+ *  shadow data a light reads its shadow map from.
+ ***********************************************************/
+void LightManager::SetLightShadow(int lightIndex, int shadowIndex)
+{
+	if ((lightIndex < 0) || (lightIndex >= (int)m_lights.size()))
+	{
+		return;
+	}
+
+	m_lights[lightIndex].shadowIndex = shadowIndex;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetLight()
+ *
+ *  This method is used for getting a previously added light,
+ *  or NULL for an unknown index.
+ ***********************************************************/
+const LightManager::LIGHT_SOURCE* LightManager::GetLight(int lightIndex) const
+{
+	if ((lightIndex < 0) || (lightIndex >= (int)m_lights.size()))
+	{
+		return(NULL);
+	}
+
+	return(&m_lights[lightIndex]);
+}
+
+/***********************************************************
+ *  ClearLights()
+ *
+ *  This method is used for removing all of the lights.
+ ***********************************************************/
+void LightManager::ClearLights()
+{
+	m_lights.clear();
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of lights.
+ ***********************************************************/
+int LightManager::GetLightCount() const
+{
+	return((int)m_lights.size());
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method is used for setting the view of the current
+ *  frame.  The near and far distances are read back out of
+ *  the projection, so the depth slices always cover the
+ *  visible range.  A perspective projection uses slices
+ *  that grow with the distance, an orthographic one uses
+ *  evenly spaced slices.
+ ***********************************************************/
+void LightManager::SetView(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int viewportWidth,
+	int viewportHeight)
+{
+	m_view = view;
+	m_projection = projection;
+	m_viewportWidth = std::max(viewportWidth, 1);
+	m_viewportHeight = std::max(viewportHeight, 1);
+
+	if (projection[2][3] != 0.0f)
+	{
+		m_clusterNear = projection[3][2] / (projection[2][2] - 1.0f);
+		m_clusterFar = projection[3][2] / (projection[2][2] + 1.0f);
+		m_bLogDepth = true;
+	}
+	else
+	{
+		m_clusterNear = (projection[3][2] + 1.0f) / projection[2][2];
+		m_clusterFar = (projection[3][2] - 1.0f) / projection[2][2];
+		m_bLogDepth = false;
+	}
+}
+
+/***********************************************************
+ *  UploadLights()
+ *
+ *  This method is used for copying the light list into the
+ *  light buffer, which only grows when it is too small.
+ ***********************************************************/
+void LightManager::UploadLights()
+{
+	GLuint lightCount = (GLuint)m_lights.size();
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+	if (lightCount > m_lightBufferCapacity)
+	{
+		m_lightBufferCapacity = lightCount;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, lightCount * sizeof(LIGHT_SOURCE), NULL, GL_DYNAMIC_DRAW);
+	}
+	if (lightCount > 0)
+	{
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightCount * sizeof(LIGHT_SOURCE), &m_lights[0]);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_bLightsDirty = false;
+}
+
+/***********************************************************
+ *  GetSliceDepth()
+ *
+ *  This method is used for getting the view distance where
+ *  a depth slice begins.
+ ***********************************************************/
+float LightManager::GetSliceDepth(int slice) const
+{
+	float t = (float)slice / (float)CLUSTER_SLICES;
+
+	if (m_bLogDepth == true)
+	{
+		return(m_clusterNear * std::pow(m_clusterFar / m_clusterNear, t));
+	}
+	return(m_clusterNear + (m_clusterFar - m_clusterNear) * t);
+}
+
+/***********************************************************
+ *  GetClusterBounds()
+ *
+ *  This method is used for getting the view space bounding
+ *  box of a cluster.  The lines through the corners of the
+ *  tile are cut at the near and far distance of the slice.
+ ***********************************************************/
+void LightManager::GetClusterBounds(
+	int column,
+	int row,
+	int slice,
+	const glm::mat4& inverseProjection,
+	glm::vec3& minimum,
+	glm::vec3& maximum) const
+{
+	glm::vec2 ndcMinimum = glm::vec2(
+		(float)column / CLUSTER_COLUMNS * 2.0f - 1.0f,
+		(float)row / CLUSTER_ROWS * 2.0f - 1.0f);
+	glm::vec2 ndcMaximum = glm::vec2(
+		(float)(column + 1) / CLUSTER_COLUMNS * 2.0f - 1.0f,
+		(float)(row + 1) / CLUSTER_ROWS * 2.0f - 1.0f);
+	float depths[2] = { GetSliceDepth(slice), GetSliceDepth(slice + 1) };
+
+	minimum = glm::vec3(1.0e30f);
+	maximum = glm::vec3(-1.0e30f);
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec2 ndcCorner = glm::vec2(
+			((i & 1) != 0) ? ndcMaximum.x : ndcMinimum.x,
+			((i & 2) != 0) ? ndcMaximum.y : ndcMinimum.y);
+
+		glm::vec4 nearPoint = inverseProjection * glm::vec4(ndcCorner, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseProjection * glm::vec4(ndcCorner, 1.0f, 1.0f);
+		glm::vec3 start = glm::vec3(nearPoint) / nearPoint.w;
+		glm::vec3 end = glm::vec3(farPoint) / farPoint.w;
+
+		float t = (-depths[i >> 2] - start.z) / (end.z - start.z);
+		glm::vec3 corner = start + (end - start) * t;
+
+		minimum = glm::min(minimum, corner);
+		maximum = glm::max(maximum, corner);
+	}
+}
+
+/***********************************************************
+ *  CullLightsOnCPU()
+ *
+ *  This method is used for filling the clusters on the CPU
+ *  with the same tests as the compute pass, then uploading
+ *  the cluster and light index lists.
+ ***********************************************************/
+void LightManager::CullLightsOnCPU(const glm::mat4& inverseProjection)
+{
+	m_clusterData.resize(CLUSTER_COUNT * 2);
+	m_lightIndices.clear();
+	// the first element is the number of used light indices
+	m_lightIndices.push_back(0);
+
+	// the lights are moved into view space once per frame
+	std::vector<glm::vec3> viewPositions(m_lights.size());
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		viewPositions[i] = glm::vec3(m_view * glm::vec4(m_lights[i].position, 1.0f));
+	}
+
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		int column = cluster % CLUSTER_COLUMNS;
+		int row = (cluster / CLUSTER_COLUMNS) % CLUSTER_ROWS;
+		int slice = cluster / (CLUSTER_COLUMNS * CLUSTER_ROWS);
+
+		glm::vec3 minimum;
+		glm::vec3 maximum;
+		GetClusterBounds(column, row, slice, inverseProjection, minimum, maximum);
+
+		GLuint offset = (GLuint)m_lightIndices.size() - 1;
+		GLuint clusterLightCount = 0;
+		for (size_t i = 0; (i < m_lights.size()) && (clusterLightCount < MAX_LIGHTS_PER_CLUSTER); i++)
+		{
+			bool bInside = (m_lights[i].range <= 0.0f);
+			if (bInside == false)
+			{
+				glm::vec3 closestPoint = glm::clamp(viewPositions[i], minimum, maximum);
+				glm::vec3 offsetToLight = closestPoint - viewPositions[i];
+				bInside = (glm::dot(offsetToLight, offsetToLight) <= m_lights[i].range * m_lights[i].range);
+			}
+
+			if (bInside == true)
+			{
+				m_lightIndices.push_back((GLuint)i);
+				clusterLightCount++;
+			}
+		}
+
+		m_clusterData[cluster * 2] = offset;
+		m_clusterData[cluster * 2 + 1] = clusterLightCount;
+	}
+	m_lightIndices[0] = (GLuint)m_lightIndices.size() - 1;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_clusterData.size() * sizeof(GLuint), &m_clusterData[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_lightIndices.size() * sizeof(GLuint), &m_lightIndices[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  CullLights()
+ *
+ *  This method is used for binning every light into the
+ *  clusters it overlaps.  Each cluster gets a range of the
+ *  shared light index list, which the fragment shader walks
+ *  instead of looping over all of the lights.
+ ***********************************************************/
+void LightManager::CullLights()
+{
+	if (m_bSupported == false)
+	{
+		return;
+	}
+
+	if (m_bLightsDirty == true)
+	{
+		UploadLights();
+	}
+
+	glm::mat4 inverseProjection = glm::inverse(m_projection);
+
+	if (m_cullProgramID == 0)
+	{
+		CullLightsOnCPU(inverseProjection);
+		return;
+	}
+
+	// reset the number of used light indices to zero
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+	glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the scene program is restored once the pass is dispatched
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_cullProgramID);
+
+	glUniform1ui(glGetUniformLocation(m_cullProgramID, "lightCount"), (GLuint)m_lights.size());
+	glUniformMatrix4fv(glGetUniformLocation(m_cullProgramID, "view"), 1, GL_FALSE, glm::value_ptr(m_view));
+	glUniformMatrix4fv(glGetUniformLocation(m_cullProgramID, "inverseProjection"), 1, GL_FALSE, glm::value_ptr(inverseProjection));
+	glUniform3i(glGetUniformLocation(m_cullProgramID, "clusterGridSize"), CLUSTER_COLUMNS, CLUSTER_ROWS, CLUSTER_SLICES);
+	glUniform1f(glGetUniformLocation(m_cullProgramID, "clusterNear"), m_clusterNear);
+	glUniform1f(glGetUniformLocation(m_cullProgramID, "clusterFar"), m_clusterFar);
+	glUniform1i(glGetUniformLocation(m_cullProgramID, "bClusterLogDepth"), m_bLogDepth);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BINDING, m_lightIndexBuffer);
+
+	glDispatchCompute((CLUSTER_COUNT + LIGHT_CULL_GROUP_SIZE - 1) / LIGHT_CULL_GROUP_SIZE, 1, 1);
+
+	// the cluster lists are read by the following fragment shaders
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  GetDepthMapping()
+ *
+ *  This method is used for getting the scale and bias that
+ *  turn a view depth into a depth slice.  The shaders take
+ *  the log of the depth first for the logarithmic slices.
+ ***********************************************************/
+void LightManager::GetDepthMapping(float& depthScale, float& depthBias) const
+{
+	if (m_bLogDepth == true)
+	{
+		float logRange = std::log(m_clusterFar / m_clusterNear);
+		depthScale = (float)CLUSTER_SLICES / logRange;
+		depthBias = -(float)CLUSTER_SLICES * std::log(m_clusterNear) / logRange;
+	}
+	else
+	{
+		depthScale = (float)CLUSTER_SLICES / (m_clusterFar - m_clusterNear);
+		depthBias = -(float)CLUSTER_SLICES * m_clusterNear / (m_clusterFar - m_clusterNear);
+	}
+}
+
+/***********************************************************
+ *  SetShaderValues()
+ *
+ *  This method is used for binding the light buffers and
+ *  setting the layout of the cluster grid into the shader,
+ *  so each fragment can find the lights of its cluster.
+ ***********************************************************/
+void LightManager::SetShaderValues(ShaderManager* pShaderManager)
+{
+	if ((m_bSupported == false) || (NULL == pShaderManager))
+	{
+		return;
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BINDING, m_lightIndexBuffer);
+
+	float depthScale = 0.0f;
+	float depthBias = 0.0f;
+	GetDepthMapping(depthScale, depthBias);
+
+	pShaderManager->setIntValue("lightCount", (int)m_lights.size());
+	pShaderManager->setIntValue("clusterColumns", CLUSTER_COLUMNS);
+	pShaderManager->setIntValue("clusterRows", CLUSTER_ROWS);
+	pShaderManager->setIntValue("clusterSlices", CLUSTER_SLICES);
+	pShaderManager->setVec2Value("clusterTileSize", glm::vec2(
+		(float)m_viewportWidth / CLUSTER_COLUMNS,
+		(float)m_viewportHeight / CLUSTER_ROWS));
+	pShaderManager->setFloatValue("clusterDepthScale", depthScale);
+	pShaderManager->setFloatValue("clusterDepthBias", depthBias);
+	pShaderManager->setBoolValue("bClusterLogDepth", m_bLogDepth);
+}
+
+/***********************************************************
+ *  SetProgramValues()
+ *
+ *  This method is used for binding the light buffers and
+ *  setting the layout of the cluster grid into a program
+ *  that is currently in use, such as the deferred lighting
+ *  pass.
+ ***********************************************************/
+void LightManager::SetProgramValues(GLuint programID)
+{
+	if ((m_bSupported == false) || (programID == 0))
+	{
+		return;
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BINDING, m_lightIndexBuffer);
+
+	float depthScale = 0.0f;
+	float depthBias = 0.0f;
+	GetDepthMapping(depthScale, depthBias);
+
+	glUniform1i(glGetUniformLocation(programID, "lightCount"), (int)m_lights.size());
+	glUniform1i(glGetUniformLocation(programID, "clusterColumns"), CLUSTER_COLUMNS);
+	glUniform1i(glGetUniformLocation(programID, "clusterRows"), CLUSTER_ROWS);
+	glUniform1i(glGetUniformLocation(programID, "clusterSlices"), CLUSTER_SLICES);
+	glUniform2f(glGetUniformLocation(programID, "clusterTileSize"),
+		(float)m_viewportWidth / CLUSTER_COLUMNS,
+		(float)m_viewportHeight / CLUSTER_ROWS);
+	glUniform1f(glGetUniformLocation(programID, "clusterDepthScale"), depthScale);
+	glUniform1f(glGetUniformLocation(programID, "clusterDepthBias"), depthBias);
+	glUniform1i(glGetUniformLocation(programID, "bClusterLogDepth"), m_bLogDepth);
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for rebuilding the light binning
+ *  program when its file is edited.  The CPU binning stays
+ *  in use when the program never compiled.
+ ***********************************************************/
+void LightManager::WatchShaders(ShaderHotReload* pHotReload)
+{
+	if ((NULL == pHotReload) || (m_cullProgramID == 0))
+	{
+		return;
+	}
+
+	pHotReload->WatchComputeProgram(&m_cullProgramID, g_LightCullShaderFile);
+}
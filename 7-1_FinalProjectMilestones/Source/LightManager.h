@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.h
+// ============
+// manage the light sources of the 3D scene and the clustered light lists
+// that the fragment shader loops over
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderHotReload.h"
+
+#include <GL/glew.h>        // GLEW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightManager
+ *
+ *  This class contains the code for storing the lights in a
+ *  shader storage buffer and binning them into a grid of
+ *  screen space tiles and depth slices.  Each fragment only
+ *  shades the lights of its own cluster, so the number of
+ *  lights in the scene is no longer limited by the shader.
+ ***********************************************************/
+class LightManager
+{
+public:
+	// constructor
+	LightManager();
+	// destructor
+	~LightManager();
+
+	// size of the cluster grid
+	static const int CLUSTER_COLUMNS = 16;
+	static const int CLUSTER_ROWS = 9;
+	static const int CLUSTER_SLICES = 24;
+	// most lights that can affect a single cluster
+	static const int MAX_LIGHTS_PER_CLUSTER = 64;
+
+	// one light source - this must match the std430 layout
+	// of LightSource in the shaders
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		// distance where the light fades out, 0 for no limit
+		float range;
+		glm::vec3 ambientColor;
+		float focalStrength;
+		glm::vec3 diffuseColor;
+		float specularIntensity;
+		glm::vec3 specularColor;
+		// index into the shadow data, -1 for no shadows
+		GLint shadowIndex;
+	};
+
+private:
+	// compute program that bins the lights into the clusters
+	GLuint m_cullProgramID;
+	// buffer holding the LIGHT_SOURCE entries
+	GLuint m_lightBuffer;
+	// buffer holding the offset and count of every cluster
+	GLuint m_clusterBuffer;
+	// buffer holding the count and the light indices of all clusters
+	GLuint m_lightIndexBuffer;
+	// allocated size of the light buffer in lights
+	GLuint m_lightBufferCapacity;
+	// true when the storage buffers could be created
+	bool m_bSupported;
+	// true when the light buffer must be uploaded again
+	bool m_bLightsDirty;
+	// lights in the scene
+	std::vector<LIGHT_SOURCE> m_lights;
+	// view of the current frame
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	int m_viewportWidth;
+	int m_viewportHeight;
+	// view distances covered by the depth slices
+	float m_clusterNear;
+	float m_clusterFar;
+	// true when the depth slices are spaced logarithmically
+	bool m_bLogDepth;
+	// cluster and light index lists built by the CPU fallback
+	std::vector<GLuint> m_clusterData;
+	std::vector<GLuint> m_lightIndices;
+
+	// upload the light list to the light buffer
+	void UploadLights();
+	// view distance where a depth slice begins
+	float GetSliceDepth(int slice) const;
+	// view space bounds of one cluster
+	void GetClusterBounds(
+		int column,
+		int row,
+		int slice,
+		const glm::mat4& inverseProjection,
+		glm::vec3& minimum,
+		glm::vec3& maximum) const;
+	// bin the lights on the CPU when the compute pass is missing
+	void CullLightsOnCPU(const glm::mat4& inverseProjection);
+	// get the mapping from view depth to depth slice
+	void GetDepthMapping(float& depthScale, float& depthBias) const;
+
+public:
+	// create the storage buffers and the culling program
+	bool Initialize();
+
+	// add a light source and get its index
+	int AddLight(
+		glm::vec3 position,
+		glm::vec3 ambientColor,
+		glm::vec3 diffuseColor,
+		glm::vec3 specularColor,
+		float focalStrength,
+		float specularIntensity,
+		float range = 0.0f);
+	// move a previously added light
+	void SetLightPosition(int lightIndex, glm::vec3 position);
+	// set the shadow map used by a light, -1 for none
+	void SetLightShadow(int lightIndex, int shadowIndex);
+	// get a previously added light, NULL for an unknown index
+	const LIGHT_SOURCE* GetLight(int lightIndex) const;
+	// remove all of the lights
+	void ClearLights();
+	// get the number of lights in the scene
+	int GetLightCount() const;
+
+	// set the view that the clusters are built for
+	void SetView(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int viewportWidth,
+		int viewportHeight);
+	// bin the lights into the clusters of the current view
+	void CullLights();
+	// bind the light buffers and set the cluster grid into the shader
+	void SetShaderValues(ShaderManager* pShaderManager);
+	// same as above for a program outside of the shader manager
+	void SetProgramValues(GLuint programID);
+	// rebuild the binning program when its file is edited
+	void WatchShaders(ShaderHotReload* pHotReload);
+};
@@ -0,0 +1,335 @@
+///////////////////////////////////////////////////////////////////////////////
+// lodselector.cpp
+// ============
+// choose the level of detail of the tessellated shapes from their
+// projected size on the screen
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LodSelector.h"
+
+#include <iostream>
+#include <cfloat>
+
+// declaration of global variables
+namespace
+{
+	// default hysteresis - a size must pass a threshold by 15%
+	const float DEFAULT_HYSTERESIS = 0.15f;
+}
+
+/***********************************************************
+ *  LodSelector()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LodSelector::LodSelector()
+{
+	m_drawSlot = 0;
+	m_hysteresis = DEFAULT_HYSTERESIS;
+	m_view = glm::mat4(1.0f);
+	m_pixelScale = 0.0f;
+	m_bOrthographic = false;
+}
+
+/***********************************************************
+ *  AddLodChain()
+ *
+ *  This method is used for defining a chain of meshes for
+ *  one shape, ordered from the finest to the coarsest, with
+ *  the smallest projected diameter in pixels where each
+ *  level is still used.  The last level should use a size
+ *  of zero so every distance has a mesh.  Returns the chain
+ *  ID, which reuses the ID of a removed chain, or -1 if the
+ *  passed in levels are not valid.
+ ***********************************************************/
+int LodSelector::AddLodChain(const int* meshIDs, const float* minScreenSizes, int levelCount)
+{
+	if ((NULL == meshIDs) || (NULL == minScreenSizes) ||
+		(levelCount < 1) || (levelCount > MAX_LOD_LEVELS))
+	{
+		std::cout << "Could not add LOD chain with " << levelCount << " levels" << std::endl;
+		return(-1);
+	}
+
+	LOD_CHAIN chain;
+	for (int i = 0; i < levelCount; i++)
+	{
+		chain.meshIDs[i] = meshIDs[i];
+		chain.minScreenSizes[i] = minScreenSizes[i];
+	}
+	chain.levelCount = levelCount;
+
+	for (size_t i = 0; i < m_chains.size(); i++)
+	{
+		if (m_chains[i].levelCount == 0)
+		{
+			m_chains[i] = chain;
+			return((int)i);
+		}
+	}
+
+	m_chains.push_back(chain);
+
+	return((int)m_chains.size() - 1);
+}
+
+/***********************************************************
+ *  RemoveLodChain()
+ *
+ *  This method is used for releasing a chain whose meshes
+ *  were removed.  The draws that used it forget their level,
+ *  so a chain added with the same ID starts over.
+ ***********************************************************/
+void LodSelector::RemoveLodChain(int chainID)
+{
+	if ((chainID < 0) || (chainID >= (int)m_chains.size()))
+	{
+		return;
+	}
+
+	m_chains[chainID].levelCount = 0;
+
+	for (size_t i = 0; i < m_drawStates.size(); i++)
+	{
+		if (m_drawStates[i].chainID == chainID)
+		{
+			m_drawStates[i].chainID = -1;
+			m_drawStates[i].level = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  SetHysteresis()
+ *
+ *  This method is used for setting how far past a threshold
+ *  the projected size must move before the level changes,
+ *  as a fraction of the threshold.
+ ***********************************************************/
+void LodSelector::SetHysteresis(float hysteresis)
+{
+	m_hysteresis = glm::clamp(hysteresis, 0.0f, 0.9f);
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method is used for setting the view and projection
+ *  of the current frame.  Only the vertical scale of the
+ *  projection is needed to turn a size into pixels.
+ ***********************************************************/
+void LodSelector::SetView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight)
+{
+	m_view = view;
+	// a perspective projection copies -z into w, an orthographic one does not
+	m_bOrthographic = (projection[2][3] == 0.0f);
+	m_pixelScale = projection[1][1] * (float)viewportHeight * 0.5f;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for restarting the draw slots.  The
+ *  scene issues its draws in the same order every frame, so
+ *  the slot number identifies a draw across frames.
+ ***********************************************************/
+void LodSelector::BeginFrame()
+{
+	m_drawSlot = 0;
+}
+
+/***********************************************************
+ *  GetScreenSize()
+ *
+ *  This method is used for getting the projected diameter
+ *  in pixels of a bounding sphere in world space.
+ ***********************************************************/
+float LodSelector::GetScreenSize(glm::vec3 center, float radius) const
+{
+	float diameter = 2.0f * radius * m_pixelScale;
+
+	if (m_bOrthographic == true)
+	{
+		return(diameter);
+	}
+
+	glm::vec3 viewCenter = glm::vec3(m_view * glm::vec4(center, 1.0f));
+	float distance = glm::length(viewCenter);
+
+	// the camera is inside the sphere, so it covers the screen
+	if (distance <= radius)
+	{
+		return(FLT_MAX);
+	}
+
+	return(diameter / distance);
+}
+
+/***********************************************************
+ *  SelectMesh()
+ *
+ *  This method is used for picking the mesh of a chain for
+ *  the next draw.  Starting from the level this draw used
+ *  in the previous frame, the level only gets finer once
+ *  the size passes the finer threshold by the hysteresis,
+ *  and only gets coarser once the size drops the same
+ *  fraction below the current threshold.
+ ***********************************************************/
+int LodSelector::SelectMesh(int chainID, glm::vec3 center, float radius)
+{
+	ReserveDrawSlots(m_drawSlot + 1);
+	int meshID = SelectMeshForSlot(chainID, m_drawSlot, center, radius);
+	m_drawSlot++;
+
+	return(meshID);
+}
+
+/***********************************************************
+ *  ReserveDrawSlots()
+ *
+ *  This method is used for making sure the passed in number
+ *  of draw slots exist, so SelectMeshForSlot() can be
+ *  called from several threads without growing the list.
+ ***********************************************************/
+void LodSelector::ReserveDrawSlots(int slotCount)
+{
+	if (slotCount > (int)m_drawStates.size())
+	{
+		DRAW_STATE state;
+		state.chainID = -1;
+		state.level = 0;
+		m_drawStates.resize(slotCount, state);
+	}
+}
+
+/***********************************************************
+ *  SelectMeshForSlot()
+ *
+ *  This method is used for picking the mesh of a chain for
+ *  an explicit draw slot.  Only the state of that slot is
+ *  touched, so draws with different slots can be selected
+ *  at the same time.
+ ***********************************************************/
+int LodSelector::SelectMeshForSlot(int chainID, int drawSlot, glm::vec3 center, float radius)
+{
+	if ((chainID < 0) || (chainID >= (int)m_chains.size()) ||
+		(m_chains[chainID].levelCount == 0) ||
+		(drawSlot < 0) || (drawSlot >= (int)m_drawStates.size()))
+	{
+		return(-1);
+	}
+
+	const LOD_CHAIN& chain = m_chains[chainID];
+	float screenSize = GetScreenSize(center, radius);
+
+	DRAW_STATE& state = m_drawStates[drawSlot];
+
+	int level = 0;
+	if (state.chainID == chainID)
+	{
+		level = glm::clamp(state.level, 0, chain.levelCount - 1);
+		while ((level > 0) &&
+			(screenSize >= chain.minScreenSizes[level - 1] * (1.0f + m_hysteresis)))
+		{
+			level--;
+		}
+		while ((level < chain.levelCount - 1) &&
+			(screenSize < chain.minScreenSizes[level] * (1.0f - m_hysteresis)))
+		{
+			level++;
+		}
+	}
+	else
+	{
+		// a new draw takes the level of its size directly
+		while ((level < chain.levelCount - 1) &&
+			(screenSize < chain.minScreenSizes[level]))
+		{
+			level++;
+		}
+	}
+
+	state.chainID = chainID;
+	state.level = level;
+
+	return(chain.meshIDs[level]);
+}
+
+/***********************************************************
+ *  GetLodMesh()
+ *
+ *  This method is used for getting the mesh of one level of
+ *  a chain, or -1 for an unknown chain or level.
+ ***********************************************************/
+int LodSelector::GetLodMesh(int chainID, int level) const
+{
+	if ((chainID < 0) || (chainID >= (int)m_chains.size()) ||
+		(level < 0) || (level >= m_chains[chainID].levelCount))
+	{
+		return(-1);
+	}
+
+	return(m_chains[chainID].meshIDs[level]);
+}
+
+/***********************************************************
+ *  GetMinScreenSize()
+ *
+ *  This method is used for getting the smallest projected
+ *  diameter in pixels where a level of a chain is still
+ *  used, or zero for an unknown chain or level.
+ ***********************************************************/
+float LodSelector::GetMinScreenSize(int chainID, int level) const
+{
+	if ((chainID < 0) || (chainID >= (int)m_chains.size()) ||
+		(level < 0) || (level >= m_chains[chainID].levelCount))
+	{
+		return(0.0f);
+	}
+
+	return(m_chains[chainID].minScreenSizes[level]);
+}
+
+/***********************************************************
+ *  GetView()
+ *
+ *  This method is used for getting the view matrix of the
+ *  current frame.
+ ***********************************************************/
+const glm::mat4& LodSelector::GetView() const
+{
+	return(m_view);
+}
+
+/***********************************************************
+ *  GetPixelScale()
+ *
+ *  This method is used for getting the pixels per unit of
+ *  size at a distance of one unit.
+ ***********************************************************/
+float LodSelector::GetPixelScale() const
+{
+	return(m_pixelScale);
+}
+
+/***********************************************************
+ *  GetHysteresis()
+ *
+ *  This method is used for getting the fraction that a size
+ *  must pass a threshold by before the level changes.
+ ***********************************************************/
+float LodSelector::GetHysteresis() const
+{
+	return(m_hysteresis);
+}
+
+/***********************************************************
+ *  IsOrthographic()
+ *
+ *  This method is used for checking whether the projection
+ *  of the current frame does not divide by the distance.
+ ***********************************************************/
+bool LodSelector::IsOrthographic() const
+{
+	return(m_bOrthographic);
+}
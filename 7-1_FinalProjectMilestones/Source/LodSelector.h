@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// lodselector.h
+// ============
+// choose the level of detail of the tessellated shapes from their
+// projected size on the screen
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LodSelector
+ *
+ *  This class contains the code for picking one mesh out of
+ *  a chain of tessellations of the same shape.  The choice
+ *  is made per draw from the projected diameter of the
+ *  bounding sphere in pixels, and each draw remembers its
+ *  last level so a size near a threshold does not flicker
+ *  between two levels.
+ ***********************************************************/
+class LodSelector
+{
+public:
+	// constructor
+	LodSelector();
+
+	// most levels that one LOD chain can hold
+	static const int MAX_LOD_LEVELS = 4;
+
+private:
+	// the meshes of one shape, from the finest to the coarsest,
+	// a removed chain has no levels
+	struct LOD_CHAIN
+	{
+		int meshIDs[MAX_LOD_LEVELS];
+		// smallest projected diameter in pixels for each level
+		float minScreenSizes[MAX_LOD_LEVELS];
+		int levelCount;
+	};
+
+	// level chosen by one draw in the previous frame
+	struct DRAW_STATE
+	{
+		int chainID;
+		int level;
+	};
+
+	// defined LOD chains, indexed by chain ID
+	std::vector<LOD_CHAIN> m_chains;
+	// previous choices, indexed by the order of the draws
+	std::vector<DRAW_STATE> m_drawStates;
+	// next draw slot in the current frame
+	int m_drawSlot;
+	// fraction that a size must pass a threshold by to switch
+	float m_hysteresis;
+	// current view matrix
+	glm::mat4 m_view;
+	// pixels per unit of size at a distance of one unit
+	float m_pixelScale;
+	// true when the projection does not divide by the distance
+	bool m_bOrthographic;
+
+public:
+	// define a chain of meshes and the sizes where each level starts
+	int AddLodChain(const int* meshIDs, const float* minScreenSizes, int levelCount);
+	// release a chain, its ID is handed out again by AddLodChain()
+	void RemoveLodChain(int chainID);
+
+	// set the fraction of hysteresis around every threshold
+	void SetHysteresis(float hysteresis);
+
+	// set the view used to project the bounding spheres
+	void SetView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+	// restart the draw slots at the beginning of a frame
+	void BeginFrame();
+
+	// projected diameter in pixels of a world space bounding sphere
+	float GetScreenSize(glm::vec3 center, float radius) const;
+	// pick the mesh of a chain for the next draw
+	int SelectMesh(int chainID, glm::vec3 center, float radius);
+	// make sure the passed in number of draw slots exist
+	void ReserveDrawSlots(int slotCount);
+	// pick the mesh of a chain for an explicit draw slot, which is
+	// safe from several threads once the slots are reserved
+	int SelectMeshForSlot(int chainID, int drawSlot, glm::vec3 center, float radius);
+	// get the mesh of one level of a chain, -1 if it does not exist
+	int GetLodMesh(int chainID, int level) const;
+	// get the smallest projected diameter where a level is used
+	float GetMinScreenSize(int chainID, int level) const;
+
+	// get the values of the current view, so the levels can be
+	// chosen the same way on the GPU
+	const glm::mat4& GetView() const;
+	float GetPixelScale() const;
+	float GetHysteresis() const;
+	bool IsOrthographic() const;
+};
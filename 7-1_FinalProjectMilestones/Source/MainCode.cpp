@@ -1,5 +1,13 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line options
+#include <thread>           // render thread
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>            // capture file names
+#include <string>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -11,8 +19,17 @@
 
 #include "SceneManager.h"
 #include "ViewManager.h"
-#include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ShaderLoader.h"
+#include "ShaderCompiler.h"
+#include "ShaderHotReload.h"
+#include "SceneFile.h"
+#include "JobSystem.h"
+#include "ResolutionScaler.h"
+#include "BatchRenderer.h"
+#include "FrameCapture.h"
+#include "RenderStats.h"
+#include "StatsOverlay.h"
 
 // Namespace for declaring global variables
 namespace
@@ -20,6 +37,57 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// command line option that selects the deferred render path
+	const char* const DEFERRED_OPTION = "--deferred";
+	// command line option that selects the scene description
+	const char* const SCENE_OPTION = "--scene";
+	// command line options that save the camera input of the run to
+	// a file, or move the camera by a saved run for benchmarking
+	const char* const RECORD_CAMERA_OPTION = "--record-camera";
+	const char* const REPLAY_CAMERA_OPTION = "--replay-camera";
+	// command line option that only redraws when the frame changed
+	const char* const ON_DEMAND_OPTION = "--on-demand";
+	// command line option that starts with the top and front views
+	// shown beside the camera, which the V key toggles
+	const char* const LAYOUT_VIEWS_OPTION = "--layout-views";
+	// command line option that captures every frame into an image
+	// sequence from the start, which the F10 key toggles
+	const char* const CAPTURE_SEQUENCE_OPTION = "--capture-sequence";
+	// command line option that starts with the statistics overlay
+	// shown, which the F1 key toggles
+	const char* const STATS_OPTION = "--stats";
+	// command line option that also hides the scene objects behind
+	// the depth of the last frame in the GPU culling pass
+	const char* const OCCLUSION_CULLING_OPTION = "--occlusion-culling";
+	// folder of the screenshots and image sequences, and the encoder
+	// threads writing them, kept few so the jobs of the frames keep
+	// the other cores
+	const char* const CAPTURE_DIRECTORY = "captures";
+	const int CAPTURE_ENCODER_THREADS = 2;
+	// command line option that sets the GPU frame time in milliseconds
+	// that the render resolution is scaled to hold, zero for always
+	// drawing at the window size
+	const char* const TARGET_FRAME_TIME_OPTION = "--target-frame-time";
+	const float DEFAULT_TARGET_FRAME_TIME = 16.0f;
+	// command line option that writes the binary form of a scene
+	// description and exits, used as --compile-scene in.json out.bin
+	const char* const COMPILE_SCENE_OPTION = "--compile-scene";
+	// command line option that renders the scenes, cameras and
+	// resolutions of a job file into images with a hidden window
+	// and exits, used as --batch jobs.json
+	const char* const BATCH_OPTION = "--batch";
+	// folder of the cached program binaries
+	const char* const SHADER_CACHE_DIRECTORY = "shadercache";
+	// length of one camera tick in seconds, and the most ticks run
+	// at once to catch up after the input thread was held up
+	const double CAMERA_TICK = 1.0 / 120.0;
+	const int MAX_CATCH_UP_TICKS = 8;
+	// longest time an idle thread waits before looking again, for
+	// the input thread in seconds and for the render thread, which
+	// polls the watched shader and scene files
+	const double IDLE_EVENT_TIMEOUT = 0.5;
+	const std::chrono::milliseconds IDLE_RENDER_TIMEOUT(250);
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -29,12 +97,48 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// shader compiler object for building programs in the background
+	ShaderCompiler* g_ShaderCompiler = nullptr;
+	// hot reload object for rebuilding the edited shader programs
+	ShaderHotReload* g_ShaderHotReload = nullptr;
+	// job system object for splitting the per-frame work over the cores
+	JobSystem* g_JobSystem = nullptr;
+	// resolution scaler object for drawing the scene below the window
+	// size when the GPU cannot keep up
+	ResolutionScaler* g_ResolutionScaler = nullptr;
+	// frame capture object for writing screenshots and sequences
+	// without waiting for the GPU
+	FrameCapture* g_FrameCapture = nullptr;
+	// statistics overlay object for showing the counts and times
+	// of the recent frames
+	StatsOverlay* g_StatsOverlay = nullptr;
+	// screenshots taken so far, the frame number of the sequence
+	// being captured or -1, its file name prefix, and the dropped
+	// frames when it started, used only by the render thread
+	unsigned int g_CapturedScreenshots = 0;
+	int g_SequenceFrame = -1;
+	std::string g_SequenceName;
+	int g_SequenceDroppedFrames = 0;
+	// true while the render thread should keep drawing frames
+	std::atomic<bool> g_bRendering(false);
+	// true when frames are only drawn after something changed
+	bool g_bOnDemand = false;
+	// set when the render thread should draw a new frame
+	bool g_bRedrawRequested = false;
+	std::mutex g_RedrawMutex;
+	std::condition_variable g_RedrawCondition;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void DestroyManagers();
+void RenderLoop();
+void CaptureFrame(int width, int height);
+void RequestRedraw();
+void ApplySceneProgramValues(void* pContext, GLuint programID);
+void Window_Refresh_Callback(GLFWwindow* window);
 
 
 /***********************************************************
@@ -45,12 +149,42 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the batch mode must be known before the window is created,
+	// and compiling a scene description does not need a window
+	const char* batchFilename = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], BATCH_OPTION) == 0) && (i + 1 < argc))
+		{
+			batchFilename = argv[i + 1];
+		}
+
+		if (strcmp(argv[i], COMPILE_SCENE_OPTION) == 0)
+		{
+			SceneFile sceneFile;
+			if ((i + 2 < argc) &&
+				(sceneFile.LoadText(argv[i + 1]) == true) &&
+				(sceneFile.WriteBinary(argv[i + 2]) == true))
+			{
+				return(EXIT_SUCCESS);
+			}
+			std::cout << "Could not compile the scene, usage: " << COMPILE_SCENE_OPTION << " <scene.json> <scene.bin>" << std::endl;
+			return(EXIT_FAILURE);
+		}
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
+	// the batch mode draws offscreen, so its window is never shown
+	if (NULL != batchFilename)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
@@ -66,20 +200,398 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	// the uniform calls are counted from here on, before the
+	// background context starts using the GLEW entry points
+	RenderStats::Initialize();
+
+	// reuse the program binaries linked by earlier runs, and build
+	// the programs that are needed later on a background context
+	ShaderLoader::EnableBinaryCache(SHADER_CACHE_DIRECTORY);
+	g_ShaderCompiler = new ShaderCompiler();
+	g_ShaderCompiler->Initialize(g_Window);
 
-	// try to create a new scene manager object and prepare the 3D scene
+	// try to create a new scene manager object
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetShaderCompiler(g_ShaderCompiler);
+
+	// the transforms and the draws of each frame are built on one
+	// worker per core, while only the render thread talks to OpenGL
+	g_JobSystem = new JobSystem();
+	g_JobSystem->Initialize();
+	g_SceneManager->SetJobSystem(g_JobSystem);
+
+	// the render path is chosen once at startup
+	bool bDeferred = false;
+	bool bOcclusionCulling = false;
+	float targetFrameTime = DEFAULT_TARGET_FRAME_TIME;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], DEFERRED_OPTION) == 0)
+		{
+			bDeferred = g_SceneManager->EnableDeferredShading(
+				g_ViewManager->GetViewportWidth(),
+				g_ViewManager->GetViewportHeight());
+		}
+		else if ((strcmp(argv[i], SCENE_OPTION) == 0) && (i + 1 < argc))
+		{
+			g_SceneManager->SetSceneFilename(argv[++i]);
+		}
+		else if ((strcmp(argv[i], RECORD_CAMERA_OPTION) == 0) && (i + 1 < argc))
+		{
+			g_ViewManager->StartCameraRecording(argv[++i], (float)CAMERA_TICK);
+		}
+		else if ((strcmp(argv[i], REPLAY_CAMERA_OPTION) == 0) && (i + 1 < argc))
+		{
+			g_ViewManager->StartCameraReplay(argv[++i]);
+		}
+		else if (strcmp(argv[i], ON_DEMAND_OPTION) == 0)
+		{
+			g_bOnDemand = true;
+		}
+		else if (strcmp(argv[i], LAYOUT_VIEWS_OPTION) == 0)
+		{
+			g_ViewManager->SetLayoutViews(true);
+		}
+		else if (strcmp(argv[i], CAPTURE_SEQUENCE_OPTION) == 0)
+		{
+			g_ViewManager->SetCaptureSequence(true);
+		}
+		else if (strcmp(argv[i], STATS_OPTION) == 0)
+		{
+			g_ViewManager->SetShowStats(true);
+		}
+		else if (strcmp(argv[i], OCCLUSION_CULLING_OPTION) == 0)
+		{
+			bOcclusionCulling = true;
+		}
+		else if ((strcmp(argv[i], TARGET_FRAME_TIME_OPTION) == 0) && (i + 1 < argc))
+		{
+			targetFrameTime = (float)atof(argv[++i]);
+		}
+	}
+
+	// the occlusion test reads the depth of the last frame, which
+	// is stale when frames are skipped or the jobs change the scene
+	if ((bOcclusionCulling == true) && (g_bOnDemand == false) && (NULL == batchFilename))
+	{
+		g_SceneManager->SetOcclusionCulling(true);
+	}
+
+	// read the job file before anything is loaded, so a broken
+	// file fails at once
+	BatchRenderer* pBatchRenderer = NULL;
+	if (NULL != batchFilename)
+	{
+		pBatchRenderer = new BatchRenderer(g_SceneManager);
+		if (pBatchRenderer->LoadJobFile(batchFilename) == false)
+		{
+			delete pBatchRenderer;
+			DestroyManagers();
+			return(EXIT_FAILURE);
+		}
+	}
+
+	// load the shader code from the GLSL files of the project, which
+	// read the scene lights out of shader storage buffers - the
+	// deferred path writes the G-buffer instead of lighting
+	const char* vertexShaderFile = "shaders/vertexShader.glsl";
+	const char* fragmentShaderFile = bDeferred ? "shaders/gBufferFragment.glsl" : "shaders/fragmentShader.glsl";
+
+	// the program is taken from the binary cache when it is up to
+	// date, otherwise the shader manager compiles it from source
+	GLuint programID = ShaderLoader::LoadProgram(vertexShaderFile, fragmentShaderFile);
+	if (programID != 0)
+	{
+		g_ShaderManager->m_programID = programID;
+	}
+	else
+	{
+		g_ShaderManager->LoadShaders(vertexShaderFile, fragmentShaderFile);
+	}
+	g_ShaderManager->use();
+
+	// the draws switch to smaller variants of the program as the
+	// background compiler finishes them
+	g_SceneManager->EnableShaderPermutations(vertexShaderFile, fragmentShaderFile);
+
+	// prepare the 3D scene
 	g_SceneManager->PrepareScene();
 
+	// the batch mode renders its jobs on this thread with the
+	// meshes, textures and programs prepared above, and exits
+	if (NULL != pBatchRenderer)
+	{
+		bool bRendered = pBatchRenderer->Run();
+		delete pBatchRenderer;
+		DestroyManagers();
+		exit(bRendered ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// the scene is drawn into an offscreen target that is scaled up
+	// into the window, at a lower resolution while the GPU is slow
+	if (targetFrameTime > 0.0f)
+	{
+		g_ResolutionScaler = new ResolutionScaler();
+		if (g_ResolutionScaler->Initialize(
+			g_ViewManager->GetViewportWidth(),
+			g_ViewManager->GetViewportHeight(),
+			targetFrameTime) == false)
+		{
+			delete g_ResolutionScaler;
+			g_ResolutionScaler = NULL;
+		}
+	}
+
+	// the frames asked for with the capture keys are read back
+	// and written while the following frames are drawn
+	g_FrameCapture = new FrameCapture();
+	g_FrameCapture->Initialize(CAPTURE_ENCODER_THREADS);
+
+	// the overlay is left out when its program does not load
+	g_StatsOverlay = new StatsOverlay();
+	if (g_StatsOverlay->Initialize() == false)
+	{
+		delete g_StatsOverlay;
+		g_StatsOverlay = NULL;
+	}
+
+	// edited shader files are rebuilt while the application runs
+	g_ShaderHotReload = new ShaderHotReload();
+	g_ShaderHotReload->WatchProgram(&g_ShaderManager->m_programID, vertexShaderFile, fragmentShaderFile,
+		ApplySceneProgramValues, g_SceneManager);
+	g_SceneManager->WatchShaders(g_ShaderHotReload);
+
+	// the OpenGL context moves to the render thread, while this
+	// thread handles the window events and moves the camera at a
+	// fixed tick, so the input does not wait for the frames
+	glfwMakeContextCurrent(NULL);
+	g_bRendering = true;
+	g_bRedrawRequested = true;
+	std::thread renderThread(RenderLoop);
+
+	// a window that was uncovered or changed needs a new frame
+	glfwSetWindowRefreshCallback(g_Window, &Window_Refresh_Callback);
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
+	double nextTick = glfwGetTime();
+	bool bCameraMoving = true;
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		if ((g_bOnDemand == true) && (bCameraMoving == false) &&
+			(g_ViewManager->IsReplaying() == false))
+		{
+			// a still camera only needs a tick once an event arrives,
+			// and the time spent waiting is not caught up
+			glfwWaitEventsTimeout(IDLE_EVENT_TIMEOUT);
+			nextTick = glfwGetTime();
+		}
+		else
+		{
+			// query the GLFW events until the next tick is due
+			double waitTime = nextTick - glfwGetTime();
+			if (waitTime > 0.0)
+			{
+				glfwWaitEventsTimeout(waitTime);
+			}
+			else
+			{
+				glfwPollEvents();
+			}
+		}
+
+		int tickCount = 0;
+		while ((glfwGetTime() >= nextTick) && (tickCount < MAX_CATCH_UP_TICKS))
+		{
+			// the tick after the camera stopped is drawn as well, so
+			// the last frame shows where it came to rest
+			bool bMoved = g_ViewManager->UpdateCamera((float)CAMERA_TICK, nextTick);
+			if ((bMoved == true) || (bCameraMoving == true))
+			{
+				RequestRedraw();
+			}
+			bCameraMoving = bMoved;
+			nextTick += CAMERA_TICK;
+			tickCount++;
+		}
+		// the ticks missed during a long stall are dropped
+		if (glfwGetTime() >= nextTick)
+		{
+			nextTick = glfwGetTime() + CAMERA_TICK;
+		}
+	}
+
+	// take the context back for freeing the OpenGL objects
+	g_bRendering = false;
+	RequestRedraw();
+	renderThread.join();
+	glfwMakeContextCurrent(g_Window);
+
+	// save the camera input when the run was recorded
+	g_ViewManager->StopCameraRecording();
+
+	// clear the allocated manager objects from memory
+	DestroyManagers();
+
+	// Terminates the program successfully
+	exit(EXIT_SUCCESS); 
+}
+
+/***********************************************************
+ *	DestroyManagers()
+ *
+ *  This function is used for freeing the manager objects,
+ *  while the OpenGL context is still current.
+ ***********************************************************/
+void DestroyManagers()
+{
+	// the captures still in flight are written first
+	if (NULL != g_FrameCapture)
+	{
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
+	}
+	if (NULL != g_StatsOverlay)
+	{
+		delete g_StatsOverlay;
+		g_StatsOverlay = NULL;
+	}
+	if (NULL != g_ResolutionScaler)
+	{
+		delete g_ResolutionScaler;
+		g_ResolutionScaler = NULL;
+	}
+	if (NULL != g_SceneManager)
+	{
+		delete g_SceneManager;
+		g_SceneManager = NULL;
+	}
+	if (NULL != g_ShaderHotReload)
+	{
+		delete g_ShaderHotReload;
+		g_ShaderHotReload = NULL;
+	}
+	if (NULL != g_JobSystem)
+	{
+		delete g_JobSystem;
+		g_JobSystem = NULL;
+	}
+	if (NULL != g_ShaderCompiler)
+	{
+		delete g_ShaderCompiler;
+		g_ShaderCompiler = NULL;
+	}
+	if (NULL != g_ViewManager)
+	{
+		delete g_ViewManager;
+		g_ViewManager = NULL;
+	}
+	if (NULL != g_ShaderManager)
+	{
+		delete g_ShaderManager;
+		g_ShaderManager = NULL;
+	}
+
+	RenderStats::Shutdown();
+}
+
+/***********************************************************
+ *	RenderLoop()
+ *
+ *  This function is run by the render thread, which owns
+ *  the OpenGL context and draws frames from the latest
+ *  camera snapshot until the application is closed.  In
+ *  the on-demand mode it sleeps until a frame is requested
+ *  or a watched file changed, and the last frame stays on
+ *  the screen in the meantime.
+ ***********************************************************/
+void RenderLoop()
+{
+	glfwMakeContextCurrent(g_Window);
+
+	// size the render targets were allocated for
+	int targetWidth = g_ViewManager->GetViewportWidth();
+	int targetHeight = g_ViewManager->GetViewportHeight();
+
+	while (g_bRendering == true)
+	{
+		bool bRedraw = true;
+		if (g_bOnDemand == true)
+		{
+			std::unique_lock<std::mutex> lock(g_RedrawMutex);
+			g_RedrawCondition.wait_for(lock, IDLE_RENDER_TIMEOUT, []()
+			{
+				return((g_bRedrawRequested == true) || (g_bRendering == false));
+			});
+			bRedraw = g_bRedrawRequested;
+			g_bRedrawRequested = false;
+		}
+		if (g_bRendering == false)
+		{
+			break;
+		}
+
+		// hand the captures the GPU has copied to the encoders,
+		// also while no frames are drawn
+		g_FrameCapture->Update();
+
+		// swap in the programs of edited shader files between frames,
+		// the variants of a rebuilt scene program are built again
+		GLuint sceneProgramID = g_ShaderManager->m_programID;
+		if (g_ShaderHotReload->Update() > 0)
+		{
+			if (g_ShaderManager->m_programID != sceneProgramID)
+			{
+				g_SceneManager->ResetShaderPermutations();
+			}
+			bRedraw = true;
+		}
+		// apply the edits of the scene file the same way
+		if (g_SceneManager->UpdateScene() == true)
+		{
+			bRedraw = true;
+		}
+
+		if (bRedraw == false)
+		{
+			continue;
+		}
+
+		// the work of the frame is counted and timed from here
+		RenderStats::BeginFrame();
+
+		// the transient data of the frame that used this block
+		// of the arena three frames ago is released at once
+		g_SceneManager->GetFrameArena()->BeginFrame();
+
+		// convert from 3D object space to 2D view with the camera
+		// of the latest tick
+		g_ViewManager->PrepareSceneView();
+
+		// the targets are only allocated again when the size of
+		// the framebuffer changed, not every frame
+		int renderWidth = g_ViewManager->GetViewportWidth();
+		int renderHeight = g_ViewManager->GetViewportHeight();
+		if ((renderWidth != targetWidth) || (renderHeight != targetHeight))
+		{
+			g_SceneManager->ResizeRenderTargets(renderWidth, renderHeight);
+			if (NULL != g_ResolutionScaler)
+			{
+				g_ResolutionScaler->Resize(renderWidth, renderHeight);
+			}
+			glViewport(0, 0, renderWidth, renderHeight);
+			targetWidth = renderWidth;
+			targetHeight = renderHeight;
+		}
+
+		// draw into the scaled offscreen target when there is one
+		if (NULL != g_ResolutionScaler)
+		{
+			g_ResolutionScaler->BeginFrame();
+			renderWidth = g_ResolutionScaler->GetRenderWidth();
+			renderHeight = g_ResolutionScaler->GetRenderHeight();
+		}
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -87,39 +599,153 @@ int main(int argc, char* argv[])
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		// pass the views along for choosing the levels of detail
+		// and binning the lights, they are all drawn from one
+		// culled set of draws
+		SCENE_VIEW sceneViews[MAX_SCENE_VIEWS];
+		int viewCount = g_ViewManager->GetSceneViews(sceneViews);
+		g_SceneManager->SetViewParameters(
+			sceneViews,
+			viewCount,
+			renderWidth,
+			renderHeight);
 
 		// refresh the 3D scene
 		g_SceneManager->RenderScene();
 
+		// scale the frame up into the window
+		if (NULL != g_ResolutionScaler)
+		{
+			g_ResolutionScaler->EndFrame();
+		}
+
+		RenderStats::EndFrame();
+
+		// read back the finished frame when a capture was asked for,
+		// before the overlay is drawn so it is not captured
+		CaptureFrame(targetWidth, targetHeight);
+
+		if ((NULL != g_StatsOverlay) && (g_ViewManager->IsShowingStats() == true))
+		{
+			g_StatsOverlay->Draw(targetWidth, targetHeight);
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
+	}
 
-		// query the latest GLFW events
-		glfwPollEvents();
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *	CaptureFrame()
+ *
+ *  This function is used for starting the readback of the
+ *  frame in the back buffer when a screenshot was asked
+ *  for or a sequence is being captured.  A screenshot waits
+ *  for a free buffer if it must, while the frames of a
+ *  sequence are dropped when the capture is behind, so the
+ *  frame rate holds.  A dropped frame leaves a gap in the
+ *  numbers, which keeps the timing of the sequence.  In the
+ *  on-demand mode only the frames that are drawn are
+ *  captured.
+ ***********************************************************/
+void CaptureFrame(int width, int height)
+{
+	unsigned int screenshotCount = g_ViewManager->GetScreenshotCount();
+	bool bCaptureSequence = g_ViewManager->IsCapturingSequence();
+
+	if ((bCaptureSequence == false) && (g_SequenceFrame >= 0))
+	{
+		std::cout << "INFO: captured sequence:" << g_SequenceName
+			<< ", frames:" << g_SequenceFrame
+			<< ", dropped:" << (g_FrameCapture->GetDroppedCount() - g_SequenceDroppedFrames) << std::endl;
+		g_SequenceFrame = -1;
 	}
 
-	// clear the allocated manager objects from memory
-	if (NULL != g_SceneManager)
+	if ((screenshotCount == g_CapturedScreenshots) && (bCaptureSequence == false))
 	{
-		delete g_SceneManager;
-		g_SceneManager = NULL;
+		return;
 	}
-	if (NULL != g_ViewManager)
+
+	// the files are named after the time they were taken
+	char timeStamp[32];
+	time_t now = time(NULL);
+	struct tm localTime;
+#ifdef _WIN32
+	localtime_s(&localTime, &now);
+#else
+	localtime_r(&now, &localTime);
+#endif
+	strftime(timeStamp, sizeof(timeStamp), "%Y%m%d_%H%M%S", &localTime);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(GL_BACK);
+
+	// several presses between two frames give one screenshot
+	if (screenshotCount != g_CapturedScreenshots)
 	{
-		delete g_ViewManager;
-		g_ViewManager = NULL;
+		g_CapturedScreenshots = screenshotCount;
+		FrameCapture::MakeDirectory(CAPTURE_DIRECTORY);
+		std::string filename = std::string(CAPTURE_DIRECTORY) + "/screenshot_" + timeStamp + "_" +
+			std::to_string(screenshotCount) + ".png";
+		g_FrameCapture->Capture(filename.c_str(), width, height);
+		std::cout << "INFO: captured screenshot:" << filename << std::endl;
 	}
-	if (NULL != g_ShaderManager)
+
+	if (bCaptureSequence == true)
 	{
-		delete g_ShaderManager;
-		g_ShaderManager = NULL;
+		if (g_SequenceFrame < 0)
+		{
+			FrameCapture::MakeDirectory(CAPTURE_DIRECTORY);
+			g_SequenceName = std::string(CAPTURE_DIRECTORY) + "/sequence_" + timeStamp;
+			g_SequenceFrame = 0;
+			g_SequenceDroppedFrames = g_FrameCapture->GetDroppedCount();
+		}
+
+		char frameNumber[16];
+		snprintf(frameNumber, sizeof(frameNumber), "_%05d.png", g_SequenceFrame++);
+		g_FrameCapture->Capture((g_SequenceName + frameNumber).c_str(), width, height, true);
 	}
+}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+/***********************************************************
+ *	RequestRedraw()
+ *
+ *  This function is used for waking the render thread to
+ *  draw a new frame in the on-demand mode.
+ ***********************************************************/
+void RequestRedraw()
+{
+	{
+		std::lock_guard<std::mutex> lock(g_RedrawMutex);
+		g_bRedrawRequested = true;
+	}
+	g_RedrawCondition.notify_one();
+}
+
+/***********************************************************
+ *	ApplySceneProgramValues()
+ *
+ *  This function is called by the shader hot reload after
+ *  the scene program was rebuilt, to set the values of the
+ *  scene manager passed as the context into it.
+ ***********************************************************/
+void ApplySceneProgramValues(void* pContext, GLuint programID)
+{
+	((SceneManager*)pContext)->ApplyProgramValues(programID);
+}
+
+/***********************************************************
+ *	Window_Refresh_Callback()
+ *
+ *  This function is automatically called from GLFW when
+ *  the contents of the window were damaged, for example
+ *  after it was uncovered.
+ ***********************************************************/
+void Window_Refresh_Callback(GLFWwindow* /*window*/)
+{
+	RequestRedraw();
 }
 
 /***********************************************************
@@ -133,17 +759,11 @@ bool InitializeGLFW()
 	// --------------------------------------
 	glfwInit();
 
-#ifdef __APPLE__
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-	// set the version of OpenGL and profile to use
+	// set the version of OpenGL and profile to use - the scene
+	// shaders need 4.6 for their storage buffers and compute passes
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#endif
 	// GLFW: end -------------------------------
 
 	return(true);
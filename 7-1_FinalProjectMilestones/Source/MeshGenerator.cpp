@@ -0,0 +1,404 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgenerator.cpp
+// ============
+// generate the vertex and index data for the basic 3D shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshGenerator.h"
+#include "MeshOptimizer.h"
+
+#include <cmath>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	const float PI = 3.14159265358979f;
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for appending one interleaved vertex
+ *  to the vertex data of the passed in mesh.
+ ***********************************************************/
+void MeshGenerator::AddVertex(
+	MESH_DATA& mesh,
+	glm::vec3 position,
+	glm::vec3 normal,
+	float u,
+	float v)
+{
+	mesh.vertices.push_back(position.x);
+	mesh.vertices.push_back(position.y);
+	mesh.vertices.push_back(position.z);
+	mesh.vertices.push_back(normal.x);
+	mesh.vertices.push_back(normal.y);
+	mesh.vertices.push_back(normal.z);
+	mesh.vertices.push_back(u);
+	mesh.vertices.push_back(v);
+}
+
+/***********************************************************
+ *  AddDisc()
+ *
+ *  This method is used for appending a flat radius 1 disc
+ *  at the passed in height, used to close the cylinder and
+ *  the half sphere.
+ ***********************************************************/
+void MeshGenerator::AddDisc(MESH_DATA& mesh, int slices, float height, bool bFacingUp)
+{
+	GLuint centerIndex = (GLuint)(mesh.vertices.size() / FLOATS_PER_VERTEX);
+	glm::vec3 normal = glm::vec3(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+
+	AddVertex(mesh, glm::vec3(0.0f, height, 0.0f), normal, 0.5f, 0.5f);
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = 2.0f * PI * (float)i / (float)slices;
+		float x = std::cos(angle);
+		float z = std::sin(angle);
+		AddVertex(mesh, glm::vec3(x, height, z), normal, 0.5f + 0.5f * x, 0.5f + 0.5f * z);
+	}
+
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint current = centerIndex + 1 + i;
+		mesh.indices.push_back(centerIndex);
+		if (bFacingUp == true)
+		{
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(current);
+		}
+		else
+		{
+			mesh.indices.push_back(current);
+			mesh.indices.push_back(current + 1);
+		}
+	}
+}
+
+/***********************************************************
+ *  CalculateBounds()
+ *
+ *  This method is used for computing a bounding sphere that
+ *  encloses all of the vertex positions of the mesh.
+ ***********************************************************/
+void MeshGenerator::CalculateBounds(MESH_DATA& mesh)
+{
+	size_t vertexCount = mesh.vertices.size() / FLOATS_PER_VERTEX;
+
+	mesh.boundsCenter = glm::vec3(0.0f);
+	mesh.boundsRadius = 0.0f;
+	if (vertexCount == 0)
+	{
+		return;
+	}
+
+	// center the sphere on the axis aligned bounds
+	glm::vec3 minimum = glm::vec3(mesh.vertices[0], mesh.vertices[1], mesh.vertices[2]);
+	glm::vec3 maximum = minimum;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* position = &mesh.vertices[i * FLOATS_PER_VERTEX];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = std::min(minimum[axis], position[axis]);
+			maximum[axis] = std::max(maximum[axis], position[axis]);
+		}
+	}
+	mesh.boundsCenter = (minimum + maximum) * 0.5f;
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* position = &mesh.vertices[i * FLOATS_PER_VERTEX];
+		glm::vec3 offset = glm::vec3(position[0], position[1], position[2]) - mesh.boundsCenter;
+		mesh.boundsRadius = std::max(mesh.boundsRadius, glm::length(offset));
+	}
+}
+
+/***********************************************************
+ *  FinishMesh()
+ *
+ *  This method is used for reordering the finished mesh for
+ *  the vertex cache and vertex fetch, and for computing its
+ *  bounding sphere.
+ ***********************************************************/
+void MeshGenerator::FinishMesh(MESH_DATA& mesh, const char* meshName)
+{
+	MeshOptimizer::OptimizeMesh(mesh, meshName);
+	CalculateBounds(mesh);
+}
+
+/***********************************************************
+ *  CreatePlane()
+ *
+ *  This method is used for building a 2x2 plane in the XZ
+ *  plane with the normal pointing up.
+ ***********************************************************/
+MeshGenerator::MESH_DATA MeshGenerator::CreatePlane()
+{
+	MESH_DATA mesh;
+	glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	AddVertex(mesh, glm::vec3(-1.0f, 0.0f, -1.0f), normal, 0.0f, 1.0f);
+	AddVertex(mesh, glm::vec3(1.0f, 0.0f, -1.0f), normal, 1.0f, 1.0f);
+	AddVertex(mesh, glm::vec3(1.0f, 0.0f, 1.0f), normal, 1.0f, 0.0f);
+	AddVertex(mesh, glm::vec3(-1.0f, 0.0f, 1.0f), normal, 0.0f, 0.0f);
+
+	GLuint indices[] = { 0, 3, 2, 0, 2, 1 };
+	mesh.indices.assign(indices, indices + 6);
+
+	FinishMesh(mesh, "plane");
+	return(mesh);
+}
+
+/***********************************************************
+ *  CreateBox()
+ *
+ *  This method is used for building a 1x1x1 box centered on
+ *  the origin.  Each face has its own four vertices so the
+ *  normals and UVs stay flat per face.
+ ***********************************************************/
+MeshGenerator::MESH_DATA MeshGenerator::CreateBox()
+{
+	MESH_DATA mesh;
+
+	// the face normal and the U and V directions of each face,
+	// chosen so that U x V points along the normal
+	const glm::vec3 faces[6][3] = {
+		{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+		{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },
+		{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) }
+	};
+	const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+	for (int face = 0; face < 6; face++)
+	{
+		GLuint firstVertex = (GLuint)(mesh.vertices.size() / FLOATS_PER_VERTEX);
+		glm::vec3 normal = faces[face][0];
+
+		for (int corner = 0; corner < 4; corner++)
+		{
+			float s = corners[corner][0];
+			float t = corners[corner][1];
+			glm::vec3 position = (normal + faces[face][1] * s + faces[face][2] * t) * 0.5f;
+			AddVertex(mesh, position, normal, (s + 1.0f) * 0.5f, (t + 1.0f) * 0.5f);
+		}
+
+		mesh.indices.push_back(firstVertex);
+		mesh.indices.push_back(firstVertex + 1);
+		mesh.indices.push_back(firstVertex + 2);
+		mesh.indices.push_back(firstVertex);
+		mesh.indices.push_back(firstVertex + 2);
+		mesh.indices.push_back(firstVertex + 3);
+	}
+
+	FinishMesh(mesh, "box");
+	return(mesh);
+}
+
+/***********************************************************
+ *  CreateCylinder()
+ *
+ *  This method is used for building a radius 1 cylinder that
+ *  stands on the XZ plane and is 1 unit tall.  The top, the
+ *  bottom and the sides can be left out individually.
+ ***********************************************************/
+MeshGenerator::MESH_DATA MeshGenerator::CreateCylinder(
+	int slices,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	MESH_DATA mesh;
+
+	if (bDrawSides == true)
+	{
+		// the seam column is repeated so the U coordinate can wrap
+		for (int i = 0; i <= slices; i++)
+		{
+			float u = (float)i / (float)slices;
+			float angle = 2.0f * PI * u;
+			glm::vec3 normal = glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+
+			AddVertex(mesh, normal, normal, u, 0.0f);
+			AddVertex(mesh, normal + glm::vec3(0.0f, 1.0f, 0.0f), normal, u, 1.0f);
+		}
+
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint bottom = (GLuint)(i * 2);
+			GLuint top = bottom + 1;
+			GLuint nextBottom = bottom + 2;
+			GLuint nextTop = bottom + 3;
+
+			mesh.indices.push_back(bottom);
+			mesh.indices.push_back(top);
+			mesh.indices.push_back(nextBottom);
+			mesh.indices.push_back(nextBottom);
+			mesh.indices.push_back(top);
+			mesh.indices.push_back(nextTop);
+		}
+	}
+
+	if (bDrawTop == true)
+	{
+		AddDisc(mesh, slices, 1.0f, true);
+	}
+	if (bDrawBottom == true)
+	{
+		AddDisc(mesh, slices, 0.0f, false);
+	}
+
+	FinishMesh(mesh, "cylinder");
+	return(mesh);
+}
+
+/***********************************************************
+ *  CreateSphere()
+ *
+ *  This method is used for building a radius 1 sphere out of
+ *  latitude stacks and longitude slices.
+ ***********************************************************/
+MeshGenerator::MESH_DATA MeshGenerator::CreateSphere(int stacks, int slices)
+{
+	MESH_DATA mesh;
+
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float v = (float)stack / (float)stacks;
+		float latitude = PI * (v - 0.5f);
+		float ringRadius = std::cos(latitude);
+		float height = std::sin(latitude);
+
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float u = (float)slice / (float)slices;
+			float longitude = 2.0f * PI * u;
+			glm::vec3 position = glm::vec3(ringRadius * std::cos(longitude), height, ringRadius * std::sin(longitude));
+			AddVertex(mesh, position, position, u, v);
+		}
+	}
+
+	GLuint rowLength = (GLuint)(slices + 1);
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			GLuint current = stack * rowLength + slice;
+			GLuint above = current + rowLength;
+
+			mesh.indices.push_back(current);
+			mesh.indices.push_back(above);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(above);
+			mesh.indices.push_back(above + 1);
+		}
+	}
+
+	FinishMesh(mesh, "sphere");
+	return(mesh);
+}
+
+/***********************************************************
+ *  CreateHalfSphere()
+ *
+ *  This method is used for building the upper half of the
+ *  radius 1 sphere, closed with a disc at y = 0.
+ ***********************************************************/
+MeshGenerator::MESH_DATA MeshGenerator::CreateHalfSphere(int stacks, int slices)
+{
+	MESH_DATA mesh;
+
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float v = (float)stack / (float)stacks;
+		float latitude = 0.5f * PI * v;
+		float ringRadius = std::cos(latitude);
+		float height = std::sin(latitude);
+
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float u = (float)slice / (float)slices;
+			float longitude = 2.0f * PI * u;
+			glm::vec3 position = glm::vec3(ringRadius * std::cos(longitude), height, ringRadius * std::sin(longitude));
+			AddVertex(mesh, position, position, u, v);
+		}
+	}
+
+	GLuint rowLength = (GLuint)(slices + 1);
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			GLuint current = stack * rowLength + slice;
+			GLuint above = current + rowLength;
+
+			mesh.indices.push_back(current);
+			mesh.indices.push_back(above);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(above);
+			mesh.indices.push_back(above + 1);
+		}
+	}
+
+	AddDisc(mesh, slices, 0.0f, false);
+
+	FinishMesh(mesh, "half sphere");
+	return(mesh);
+}
+
+/***********************************************************
+ *  CreateTorus()
+ *
+ *  This method is used for building a torus that circles
+ *  the Z axis with a main radius of 1.  The thickness is
+ *  the radius of the tube.
+ ***********************************************************/
+MeshGenerator::MESH_DATA MeshGenerator::CreateTorus(
+	float thickness,
+	int mainSegments,
+	int tubeSegments)
+{
+	MESH_DATA mesh;
+
+	for (int i = 0; i <= mainSegments; i++)
+	{
+		float u = (float)i / (float)mainSegments;
+		float mainAngle = 2.0f * PI * u;
+		glm::vec3 ringDirection = glm::vec3(std::cos(mainAngle), std::sin(mainAngle), 0.0f);
+
+		for (int j = 0; j <= tubeSegments; j++)
+		{
+			float v = (float)j / (float)tubeSegments;
+			float tubeAngle = 2.0f * PI * v;
+			glm::vec3 normal = ringDirection * std::cos(tubeAngle) + glm::vec3(0.0f, 0.0f, std::sin(tubeAngle));
+			AddVertex(mesh, ringDirection + normal * thickness, normal, u, v);
+		}
+	}
+
+	GLuint rowLength = (GLuint)(tubeSegments + 1);
+	for (int i = 0; i < mainSegments; i++)
+	{
+		for (int j = 0; j < tubeSegments; j++)
+		{
+			GLuint current = i * rowLength + j;
+			GLuint next = current + rowLength;
+
+			mesh.indices.push_back(current);
+			mesh.indices.push_back(next);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(next);
+			mesh.indices.push_back(next + 1);
+		}
+	}
+
+	FinishMesh(mesh, "torus");
+	return(mesh);
+}
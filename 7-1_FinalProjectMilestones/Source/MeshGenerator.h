@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgenerator.h
+// ============
+// generate the vertex and index data for the basic 3D shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshGenerator
+ *
+ *  This class contains the code for building the basic 3D
+ *  shapes on the CPU.  The shapes match the dimensions of
+ *  the ShapeMeshes primitives so existing transforms in the
+ *  scene keep working unchanged.
+ ***********************************************************/
+class MeshGenerator
+{
+public:
+	// number of floats per vertex - position, normal and UV
+	static const int FLOATS_PER_VERTEX = 8;
+
+	struct MESH_DATA
+	{
+		// interleaved position(3), normal(3) and UV(2) floats
+		std::vector<GLfloat> vertices;
+		// triangle list indices into the vertices
+		std::vector<GLuint> indices;
+		// bounding sphere of the vertex positions
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+	};
+
+	// 2x2 plane in the XZ plane facing up
+	static MESH_DATA CreatePlane();
+	// 1x1x1 box centered on the origin
+	static MESH_DATA CreateBox();
+	// radius 1 cylinder from y = 0 to y = 1
+	static MESH_DATA CreateCylinder(
+		int slices = 36,
+		bool bDrawTop = true,
+		bool bDrawBottom = true,
+		bool bDrawSides = true);
+	// radius 1 sphere centered on the origin
+	static MESH_DATA CreateSphere(int stacks = 18, int slices = 36);
+	// upper half of the radius 1 sphere, closed at y = 0
+	static MESH_DATA CreateHalfSphere(int stacks = 9, int slices = 36);
+	// torus of radius 1 around the Z axis with the passed in tube radius
+	static MESH_DATA CreateTorus(
+		float thickness = 0.1f,
+		int mainSegments = 36,
+		int tubeSegments = 18);
+
+	// compute the bounding sphere from the vertex positions
+	static void CalculateBounds(MESH_DATA& mesh);
+
+private:
+	// append one interleaved vertex to the mesh
+	static void AddVertex(
+		MESH_DATA& mesh,
+		glm::vec3 position,
+		glm::vec3 normal,
+		float u,
+		float v);
+	// append a flat disc at the passed in height, facing up or down
+	static void AddDisc(MESH_DATA& mesh, int slices, float height, bool bFacingUp);
+	// optimize the index and vertex order and compute the bounds
+	static void FinishMesh(MESH_DATA& mesh, const char* meshName);
+};
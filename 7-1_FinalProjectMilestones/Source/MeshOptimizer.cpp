@@ -0,0 +1,392 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder the triangles and vertices of the generated meshes for the
+// post-transform vertex cache, overdraw and vertex fetch locality
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <iostream>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// run of triangles that is kept together by the overdraw pass
+	struct TRIANGLE_CLUSTER
+	{
+		GLuint firstTriangle;
+		GLuint triangleCount;
+		float sortKey;
+	};
+
+	// clusters that face away from the mesh center are drawn first
+	bool CompareClusters(const TRIANGLE_CLUSTER& first, const TRIANGLE_CLUSTER& second)
+	{
+		return(first.sortKey > second.sortKey);
+	}
+
+	// get the position of a vertex out of the interleaved data
+	glm::vec3 GetPosition(const MeshGenerator::MESH_DATA& mesh, GLuint vertex)
+	{
+		const GLfloat* position = &mesh.vertices[vertex * MeshGenerator::FLOATS_PER_VERTEX];
+		return(glm::vec3(position[0], position[1], position[2]));
+	}
+}
+
+/***********************************************************
+ *  OptimizeMesh()
+ *
+ *  This method is used for running the vertex cache, the
+ *  overdraw and the vertex fetch passes on a mesh, and for
+ *  printing the cache miss ratio before and after.
+ ***********************************************************/
+void MeshOptimizer::OptimizeMesh(MeshGenerator::MESH_DATA& mesh, const char* meshName)
+{
+	GLuint vertexCount = (GLuint)(mesh.vertices.size() / MeshGenerator::FLOATS_PER_VERTEX);
+	float acmrBefore = CalculateACMR(mesh.indices, vertexCount);
+
+	OptimizeVertexCache(mesh);
+	OptimizeVertexFetch(mesh);
+
+	vertexCount = (GLuint)(mesh.vertices.size() / MeshGenerator::FLOATS_PER_VERTEX);
+	float acmrAfter = CalculateACMR(mesh.indices, vertexCount);
+
+	std::cout << "Optimized mesh:" << meshName << ", triangles:" << mesh.indices.size() / 3
+		<< ", ACMR before:" << acmrBefore << ", ACMR after:" << acmrAfter << std::endl;
+}
+
+/***********************************************************
+ *  CalculateACMR()
+ *
+ *  This method is used for simulating a FIFO post-transform
+ *  cache over the indices and returning the number of cache
+ *  misses per triangle.  A value near 0.5 is ideal and 3.0
+ *  means no vertex was ever reused.
+ ***********************************************************/
+float MeshOptimizer::CalculateACMR(
+	const std::vector<GLuint>& indices,
+	GLuint vertexCount,
+	int cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+	if ((triangleCount == 0) || (vertexCount == 0))
+	{
+		return(0.0f);
+	}
+
+	std::vector<GLint> cacheEntries(cacheSize, -1);
+	int nextEntry = 0;
+	int cacheMisses = 0;
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		bool bHit = false;
+		for (int entry = 0; entry < cacheSize; entry++)
+		{
+			if (cacheEntries[entry] == (GLint)indices[i])
+			{
+				bHit = true;
+				break;
+			}
+		}
+
+		if (bHit == false)
+		{
+			cacheEntries[nextEntry] = (GLint)indices[i];
+			nextEntry = (nextEntry + 1) % cacheSize;
+			cacheMisses++;
+		}
+	}
+
+	return((float)cacheMisses / (float)triangleCount);
+}
+
+/***********************************************************
+ *  GetNextVertex()
+ *
+ *  This method is used for picking the next fanning vertex.
+ *  The candidate still in the cache with the oldest entry
+ *  wins, as long as its remaining triangles will not push
+ *  it out of the cache.  Otherwise the walk jumps to a dead
+ *  end vertex, or scans for any vertex with live triangles.
+ ***********************************************************/
+int MeshOptimizer::GetNextVertex(
+	const std::vector<int>& candidates,
+	const std::vector<int>& cacheTime,
+	int timeStamp,
+	int cacheSize,
+	const std::vector<int>& liveTriangles,
+	std::vector<int>& deadEndStack,
+	GLuint& scanCursor,
+	bool& bDeadEnd)
+{
+	int bestVertex = -1;
+	int bestPriority = -1;
+
+	bDeadEnd = false;
+
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		int vertex = candidates[i];
+		if (liveTriangles[vertex] > 0)
+		{
+			int priority = 0;
+			if (timeStamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = timeStamp - cacheTime[vertex];
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = vertex;
+			}
+		}
+	}
+
+	if (bestVertex >= 0)
+	{
+		return(bestVertex);
+	}
+
+	bDeadEnd = true;
+
+	// the most recently used vertices are still likely cached
+	while (deadEndStack.empty() == false)
+	{
+		int vertex = deadEndStack.back();
+		deadEndStack.pop_back();
+		if (liveTriangles[vertex] > 0)
+		{
+			return(vertex);
+		}
+	}
+
+	while (scanCursor < liveTriangles.size())
+	{
+		if (liveTriangles[scanCursor] > 0)
+		{
+			return((int)scanCursor);
+		}
+		scanCursor++;
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This method is used for reordering the triangles with
+ *  the Tipsify walk.  Every triangle around the fanning
+ *  vertex is emitted before moving on to a neighbor that is
+ *  still in the simulated cache.  The points where the walk
+ *  hits a dead end split the output into clusters that are
+ *  then sorted by the overdraw pass.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexCache(MeshGenerator::MESH_DATA& mesh, int cacheSize)
+{
+	GLuint vertexCount = (GLuint)(mesh.vertices.size() / MeshGenerator::FLOATS_PER_VERTEX);
+	size_t triangleCount = mesh.indices.size() / 3;
+
+	if ((triangleCount == 0) || (vertexCount == 0))
+	{
+		return;
+	}
+
+	// build the vertex to triangle adjacency in one flat array
+	std::vector<int> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		liveTriangles[mesh.indices[i]]++;
+	}
+
+	std::vector<GLuint> adjacencyOffset(vertexCount + 1, 0);
+	for (GLuint vertex = 0; vertex < vertexCount; vertex++)
+	{
+		adjacencyOffset[vertex + 1] = adjacencyOffset[vertex] + liveTriangles[vertex];
+	}
+
+	std::vector<GLuint> adjacency(triangleCount * 3);
+	std::vector<GLuint> fillCursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fillCursor[mesh.indices[i]]++] = (GLuint)(i / 3);
+	}
+
+	std::vector<int> cacheTime(vertexCount, 0);
+	std::vector<bool> bEmitted(triangleCount, false);
+	std::vector<int> deadEndStack;
+	std::vector<int> candidates;
+	std::vector<GLuint> output;
+	std::vector<GLuint> clusterStarts;
+
+	output.reserve(triangleCount * 3);
+	clusterStarts.push_back(0);
+
+	// every vertex starts out older than the cache size
+	int timeStamp = cacheSize + 1;
+	GLuint scanCursor = 0;
+	bool bDeadEnd = false;
+
+	int fanningVertex = GetNextVertex(candidates, cacheTime, timeStamp, cacheSize,
+		liveTriangles, deadEndStack, scanCursor, bDeadEnd);
+
+	while (fanningVertex >= 0)
+	{
+		candidates.clear();
+
+		for (GLuint a = adjacencyOffset[fanningVertex]; a < adjacencyOffset[fanningVertex + 1]; a++)
+		{
+			GLuint triangle = adjacency[a];
+			if (bEmitted[triangle] == true)
+			{
+				continue;
+			}
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				GLuint vertex = mesh.indices[triangle * 3 + corner];
+
+				output.push_back(vertex);
+				deadEndStack.push_back((int)vertex);
+				candidates.push_back((int)vertex);
+				liveTriangles[vertex]--;
+
+				// only a miss puts the vertex back at the front of the cache
+				if (timeStamp - cacheTime[vertex] > cacheSize)
+				{
+					cacheTime[vertex] = timeStamp;
+					timeStamp++;
+				}
+			}
+			bEmitted[triangle] = true;
+		}
+
+		fanningVertex = GetNextVertex(candidates, cacheTime, timeStamp, cacheSize,
+			liveTriangles, deadEndStack, scanCursor, bDeadEnd);
+
+		if ((bDeadEnd == true) && (fanningVertex >= 0))
+		{
+			clusterStarts.push_back((GLuint)(output.size() / 3));
+		}
+	}
+
+	mesh.indices.swap(output);
+
+	OptimizeOverdraw(mesh, clusterStarts);
+}
+
+/***********************************************************
+ *  OptimizeOverdraw()
+ *
+ *  This method is used for sorting the triangle clusters by
+ *  how far they face away from the center of the mesh.  The
+ *  outward facing clusters tend to occlude the rest, so
+ *  drawing them first lets the depth test reject more
+ *  fragments.  The clusters were split where the cache walk
+ *  restarted, so moving them costs few extra cache misses.
+ ***********************************************************/
+void MeshOptimizer::OptimizeOverdraw(
+	MeshGenerator::MESH_DATA& mesh,
+	const std::vector<GLuint>& clusterStarts)
+{
+	GLuint vertexCount = (GLuint)(mesh.vertices.size() / MeshGenerator::FLOATS_PER_VERTEX);
+	GLuint triangleCount = (GLuint)(mesh.indices.size() / 3);
+
+	if ((clusterStarts.size() < 2) || (vertexCount == 0))
+	{
+		return;
+	}
+
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	for (GLuint vertex = 0; vertex < vertexCount; vertex++)
+	{
+		meshCenter += GetPosition(mesh, vertex);
+	}
+	meshCenter = meshCenter / (float)vertexCount;
+
+	std::vector<TRIANGLE_CLUSTER> clusters;
+	for (size_t i = 0; i < clusterStarts.size(); i++)
+	{
+		TRIANGLE_CLUSTER cluster;
+		GLuint clusterEnd = (i + 1 < clusterStarts.size()) ? clusterStarts[i + 1] : triangleCount;
+
+		cluster.firstTriangle = clusterStarts[i];
+		cluster.triangleCount = clusterEnd - clusterStarts[i];
+		cluster.sortKey = 0.0f;
+
+		// area weighted centroid and normal of the cluster
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (GLuint triangle = cluster.firstTriangle; triangle < clusterEnd; triangle++)
+		{
+			glm::vec3 a = GetPosition(mesh, mesh.indices[triangle * 3]);
+			glm::vec3 b = GetPosition(mesh, mesh.indices[triangle * 3 + 1]);
+			glm::vec3 c = GetPosition(mesh, mesh.indices[triangle * 3 + 2]);
+			glm::vec3 faceNormal = glm::cross(b - a, c - a);
+			float faceArea = glm::length(faceNormal);
+
+			centroid += (a + b + c) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		if ((area > 0.0f) && (glm::length(normal) > 0.0f))
+		{
+			centroid = centroid / area;
+			cluster.sortKey = glm::dot(centroid - meshCenter, glm::normalize(normal));
+		}
+
+		clusters.push_back(cluster);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), CompareClusters);
+
+	std::vector<GLuint> sortedIndices;
+	sortedIndices.reserve(mesh.indices.size());
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		std::vector<GLuint>::const_iterator first = mesh.indices.begin() + clusters[i].firstTriangle * 3;
+		sortedIndices.insert(sortedIndices.end(), first, first + clusters[i].triangleCount * 3);
+	}
+
+	mesh.indices.swap(sortedIndices);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This method is used for renumbering the vertices in the
+ *  order that the indices first reference them, so the
+ *  vertex fetch walks through memory mostly sequentially.
+ *  Vertices that no triangle uses are dropped.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexFetch(MeshGenerator::MESH_DATA& mesh)
+{
+	const int FLOATS_PER_VERTEX = MeshGenerator::FLOATS_PER_VERTEX;
+	GLuint vertexCount = (GLuint)(mesh.vertices.size() / FLOATS_PER_VERTEX);
+
+	std::vector<GLint> remap(vertexCount, -1);
+	std::vector<GLfloat> sortedVertices;
+	GLuint nextVertex = 0;
+
+	sortedVertices.reserve(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		GLuint vertex = mesh.indices[i];
+		if (remap[vertex] < 0)
+		{
+			remap[vertex] = (GLint)nextVertex;
+			nextVertex++;
+
+			std::vector<GLfloat>::const_iterator first = mesh.vertices.begin() + vertex * FLOATS_PER_VERTEX;
+			sortedVertices.insert(sortedVertices.end(), first, first + FLOATS_PER_VERTEX);
+		}
+		mesh.indices[i] = (GLuint)remap[vertex];
+	}
+
+	mesh.vertices.swap(sortedVertices);
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder the triangles and vertices of the generated meshes for the
+// post-transform vertex cache, overdraw and vertex fetch locality
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGenerator.h"
+
+#include <GL/glew.h>        // GLEW library
+
+#include <vector>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  This class contains the code for the load time reordering
+ *  of mesh data.  The triangle order follows the Tipsify
+ *  algorithm (Sander, Nehab and Barczak 2007) and the vertex
+ *  order follows the first use of each vertex by the indices.
+ ***********************************************************/
+class MeshOptimizer
+{
+public:
+	// number of entries in the simulated post-transform cache
+	static const int DEFAULT_CACHE_SIZE = 16;
+
+	// run all of the passes on a mesh and report the results
+	static void OptimizeMesh(MeshGenerator::MESH_DATA& mesh, const char* meshName);
+
+	// reorder the triangles for the vertex cache and overdraw
+	static void OptimizeVertexCache(
+		MeshGenerator::MESH_DATA& mesh,
+		int cacheSize = DEFAULT_CACHE_SIZE);
+	// reorder the vertices in the order the indices first use them
+	static void OptimizeVertexFetch(MeshGenerator::MESH_DATA& mesh);
+
+	// average cache miss ratio - transformed vertices per triangle
+	static float CalculateACMR(
+		const std::vector<GLuint>& indices,
+		GLuint vertexCount,
+		int cacheSize = DEFAULT_CACHE_SIZE);
+
+private:
+	// choose the next fanning vertex of the Tipsify walk
+	static int GetNextVertex(
+		const std::vector<int>& candidates,
+		const std::vector<int>& cacheTime,
+		int timeStamp,
+		int cacheSize,
+		const std::vector<int>& liveTriangles,
+		std::vector<int>& deadEndStack,
+		GLuint& scanCursor,
+		bool& bDeadEnd);
+	// sort the triangle clusters so outward facing ones draw first
+	static void OptimizeOverdraw(
+		MeshGenerator::MESH_DATA& mesh,
+		const std::vector<GLuint>& clusterStarts);
+};
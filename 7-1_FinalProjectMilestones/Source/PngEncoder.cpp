@@ -0,0 +1,476 @@
+///////////////////////////////////////////////////////////////////////////////
+// pngencoder.cpp
+// ============
+// compress rendered frames into PNG files, without any library beyond the
+// standard one
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PngEncoder.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// bytes of each pixel written, the alpha of the frame is dropped
+	const int PNG_BYTES_PER_PIXEL = 3;
+	// the PNG filter types tried for each row
+	const int PNG_FILTER_COUNT = 5;
+
+	// the matches of deflate reach back 32 KB and are 3 to 258 bytes
+	const int DEFLATE_WINDOW_SIZE = 32768;
+	const int DEFLATE_MIN_MATCH = 3;
+	const int DEFLATE_MAX_MATCH = 258;
+	// positions hashed by their first three bytes, and the number of
+	// earlier positions with the same hash compared for a match
+	const int DEFLATE_HASH_BITS = 15;
+	const int DEFLATE_MAX_CHAIN = 32;
+
+	// lengths and distances of the deflate symbols and their extra bits
+	const int LENGTH_BASES[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const int LENGTH_EXTRA_BITS[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const int DISTANCE_BASES[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const int DISTANCE_EXTRA_BITS[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// bits written least significant first, as deflate packs them
+	struct BIT_WRITER
+	{
+		std::vector<unsigned char>* pOutput;
+		uint32_t bits;
+		int count;
+	};
+
+	void PutBits(BIT_WRITER& writer, uint32_t value, int count)
+	{
+		writer.bits |= value << writer.count;
+		writer.count += count;
+		while (writer.count >= 8)
+		{
+			writer.pOutput->push_back((unsigned char)(writer.bits & 0xFF));
+			writer.bits >>= 8;
+			writer.count -= 8;
+		}
+	}
+
+	// Huffman codes are packed starting from their top bit
+	void PutCode(BIT_WRITER& writer, uint32_t code, int length)
+	{
+		uint32_t reversed = 0;
+		for (int i = 0; i < length; i++)
+		{
+			reversed = (reversed << 1) | ((code >> i) & 1);
+		}
+		PutBits(writer, reversed, length);
+	}
+
+	// write a literal or length symbol with the fixed Huffman codes
+	void PutLiteral(BIT_WRITER& writer, int symbol)
+	{
+		if (symbol < 144)
+		{
+			PutCode(writer, 0x30 + symbol, 8);
+		}
+		else if (symbol < 256)
+		{
+			PutCode(writer, 0x190 + (symbol - 144), 9);
+		}
+		else if (symbol < 280)
+		{
+			PutCode(writer, symbol - 256, 7);
+		}
+		else
+		{
+			PutCode(writer, 0xC0 + (symbol - 280), 8);
+		}
+	}
+
+	// write a match as its length and distance symbols
+	void PutMatch(BIT_WRITER& writer, int length, int distance)
+	{
+		int lengthCode = 28;
+		while (LENGTH_BASES[lengthCode] > length)
+		{
+			lengthCode--;
+		}
+		PutLiteral(writer, 257 + lengthCode);
+		PutBits(writer, length - LENGTH_BASES[lengthCode], LENGTH_EXTRA_BITS[lengthCode]);
+
+		int distanceCode = 29;
+		while (DISTANCE_BASES[distanceCode] > distance)
+		{
+			distanceCode--;
+		}
+		PutCode(writer, distanceCode, 5);
+		PutBits(writer, distance - DISTANCE_BASES[distanceCode], DISTANCE_EXTRA_BITS[distanceCode]);
+	}
+
+	// hash of the three bytes starting a possible match
+	uint32_t HashBytes(const unsigned char* pBytes)
+	{
+		uint32_t value = ((uint32_t)pBytes[0] << 16) | ((uint32_t)pBytes[1] << 8) | pBytes[2];
+		return((value * 2654435761u) >> (32 - DEFLATE_HASH_BITS));
+	}
+
+	// the CRC-32 table of the PNG chunks, built once on first use
+	struct CRC_TABLE
+	{
+		uint32_t values[256];
+
+		CRC_TABLE()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+				}
+				values[i] = value;
+			}
+		}
+	};
+
+	uint32_t UpdateCrc(uint32_t crc, const unsigned char* pData, size_t length)
+	{
+		static const CRC_TABLE table;
+		for (size_t i = 0; i < length; i++)
+		{
+			crc = table.values[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(crc);
+	}
+
+	// the checksum that ends a zlib stream
+	uint32_t GetAdler32(const std::vector<unsigned char>& data)
+	{
+		uint32_t a = 1;
+		uint32_t b = 0;
+		size_t position = 0;
+		while (position < data.size())
+		{
+			// the sums cannot overflow within this many bytes
+			size_t end = std::min(position + 5552, data.size());
+			for (; position < end; position++)
+			{
+				a += data[position];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return((b << 16) | a);
+	}
+
+	void PutBigEndian(std::vector<unsigned char>& output, uint32_t value)
+	{
+		output.push_back((unsigned char)(value >> 24));
+		output.push_back((unsigned char)(value >> 16));
+		output.push_back((unsigned char)(value >> 8));
+		output.push_back((unsigned char)value);
+	}
+
+	// predict a byte from its left, upper and upper left neighbours
+	int PaethPredictor(int left, int up, int upLeft)
+	{
+		int estimate = left + up - upLeft;
+		int leftDistance = abs(estimate - left);
+		int upDistance = abs(estimate - up);
+		int upLeftDistance = abs(estimate - upLeft);
+		if ((leftDistance <= upDistance) && (leftDistance <= upLeftDistance))
+		{
+			return(left);
+		}
+		if (upDistance <= upLeftDistance)
+		{
+			return(up);
+		}
+		return(upLeft);
+	}
+}
+
+/***********************************************************
+ *  Encode()
+ *
+ *  This method is used for encoding RGBA pixels into the
+ *  bytes of a PNG file.  The alpha is dropped, since the
+ *  frames are opaque.  OpenGL returns the bottom row first,
+ *  so the rows are flipped when asked for.
+ ***********************************************************/
+bool PngEncoder::Encode(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	bool bFlipRows,
+	std::vector<unsigned char>& image)
+{
+	image.clear();
+	if ((NULL == pPixels) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	std::vector<unsigned char> scanlines;
+	FilterRows(pPixels, width, height, bFlipRows, scanlines);
+
+	std::vector<unsigned char> stream;
+	Compress(scanlines, stream);
+
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	image.insert(image.end(), signature, signature + 8);
+
+	// 8 bits per channel, RGB, no interlacing
+	std::vector<unsigned char> header;
+	PutBigEndian(header, (uint32_t)width);
+	PutBigEndian(header, (uint32_t)height);
+	header.push_back(8);
+	header.push_back(2);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	WriteChunk(image, "IHDR", &header[0], (uint32_t)header.size());
+	WriteChunk(image, "IDAT", &stream[0], (uint32_t)stream.size());
+	WriteChunk(image, "IEND", NULL, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriteFile()
+ *
+ *  This method is used for encoding the pixels and writing
+ *  the image to a file.
+ ***********************************************************/
+bool PngEncoder::WriteFile(
+	const char* filename,
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	bool bFlipRows)
+{
+	std::vector<unsigned char> image;
+	if ((NULL == filename) || (Encode(pPixels, width, height, bFlipRows, image) == false))
+	{
+		return(false);
+	}
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Could not write image file:" << filename << std::endl;
+		return(false);
+	}
+	file.write((const char*)&image[0], image.size());
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  FilterRows()
+ *
+ *  This method is used for turning the rows into the
+ *  scanlines of PNG.  Every filter is tried on each row
+ *  and the one with the smallest sum of differences is
+ *  kept, which makes the rows compress best.
+ ***********************************************************/
+void PngEncoder::FilterRows(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	bool bFlipRows,
+	std::vector<unsigned char>& scanlines)
+{
+	const int rowSize = width * PNG_BYTES_PER_PIXEL;
+	std::vector<unsigned char> row(rowSize);
+	std::vector<unsigned char> previousRow(rowSize, 0);
+	std::vector<unsigned char> filtered[PNG_FILTER_COUNT];
+	for (int i = 0; i < PNG_FILTER_COUNT; i++)
+	{
+		filtered[i].resize(rowSize);
+	}
+
+	scanlines.clear();
+	scanlines.reserve((size_t)(rowSize + 1) * height);
+
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* pSource = pPixels + (size_t)(bFlipRows ? (height - 1 - y) : y) * width * 4;
+		for (int x = 0; x < width; x++)
+		{
+			row[x * 3 + 0] = pSource[x * 4 + 0];
+			row[x * 3 + 1] = pSource[x * 4 + 1];
+			row[x * 3 + 2] = pSource[x * 4 + 2];
+		}
+
+		int bestFilter = 0;
+		unsigned int bestSum = 0xFFFFFFFFu;
+		for (int filter = 0; filter < PNG_FILTER_COUNT; filter++)
+		{
+			unsigned int sum = 0;
+			for (int i = 0; i < rowSize; i++)
+			{
+				int left = (i >= PNG_BYTES_PER_PIXEL) ? row[i - PNG_BYTES_PER_PIXEL] : 0;
+				int up = previousRow[i];
+				int upLeft = (i >= PNG_BYTES_PER_PIXEL) ? previousRow[i - PNG_BYTES_PER_PIXEL] : 0;
+
+				int prediction = 0;
+				switch (filter)
+				{
+				case 1: prediction = left; break;
+				case 2: prediction = up; break;
+				case 3: prediction = (left + up) / 2; break;
+				case 4: prediction = PaethPredictor(left, up, upLeft); break;
+				}
+
+				unsigned char value = (unsigned char)(row[i] - prediction);
+				filtered[filter][i] = value;
+				sum += (value < 128) ? value : 256 - value;
+			}
+
+			if (sum < bestSum)
+			{
+				bestSum = sum;
+				bestFilter = filter;
+			}
+		}
+
+		scanlines.push_back((unsigned char)bestFilter);
+		scanlines.insert(scanlines.end(), filtered[bestFilter].begin(), filtered[bestFilter].end());
+		row.swap(previousRow);
+	}
+}
+
+/***********************************************************
+ *  Compress()
+ *
+ *  This method is used for compressing the scanlines into
+ *  a zlib stream holding one deflate block with the fixed
+ *  Huffman codes.  Matches are found through chains of the
+ *  earlier positions that start with the same three bytes.
+ ***********************************************************/
+void PngEncoder::Compress(const std::vector<unsigned char>& data, std::vector<unsigned char>& stream)
+{
+	stream.clear();
+	stream.reserve(data.size() / 2 + 64);
+
+	// deflate with a 32 KB window and no preset dictionary
+	stream.push_back(0x78);
+	stream.push_back(0x01);
+
+	BIT_WRITER writer;
+	writer.pOutput = &stream;
+	writer.bits = 0;
+	writer.count = 0;
+
+	// the only block, compressed with the fixed codes
+	PutBits(writer, 1, 1);
+	PutBits(writer, 1, 2);
+
+	std::vector<int> head((size_t)1 << DEFLATE_HASH_BITS, -1);
+	std::vector<int> previous(DEFLATE_WINDOW_SIZE, -1);
+	const int size = (int)data.size();
+	const unsigned char* pData = data.empty() ? NULL : &data[0];
+
+	int position = 0;
+	while (position < size)
+	{
+		int bestLength = 0;
+		int bestDistance = 0;
+
+		if (position + DEFLATE_MIN_MATCH <= size)
+		{
+			uint32_t hash = HashBytes(pData + position);
+			int maxLength = std::min(DEFLATE_MAX_MATCH, size - position);
+			int candidate = head[hash];
+
+			for (int chain = 0; (chain < DEFLATE_MAX_CHAIN) && (candidate >= 0) &&
+				(position - candidate <= DEFLATE_WINDOW_SIZE); chain++)
+			{
+				int length = 0;
+				while ((length < maxLength) && (pData[candidate + length] == pData[position + length]))
+				{
+					length++;
+				}
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = position - candidate;
+					if (length == maxLength)
+					{
+						break;
+					}
+				}
+				candidate = previous[candidate & (DEFLATE_WINDOW_SIZE - 1)];
+			}
+
+			previous[position & (DEFLATE_WINDOW_SIZE - 1)] = head[hash];
+			head[hash] = position;
+		}
+
+		if (bestLength >= DEFLATE_MIN_MATCH)
+		{
+			PutMatch(writer, bestLength, bestDistance);
+
+			// the positions inside the match can start later matches
+			for (int i = 1; i < bestLength; i++)
+			{
+				int next = position + i;
+				if (next + DEFLATE_MIN_MATCH <= size)
+				{
+					uint32_t hash = HashBytes(pData + next);
+					previous[next & (DEFLATE_WINDOW_SIZE - 1)] = head[hash];
+					head[hash] = next;
+				}
+			}
+			position += bestLength;
+		}
+		else
+		{
+			PutLiteral(writer, pData[position]);
+			position++;
+		}
+	}
+
+	// end of the block, padded to a whole byte
+	PutLiteral(writer, 256);
+	if (writer.count > 0)
+	{
+		PutBits(writer, 0, 8 - writer.count);
+	}
+
+	PutBigEndian(stream, GetAdler32(data));
+}
+
+/***********************************************************
+ *  WriteChunk()
+ *
+ *  This method is used for appending a chunk to the image,
+ *  with its length before it and the CRC of its type and
+ *  data after it.
+ ***********************************************************/
+void PngEncoder::WriteChunk(
+	std::vector<unsigned char>& image,
+	const char* type,
+	const unsigned char* pData,
+	uint32_t length)
+{
+	PutBigEndian(image, length);
+
+	size_t typeOffset = image.size();
+	image.insert(image.end(), (const unsigned char*)type, (const unsigned char*)type + 4);
+	if (length > 0)
+	{
+		image.insert(image.end(), pData, pData + length);
+	}
+
+	uint32_t crc = UpdateCrc(0xFFFFFFFFu, &image[typeOffset], length + 4);
+	PutBigEndian(image, crc ^ 0xFFFFFFFFu);
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// pngencoder.h
+// ============
+// compress rendered frames into PNG files, without any library beyond the
+// standard one
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  PngEncoder
+ *
+ *  This class contains a small PNG writer for the frames
+ *  read back from OpenGL.  Each row is filtered with the
+ *  PNG filter that leaves the smallest differences, and
+ *  the rows are compressed with LZ77 and the fixed Huffman
+ *  codes of deflate, which is much smaller than storing the
+ *  pixels while staying fast enough for many images.  The
+ *  methods do not share any state, so several threads can
+ *  encode at once.
+ ***********************************************************/
+class PngEncoder
+{
+public:
+	// encode RGBA pixels into an RGB PNG image, flipping the rows
+	// when they start at the bottom as OpenGL returns them
+	static bool Encode(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		bool bFlipRows,
+		std::vector<unsigned char>& image);
+
+	// encode the pixels and write the image to a file
+	static bool WriteFile(
+		const char* filename,
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		bool bFlipRows);
+
+private:
+	// filter the rows into the scanline format of PNG
+	static void FilterRows(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		bool bFlipRows,
+		std::vector<unsigned char>& scanlines);
+	// compress the scanlines into a zlib stream
+	static void Compress(const std::vector<unsigned char>& data, std::vector<unsigned char>& stream);
+	// append a chunk with its length and checksum
+	static void WriteChunk(
+		std::vector<unsigned char>& image,
+		const char* type,
+		const unsigned char* pData,
+		uint32_t length);
+};
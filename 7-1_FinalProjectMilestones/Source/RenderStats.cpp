@@ -0,0 +1,372 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstats.cpp
+// ============
+// count the work of every frame and measure its CPU and GPU time, for the
+// statistics overlay and for tests
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderStats.h"
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// counts of the frame being drawn, which the shader compiler
+	// thread can add uniform uploads to as well
+	std::atomic<int> g_DrawCalls(0);
+	std::atomic<int> g_UniformUploads(0);
+	std::atomic<int> g_TextureBinds(0);
+	std::atomic<int> g_Triangles(0);
+	std::atomic<int> g_MeshRegenerations(0);
+
+	// totals of the last finished frame
+	std::mutex g_FrameStatsMutex;
+	RenderStats::FRAME_STATS g_FrameStats = RenderStats::FRAME_STATS();
+
+	// start of the measured part of the frame
+	std::chrono::steady_clock::time_point g_FrameStartTime;
+	bool g_bFrameStarted = false;
+
+	// ring of timestamp pairs and which of them are in flight
+	GLuint g_StartQueries[RenderStats::QUERY_COUNT] = { 0 };
+	GLuint g_EndQueries[RenderStats::QUERY_COUNT] = { 0 };
+	bool g_bQueryPending[RenderStats::QUERY_COUNT] = { false };
+	int g_Query = 0;
+	// GPU time of the latest measured frame in milliseconds
+	float g_GpuFrameTime = 0.0f;
+
+	// the GLEW entry points replaced by the counting ones
+	PFNGLUNIFORM1IPROC g_Uniform1i = NULL;
+	PFNGLUNIFORM2IPROC g_Uniform2i = NULL;
+	PFNGLUNIFORM3IPROC g_Uniform3i = NULL;
+	PFNGLUNIFORM1UIPROC g_Uniform1ui = NULL;
+	PFNGLUNIFORM1FPROC g_Uniform1f = NULL;
+	PFNGLUNIFORM2FPROC g_Uniform2f = NULL;
+	PFNGLUNIFORM3FPROC g_Uniform3f = NULL;
+	PFNGLUNIFORM4FPROC g_Uniform4f = NULL;
+	PFNGLUNIFORM2FVPROC g_Uniform2fv = NULL;
+	PFNGLUNIFORM3FVPROC g_Uniform3fv = NULL;
+	PFNGLUNIFORM4FVPROC g_Uniform4fv = NULL;
+	PFNGLUNIFORMMATRIX3FVPROC g_UniformMatrix3fv = NULL;
+	PFNGLUNIFORMMATRIX4FVPROC g_UniformMatrix4fv = NULL;
+
+	// each counting entry point counts the call and forwards it
+	void GLAPIENTRY CountUniform1i(GLint location, GLint v0)
+	{
+		g_UniformUploads++;
+		g_Uniform1i(location, v0);
+	}
+
+	void GLAPIENTRY CountUniform2i(GLint location, GLint v0, GLint v1)
+	{
+		g_UniformUploads++;
+		g_Uniform2i(location, v0, v1);
+	}
+
+	void GLAPIENTRY CountUniform3i(GLint location, GLint v0, GLint v1, GLint v2)
+	{
+		g_UniformUploads++;
+		g_Uniform3i(location, v0, v1, v2);
+	}
+
+	void GLAPIENTRY CountUniform1ui(GLint location, GLuint v0)
+	{
+		g_UniformUploads++;
+		g_Uniform1ui(location, v0);
+	}
+
+	void GLAPIENTRY CountUniform1f(GLint location, GLfloat v0)
+	{
+		g_UniformUploads++;
+		g_Uniform1f(location, v0);
+	}
+
+	void GLAPIENTRY CountUniform2f(GLint location, GLfloat v0, GLfloat v1)
+	{
+		g_UniformUploads++;
+		g_Uniform2f(location, v0, v1);
+	}
+
+	void GLAPIENTRY CountUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+	{
+		g_UniformUploads++;
+		g_Uniform3f(location, v0, v1, v2);
+	}
+
+	void GLAPIENTRY CountUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+	{
+		g_UniformUploads++;
+		g_Uniform4f(location, v0, v1, v2, v3);
+	}
+
+	void GLAPIENTRY CountUniform2fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_UniformUploads++;
+		g_Uniform2fv(location, count, value);
+	}
+
+	void GLAPIENTRY CountUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_UniformUploads++;
+		g_Uniform3fv(location, count, value);
+	}
+
+	void GLAPIENTRY CountUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_UniformUploads++;
+		g_Uniform4fv(location, count, value);
+	}
+
+	void GLAPIENTRY CountUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		g_UniformUploads++;
+		g_UniformMatrix3fv(location, count, transpose, value);
+	}
+
+	void GLAPIENTRY CountUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		g_UniformUploads++;
+		g_UniformMatrix4fv(location, count, transpose, value);
+	}
+
+	// replace an entry point with its counting one, keeping the
+	// original for forwarding, unless the driver lacks it
+	template <typename PROC>
+	void WrapEntryPoint(PROC& entryPoint, PROC& original, PROC counting)
+	{
+		if ((NULL != entryPoint) && (NULL == original))
+		{
+			original = entryPoint;
+			entryPoint = counting;
+		}
+	}
+
+	// put an original entry point back
+	template <typename PROC>
+	void RestoreEntryPoint(PROC& entryPoint, PROC& original)
+	{
+		if (NULL != original)
+		{
+			entryPoint = original;
+			original = NULL;
+		}
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the timestamp queries
+ *  and wrapping the uniform entry points of GLEW.  It must
+ *  be called after glewInit() and before any other thread
+ *  makes OpenGL calls.
+ ***********************************************************/
+void RenderStats::Initialize()
+{
+	glGenQueries(QUERY_COUNT, g_StartQueries);
+	glGenQueries(QUERY_COUNT, g_EndQueries);
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		g_bQueryPending[i] = false;
+	}
+	g_Query = 0;
+
+	WrapEntryPoint(__glewUniform1i, g_Uniform1i, &CountUniform1i);
+	WrapEntryPoint(__glewUniform2i, g_Uniform2i, &CountUniform2i);
+	WrapEntryPoint(__glewUniform3i, g_Uniform3i, &CountUniform3i);
+	WrapEntryPoint(__glewUniform1ui, g_Uniform1ui, &CountUniform1ui);
+	WrapEntryPoint(__glewUniform1f, g_Uniform1f, &CountUniform1f);
+	WrapEntryPoint(__glewUniform2f, g_Uniform2f, &CountUniform2f);
+	WrapEntryPoint(__glewUniform3f, g_Uniform3f, &CountUniform3f);
+	WrapEntryPoint(__glewUniform4f, g_Uniform4f, &CountUniform4f);
+	WrapEntryPoint(__glewUniform2fv, g_Uniform2fv, &CountUniform2fv);
+	WrapEntryPoint(__glewUniform3fv, g_Uniform3fv, &CountUniform3fv);
+	WrapEntryPoint(__glewUniform4fv, g_Uniform4fv, &CountUniform4fv);
+	WrapEntryPoint(__glewUniformMatrix3fv, g_UniformMatrix3fv, &CountUniformMatrix3fv);
+	WrapEntryPoint(__glewUniformMatrix4fv, g_UniformMatrix4fv, &CountUniformMatrix4fv);
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for putting the uniform entry points
+ *  back and freeing the queries.
+ ***********************************************************/
+void RenderStats::Shutdown()
+{
+	RestoreEntryPoint(__glewUniform1i, g_Uniform1i);
+	RestoreEntryPoint(__glewUniform2i, g_Uniform2i);
+	RestoreEntryPoint(__glewUniform3i, g_Uniform3i);
+	RestoreEntryPoint(__glewUniform1ui, g_Uniform1ui);
+	RestoreEntryPoint(__glewUniform1f, g_Uniform1f);
+	RestoreEntryPoint(__glewUniform2f, g_Uniform2f);
+	RestoreEntryPoint(__glewUniform3f, g_Uniform3f);
+	RestoreEntryPoint(__glewUniform4f, g_Uniform4f);
+	RestoreEntryPoint(__glewUniform2fv, g_Uniform2fv);
+	RestoreEntryPoint(__glewUniform3fv, g_Uniform3fv);
+	RestoreEntryPoint(__glewUniform4fv, g_Uniform4fv);
+	RestoreEntryPoint(__glewUniformMatrix3fv, g_UniformMatrix3fv);
+	RestoreEntryPoint(__glewUniformMatrix4fv, g_UniformMatrix4fv);
+
+	if (g_StartQueries[0] != 0)
+	{
+		glDeleteQueries(QUERY_COUNT, g_StartQueries);
+		glDeleteQueries(QUERY_COUNT, g_EndQueries);
+		for (int i = 0; i < QUERY_COUNT; i++)
+		{
+			g_StartQueries[i] = 0;
+			g_EndQueries[i] = 0;
+			g_bQueryPending[i] = false;
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the CPU timer and the
+ *  first timestamp of the frame.  A query pair that was
+ *  never read is dropped rather than waited for.
+ ***********************************************************/
+void RenderStats::BeginFrame()
+{
+	ReadQueries();
+
+	g_FrameStartTime = std::chrono::steady_clock::now();
+	g_bFrameStarted = true;
+
+	if ((g_StartQueries[g_Query] != 0) && (g_bQueryPending[g_Query] == false))
+	{
+		glQueryCounter(g_StartQueries[g_Query], GL_TIMESTAMP);
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for taking the counts of the frame
+ *  and starting the counts of the next one.  Work done
+ *  between two frames, such as loading an edited scene, is
+ *  counted with the frame that follows it.
+ ***********************************************************/
+void RenderStats::EndFrame()
+{
+	if (g_bFrameStarted == false)
+	{
+		return;
+	}
+	g_bFrameStarted = false;
+
+	if ((g_StartQueries[g_Query] != 0) && (g_bQueryPending[g_Query] == false))
+	{
+		glQueryCounter(g_EndQueries[g_Query], GL_TIMESTAMP);
+		g_bQueryPending[g_Query] = true;
+		g_Query = (g_Query + 1) % QUERY_COUNT;
+	}
+
+	FRAME_STATS stats;
+	stats.drawCalls = g_DrawCalls.exchange(0);
+	stats.uniformUploads = g_UniformUploads.exchange(0);
+	stats.textureBinds = g_TextureBinds.exchange(0);
+	stats.triangles = g_Triangles.exchange(0);
+	stats.meshRegenerations = g_MeshRegenerations.exchange(0);
+	stats.cpuTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - g_FrameStartTime).count();
+	stats.gpuTime = g_GpuFrameTime;
+
+	std::lock_guard<std::mutex> lock(g_FrameStatsMutex);
+	g_FrameStats = stats;
+}
+
+/***********************************************************
+ *  ReadQueries()
+ *
+ *  This method is used for reading the timestamp pairs that
+ *  the GPU has finished.
+ ***********************************************************/
+void RenderStats::ReadQueries()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		if (g_bQueryPending[i] == false)
+		{
+			continue;
+		}
+
+		// the end timestamp finishes after the start one
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(g_EndQueries[i], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable == 0)
+		{
+			continue;
+		}
+
+		GLuint64 startTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(g_StartQueries[i], GL_QUERY_RESULT, &startTime);
+		glGetQueryObjectui64v(g_EndQueries[i], GL_QUERY_RESULT, &endTime);
+		g_bQueryPending[i] = false;
+
+		g_GpuFrameTime = (float)((endTime - startTime) / 1000000.0);
+	}
+}
+
+/***********************************************************
+ *  CountDraw()
+ *
+ *  This method is used for counting a draw call and the
+ *  triangles of all its instances.
+ ***********************************************************/
+void RenderStats::CountDraw(int triangles)
+{
+	g_DrawCalls++;
+	g_Triangles += triangles;
+}
+
+/***********************************************************
+ *  CountTriangles()
+ *
+ *  This method is used for counting the triangles of the
+ *  indirect draws, which are only known once the culling
+ *  pass that built them is read back a few frames later.
+ ***********************************************************/
+void RenderStats::CountTriangles(int triangles)
+{
+	g_Triangles += triangles;
+}
+
+/***********************************************************
+ *  CountTextureBinds()
+ *
+ *  This method is used for counting the textures bound for
+ *  drawing.
+ ***********************************************************/
+void RenderStats::CountTextureBinds(int count)
+{
+	g_TextureBinds += count;
+}
+
+/***********************************************************
+ *  CountMeshRegeneration()
+ *
+ *  This method is used for counting a mesh that was
+ *  generated and uploaded.
+ ***********************************************************/
+void RenderStats::CountMeshRegeneration()
+{
+	g_MeshRegenerations++;
+}
+
+/***********************************************************
+ *  GetFrameStats()
+ *
+ *  This method is used for getting the counts and times of
+ *  the last finished frame, from any thread.
+ ***********************************************************/
+RenderStats::FRAME_STATS RenderStats::GetFrameStats()
+{
+	std::lock_guard<std::mutex> lock(g_FrameStatsMutex);
+	return(g_FrameStats);
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderstats.h
+// ============
+// count the work of every frame and measure its CPU and GPU time, for the
+// statistics overlay and for tests
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+/***********************************************************
+ *  RenderStats
+ *
+ *  This class contains the counters of the frame being
+ *  drawn and the totals of the last finished frame.  The
+ *  draws, texture binds and mesh builds are counted where
+ *  they are issued.  The uniforms are mostly set inside the
+ *  shader manager, which is not part of this project, so
+ *  the GLEW entry points of the uniform calls are wrapped
+ *  with counting ones instead.  The GPU time is measured
+ *  with timestamp queries read a few frames later, so it
+ *  never waits for the GPU and can run alongside the timer
+ *  queries of the resolution scaler.
+ ***********************************************************/
+class RenderStats
+{
+public:
+	// counts and times of one frame
+	struct FRAME_STATS
+	{
+		int drawCalls;
+		int uniformUploads;
+		int textureBinds;
+		int triangles;
+		// meshes generated and uploaded, when a scene is loaded
+		// or a scene file edit adds meshes
+		int meshRegenerations;
+		// time the render thread spent on the frame, and the GPU
+		// time of the latest measured frame, in milliseconds
+		float cpuTime;
+		float gpuTime;
+	};
+
+	// timestamp queries in flight, read once the GPU has finished them
+	static const int QUERY_COUNT = 4;
+
+	// create the timestamp queries and start counting the uniform
+	// uploads, after GLEW was initialized
+	static void Initialize();
+	// stop counting and free the queries
+	static void Shutdown();
+
+	// start and end the measured part of a frame on the render
+	// thread, the counts of the frame are taken at its end
+	static void BeginFrame();
+	static void EndFrame();
+
+	// count a draw call and the triangles it draws
+	static void CountDraw(int triangles);
+	// count the triangles of draws whose count was read back from
+	// the GPU, after the frame they were drawn in
+	static void CountTriangles(int triangles);
+	// count texture binds
+	static void CountTextureBinds(int count);
+	// count a mesh generated and uploaded
+	static void CountMeshRegeneration();
+
+	// get the counts and times of the last finished frame
+	static FRAME_STATS GetFrameStats();
+
+private:
+	// read the finished timestamp queries
+	static void ReadQueries();
+};
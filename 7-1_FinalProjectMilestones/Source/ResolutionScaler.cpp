@@ -0,0 +1,367 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.cpp
+// ============
+// render the scene into an offscreen target whose resolution follows the
+// GPU frame time, and scale it up into the window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResolutionScaler.h"
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// smallest fraction of the window size that is drawn
+	const float MIN_SCALE = 0.5f;
+	// largest change of the fraction at once
+	const float MAX_SCALE_STEP = 0.1f;
+	// frames measured before the fraction may change again
+	const int SCALE_INTERVAL = 8;
+	// weight of a new measurement in the smoothed frame time
+	const float FRAME_TIME_SMOOTHING = 0.2f;
+	// the fraction is lowered above the target and only raised
+	// well below it, so it does not go back and forth
+	const float LOWER_THRESHOLD = 1.05f;
+	const float RAISE_THRESHOLD = 0.8f;
+	// the render size is kept to whole blocks of pixels
+	const int SIZE_ALIGNMENT = 8;
+}
+
+/***********************************************************
+ *  ResolutionScaler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ResolutionScaler::ResolutionScaler()
+{
+	m_frameBuffer = 0;
+	m_colorTexture = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_scale = 1.0f;
+	m_targetFrameTime = 0.0f;
+	m_gpuFrameTime = 0.0f;
+	m_measuredFrames = 0;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_queries[i] = 0;
+		m_bQueryPending[i] = false;
+	}
+	m_query = 0;
+}
+
+/***********************************************************
+ *  ~ResolutionScaler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ResolutionScaler::~ResolutionScaler()
+{
+	DestroyTarget();
+
+	if (m_queries[0] != 0)
+	{
+		glDeleteQueries(QUERY_COUNT, m_queries);
+		for (int i = 0; i < QUERY_COUNT; i++)
+		{
+			m_queries[i] = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the offscreen target
+ *  and the timer queries.  A target frame time of zero
+ *  keeps drawing at the full window size.
+ ***********************************************************/
+bool ResolutionScaler::Initialize(int width, int height, float targetFrameTime)
+{
+	m_targetFrameTime = std::max(targetFrameTime, 0.0f);
+	m_scale = 1.0f;
+
+	if (CreateTarget(width, height) == false)
+	{
+		std::cout << "Could not create the offscreen target, size:" << width << "x" << height << std::endl;
+		DestroyTarget();
+		return(false);
+	}
+
+	glGenQueries(QUERY_COUNT, m_queries);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for allocating the color and depth
+ *  attachments at the window size.  The depth uses the
+ *  format of the G-buffer, so the deferred path can blit
+ *  its depth across.
+ ***********************************************************/
+bool ResolutionScaler::CreateTarget(int width, int height)
+{
+	DestroyTarget();
+
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+
+	glGenFramebuffers(1, &m_frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	UpdateRenderSize();
+
+	return(bComplete);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the offscreen target.
+ ***********************************************************/
+void ResolutionScaler::DestroyTarget()
+{
+	if (m_frameBuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_frameBuffer);
+		m_frameBuffer = 0;
+	}
+	if (m_colorTexture != 0)
+	{
+		glDeleteTextures(1, &m_colorTexture);
+		glDeleteTextures(1, &m_depthTexture);
+		m_colorTexture = 0;
+		m_depthTexture = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for allocating the target again
+ *  when the size of the window has changed.
+ ***********************************************************/
+void ResolutionScaler::Resize(int width, int height)
+{
+	if ((width <= 0) || (height <= 0) ||
+		((width == m_width) && (height == m_height)))
+	{
+		return;
+	}
+
+	CreateTarget(width, height);
+}
+
+/***********************************************************
+ *  UpdateRenderSize()
+ *
+ *  This method is used for setting the size drawn this
+ *  frame from the current fraction of the window size.
+ ***********************************************************/
+void ResolutionScaler::UpdateRenderSize()
+{
+	m_renderWidth = (int)(m_width * m_scale + 0.5f);
+	m_renderHeight = (int)(m_height * m_scale + 0.5f);
+
+	if (m_scale < 1.0f)
+	{
+		m_renderWidth = std::max(m_renderWidth - m_renderWidth % SIZE_ALIGNMENT, SIZE_ALIGNMENT);
+		m_renderHeight = std::max(m_renderHeight - m_renderHeight % SIZE_ALIGNMENT, SIZE_ALIGNMENT);
+	}
+
+	m_renderWidth = std::min(m_renderWidth, m_width);
+	m_renderHeight = std::min(m_renderHeight, m_height);
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used for reading the timer queries that
+ *  the GPU has finished and adjusting the fraction of the
+ *  window size.  The pixel count grows with the square of
+ *  the fraction, so the fraction moves by the square root
+ *  of how far the frame time is from the target.
+ ***********************************************************/
+void ResolutionScaler::UpdateScale()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		if (m_bQueryPending[i] == false)
+		{
+			continue;
+		}
+
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(m_queries[i], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable == 0)
+		{
+			continue;
+		}
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(m_queries[i], GL_QUERY_RESULT, &elapsed);
+		m_bQueryPending[i] = false;
+
+		float frameTime = (float)(elapsed / 1000000.0);
+		if (m_gpuFrameTime <= 0.0f)
+		{
+			m_gpuFrameTime = frameTime;
+		}
+		else
+		{
+			m_gpuFrameTime += (frameTime - m_gpuFrameTime) * FRAME_TIME_SMOOTHING;
+		}
+		m_measuredFrames++;
+	}
+
+	if ((m_targetFrameTime <= 0.0f) || (m_measuredFrames < SCALE_INTERVAL) || (m_gpuFrameTime <= 0.0f))
+	{
+		return;
+	}
+
+	float ratio = m_gpuFrameTime / m_targetFrameTime;
+	if ((ratio > LOWER_THRESHOLD) || ((ratio < RAISE_THRESHOLD) && (m_scale < 1.0f)))
+	{
+		float scale = m_scale / std::sqrt(ratio);
+		scale = std::max(std::min(scale, m_scale + MAX_SCALE_STEP), m_scale - MAX_SCALE_STEP);
+		m_scale = std::max(std::min(scale, 1.0f), MIN_SCALE);
+		UpdateRenderSize();
+
+		// the next measurements are of frames at the new size
+		m_measuredFrames = 0;
+		m_gpuFrameTime = 0.0f;
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for binding the offscreen target,
+ *  restricting the drawing to the scaled size and starting
+ *  the timer query of the frame.
+ ***********************************************************/
+void ResolutionScaler::BeginFrame()
+{
+	if (m_frameBuffer == 0)
+	{
+		return;
+	}
+
+	UpdateScale();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+	// a query that was never read is dropped rather than waited for
+	if (m_bQueryPending[m_query] == false)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[m_query]);
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for ending the timer query and
+ *  stretching the drawn part of the target over the whole
+ *  window with linear filtering.
+ ***********************************************************/
+void ResolutionScaler::EndFrame()
+{
+	if (m_frameBuffer == 0)
+	{
+		return;
+	}
+
+	if (m_bQueryPending[m_query] == false)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_bQueryPending[m_query] = true;
+	}
+	m_query = (m_query + 1) % QUERY_COUNT;
+
+	GLenum filter = ((m_renderWidth == m_width) && (m_renderHeight == m_height)) ? GL_NEAREST : GL_LINEAR;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_frameBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, m_renderWidth, m_renderHeight, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, filter);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  GetRenderWidth()
+ *
+ *  This method is used for getting the width of the part
+ *  of the target drawn this frame.
+ ***********************************************************/
+int ResolutionScaler::GetRenderWidth() const
+{
+	return(m_renderWidth);
+}
+
+/***********************************************************
+ *  GetRenderHeight()
+ *
+ *  This method is used for getting the height of the part
+ *  of the target drawn this frame.
+ ***********************************************************/
+int ResolutionScaler::GetRenderHeight() const
+{
+	return(m_renderHeight);
+}
+
+/***********************************************************
+ *  GetScale()
+ *
+ *  This method is used for getting the fraction of the
+ *  window size that is drawn.
+ ***********************************************************/
+float ResolutionScaler::GetScale() const
+{
+	return(m_scale);
+}
+
+/***********************************************************
+ *  GetGpuFrameTime()
+ *
+ *  This method is used for getting the smoothed GPU time of
+ *  the recent frames in milliseconds.
+ ***********************************************************/
+float ResolutionScaler::GetGpuFrameTime() const
+{
+	return(m_gpuFrameTime);
+}
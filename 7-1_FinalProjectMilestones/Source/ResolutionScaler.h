@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// resolutionscaler.h
+// ============
+// render the scene into an offscreen target whose resolution follows the
+// GPU frame time, and scale it up into the window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+/***********************************************************
+ *  ResolutionScaler
+ *
+ *  This class contains an offscreen color and depth target
+ *  the size of the window.  Each frame is drawn into its
+ *  lower left corner at a fraction of the window size, and
+ *  then blitted with filtering over the whole window.  The
+ *  GPU time of every frame is measured with timer queries
+ *  that are read a few frames later, so the CPU never waits
+ *  for them, and the fraction is lowered when the frames
+ *  take longer than the target and raised again when there
+ *  is room.  The target itself is only allocated again when
+ *  the window size changes.
+ ***********************************************************/
+class ResolutionScaler
+{
+public:
+	// constructor
+	ResolutionScaler();
+	// destructor
+	~ResolutionScaler();
+
+	// timer queries in flight, read once the GPU has finished them
+	static const int QUERY_COUNT = 4;
+
+private:
+	// offscreen target and its attachments
+	GLuint m_frameBuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthTexture;
+	// size of the window and of the attachments
+	int m_width;
+	int m_height;
+	// size drawn this frame
+	int m_renderWidth;
+	int m_renderHeight;
+	// fraction of the window size drawn
+	float m_scale;
+	// frame time to hold in milliseconds, zero keeps the full size
+	float m_targetFrameTime;
+	// smoothed GPU time of the recent frames in milliseconds
+	float m_gpuFrameTime;
+	// frames measured since the scale last changed
+	int m_measuredFrames;
+	// ring of timer queries and which of them are in flight
+	GLuint m_queries[QUERY_COUNT];
+	bool m_bQueryPending[QUERY_COUNT];
+	int m_query;
+
+	// allocate the target for the passed in window size
+	bool CreateTarget(int width, int height);
+	// free the target
+	void DestroyTarget();
+	// read the finished timer queries and adjust the scale
+	void UpdateScale();
+	// set the render size for the current scale
+	void UpdateRenderSize();
+
+public:
+	// create the target and the timer queries, with the frame
+	// time to hold in milliseconds or zero for the full size
+	bool Initialize(int width, int height, float targetFrameTime);
+	// allocate the target again for a new window size
+	void Resize(int width, int height);
+
+	// bind the target and start measuring the frame
+	void BeginFrame();
+	// stop measuring and scale the frame up into the window
+	void EndFrame();
+
+	// get the size of the part of the target drawn this frame
+	int GetRenderWidth() const;
+	int GetRenderHeight() const;
+	float GetScale() const;
+	// get the smoothed GPU time of the recent frames
+	float GetGpuFrameTime() const;
+};
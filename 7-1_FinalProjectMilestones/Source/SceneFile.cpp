@@ -0,0 +1,650 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// load the scene description from its JSON text form or from its compiled
+// binary form, which is mapped into memory and used without parsing
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "JsonParser.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// first bytes of the binary form, "SCN1"
+	const uint32_t SCENE_MAGIC = 0x314E4353;
+	// raised whenever the layout of an entry changes
+	const uint32_t SCENE_VERSION = 1;
+	// alignment of the arrays inside the binary form
+	const uint32_t SCENE_ALIGNMENT = 16;
+
+	// the binary form is only valid while these sizes hold
+	static_assert(sizeof(SceneFile::SCENE_MESH) == 40, "SCENE_MESH layout changed");
+	static_assert(sizeof(SceneFile::SCENE_TEXTURE) == 160, "SCENE_TEXTURE layout changed");
+	static_assert(sizeof(SceneFile::SCENE_MATERIAL) == 76, "SCENE_MATERIAL layout changed");
+	static_assert(sizeof(SceneFile::SCENE_LIGHT) == 88, "SCENE_LIGHT layout changed");
+	static_assert(sizeof(SceneFile::SCENE_OBJECT) == 108, "SCENE_OBJECT layout changed");
+
+	typedef JsonParser::JSON_VALUE JSON_VALUE;
+
+	// copy a name into a fixed-size field, reporting truncation
+	void CopyName(char* destination, size_t size, const std::string& name)
+	{
+		memset(destination, 0, size);
+		if (name.size() >= size)
+		{
+			std::cout << "INFO: scene name truncated:" << name << std::endl;
+		}
+		memcpy(destination, name.c_str(), (name.size() < size) ? name.size() : size - 1);
+	}
+
+	// read a string member, keeping the default when it is missing
+	std::string ReadString(const JSON_VALUE& object, const char* name, const char* defaultValue)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_STRING))
+		{
+			return(defaultValue);
+		}
+		return(pValue->text);
+	}
+
+	// read a number member, keeping the default when it is missing
+	float ReadFloat(const JSON_VALUE& object, const char* name, float defaultValue)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_NUMBER))
+		{
+			return(defaultValue);
+		}
+		return((float)pValue->number);
+	}
+
+	// read a bool member, keeping the default when it is missing
+	bool ReadBool(const JSON_VALUE& object, const char* name, bool defaultValue)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_BOOL))
+		{
+			return(defaultValue);
+		}
+		return(pValue->boolean);
+	}
+
+	// read an array of numbers into consecutive floats
+	void ReadFloats(const JSON_VALUE& object, const char* name, float* pValues, int count)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_ARRAY))
+		{
+			return;
+		}
+		for (int i = 0; (i < count) && (i < (int)pValue->elements.size()); i++)
+		{
+			if (pValue->elements[i].type == JsonParser::JSON_NUMBER)
+			{
+				pValues[i] = (float)pValue->elements[i].number;
+			}
+		}
+	}
+
+	// get an array member, which may be missing
+	const std::vector<JSON_VALUE>* GetArray(const JSON_VALUE& object, const char* name)
+	{
+		const JSON_VALUE* pValue = object.Find(name);
+		if ((NULL == pValue) || (pValue->type != JsonParser::JSON_ARRAY))
+		{
+			return(NULL);
+		}
+		return(&pValue->elements);
+	}
+
+	// find an entry by the name stored in its first field
+	template <typename ENTRY>
+	int FindByName(const std::vector<ENTRY>& entries, const std::string& name)
+	{
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (name == (const char*)&entries[i])
+			{
+				return((int)i);
+			}
+		}
+		return(-1);
+	}
+
+	// round an offset up to the array alignment
+	uint32_t AlignOffset(uint32_t offset)
+	{
+		return((offset + SCENE_ALIGNMENT - 1) & ~(SCENE_ALIGNMENT - 1));
+	}
+
+	// check that an array lies inside the mapped file
+	bool IsRangeValid(uint32_t offset, uint32_t count, size_t entrySize, size_t fileSize)
+	{
+		if ((offset % 4) != 0)
+		{
+			return(false);
+		}
+		return(((uint64_t)offset + (uint64_t)count * entrySize) <= fileSize);
+	}
+
+	// check that a fixed-size name is terminated
+	bool IsNameValid(const char* name, size_t size)
+	{
+		return(name[size - 1] == '\0');
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pMapping = NULL;
+	m_mappingSize = 0;
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+	m_pHeader = NULL;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for releasing the mapping of the
+ *  binary form and the entries of the text form.
+ ***********************************************************/
+void SceneFile::Clear()
+{
+	if (NULL != m_pMapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pMapping);
+		CloseHandle((HANDLE)m_mappingHandle);
+		CloseHandle((HANDLE)m_fileHandle);
+#else
+		munmap(m_pMapping, m_mappingSize);
+#endif
+		m_pMapping = NULL;
+		m_mappingSize = 0;
+		m_fileHandle = NULL;
+		m_mappingHandle = NULL;
+		m_pHeader = NULL;
+	}
+
+	m_meshes.clear();
+	m_textures.clear();
+	m_materials.clear();
+	m_lights.clear();
+	m_objects.clear();
+}
+
+/***********************************************************
+ *  LoadText()
+ *
+ *  This method is used for parsing the JSON form of a
+ *  scene.  The names the objects refer to are resolved to
+ *  indices here, so drawing never compares strings.
+ ***********************************************************/
+bool SceneFile::LoadText(const char* filename)
+{
+	std::ifstream sceneFile(filename, std::ios::in | std::ios::binary);
+	if (!sceneFile.is_open())
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream sceneStream;
+	sceneStream << sceneFile.rdbuf();
+
+	JSON_VALUE root;
+	std::string error;
+	if (JsonParser::Parse(sceneStream.str(), root, error) == false)
+	{
+		std::cout << "Could not parse scene file:" << filename << ", " << error << std::endl;
+		return(false);
+	}
+	if (root.type != JsonParser::JSON_OBJECT)
+	{
+		std::cout << "Could not parse scene file:" << filename << ", the root must be an object" << std::endl;
+		return(false);
+	}
+
+	Clear();
+
+	const std::vector<JSON_VALUE>* pArray = GetArray(root, "meshes");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		const JSON_VALUE& value = (*pArray)[i];
+		SCENE_MESH mesh;
+		CopyName(mesh.name, sizeof(mesh.name), ReadString(value, "name", ""));
+		mesh.thickness = ReadFloat(value, "thickness", 0.2f);
+
+		std::string type = ReadString(value, "type", "");
+		if (type == "plane") mesh.type = MESH_TYPE_PLANE;
+		else if (type == "box") mesh.type = MESH_TYPE_BOX;
+		else if (type == "cylinder") mesh.type = MESH_TYPE_CYLINDER;
+		else if (type == "sphere") mesh.type = MESH_TYPE_SPHERE;
+		else if (type == "halfSphere") mesh.type = MESH_TYPE_HALF_SPHERE;
+		else if (type == "torus") mesh.type = MESH_TYPE_TORUS;
+		else
+		{
+			std::cout << "Could not load scene file:" << filename << ", unknown mesh type '" << type << "'" << std::endl;
+			Clear();
+			return(false);
+		}
+		m_meshes.push_back(mesh);
+	}
+
+	pArray = GetArray(root, "textures");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		const JSON_VALUE& value = (*pArray)[i];
+		SCENE_TEXTURE texture;
+		CopyName(texture.tag, sizeof(texture.tag), ReadString(value, "tag", ""));
+		CopyName(texture.filename, sizeof(texture.filename), ReadString(value, "file", ""));
+		m_textures.push_back(texture);
+	}
+
+	pArray = GetArray(root, "materials");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		const JSON_VALUE& value = (*pArray)[i];
+		SCENE_MATERIAL material;
+		CopyName(material.tag, sizeof(material.tag), ReadString(value, "tag", ""));
+		material.ambientColor = glm::vec3(1.0f);
+		material.diffuseColor = glm::vec3(0.0f);
+		material.specularColor = glm::vec3(0.0f);
+		ReadFloats(value, "ambientColor", &material.ambientColor.x, 3);
+		ReadFloats(value, "diffuseColor", &material.diffuseColor.x, 3);
+		ReadFloats(value, "specularColor", &material.specularColor.x, 3);
+		material.ambientStrength = ReadFloat(value, "ambientStrength", 0.01f);
+		material.shininess = ReadFloat(value, "shininess", 20.0f);
+		m_materials.push_back(material);
+	}
+
+	pArray = GetArray(root, "lights");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		const JSON_VALUE& value = (*pArray)[i];
+		SCENE_LIGHT light;
+		light.position = glm::vec3(0.0f);
+		light.ambientColor = glm::vec3(0.0f);
+		light.diffuseColor = glm::vec3(0.0f);
+		light.specularColor = glm::vec3(0.0f);
+		ReadFloats(value, "position", &light.position.x, 3);
+		ReadFloats(value, "ambientColor", &light.ambientColor.x, 3);
+		ReadFloats(value, "diffuseColor", &light.diffuseColor.x, 3);
+		ReadFloats(value, "specularColor", &light.specularColor.x, 3);
+		light.range = ReadFloat(value, "range", 0.0f);
+		light.focalStrength = ReadFloat(value, "focalStrength", 32.0f);
+		light.specularIntensity = ReadFloat(value, "specularIntensity", 0.5f);
+
+		// a light only casts shadows when it has a shadow member
+		const JSON_VALUE* pShadow = value.Find("shadow");
+		light.bCastShadows = ((NULL != pShadow) && (pShadow->type == JsonParser::JSON_OBJECT)) ? 1 : 0;
+		light.shadowTarget = glm::vec3(0.0f);
+		light.shadowFieldOfView = 80.0f;
+		light.shadowFarPlane = 40.0f;
+		light.shadowResolution = 1024;
+		if (light.bCastShadows != 0)
+		{
+			ReadFloats(*pShadow, "target", &light.shadowTarget.x, 3);
+			light.shadowFieldOfView = ReadFloat(*pShadow, "fieldOfView", light.shadowFieldOfView);
+			light.shadowFarPlane = ReadFloat(*pShadow, "farPlane", light.shadowFarPlane);
+			light.shadowResolution = (int32_t)ReadFloat(*pShadow, "resolution", (float)light.shadowResolution);
+		}
+		m_lights.push_back(light);
+	}
+
+	pArray = GetArray(root, "objects");
+	for (size_t i = 0; (NULL != pArray) && (i < pArray->size()); i++)
+	{
+		const JSON_VALUE& value = (*pArray)[i];
+		SCENE_OBJECT object;
+		CopyName(object.name, sizeof(object.name), ReadString(value, "name", ""));
+		object.scale = glm::vec3(1.0f);
+		object.rotation = glm::vec3(0.0f);
+		object.position = glm::vec3(0.0f);
+		object.color = glm::vec4(1.0f);
+		object.UVscale = glm::vec2(1.0f, 1.0f);
+		ReadFloats(value, "scale", &object.scale.x, 3);
+		ReadFloats(value, "rotation", &object.rotation.x, 3);
+		ReadFloats(value, "position", &object.position.x, 3);
+		ReadFloats(value, "color", &object.color.x, 4);
+		ReadFloats(value, "UVscale", &object.UVscale.x, 2);
+		object.bDynamic = ReadBool(value, "dynamic", false) ? 1 : 0;
+
+		std::string meshName = ReadString(value, "mesh", "");
+		std::string materialTag = ReadString(value, "material", "");
+		std::string textureTag = ReadString(value, "texture", "");
+
+		object.meshIndex = FindByName(m_meshes, meshName);
+		object.materialIndex = materialTag.empty() ? -1 : FindByName(m_materials, materialTag);
+		object.textureIndex = textureTag.empty() ? -1 : FindByName(m_textures, textureTag);
+
+		if ((object.meshIndex < 0) ||
+			((materialTag.empty() == false) && (object.materialIndex < 0)) ||
+			((textureTag.empty() == false) && (object.textureIndex < 0)))
+		{
+			std::cout << "Could not load scene file:" << filename << ", object " << i
+				<< " refers to an unknown mesh, material or texture" << std::endl;
+			Clear();
+			return(false);
+		}
+		m_objects.push_back(object);
+	}
+
+	std::cout << "INFO: loaded scene file:" << filename << ", objects:" << m_objects.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for mapping the binary form of a
+ *  scene into memory.  The arrays are used in place, and
+ *  only the offsets, names and indices are checked so a
+ *  damaged file cannot be read out of bounds.
+ ***********************************************************/
+bool SceneFile::LoadBinary(const char* filename)
+{
+	Clear();
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	void* pMapping = (NULL != mappingHandle) ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (NULL == pMapping)
+	{
+		std::cout << "Could not map scene file:" << filename << std::endl;
+		if (NULL != mappingHandle)
+		{
+			CloseHandle(mappingHandle);
+		}
+		CloseHandle(fileHandle);
+		return(false);
+	}
+
+	m_fileHandle = fileHandle;
+	m_mappingHandle = mappingHandle;
+	m_mappingSize = (size_t)fileSize.QuadPart;
+#else
+	int fileDescriptor = open(filename, O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	struct stat fileStatus;
+	void* pMapping = MAP_FAILED;
+	if ((fstat(fileDescriptor, &fileStatus) == 0) && (fileStatus.st_size > 0))
+	{
+		pMapping = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	}
+	// the mapping stays valid once the file is closed
+	close(fileDescriptor);
+
+	if (pMapping == MAP_FAILED)
+	{
+		std::cout << "Could not map scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	m_mappingSize = (size_t)fileStatus.st_size;
+#endif
+
+	m_pMapping = pMapping;
+
+	const SCENE_HEADER* pHeader = (const SCENE_HEADER*)m_pMapping;
+	bool bValid = (m_mappingSize >= sizeof(SCENE_HEADER)) &&
+		(pHeader->magic == SCENE_MAGIC) &&
+		(pHeader->version == SCENE_VERSION) &&
+		(pHeader->fileSize == m_mappingSize) &&
+		IsRangeValid(pHeader->meshOffset, pHeader->meshCount, sizeof(SCENE_MESH), m_mappingSize) &&
+		IsRangeValid(pHeader->textureOffset, pHeader->textureCount, sizeof(SCENE_TEXTURE), m_mappingSize) &&
+		IsRangeValid(pHeader->materialOffset, pHeader->materialCount, sizeof(SCENE_MATERIAL), m_mappingSize) &&
+		IsRangeValid(pHeader->lightOffset, pHeader->lightCount, sizeof(SCENE_LIGHT), m_mappingSize) &&
+		IsRangeValid(pHeader->objectOffset, pHeader->objectCount, sizeof(SCENE_OBJECT), m_mappingSize);
+
+	if (bValid == true)
+	{
+		m_pHeader = pHeader;
+
+		for (int i = 0; (i < GetMeshCount()) && (bValid == true); i++)
+		{
+			bValid = IsNameValid(GetMeshes()[i].name, MAX_NAME_LENGTH);
+		}
+		for (int i = 0; (i < GetTextureCount()) && (bValid == true); i++)
+		{
+			bValid = IsNameValid(GetTextures()[i].tag, MAX_NAME_LENGTH) &&
+				IsNameValid(GetTextures()[i].filename, MAX_PATH_LENGTH);
+		}
+		for (int i = 0; (i < GetMaterialCount()) && (bValid == true); i++)
+		{
+			bValid = IsNameValid(GetMaterials()[i].tag, MAX_NAME_LENGTH);
+		}
+		for (int i = 0; (i < GetObjectCount()) && (bValid == true); i++)
+		{
+			const SCENE_OBJECT& object = GetObjects()[i];
+			bValid = IsNameValid(object.name, MAX_NAME_LENGTH) &&
+				(object.meshIndex >= 0) && (object.meshIndex < GetMeshCount()) &&
+				(object.materialIndex >= -1) && (object.materialIndex < GetMaterialCount()) &&
+				(object.textureIndex >= -1) && (object.textureIndex < GetTextureCount());
+		}
+	}
+
+	if (bValid == false)
+	{
+		std::cout << "Could not load scene file:" << filename << ", the binary form is damaged or out of date" << std::endl;
+		Clear();
+		return(false);
+	}
+
+	std::cout << "INFO: mapped scene file:" << filename << ", objects:" << GetObjectCount() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a scene in the form
+ *  given by its extension, .json for the text form and
+ *  anything else for the binary form.
+ ***********************************************************/
+bool SceneFile::Load(const char* filename)
+{
+	if (NULL == filename)
+	{
+		return(false);
+	}
+
+	std::string name = filename;
+	if ((name.size() >= 5) && (name.compare(name.size() - 5, 5, ".json") == 0))
+	{
+		return(LoadText(filename));
+	}
+
+	return(LoadBinary(filename));
+}
+
+/***********************************************************
+ *  WriteBinary()
+ *
+ *  This method is used for writing the loaded scene in the
+ *  binary form.  Each array starts on an aligned offset so
+ *  it can be used in place once the file is mapped.
+ ***********************************************************/
+bool SceneFile::WriteBinary(const char* filename) const
+{
+	SCENE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SCENE_MAGIC;
+	header.version = SCENE_VERSION;
+
+	uint32_t offset = AlignOffset(sizeof(SCENE_HEADER));
+	header.meshCount = (uint32_t)GetMeshCount();
+	header.meshOffset = offset;
+	offset = AlignOffset(offset + header.meshCount * sizeof(SCENE_MESH));
+	header.textureCount = (uint32_t)GetTextureCount();
+	header.textureOffset = offset;
+	offset = AlignOffset(offset + header.textureCount * sizeof(SCENE_TEXTURE));
+	header.materialCount = (uint32_t)GetMaterialCount();
+	header.materialOffset = offset;
+	offset = AlignOffset(offset + header.materialCount * sizeof(SCENE_MATERIAL));
+	header.lightCount = (uint32_t)GetLightCount();
+	header.lightOffset = offset;
+	offset = AlignOffset(offset + header.lightCount * sizeof(SCENE_LIGHT));
+	header.objectCount = (uint32_t)GetObjectCount();
+	header.objectOffset = offset;
+	offset = offset + header.objectCount * sizeof(SCENE_OBJECT);
+	header.fileSize = offset;
+
+	std::vector<char> buffer(header.fileSize, 0);
+	memcpy(&buffer[0], &header, sizeof(header));
+	if (header.meshCount > 0)
+		memcpy(&buffer[header.meshOffset], GetMeshes(), header.meshCount * sizeof(SCENE_MESH));
+	if (header.textureCount > 0)
+		memcpy(&buffer[header.textureOffset], GetTextures(), header.textureCount * sizeof(SCENE_TEXTURE));
+	if (header.materialCount > 0)
+		memcpy(&buffer[header.materialOffset], GetMaterials(), header.materialCount * sizeof(SCENE_MATERIAL));
+	if (header.lightCount > 0)
+		memcpy(&buffer[header.lightOffset], GetLights(), header.lightCount * sizeof(SCENE_LIGHT));
+	if (header.objectCount > 0)
+		memcpy(&buffer[header.objectOffset], GetObjects(), header.objectCount * sizeof(SCENE_OBJECT));
+
+	// a viewer may have the file mapped, so it is replaced by a
+	// finished copy instead of being truncated under the mapping
+	std::string temporaryName = std::string(filename) + ".tmp";
+	std::ofstream binaryFile(temporaryName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!binaryFile.is_open())
+	{
+		std::cout << "Could not write scene file:" << filename << std::endl;
+		return(false);
+	}
+	binaryFile.write(&buffer[0], buffer.size());
+	binaryFile.close();
+
+#ifdef _WIN32
+	// rename() does not replace an existing file on Windows
+	remove(filename);
+#endif
+	if ((binaryFile.fail() == true) || (rename(temporaryName.c_str(), filename) != 0))
+	{
+		std::cout << "Could not write scene file:" << filename << std::endl;
+		remove(temporaryName.c_str());
+		return(false);
+	}
+
+	std::cout << "INFO: wrote scene file:" << filename << ", bytes:" << buffer.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetEntries()
+ *
+ *  This method is used for getting an array of the loaded
+ *  form, either in the mapping or in the parsed entries.
+ ***********************************************************/
+template <typename ENTRY>
+const ENTRY* SceneFile::GetEntries(const std::vector<ENTRY>& parsed, uint32_t offset) const
+{
+	if (NULL != m_pHeader)
+	{
+		return((const ENTRY*)((const char*)m_pMapping + offset));
+	}
+
+	return(parsed.empty() ? NULL : &parsed[0]);
+}
+
+int SceneFile::GetMeshCount() const
+{
+	return((NULL != m_pHeader) ? (int)m_pHeader->meshCount : (int)m_meshes.size());
+}
+
+const SceneFile::SCENE_MESH* SceneFile::GetMeshes() const
+{
+	return(GetEntries(m_meshes, (NULL != m_pHeader) ? m_pHeader->meshOffset : 0));
+}
+
+int SceneFile::GetTextureCount() const
+{
+	return((NULL != m_pHeader) ? (int)m_pHeader->textureCount : (int)m_textures.size());
+}
+
+const SceneFile::SCENE_TEXTURE* SceneFile::GetTextures() const
+{
+	return(GetEntries(m_textures, (NULL != m_pHeader) ? m_pHeader->textureOffset : 0));
+}
+
+int SceneFile::GetMaterialCount() const
+{
+	return((NULL != m_pHeader) ? (int)m_pHeader->materialCount : (int)m_materials.size());
+}
+
+const SceneFile::SCENE_MATERIAL* SceneFile::GetMaterials() const
+{
+	return(GetEntries(m_materials, (NULL != m_pHeader) ? m_pHeader->materialOffset : 0));
+}
+
+int SceneFile::GetLightCount() const
+{
+	return((NULL != m_pHeader) ? (int)m_pHeader->lightCount : (int)m_lights.size());
+}
+
+const SceneFile::SCENE_LIGHT* SceneFile::GetLights() const
+{
+	return(GetEntries(m_lights, (NULL != m_pHeader) ? m_pHeader->lightOffset : 0));
+}
+
+int SceneFile::GetObjectCount() const
+{
+	return((NULL != m_pHeader) ? (int)m_pHeader->objectCount : (int)m_objects.size());
+}
+
+const SceneFile::SCENE_OBJECT* SceneFile::GetObjects() const
+{
+	return(GetEntries(m_objects, (NULL != m_pHeader) ? m_pHeader->objectOffset : 0));
+}
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// load the scene description from its JSON text form or from its compiled
+// binary form, which is mapped into memory and used without parsing
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class contains the meshes, textures, materials,
+ *  lights and objects of a scene.  The text form is parsed
+ *  into arrays with the same layout as the binary form, so
+ *  the scene is read through the same accessors whichever
+ *  form it was loaded from.  The objects refer to the other
+ *  entries by index, resolved when the scene is loaded.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// longest names, including the terminating zero
+	static const int MAX_NAME_LENGTH = 32;
+	static const int MAX_PATH_LENGTH = 128;
+
+	// shapes that the mesh generator can build
+	enum MESH_TYPE
+	{
+		MESH_TYPE_PLANE = 0,
+		MESH_TYPE_BOX,
+		MESH_TYPE_CYLINDER,
+		MESH_TYPE_SPHERE,
+		MESH_TYPE_HALF_SPHERE,
+		MESH_TYPE_TORUS
+	};
+
+	// the entries below are stored as-is in the binary form,
+	// so they only hold fixed-size fields
+	struct SCENE_MESH
+	{
+		char name[MAX_NAME_LENGTH];
+		int32_t type;
+		// tube thickness of a torus
+		float thickness;
+	};
+
+	struct SCENE_TEXTURE
+	{
+		char tag[MAX_NAME_LENGTH];
+		char filename[MAX_PATH_LENGTH];
+	};
+
+	struct SCENE_MATERIAL
+	{
+		char tag[MAX_NAME_LENGTH];
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float shininess;
+		glm::vec3 specularColor;
+	};
+
+	struct SCENE_LIGHT
+	{
+		glm::vec3 position;
+		// zero reaches every object
+		float range;
+		glm::vec3 ambientColor;
+		float focalStrength;
+		glm::vec3 diffuseColor;
+		float specularIntensity;
+		glm::vec3 specularColor;
+		int32_t bCastShadows;
+		// spot shadow aimed from the light position
+		glm::vec3 shadowTarget;
+		float shadowFieldOfView;
+		float shadowFarPlane;
+		int32_t shadowResolution;
+	};
+
+	struct SCENE_OBJECT
+	{
+		char name[MAX_NAME_LENGTH];
+		int32_t meshIndex;
+		int32_t materialIndex;
+		// -1 when the object is drawn with its color
+		int32_t textureIndex;
+		int32_t bDynamic;
+		glm::vec3 scale;
+		// rotation in degrees around the X, Y and Z axes
+		glm::vec3 rotation;
+		glm::vec3 position;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+	};
+
+private:
+	// header at the start of the binary form
+	struct SCENE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t fileSize;
+		uint32_t meshCount;
+		uint32_t meshOffset;
+		uint32_t textureCount;
+		uint32_t textureOffset;
+		uint32_t materialCount;
+		uint32_t materialOffset;
+		uint32_t lightCount;
+		uint32_t lightOffset;
+		uint32_t objectCount;
+		uint32_t objectOffset;
+	};
+
+	// entries parsed from the text form
+	std::vector<SCENE_MESH> m_meshes;
+	std::vector<SCENE_TEXTURE> m_textures;
+	std::vector<SCENE_MATERIAL> m_materials;
+	std::vector<SCENE_LIGHT> m_lights;
+	std::vector<SCENE_OBJECT> m_objects;
+
+	// mapping of the binary form, NULL for the text form
+	void* m_pMapping;
+	size_t m_mappingSize;
+	// handles kept open for the mapping on Windows
+	void* m_fileHandle;
+	void* m_mappingHandle;
+	const SCENE_HEADER* m_pHeader;
+
+	// release the mapping and the parsed entries
+	void Clear();
+	// get the entries of the loaded form
+	template <typename ENTRY>
+	const ENTRY* GetEntries(const std::vector<ENTRY>& parsed, uint32_t offset) const;
+
+public:
+	// load the text form of a scene
+	bool LoadText(const char* filename);
+	// map the binary form of a scene into memory
+	bool LoadBinary(const char* filename);
+	// load either form, chosen by the file extension
+	bool Load(const char* filename);
+	// write the loaded scene in the binary form
+	bool WriteBinary(const char* filename) const;
+
+	int GetMeshCount() const;
+	const SCENE_MESH* GetMeshes() const;
+	int GetTextureCount() const;
+	const SCENE_TEXTURE* GetTextures() const;
+	int GetMaterialCount() const;
+	const SCENE_MATERIAL* GetMaterials() const;
+	int GetLightCount() const;
+	const SCENE_LIGHT* GetLights() const;
+	int GetObjectCount() const;
+	const SCENE_OBJECT* GetObjects() const;
+};
@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "RenderStats.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -15,15 +16,139 @@
 #endif
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
 
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// the shader manager takes the uniform names as strings, so they
+	// are built once instead of as a temporary on every draw
+	const std::string g_ModelName = "model";
+	const char* const g_NormalMatrixName = "normalMatrix";
+	const std::string g_ObjectIndexName = "objectIndex";
+	const std::string g_ColorValueName = "objectColor";
+	const std::string g_TextureValueName = "objectTexture";
+	const std::string g_UseTextureName = "bUseTexture";
+	const std::string g_UseLightingName = "bUseLighting";
+	const std::string g_UVScaleName = "UVscale";
+	const std::string g_AmbientColorName = "material.ambientColor";
+	const std::string g_AmbientStrengthName = "material.ambientStrength";
+	const std::string g_DiffuseColorName = "material.diffuseColor";
+	const std::string g_SpecularColorName = "material.specularColor";
+	const std::string g_ShininessName = "material.shininess";
+	const std::string g_MaterialIDName = "materialID";
+	const std::string g_ViewName = "view";
+	const std::string g_FirstViewName = "firstView";
+	const std::string g_IndirectDrawName = "bIndirectDraw";
+	const std::string g_ViewProjectionNames[MAX_SCENE_VIEWS] =
+	{
+		"viewProjections[0]", "viewProjections[1]", "viewProjections[2]", "viewProjections[3]"
+	};
+	const std::string g_ViewPositionNames[MAX_SCENE_VIEWS] =
+	{
+		"viewPositions[0]", "viewPositions[1]", "viewPositions[2]", "viewPositions[3]"
+	};
+
+	// bytes of each frame arena block besides the arrays built
+	// for the scene objects, which grow the blocks with the scene
+	const size_t FRAME_ARENA_SIZE = 64 * 1024;
+	// bits of a draw's sort key holding its queue index and mesh
+	const int SORT_INDEX_BITS = 20;
+	const int SORT_MESH_BITS = 20;
+	// scene objects handled by one job when the draws are built
+	const int DRAW_PACKET_CHUNK = 256;
+
+	// tessellation of each level of detail, from the finest to the coarsest
+	const int LOD_CYLINDER_SLICES[LodSelector::MAX_LOD_LEVELS] = { 36, 20, 12, 6 };
+	const int LOD_SPHERE_STACKS[LodSelector::MAX_LOD_LEVELS] = { 18, 12, 8, 4 };
+	const int LOD_SPHERE_SLICES[LodSelector::MAX_LOD_LEVELS] = { 36, 24, 16, 8 };
+	const int LOD_TORUS_MAIN_SEGMENTS[LodSelector::MAX_LOD_LEVELS] = { 36, 24, 16, 10 };
+	const int LOD_TORUS_TUBE_SEGMENTS[LodSelector::MAX_LOD_LEVELS] = { 18, 12, 8, 5 };
+	// smallest projected diameter in pixels where each level is used
+	const float LOD_SCREEN_SIZES[LodSelector::MAX_LOD_LEVELS] = { 240.0f, 100.0f, 40.0f, 0.0f };
+
+	// size of the shadow atlas shared by the shadow casting lights
+	const int SHADOW_ATLAS_SIZE = 2048;
+	// the shadow passes draw a fixed level, since the LOD selection
+	// remembers the level of each draw of the camera view
+	const int SHADOW_LOD_LEVEL = 1;
+	// starting value of the FNV-1a checksum of the static transforms
+	const uint32_t CHECKSUM_SEED = 2166136261u;
+	// storage bindings of the world and normal matrices read by
+	// the vertex shader
+	const GLuint TRANSFORM_BINDING = 8;
+	const GLuint NORMAL_MATRIX_BINDING = 11;
+	// storage binding of the object values read by the culled draws
+	const GLuint OBJECT_DATA_BINDING = 9;
+	// scene description loaded when no other one is set
+	const char* const DEFAULT_SCENE_FILE = "scenes/kitchen.json";
+
+	// get the FNV-1a hash of the contents of a file, zero when
+	// it cannot be read
+	uint64_t HashFileContents(const char* filename)
+	{
+		std::ifstream file(filename, std::ios::in | std::ios::binary);
+		if (!file.is_open())
+		{
+			return(0);
+		}
+
+		uint64_t hash = 14695981039346656037ull;
+		char buffer[65536];
+		while (file)
+		{
+			file.read(buffer, sizeof(buffer));
+			std::streamsize count = file.gcount();
+			for (std::streamsize i = 0; i < count; i++)
+			{
+				hash = (hash ^ (unsigned char)buffer[i]) * 1099511628211ull;
+			}
+		}
+
+		return(hash);
+	}
+
+	// get the FNV-1a hash of the bytes of a matrix
+	uint32_t HashMatrix(const glm::mat4& matrix)
+	{
+		unsigned char bytes[sizeof(glm::mat4)];
+		memcpy(bytes, &matrix, sizeof(glm::mat4));
+
+		uint32_t hash = CHECKSUM_SEED;
+		for (size_t i = 0; i < sizeof(glm::mat4); i++)
+		{
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+
+		return(hash);
+	}
+
+	// get the largest scale of the axes of a matrix, which
+	// scales the radius of a bounding sphere
+	float GetMaxScale(const glm::mat4& matrix)
+	{
+		return(glm::max(glm::length(glm::vec3(matrix[0])),
+			glm::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])))));
+	}
+
+	// call function(begin, end) over [0, count), split over the
+	// workers when there is a job system and inline otherwise
+	template <typename FUNCTION>
+	void RunParallel(JobSystem* pJobSystem, int count, int chunkSize, const FUNCTION& function)
+	{
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(count, chunkSize, function);
+		}
+		else if (count > 0)
+		{
+			function(0, count);
+		}
+	}
 }
 
 /***********************************************************
@@ -34,7 +159,52 @@ namespace
 SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_pShaderCompiler = NULL;
+	m_shaderPermutations = new ShaderPermutations();
+	m_drawState.programID = 0;
+	m_drawState.meshID = -1;
+	m_drawState.modelMatrix = glm::mat4(1.0f);
+	m_drawState.bUseTexture = false;
+	m_drawState.textureSlot = -1;
+	m_drawState.color = glm::vec4(1.0f);
+	m_drawState.UVscale = glm::vec2(1.0f, 1.0f);
+	m_drawState.materialID = -1;
+	m_drawState.objectIndex = -1;
+	m_renderQueue = NULL;
+	m_renderQueueCount = 0;
+	m_renderQueueCapacity = 0;
+	m_frameArena = new FrameArena();
+	m_frameArena->Initialize(FRAME_ARENA_SIZE);
+	m_pJobSystem = NULL;
+	m_bUseLighting = false;
+	m_loadedTextures = 0;
+	m_geometryPool = new GeometryPool();
+	m_lodSelector = new LodSelector();
+	m_cullingManager = new CullingManager();
+	m_bGpuCulling = false;
+	m_objectDataBuffer = 0;
+	m_lightManager = new LightManager();
+	m_deferredRenderer = NULL;
+	m_shadowManager = new ShadowManager();
+	m_renderPass = RENDER_PASS_SCENE;
+	m_bDynamicObject = false;
+	m_staticChecksum = CHECKSUM_SEED;
+	m_shadowChecksum = CHECKSUM_SEED;
+	m_dynamicDrawCount = 0;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_views[0].view = glm::mat4(1.0f);
+	m_views[0].projection = glm::mat4(1.0f);
+	m_views[0].viewport = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	m_viewCount = 1;
+	m_targetWidth = 1;
+	m_targetHeight = 1;
+	m_bViewportArray = false;
+	m_sceneFilename = DEFAULT_SCENE_FILE;
+	m_sceneFile = new SceneFile();
+	m_sceneWatcher = NULL;
+	m_transformStore = new TransformStore();
+	m_modelMatrix = glm::mat4(1.0f);
 }
 
 /***********************************************************
@@ -45,8 +215,42 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
+	m_pShaderCompiler = NULL;
+	m_pJobSystem = NULL;
+	DestroyGLTextures();
+	delete m_shaderPermutations;
+	m_shaderPermutations = NULL;
+	delete m_geometryPool;
+	m_geometryPool = NULL;
+	delete m_lodSelector;
+	m_lodSelector = NULL;
+	delete m_cullingManager;
+	m_cullingManager = NULL;
+	if (m_objectDataBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_objectDataBuffer);
+		m_objectDataBuffer = 0;
+	}
+	delete m_lightManager;
+	m_lightManager = NULL;
+	delete m_shadowManager;
+	m_shadowManager = NULL;
+	delete m_sceneFile;
+	m_sceneFile = NULL;
+	delete m_transformStore;
+	m_transformStore = NULL;
+	delete m_frameArena;
+	m_frameArena = NULL;
+	if (NULL != m_sceneWatcher)
+	{
+		delete m_sceneWatcher;
+		m_sceneWatcher = NULL;
+	}
+	if (NULL != m_deferredRenderer)
+	{
+		delete m_deferredRenderer;
+		m_deferredRenderer = NULL;
+	}
 }
 
 /***********************************************************
@@ -58,11 +262,47 @@ SceneManager::~SceneManager()
  *  the next available texture slot in memory.
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+{
+	GLuint textureID = 0;
+
+	// the texture slots are bound to the units below the ones
+	// reserved for the renderers
+	if (m_loadedTextures >= MAX_SCENE_TEXTURES)
+	{
+		std::cout << "Could not load image:" << filename << ", all " << MAX_SCENE_TEXTURES << " texture slots are used" << std::endl;
+		return false;
+	}
+
+	glGenTextures(1, &textureID);
+
+	if (LoadGLTextureImage(textureID, filename) == false)
+	{
+		glDeleteTextures(1, &textureID);
+		return false;
+	}
+
+	// register the loaded texture and associate it with the special tag string
+	m_textureIDs[m_loadedTextures].ID = textureID;
+	m_textureIDs[m_loadedTextures].tag = tag;
+	m_textureIDs[m_loadedTextures].contentHash = 0;
+	m_loadedTextures++;
+
+	return true;
+}
+
+/***********************************************************
+ *  LoadGLTextureImage()
+ *
+ *  This method is used for decoding an image file into the
+ *  passed in texture, configuring the texture mapping
+ *  parameters and generating the mipmaps.  A texture that
+ *  already holds an image is given the new one in place.
+ ***********************************************************/
+bool SceneManager::LoadGLTextureImage(GLuint textureID, const char* filename)
 {
 	int width = 0;
 	int height = 0;
 	int colorChannels = 0;
-	GLuint textureID = 0;
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
@@ -80,7 +320,6 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	{
 		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
 
-		glGenTextures(1, &textureID);
 		glBindTexture(GL_TEXTURE_2D, textureID);
 
 		// set the texture wrapping parameters
@@ -99,6 +338,8 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		else
 		{
 			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+			stbi_image_free(image);
+			glBindTexture(GL_TEXTURE_2D, 0);
 			return false;
 		}
 
@@ -109,11 +350,6 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		stbi_image_free(image);
 		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
 		return true;
 	}
 
@@ -127,7 +363,9 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
  *  BindGLTextures()
  *
  *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  OpenGL texture memory slots.  There are up to
+ *  MAX_SCENE_TEXTURES slots, the units above them are
+ *  reserved for the renderers.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
@@ -137,6 +375,7 @@ void SceneManager::BindGLTextures()
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
 	}
+	RenderStats::CountTextureBinds(m_loadedTextures);
 }
 
 /***********************************************************
@@ -149,8 +388,12 @@ void SceneManager::DestroyGLTextures()
 {
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		glDeleteTextures(1, &m_textureIDs[i].ID);
+		m_textureIDs[i].ID = 0;
+		m_textureIDs[i].tag.clear();
+		m_textureIDs[i].contentHash = 0;
 	}
+	m_loadedTextures = 0;
 }
 
 /***********************************************************
@@ -159,7 +402,7 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const char* tag)
 {
 	int textureID = -1;
 	int index = 0;
@@ -185,7 +428,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const char* tag)
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -211,7 +454,7 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const char* tag, OBJECT_MATERIAL& material)
 {
 	if (m_objectMaterials.size() == 0)
 	{
@@ -240,6 +483,33 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	return(true);
 }
 
+/***********************************************************
+ *  FindMaterialID()
+ *
+ *  This method is used for getting the index of the defined
+ *  material associated with the passed in tag, which is its
+ *  ID in the deferred material table.
+ ***********************************************************/
+int SceneManager::FindMaterialID(const char* tag)
+{
+	int materialID = -1;
+	int index = 0;
+	bool bFound = false;
+
+	while ((index < m_objectMaterials.size()) && (bFound == false))
+	{
+		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		{
+			materialID = index;
+			bFound = true;
+		}
+		else
+			index++;
+	}
+
+	return(materialID);
+}
+
 /***********************************************************
  *  SetTransformations()
  *
@@ -271,18 +541,15 @@ void SceneManager::SetTransformations(
 	translation = glm::translate(positionXYZ);
 
 	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	// the matrix is set into the shader when the draw is submitted
+	m_modelMatrix = modelView;
 }
 
 /***********************************************************
  *  SetShaderColor()
  *
  *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  for the next draw command
  ***********************************************************/
 void SceneManager::SetShaderColor(
 	float redColorValue,
@@ -298,634 +565,1750 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_drawState.bUseTexture = false;
+	m_drawState.color = currentColor;
 }
 
 /***********************************************************
  *  SetShaderTexture()
  *
  *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  associated with the passed in ID for the next draw.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const char* textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	m_drawState.bUseTexture = true;
+	m_drawState.textureSlot = FindTextureSlot(textureTag);
 }
 
 /***********************************************************
  *  SetTextureUVScale()
  *
  *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  values for the next draw.
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_drawState.UVscale = glm::vec2(u, v);
 }
 
 /***********************************************************
  *  SetShaderMaterial()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for setting the material of the
+ *  next draw.  An unknown tag keeps the current material.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
-	if (m_objectMaterials.size() > 0)
+	int materialID = FindMaterialID(materialTag);
+	if (materialID >= 0)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+		m_drawState.materialID = materialID;
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
- /***********************************************************
-  *  DefineObjectMaterials()
-  *
-  *  This method is used for configuring the various material
-  *  settings for all of the objects within the 3D scene.
-  ***********************************************************/
-void SceneManager::DefineObjectMaterials() {
-
-	//create the material for the base of the shaker
-	OBJECT_MATERIAL designMaterial;
-	designMaterial.ambientColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	designMaterial.ambientStrength = 0.01f;
-	designMaterial.diffuseColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	designMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.35f);
-	designMaterial.shininess = 20.0;
-	designMaterial.tag = "design";
+/***********************************************************
+ *  DrawLodMesh()
+ *
+ *  This method is used for drawing a LOD chain into the
+ *  shadow atlas.  The shadow passes draw a fixed level,
+ *  since the camera view picks the level of each object.
+ ***********************************************************/
+void SceneManager::DrawLodMesh(int lodChainID)
+{
+	DrawSceneMesh(m_lodSelector->GetLodMesh(lodChainID, SHADOW_LOD_LEVEL));
+}
 
-	m_objectMaterials.push_back(designMaterial);
+/***********************************************************
+ *  DrawSceneMesh()
+ *
+ *  This method is used for drawing a mesh with the current
+ *  transformations into the shadow atlas.  Each shadow pass
+ *  only draws the objects that belong to its atlas, the
+ *  static ones or the dynamic ones.
+ ***********************************************************/
+void SceneManager::DrawSceneMesh(int meshID)
+{
+	bool bStaticPass = (m_renderPass == RENDER_PASS_STATIC_SHADOW);
+	if (bStaticPass == m_bDynamicObject)
+	{
+		return;
+	}
 
-	//create the material for the top of the shaker
-	OBJECT_MATERIAL brownMaterial;
-	brownMaterial.ambientColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	brownMaterial.ambientStrength = 0.01f;
-	brownMaterial.diffuseColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	brownMaterial.specularColor = glm::vec3(0.05f, 0.05f, 0.05f);
-	brownMaterial.shininess = 20.0f;
-	brownMaterial.tag = "brown";
+	m_shadowManager->SetModelMatrix(m_modelMatrix);
+	m_geometryPool->DrawMesh(meshID);
+}
 
-	m_objectMaterials.push_back(brownMaterial);
+/***********************************************************
+ *  SetDynamicObject()
+ *
+ *  This method is used for marking the objects drawn after
+ *  it as moving between frames.  Their shadows are drawn
+ *  every frame on top of the cached static shadows.
+ ***********************************************************/
+void SceneManager::SetDynamicObject(bool bDynamic)
+{
+	m_bDynamicObject = bDynamic;
+}
 
-	//create the material for the counter top (plane)
-	OBJECT_MATERIAL tableMaterial;
-	tableMaterial.ambientColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	tableMaterial.ambientStrength = 0.01f;
-	tableMaterial.diffuseColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	tableMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	tableMaterial.shininess = 30.0f;
-	tableMaterial.tag = "table";
+/***********************************************************
+ *  RenderShadowMaps()
+ *
+ *  This method is used for drawing the shadow casters of
+ *  every shadow casting light.  The static objects are only
+ *  drawn when the cached shadows are out of date, while the
+ *  dynamic objects are drawn every frame on top of a copy
+ *  of the cached shadows.  The checksum of the static
+ *  transforms is taken before, so a moved static object
+ *  rebuilds the shadows in the same frame.
+ ***********************************************************/
+void SceneManager::RenderShadowMaps()
+{
+	m_shadowManager->UpdateLights(m_lightManager);
 
-	m_objectMaterials.push_back(tableMaterial);
+	// the cached shadows were rendered with other transforms
+	if (m_staticChecksum != m_shadowChecksum)
+	{
+		m_shadowManager->InvalidateStaticShadows();
+	}
 
-	OBJECT_MATERIAL napkinMaterial;
-	napkinMaterial.ambientColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	napkinMaterial.ambientStrength = 0.005f;
-	napkinMaterial.diffuseColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	napkinMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	napkinMaterial.shininess = 0.5f;
-	napkinMaterial.tag = "napkin";
+	if (m_shadowManager->IsStaticPassNeeded() == true)
+	{
+		m_renderPass = RENDER_PASS_STATIC_SHADOW;
+		for (int i = 0; i < m_shadowManager->GetShadowCount(); i++)
+		{
+			m_shadowManager->BeginStaticPass(i);
+			DrawSceneObjects();
+			m_shadowManager->EndPass();
+		}
+		m_shadowManager->EndStaticPasses();
+		m_shadowChecksum = m_staticChecksum;
+	}
 
-	m_objectMaterials.push_back(napkinMaterial);
+	// the dynamic passes are skipped while nothing is moving
+	if (m_dynamicDrawCount > 0)
+	{
+		m_shadowManager->PrepareDynamicPasses();
+		m_renderPass = RENDER_PASS_DYNAMIC_SHADOW;
+		for (int i = 0; i < m_shadowManager->GetShadowCount(); i++)
+		{
+			m_shadowManager->BeginDynamicPass(i);
+			DrawSceneObjects();
+			m_shadowManager->EndPass();
+		}
+	}
+	else
+	{
+		m_shadowManager->SkipDynamicPasses();
+	}
 
+	m_renderPass = RENDER_PASS_SCENE;
+	m_bDynamicObject = false;
 }
 
 /***********************************************************
- *  SetupSceneLights()
+ *  SetViewParameters()
  *
- *  This method is called to add and configure the light
- *  sources for the 3D scene. There are up to 4 light sources.
+ *  This method is used for passing the view of the current
+ *  frame, which the levels of detail are chosen against and
+ *  the light clusters are built for.
  ***********************************************************/
-void SceneManager::SetupSceneLights() {
-
-	//light from the kitchen
-	m_pShaderManager->setVec3Value("lightSources[0].position", -7.0f, 8.0f, -2.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.5f, 0.5f, 0.45f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.1f, 0.1f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.9f, 0.9f, 0.5f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 64.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.9f);
-
-	//trying to mimic light from window
-	m_pShaderManager->setVec3Value("lightSources[1].position", 0.0f, 7.0f, 15.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.5f, 0.5f, 0.6f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.5f, 0.5f, 0.8f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 7.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.2f);
-
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+void SceneManager::SetViewParameters(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int viewportWidth,
+	int viewportHeight)
+{
+	SCENE_VIEW sceneView;
+	sceneView.view = view;
+	sceneView.projection = projection;
+	sceneView.viewport = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
 
+	SetViewParameters(&sceneView, 1, viewportWidth, viewportHeight);
 }
 
+/***********************************************************
+ *  SetViewParameters()
+ *
+ *  This method is used for passing every view of the
+ *  current frame.  The objects are culled once against all
+ *  of them and their draws are shared, while the levels of
+ *  detail and the light clusters follow the camera view,
+ *  which comes first.
+ ***********************************************************/
+void SceneManager::SetViewParameters(
+	const SCENE_VIEW* pViews,
+	int viewCount,
+	int targetWidth,
+	int targetHeight)
+{
+	if ((NULL == pViews) || (viewCount <= 0))
+	{
+		return;
+	}
 
- /***********************************************************
-  *  LoadSceneTextures()
-  *
-  *  This method is used for preparing the 3D scene by loading
-  *  the shapes, textures in memory to support the 3D scene
-  *  rendering
-  ***********************************************************/
-void SceneManager::LoadSceneTextures() {
-
-	//Creating the textures
-	CreateGLTexture("../../Utilities/textures/customTexture.jpg", "customTexture");
-	CreateGLTexture("../../Utilities/textures/customTexture2.jpg", "customTexture2");
-	CreateGLTexture("../../Utilities/textures/table_wood.jpg", "table_wood");
-	CreateGLTexture("../../Utilities/textures/butter_tray.jpg", "butter_tray");
-	CreateGLTexture("../../Utilities/textures/napkin_holder.jpg", "napkin_holder");
-	BindGLTextures();
+	m_viewCount = std::min(viewCount, MAX_SCENE_VIEWS);
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		m_views[i] = pViews[i];
+	}
+	m_targetWidth = std::max(targetWidth, 1);
+	m_targetHeight = std::max(targetHeight, 1);
+
+	// the camera view starts in the lower left corner, so its
+	// pixels line up with the light clusters
+	glm::ivec4 camera = GetViewportPixels(m_views[0], m_targetWidth, m_targetHeight);
+	m_viewMatrix = m_views[0].view;
+	m_projectionMatrix = m_views[0].projection;
+	m_lodSelector->SetView(m_viewMatrix, m_projectionMatrix, camera.w);
+	m_lightManager->SetView(m_viewMatrix, m_projectionMatrix, camera.z, camera.w);
 }
 
+/***********************************************************
+ *  GetFrameArena()
+ *
+ *  This method is used for getting the arena that holds the
+ *  data built each frame.  The main loop starts each frame
+ *  by calling its BeginFrame().
+ ***********************************************************/
+FrameArena* SceneManager::GetFrameArena()
+{
+	return(m_frameArena);
+}
 
+/***********************************************************
+ *  SetShaderCompiler()
+ *
+ *  This method is used for setting the compiler that the
+ *  programs needed after startup are built with, so they
+ *  do not stall the frame that first uses them.
+ ***********************************************************/
+void SceneManager::SetShaderCompiler(ShaderCompiler* pShaderCompiler)
+{
+	m_pShaderCompiler = pShaderCompiler;
+}
 
 /***********************************************************
- *  PrepareScene()
+ *  SetJobSystem()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for setting the worker threads that
+ *  the transforms and the draws of each frame are built
+ *  on.  Without one the work runs on the main thread.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::SetJobSystem(JobSystem* pJobSystem)
 {
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-	LoadSceneTextures();
+	m_pJobSystem = pJobSystem;
+}
 
-	// define the materials for objects in the scene
-	DefineObjectMaterials();
+/***********************************************************
+ *  EnableShaderPermutations()
+ *
+ *  This method is used for building variants of the loaded
+ *  scene program, with the features of each draw fixed at
+ *  compile time.  The loaded program draws everything until
+ *  the variants are ready.
+ ***********************************************************/
+void SceneManager::EnableShaderPermutations(
+	const char* vertexShaderFile,
+	const char* fragmentShaderFile)
+{
+	m_shaderPermutations->Initialize(
+		m_pShaderCompiler,
+		vertexShaderFile,
+		fragmentShaderFile,
+		m_pShaderManager->m_programID);
+}
 
-	// add and define the light sources for the scene
-	SetupSceneLights();
+/***********************************************************
+ *  ResetShaderPermutations()
+ *
+ *  This method is used for dropping the variants of the
+ *  scene program once it was rebuilt from edited files, so
+ *  they are built again from the new source.
+ ***********************************************************/
+void SceneManager::ResetShaderPermutations()
+{
+	m_shaderPermutations->Reset(m_pShaderManager->m_programID);
+}
 
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for rebuilding the programs of the
+ *  lights, the shadows and the deferred lighting pass when
+ *  their files are edited.  It is called once the scene is
+ *  prepared.
+ ***********************************************************/
+void SceneManager::WatchShaders(ShaderHotReload* pHotReload)
+{
+	m_lightManager->WatchShaders(pHotReload);
+	m_shadowManager->WatchShaders(pHotReload);
+	if (NULL != m_deferredRenderer)
+	{
+		m_deferredRenderer->WatchShaders(pHotReload);
+	}
+}
 
-	m_basicMeshes->LoadPlaneMesh();
+/***********************************************************
+ *  ApplyProgramValues()
+ *
+ *  This method is used for setting the values of the frame,
+ *  the lights and the shadows into a scene program that was
+ *  rebuilt from its files, which is in use while this is
+ *  called.  The scene program of the shader manager is kept.
+ ***********************************************************/
+void SceneManager::ApplyProgramValues(GLuint programID)
+{
+	GLuint sceneProgramID = m_pShaderManager->m_programID;
+	m_pShaderManager->m_programID = programID;
+	SetFrameShaderValues();
+	m_pShaderManager->m_programID = sceneProgramID;
+}
 
-	m_basicMeshes->LoadCylinderMesh();
+/***********************************************************
+ *  SetFrameShaderValues()
+ *
+ *  This method is used for setting the values that are the
+ *  same for every draw of the frame, such as the views and
+ *  the lights, into the program that is currently in use.
+ ***********************************************************/
+void SceneManager::SetFrameShaderValues()
+{
+	m_pShaderManager->setMat4Value(g_ViewName, m_viewMatrix);
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		m_pShaderManager->setMat4Value(g_ViewProjectionNames[i], m_views[i].projection * m_views[i].view);
+		m_pShaderManager->setVec3Value(g_ViewPositionNames[i], glm::vec3(glm::inverse(m_views[i].view)[3]));
+	}
+	m_pShaderManager->setBoolValue(g_UseLightingName, m_bUseLighting);
 
-	m_basicMeshes->LoadSphereMesh();
+	m_lightManager->SetShaderValues(m_pShaderManager);
+	m_shadowManager->SetShaderValues(m_pShaderManager);
+}
 
-	m_basicMeshes->LoadTorusMesh();
+/***********************************************************
+ *  ReserveFrameArena()
+ *
+ *  This method is used for growing the frame arena to hold
+ *  the arrays that a frame builds for each scene object,
+ *  so a larger scene does not spill onto the heap.  The
+ *  draw groups are counted as one per level of an object,
+ *  which is the most the culling pass can create.
+ ***********************************************************/
+void SceneManager::ReserveFrameArena()
+{
+	// the queued draw, its features, its sort key, the hash of
+	// the world matrix and the order and program of the groups
+	size_t objectBytes = sizeof(DRAW_ITEM) + sizeof(int) + sizeof(uint64_t) + sizeof(uint32_t) +
+		CullingManager::MAX_DRAW_LEVELS * (sizeof(int) + sizeof(GLuint));
 
-	m_basicMeshes->LoadBoxMesh();
+	m_frameArena->Reserve(FRAME_ARENA_SIZE + objectBytes * (size_t)m_sceneFile->GetObjectCount());
+}
 
+/***********************************************************
+ *  BeginRenderQueue()
+ *
+ *  This method is used for allocating the queue of the
+ *  frame's draws from the frame arena.  Each scene object
+ *  queues at most one draw, so the queue never grows.
+ ***********************************************************/
+void SceneManager::BeginRenderQueue()
+{
+	m_renderQueueCapacity = std::min(m_sceneFile->GetObjectCount(), 1 << SORT_INDEX_BITS);
+	m_renderQueue = m_frameArena->AllocateArray<DRAW_ITEM>(m_renderQueueCapacity);
+	m_renderQueueCount = 0;
+	if (NULL == m_renderQueue)
+	{
+		m_renderQueueCapacity = 0;
+	}
 }
 
 /***********************************************************
- *  RenderScene()
+ *  GetSharedFeatures()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for getting the program features
+ *  that every draw of the current frame needs.
  ***********************************************************/
-void SceneManager::RenderScene()
+int SceneManager::GetSharedFeatures() const
 {
+	int sharedFeatures = 0;
+	if (m_bUseLighting == true)
+	{
+		sharedFeatures |= ShaderPermutations::FEATURE_LIGHTING;
+	}
+	if (m_shadowManager->GetShadowCount() > 0)
+	{
+		sharedFeatures |= ShaderPermutations::FEATURE_SHADOWS;
+	}
 
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	return(sharedFeatures);
+}
 
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
+/***********************************************************
+ *  BuildDrawPackets()
+ *
+ *  This method is used for filling the render queue with
+ *  the draws of the scene objects when there is no GPU
+ *  culling pass.  The objects are split into chunks that
+ *  the worker threads pick the level of detail for and turn
+ *  into draws, each writing only the entries of its own
+ *  objects.  The results are then merged on this thread in
+ *  object order, which also resolves the programs, since a
+ *  missing variant is requested from the shader compiler.
+ ***********************************************************/
+void SceneManager::BuildDrawPackets()
+{
+	int objectCount = m_renderQueueCapacity;
+	m_renderQueueCount = 0;
+	if (objectCount == 0)
+	{
+		return;
+	}
 
+	// the program features of each object
+	int* pFeatures = m_frameArena->AllocateArray<int>(objectCount);
+	if (NULL == pFeatures)
+	{
+		return;
+	}
 
-	/****************************************************************/
-	//**				  Drawing the Table Plane				  **//
-	/****************************************************************/
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile->GetObjects();
+	DRAW_ITEM* pItems = m_renderQueue;
+	bool bInstanced = m_transformStore->HasInstanceBuffer();
+	int sharedFeatures = GetSharedFeatures();
 
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(25.0f, 1.0f, 25.0f);
+	// every object has its own LOD slot, so the workers never
+	// touch the same selection state
+	m_lodSelector->ReserveDrawSlots(objectCount);
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	RunParallel(m_pJobSystem, objectCount, DRAW_PACKET_CHUNK, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			const SceneFile::SCENE_OBJECT& object = pObjects[i];
+			const glm::mat4& worldMatrix = m_transformStore->GetWorldMatrix(i);
+
+			DRAW_ITEM& item = pItems[i];
+			item.programID = 0;
+			item.meshID = -1;
+			item.modelMatrix = worldMatrix;
+			item.bUseTexture = (object.textureIndex >= 0);
+			item.textureSlot = (item.bUseTexture == true) ? m_textureSlots[object.textureIndex] : -1;
+			item.color = object.color;
+			item.UVscale = object.UVscale;
+			item.materialID = object.materialIndex;
+			item.objectIndex = (bInstanced == true) ? i : -1;
+
+			pFeatures[i] = sharedFeatures;
+			if (item.bUseTexture == true)
+			{
+				pFeatures[i] |= ShaderPermutations::FEATURE_TEXTURE;
+			}
+
+			// the bounds of the finest level stand in for every level
+			const SCENE_MESH_ID& sceneMesh = m_sceneMeshes[object.meshIndex];
+			if (sceneMesh.lodChainID < 0)
+			{
+				item.meshID = sceneMesh.meshID;
+				continue;
+			}
+			const GeometryPool::MESH_RANGE* pMesh =
+				m_geometryPool->GetMesh(m_lodSelector->GetLodMesh(sceneMesh.lodChainID, 0));
+			if (NULL == pMesh)
+			{
+				continue;
+			}
+
+			glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(pMesh->boundsCenter, 1.0f));
+			float radius = pMesh->boundsRadius * GetMaxScale(worldMatrix);
+			item.meshID = m_lodSelector->SelectMeshForSlot(sceneMesh.lodChainID, i, center, radius);
+		}
+	});
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, -10.0f);
+	int lightCount = m_lightManager->GetLightCount();
+	for (int i = 0; i < objectCount; i++)
+	{
+		// the draws without a mesh are packed out of the queue
+		if (pItems[i].meshID < 0)
+		{
+			continue;
+		}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		DRAW_ITEM& item = m_renderQueue[m_renderQueueCount];
+		if (m_renderQueueCount != i)
+		{
+			item = pItems[i];
+		}
+		item.programID = m_shaderPermutations->GetProgram(pFeatures[i], lightCount);
+		if (item.programID == 0)
+		{
+			item.programID = m_pShaderManager->m_programID;
+		}
+		m_renderQueueCount++;
+	}
+}
 
-	//set the color of the shader (brown)
-	//SetShaderColor(0.130, 0.086, 0.046, 1);
-	SetShaderColor(0.1f, 0.084f, 0.052f, 1.0f);
-	//set the material for the shader
-	SetShaderMaterial("table");
+/***********************************************************
+ *  UpdateStaticChecksum()
+ *
+ *  This method is used for folding the hash of every static
+ *  world matrix into the checksum of the frame and counting
+ *  the dynamic objects.  It covers the objects outside the
+ *  view as well, since they still cast shadows into it.
+ *  The hashes are taken on the workers and folded here in
+ *  object order, so the checksum does not depend on them.
+ ***********************************************************/
+void SceneManager::UpdateStaticChecksum()
+{
+	m_staticChecksum = CHECKSUM_SEED;
+	m_dynamicDrawCount = 0;
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
+	int objectCount = m_sceneFile->GetObjectCount();
+	uint32_t* pHashes = m_frameArena->AllocateArray<uint32_t>(objectCount);
+	if ((objectCount == 0) || (NULL == pHashes))
+	{
+		return;
+	}
 
-	/****************************************************************/
-	//**				  Drawing Salt Shaker					  **//
-	/****************************************************************/
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile->GetObjects();
+	RunParallel(m_pJobSystem, objectCount, DRAW_PACKET_CHUNK, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			pHashes[i] = (pObjects[i].bDynamic != 0) ? 0 : HashMatrix(m_transformStore->GetWorldMatrix(i));
+		}
+	});
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		if (pObjects[i].bDynamic != 0)
+		{
+			m_dynamicDrawCount++;
+		}
+		else
+		{
+			m_staticChecksum = (m_staticChecksum ^ pHashes[i]) * 16777619u;
+		}
+	}
+}
+
+/***********************************************************
+ *  FindCullGroup()
+ *
+ *  This method is used for finding the draw group of the
+ *  culling pass that the meshes with the vertex format and
+ *  the index type of the passed in one are drawn with, with
+ *  the passed in texture, adding one when there is none.
+ ***********************************************************/
+int SceneManager::FindCullGroup(const GeometryPool::MESH_RANGE* pMesh, int textureSlot)
+{
+	for (size_t i = 0; i < m_cullGroups.size(); i++)
+	{
+		const CULL_GROUP& group = m_cullGroups[i];
+		if ((group.vertexFormat == pMesh->vertexFormat) &&
+			(group.indexType == pMesh->indexType) && (group.textureSlot == textureSlot))
+		{
+			return((int)i);
+		}
+	}
+
+	CULL_GROUP group;
+	group.vertexFormat = pMesh->vertexFormat;
+	group.indexType = pMesh->indexType;
+	group.textureSlot = textureSlot;
+	m_cullGroups.push_back(group);
+
+	return(m_cullingManager->CreateDrawGroup());
+}
+
+/***********************************************************
+ *  CreateCullObjects()
+ *
+ *  This method is used for handing every scene object to
+ *  the culling pass, with the bounds of its finest mesh and
+ *  the index range of each of its levels of detail.  The
+ *  objects are added in the order of the scene file, so the
+ *  index of each is also the index of its world matrix and
+ *  its values.  It is only called when the scene is loaded,
+ *  since the pass moves the bounds and picks the levels.
+ *  A reloaded scene with as many objects replaces them in
+ *  place, so only the changed ones are uploaded again.
+ ***********************************************************/
+void SceneManager::CreateCullObjects()
+{
+	bool bReplace = (m_bGpuCulling == true) &&
+		(m_cullingManager->GetObjectCount() == m_sceneFile->GetObjectCount());
+	if (bReplace == false)
+	{
+		m_cullingManager->ClearObjects();
+		m_cullGroups.clear();
+	}
+	if (m_bGpuCulling == false)
+	{
+		return;
+	}
+
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile->GetObjects();
+	for (int i = 0; i < m_sceneFile->GetObjectCount(); i++)
+	{
+		const SceneFile::SCENE_OBJECT& object = pObjects[i];
+		const SCENE_MESH_ID& sceneMesh = m_sceneMeshes[object.meshIndex];
+		int textureSlot = (object.textureIndex >= 0) ? m_textureSlots[object.textureIndex] : -1;
+
+		int meshCount = 1;
+		int meshIDs[CullingManager::MAX_DRAW_LEVELS];
+		float minScreenSizes[CullingManager::MAX_DRAW_LEVELS];
+		meshIDs[0] = sceneMesh.meshID;
+		minScreenSizes[0] = 0.0f;
+		if (sceneMesh.lodChainID >= 0)
+		{
+			meshCount = std::min((int)LodSelector::MAX_LOD_LEVELS, (int)CullingManager::MAX_DRAW_LEVELS);
+			for (int level = 0; level < meshCount; level++)
+			{
+				meshIDs[level] = m_lodSelector->GetLodMesh(sceneMesh.lodChainID, level);
+				minScreenSizes[level] = m_lodSelector->GetMinScreenSize(sceneMesh.lodChainID, level);
+			}
+		}
+
+		// an object without a mesh is still added, so the indices
+		// of the objects after it stay the same
+		CullingManager::DRAW_LEVEL levels[CullingManager::MAX_DRAW_LEVELS];
+		int levelCount = 0;
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+		for (int level = 0; level < meshCount; level++)
+		{
+			const GeometryPool::MESH_RANGE* pMesh = m_geometryPool->GetMesh(meshIDs[level]);
+			if (NULL == pMesh)
+			{
+				break;
+			}
+
+			// the bounds of the finest level stand in for every level
+			if (level == 0)
+			{
+				center = pMesh->boundsCenter;
+				radius = pMesh->boundsRadius;
+			}
+
+			levels[levelCount].drawGroup = FindCullGroup(pMesh, textureSlot);
+			levels[levelCount].indexCount = pMesh->indexCount;
+			levels[levelCount].firstIndex = pMesh->firstIndex;
+			levels[levelCount].baseVertex = pMesh->baseVertex;
+			levels[levelCount].minScreenSize = minScreenSizes[level];
+			levelCount++;
+		}
+
+		if (bReplace == true)
+		{
+			m_cullingManager->SetObjectDraw(i, levels, levelCount, center, radius);
+		}
+		else
+		{
+			m_cullingManager->AddObject(levels, levelCount, center, radius);
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawCulledObjects()
+ *
+ *  This method is used for culling the scene objects on the
+ *  GPU and drawing the visible ones with one indirect call
+ *  per draw group, so the CPU never reads back which of
+ *  them are visible and does no work per object.  The
+ *  program of each group is resolved from its features,
+ *  and the groups are drawn sorted by it, so each program
+ *  is bound once with the frame values.  The views are
+ *  drawn the same way as the queued draws, either as
+ *  instances routed to their viewports or once per view.
+ ***********************************************************/
+void SceneManager::DrawCulledObjects()
+{
+	int groupCount = (int)m_cullGroups.size();
+	int* pGroupOrder = m_frameArena->AllocateArray<int>(groupCount);
+	GLuint* pGroupPrograms = m_frameArena->AllocateArray<GLuint>(groupCount);
+	if ((groupCount == 0) || (NULL == pGroupOrder) || (NULL == pGroupPrograms))
+	{
+		return;
+	}
+
+	int passCount = 1;
+	int instanceCount = m_viewCount;
+	if ((m_viewCount > 1) && (m_bViewportArray == false))
+	{
+		passCount = m_viewCount;
+		instanceCount = 1;
+	}
+
+	// the levels of detail are picked against the camera view
+	CullingManager::LOD_VIEW lodView;
+	lodView.view = m_lodSelector->GetView();
+	lodView.pixelScale = m_lodSelector->GetPixelScale();
+	lodView.hysteresis = m_lodSelector->GetHysteresis();
+	lodView.bOrthographic = m_lodSelector->IsOrthographic();
+	m_cullingManager->SetLodView(lodView);
+
+	glm::mat4 viewProjections[MAX_SCENE_VIEWS];
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		viewProjections[i] = m_views[i].projection * m_views[i].view;
+	}
+	m_cullingManager->CullObjects(viewProjections, m_viewCount, (GLuint)instanceCount);
+
+	int sharedFeatures = GetSharedFeatures();
+	int lightCount = m_lightManager->GetLightCount();
+	for (int i = 0; i < groupCount; i++)
+	{
+		int features = sharedFeatures;
+		if (m_cullGroups[i].textureSlot >= 0)
+		{
+			features |= ShaderPermutations::FEATURE_TEXTURE;
+		}
+		pGroupPrograms[i] = m_shaderPermutations->GetProgram(features, lightCount);
+		if (pGroupPrograms[i] == 0)
+		{
+			pGroupPrograms[i] = m_pShaderManager->m_programID;
+		}
+		pGroupOrder[i] = i;
+	}
+	std::sort(pGroupOrder, pGroupOrder + groupCount, [pGroupPrograms](int first, int second)
+	{
+		if (pGroupPrograms[first] != pGroupPrograms[second])
+		{
+			return(pGroupPrograms[first] < pGroupPrograms[second]);
+		}
+		return(first < second);
+	});
+
+	if ((m_viewCount > 1) && (m_bViewportArray == true))
+	{
+		for (int i = 0; i < m_viewCount; i++)
+		{
+			glm::ivec4 rect = GetViewportPixels(m_views[i], m_targetWidth, m_targetHeight);
+			glViewportIndexedf(i, (float)rect.x, (float)rect.y, (float)rect.z, (float)rect.w);
+		}
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_DATA_BINDING, m_objectDataBuffer);
+	GLuint sceneProgramID = m_pShaderManager->m_programID;
+
+	for (int pass = 0; pass < passCount; pass++)
+	{
+		if (passCount > 1)
+		{
+			glm::ivec4 rect = GetViewportPixels(m_views[pass], m_targetWidth, m_targetHeight);
+			glViewport(rect.x, rect.y, rect.z, rect.w);
+		}
+
+		GLuint currentProgramID = 0;
+		for (int i = 0; i < groupCount; i++)
+		{
+			int drawGroup = pGroupOrder[i];
+			const CULL_GROUP& group = m_cullGroups[drawGroup];
+			if (m_cullingManager->GetGroupObjectCount(drawGroup) == 0)
+			{
+				continue;
+			}
+
+			if (pGroupPrograms[drawGroup] != currentProgramID)
+			{
+				m_pShaderManager->m_programID = pGroupPrograms[drawGroup];
+				m_pShaderManager->use();
+				SetFrameShaderValues();
+				m_pShaderManager->setIntValue(g_FirstViewName, pass);
+				m_pShaderManager->setBoolValue(g_IndirectDrawName, true);
+				currentProgramID = pGroupPrograms[drawGroup];
+			}
+
+			m_pShaderManager->setIntValue(g_UseTextureName, group.textureSlot >= 0);
+			if (group.textureSlot >= 0)
+			{
+				m_pShaderManager->setSampler2DValue(g_TextureValueName, group.textureSlot);
+			}
+
+			m_geometryPool->Bind(group.vertexFormat);
+			m_cullingManager->DrawGroup(drawGroup, group.indexType);
+		}
+	}
+
+	// every viewport is set back to the whole target
+	if (m_viewCount > 1)
+	{
+		glViewport(0, 0, m_targetWidth, m_targetHeight);
+	}
+
+	m_pShaderManager->m_programID = sceneProgramID;
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  FlushRenderQueue()
+ *
+ *  This method is used for submitting the queued draws of
+ *  the scene pass, sorted by program and then by mesh, so
+ *  each program is bound once and its frame values are set
+ *  once.  The draws are sorted through 64-bit keys in the
+ *  frame arena, and the queue index in the low bits keeps
+ *  equal draws in the order they were queued.  With several
+ *  views each draw is instanced once per view and every
+ *  instance is routed to the viewport of its view, or when
+ *  the driver cannot route them, the sorted draws are
+ *  submitted again for each view.
+ ***********************************************************/
+void SceneManager::FlushRenderQueue()
+{
+	if (m_renderQueueCount == 0)
+	{
+		return;
+	}
+
+	uint64_t* pSortKeys = m_frameArena->AllocateArray<uint64_t>(m_renderQueueCount);
+	if (NULL == pSortKeys)
+	{
+		m_renderQueueCount = 0;
+		return;
+	}
+
+	for (int i = 0; i < m_renderQueueCount; i++)
+	{
+		const DRAW_ITEM& item = m_renderQueue[i];
+		pSortKeys[i] = ((uint64_t)item.programID << (SORT_MESH_BITS + SORT_INDEX_BITS)) |
+			((uint64_t)(item.meshID & ((1 << SORT_MESH_BITS) - 1)) << SORT_INDEX_BITS) |
+			(uint64_t)i;
+	}
+	std::sort(pSortKeys, pSortKeys + m_renderQueueCount);
 
-	// set the rotation on the X and Y axis
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 55.0f;
+	int passCount = 1;
+	int instanceCount = m_viewCount;
+	if (m_viewCount > 1)
+	{
+		if (m_bViewportArray == true)
+		{
+			for (int i = 0; i < m_viewCount; i++)
+			{
+				glm::ivec4 rect = GetViewportPixels(m_views[i], m_targetWidth, m_targetHeight);
+				glViewportIndexedf(i, (float)rect.x, (float)rect.y, (float)rect.z, (float)rect.w);
+			}
+		}
+		else
+		{
+			passCount = m_viewCount;
+			instanceCount = 1;
+		}
+	}
+
+	GLuint sceneProgramID = m_pShaderManager->m_programID;
+
+	for (int pass = 0; pass < passCount; pass++)
+	{
+		if (passCount > 1)
+		{
+			glm::ivec4 rect = GetViewportPixels(m_views[pass], m_targetWidth, m_targetHeight);
+			glViewport(rect.x, rect.y, rect.z, rect.w);
+		}
+		SubmitRenderQueue(pSortKeys, pass, instanceCount);
+	}
+
+	// every viewport is set back to the whole target
+	if (m_viewCount > 1)
+	{
+		glViewport(0, 0, m_targetWidth, m_targetHeight);
+	}
+
+	m_pShaderManager->m_programID = sceneProgramID;
+	m_pShaderManager->use();
+	m_renderQueueCount = 0;
+}
+
+/***********************************************************
+ *  SubmitRenderQueue()
+ *
+ *  This method is used for submitting the sorted draws of
+ *  the scene pass, each drawing the passed in number of
+ *  views starting at the passed in one.  The frame values
+ *  are set whenever the program changes.
+ ***********************************************************/
+void SceneManager::SubmitRenderQueue(const uint64_t* pSortKeys, int firstView, int instanceCount)
+{
+	GLuint currentProgramID = 0;
+
+	for (int i = 0; i < m_renderQueueCount; i++)
+	{
+		const DRAW_ITEM& item = m_renderQueue[pSortKeys[i] & ((1 << SORT_INDEX_BITS) - 1)];
+
+		if (item.programID != currentProgramID)
+		{
+			m_pShaderManager->m_programID = item.programID;
+			m_pShaderManager->use();
+			SetFrameShaderValues();
+			m_pShaderManager->setIntValue(g_FirstViewName, firstView);
+			m_pShaderManager->setBoolValue(g_IndirectDrawName, false);
+			currentProgramID = item.programID;
+		}
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(1.4f, 2.5f, 1.4f);
+		// the world matrix is read from the instance buffer when
+		// there is one, so only its index is set per draw
+		m_pShaderManager->setIntValue(g_ObjectIndexName, item.objectIndex);
+		if (item.objectIndex < 0)
+		{
+			// the shader manager has no mat3 setter, so the normal
+			// matrix is set straight on the program
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(item.modelMatrix)));
+			m_pShaderManager->setMat4Value(g_ModelName, item.modelMatrix);
+			glUniformMatrix3fv(glGetUniformLocation(item.programID, g_NormalMatrixName), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+		}
+		m_pShaderManager->setIntValue(g_UseTextureName, item.bUseTexture);
+		if (item.bUseTexture == true)
+		{
+			m_pShaderManager->setSampler2DValue(g_TextureValueName, item.textureSlot);
+		}
+		else
+		{
+			m_pShaderManager->setVec4Value(g_ColorValueName, item.color);
+		}
+		m_pShaderManager->setVec2Value(g_UVScaleName, item.UVscale);
+
+		if (item.materialID >= 0)
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[item.materialID];
+			m_pShaderManager->setVec3Value(g_AmbientColorName, material.ambientColor);
+			m_pShaderManager->setFloatValue(g_AmbientStrengthName, material.ambientStrength);
+			m_pShaderManager->setVec3Value(g_DiffuseColorName, material.diffuseColor);
+			m_pShaderManager->setVec3Value(g_SpecularColorName, material.specularColor);
+			m_pShaderManager->setFloatValue(g_ShininessName, material.shininess);
+			// the deferred path looks the values up in the material table
+			m_pShaderManager->setIntValue(g_MaterialIDName, item.materialID);
+		}
 
-	// set the position for the mesh
-	positionXYZ = glm::vec3(4.2f, 1.2f, 2.8f);
+		m_geometryPool->DrawMesh(item.meshID, instanceCount);
+	}
+}
 
-	//set the tansformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  EnableDeferredShading()
+ *
+ *  This method is used for switching the scene to the
+ *  deferred render path.  It must be called before the
+ *  scene is prepared, and the shader manager must then be
+ *  loaded with the G-buffer fragment shader.  False is
+ *  returned when the scene has to be rendered forward.
+ ***********************************************************/
+bool SceneManager::EnableDeferredShading(int width, int height)
+{
+	if (NULL != m_deferredRenderer)
+	{
+		return(true);
+	}
 
-	//set the color for the shader (light blue)
-	//SetShaderColor(0.624, 0.812, 0.936, 1);
+	m_deferredRenderer = new DeferredRenderer();
+	if (m_deferredRenderer->Initialize(width, height) == false)
+	{
+		delete m_deferredRenderer;
+		m_deferredRenderer = NULL;
+		return(false);
+	}
 
-	//setting the scale for the texture and loading it
-	SetTextureUVScale(2.0f, 1.0f);
-	SetShaderTexture("customTexture");
-	//set the material of the shader
-	SetShaderMaterial("design");
+	return(true);
+}
 
+/***********************************************************
+ *  ResizeRenderTargets()
+ *
+ *  This method is used for allocating the render targets
+ *  of the deferred path again after the framebuffer of the
+ *  window changed size.
+ ***********************************************************/
+void SceneManager::ResizeRenderTargets(int width, int height)
+{
+	if (NULL != m_deferredRenderer)
+	{
+		m_deferredRenderer->Resize(width, height);
+	}
+}
 
-	//draw the mesh with transformations
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  UploadMaterialTable()
+ *
+ *  This method is used for copying the defined materials
+ *  into the table read by the deferred lighting pass, in
+ *  the same order that FindMaterialID() numbers them.
+ ***********************************************************/
+void SceneManager::UploadMaterialTable()
+{
+	if (NULL == m_deferredRenderer)
+	{
+		return;
+	}
 
-	/****************************************************************/
+	std::vector<DeferredRenderer::MATERIAL_ENTRY> materialTable;
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		DeferredRenderer::MATERIAL_ENTRY entry;
+		entry.ambientColor = m_objectMaterials[i].ambientColor;
+		entry.ambientStrength = m_objectMaterials[i].ambientStrength;
+		entry.diffuseColor = m_objectMaterials[i].diffuseColor;
+		entry.shininess = m_objectMaterials[i].shininess;
+		entry.specularColor = m_objectMaterials[i].specularColor;
+		entry.padding = 0.0f;
+		materialTable.push_back(entry);
+	}
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(1.5f, 1.0f, 1.5f);
+	m_deferredRenderer->SetMaterials(materialTable);
+}
 
-	//set the position for the mesh
-	positionXYZ = glm::vec3(4.2f, 3.7f, 2.8f);
+/***********************************************************
+ *  UploadObjectData()
+ *
+ *  This method is used for copying the color, the texture
+ *  scale and the material of every scene object into the
+ *  buffer read by the shaders of the GPU culling pass, by
+ *  the index of the object.  An object without a material
+ *  is lit with the first one.
+ ***********************************************************/
+void SceneManager::UploadObjectData()
+{
+	if (m_bGpuCulling == false)
+	{
+		return;
+	}
 
-	//set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile->GetObjects();
+	int objectCount = m_sceneFile->GetObjectCount();
+
+	OBJECT_DATA emptyEntry;
+	emptyEntry.color = glm::vec4(1.0f);
+	emptyEntry.ambientColor = glm::vec3(0.0f);
+	emptyEntry.ambientStrength = 0.0f;
+	emptyEntry.diffuseColor = glm::vec3(0.0f);
+	emptyEntry.shininess = 1.0f;
+	emptyEntry.specularColor = glm::vec3(0.0f);
+	emptyEntry.materialID = 0;
+	emptyEntry.UVscale = glm::vec2(1.0f, 1.0f);
+	emptyEntry.padding = glm::vec2(0.0f);
+
+	// the buffer is never empty, so it can always be bound
+	std::vector<OBJECT_DATA> objectData((objectCount > 0) ? objectCount : 1, emptyEntry);
+	for (int i = 0; i < objectCount; i++)
+	{
+		const SceneFile::SCENE_OBJECT& object = pObjects[i];
+		OBJECT_DATA& entry = objectData[i];
+		entry.color = object.color;
+		entry.UVscale = object.UVscale;
 
-	//change the color of the shader (brown)
-	//SetShaderColor(0.244, 0.192, 0.208, 1);
+		int materialID = (object.materialIndex >= 0) ? object.materialIndex : 0;
+		if (materialID < (int)m_objectMaterials.size())
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[materialID];
+			entry.ambientColor = material.ambientColor;
+			entry.ambientStrength = material.ambientStrength;
+			entry.diffuseColor = material.diffuseColor;
+			entry.shininess = material.shininess;
+			entry.specularColor = material.specularColor;
+			entry.materialID = materialID;
+		}
+	}
 
-	//setting the scale for the texture then loading it
-	SetTextureUVScale(4.0f, 3.0f);
-	SetShaderTexture("customTexture2");
-	//set the material or the shader
-	SetShaderMaterial("brown");
+	if (m_objectDataBuffer == 0)
+	{
+		glGenBuffers(1, &m_objectDataBuffer);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectDataBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, objectData.size() * sizeof(OBJECT_DATA), &objectData[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
 
-	//draw the mesh with transformations
-	m_basicMeshes->DrawHalfSphereMesh();
+/***********************************************************
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for also testing the scene objects
+ *  of the GPU culling pass against the depth of the last
+ *  frame, which only holds with a single view.
+ ***********************************************************/
+void SceneManager::SetOcclusionCulling(bool bEnable)
+{
+	m_cullingManager->SetOcclusionCulling(bEnable);
+}
 
-	/****************************************************************/
-	//**				  Drawing Pepper Shaker					  **//
-	/****************************************************************/
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
 
-	//set the rotation on the Y axis
-	YrotationDegrees = 85.0f;
+/***********************************************************
+ *  SetSceneFilename()
+ *
+ *  This method is used for setting the scene description
+ *  that PrepareScene() loads.  A .json file is parsed and
+ *  any other file is mapped as the binary form.
+ ***********************************************************/
+void SceneManager::SetSceneFilename(const char* filename)
+{
+	if (NULL != filename)
+	{
+		m_sceneFilename = filename;
+	}
+}
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(1.4f, 2.5f, 1.4f);
+/***********************************************************
+ *  LoadScene()
+ *
+ *  This method is used for switching the prepared scene to
+ *  another scene file.  Only what differs from the loaded
+ *  scene is built, so a batch of scenes that share meshes
+ *  and textures loads them once.  When the file cannot be
+ *  loaded, the loaded scene and its filename stay in place.
+ ***********************************************************/
+bool SceneManager::LoadScene(const char* filename)
+{
+	if (NULL == filename)
+	{
+		return(false);
+	}
+	if (m_sceneFilename == filename)
+	{
+		return(true);
+	}
 
-	// set the position for the mesh
-	positionXYZ = glm::vec3(-3.5f, 1.2f, 2.5f);
+	std::string loadedFilename = m_sceneFilename;
+	m_sceneFilename = filename;
+	if (ReloadScene() == false)
+	{
+		m_sceneFilename = loadedFilename;
+		return(false);
+	}
 
-	//set the tansformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	return(true);
+}
 
-	//set the color for the shader (light blue)
-	//SetShaderColor(0.624, 0.812, 0.936, 1);
+ /***********************************************************
+  *  DefineObjectMaterials()
+  *
+  *  This method is used for configuring the various material
+  *  settings for all of the objects within the 3D scene.  The
+  *  materials keep the order of the scene file, so the index
+  *  an object refers to is also its material ID.
+  ***********************************************************/
+void SceneManager::DefineObjectMaterials() {
 
-	//setting the scale for the texture and loading it
-	SetTextureUVScale(2.0f, 1.0f);
-	SetShaderTexture("customTexture");
+	const SceneFile::SCENE_MATERIAL* pMaterials = m_sceneFile->GetMaterials();
+	for (int i = 0; i < m_sceneFile->GetMaterialCount(); i++)
+	{
+		OBJECT_MATERIAL material;
+		material.ambientColor = pMaterials[i].ambientColor;
+		material.ambientStrength = pMaterials[i].ambientStrength;
+		material.diffuseColor = pMaterials[i].diffuseColor;
+		material.specularColor = pMaterials[i].specularColor;
+		material.shininess = pMaterials[i].shininess;
+		material.tag = pMaterials[i].tag;
+
+		m_objectMaterials.push_back(material);
+	}
 
-	//set the material of the shader
-	SetShaderMaterial("design");
+}
 
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is called to add and configure the light
+ *  sources for the 3D scene.  The lights are stored in a
+ *  shader storage buffer, so there is no fixed limit on the
+ *  number of light sources.  The shadow casting lights are
+ *  shadowed as spot lights aimed at their target.
+ ***********************************************************/
+void SceneManager::SetupSceneLights() {
 
-	//draw the mesh with transformations
-	m_basicMeshes->DrawCylinderMesh();
+	const SceneFile::SCENE_LIGHT* pLights = m_sceneFile->GetLights();
+	for (int i = 0; i < m_sceneFile->GetLightCount(); i++)
+	{
+		// lights without a range reach every object in the scene
+		int lightIndex = m_lightManager->AddLight(
+			pLights[i].position,
+			pLights[i].ambientColor,
+			pLights[i].diffuseColor,
+			pLights[i].specularColor,
+			pLights[i].focalStrength,
+			pLights[i].specularIntensity,
+			pLights[i].range);
+
+		if ((lightIndex >= 0) && (pLights[i].bCastShadows != 0))
+		{
+			m_shadowManager->AddShadowLight(
+				m_lightManager,
+				lightIndex,
+				pLights[i].shadowTarget,
+				pLights[i].shadowFieldOfView,
+				pLights[i].shadowFarPlane,
+				pLights[i].shadowResolution);
+		}
+	}
 
-	/****************************************************************/
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_bUseLighting = true;
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(1.5f, 1.0f, 1.5f);
+}
 
-	//set the position for the mesh
-	positionXYZ = glm::vec3(-3.5f, 3.7f, 2.5f);
 
-	//set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+ /***********************************************************
+  *  LoadSceneTextures()
+  *
+  *  This method is used for preparing the 3D scene by loading
+  *  the shapes, textures in memory to support the 3D scene
+  *  rendering
+  ***********************************************************/
+void SceneManager::LoadSceneTextures() {
 
-	//change the color of the shader (brown)
-	//SetShaderColor(0.244, 0.192, 0.208, 1);
+	//Creating the textures, a texture that is already loaded
+	//is only decoded again when its image file has changed
+	const SceneFile::SCENE_TEXTURE* pTextures = m_sceneFile->GetTextures();
+	for (int i = 0; i < m_sceneFile->GetTextureCount(); i++)
+	{
+		int textureSlot = FindTextureSlot(pTextures[i].tag);
 
-	//setting the scale for the texture then loading it
-	SetTextureUVScale(4.0f, 3.0f);
-	SetShaderTexture("customTexture2");
+		// the textures past the last slot are drawn untextured,
+		// rather than bound over the units of the renderers
+		if ((textureSlot < 0) && (m_loadedTextures >= MAX_SCENE_TEXTURES))
+		{
+			std::cout << "INFO: skipped texture:" << pTextures[i].tag
+				<< ", the scene holds at most " << MAX_SCENE_TEXTURES << " textures" << std::endl;
+			continue;
+		}
 
-	//set the material or the shader
-	SetShaderMaterial("brown");
+		uint64_t contentHash = HashFileContents(pTextures[i].filename);
+		if (textureSlot < 0)
+		{
+			if (CreateGLTexture(pTextures[i].filename, pTextures[i].tag) == true)
+			{
+				m_textureIDs[m_loadedTextures - 1].contentHash = contentHash;
+			}
+		}
+		else if ((contentHash != 0) && (contentHash != m_textureIDs[textureSlot].contentHash))
+		{
+			if (LoadGLTextureImage(m_textureIDs[textureSlot].ID, pTextures[i].filename) == true)
+			{
+				m_textureIDs[textureSlot].contentHash = contentHash;
+			}
+		}
+	}
+	BindGLTextures();
 
-	//draw the mesh with transformations
-	m_basicMeshes->DrawHalfSphereMesh();
+	// the objects refer to the textures by their index in the
+	// scene file, which stays valid when a texture fails to load
+	m_textureSlots.clear();
+	for (int i = 0; i < m_sceneFile->GetTextureCount(); i++)
+	{
+		m_textureSlots.push_back(FindTextureSlot(pTextures[i].tag));
+	}
+}
 
-	/****************************************************************/
-	//**				  Drawing the Table Tray				  **//
-	/****************************************************************/
-	
-	// reset the rotation on the Y axis
-	YrotationDegrees = 0.0f;
+/***********************************************************
+ *  CreateSceneMeshes()
+ *
+ *  This method is used for building each mesh listed in the
+ *  scene file into the shared geometry pool.
+ ***********************************************************/
+void SceneManager::CreateSceneMeshes()
+{
+	const SceneFile::SCENE_MESH* pMeshes = m_sceneFile->GetMeshes();
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(7.0f, 0.9f, 7.0f);
+	m_sceneMeshes.clear();
+	for (int i = 0; i < m_sceneFile->GetMeshCount(); i++)
+	{
+		m_sceneMeshes.push_back(CreateSceneMesh(pMeshes[i]));
+	}
+}
 
-	//set the position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.3f, 0.0f);
+/***********************************************************
+ *  CreateSceneMesh()
+ *
+ *  This method is used for building one mesh of the scene
+ *  file into the shared geometry pool.
+ ***********************************************************/
+SceneManager::SCENE_MESH_ID SceneManager::CreateSceneMesh(const SceneFile::SCENE_MESH& sceneMesh)
+{
+	SCENE_MESH_ID meshID;
+	meshID.meshID = -1;
+	meshID.lodChainID = -1;
 
-	//set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (sceneMesh.type == SceneFile::MESH_TYPE_PLANE)
+	{
+		meshID.meshID = m_geometryPool->AddMesh(MeshGenerator::CreatePlane());
+	}
+	else if (sceneMesh.type == SceneFile::MESH_TYPE_BOX)
+	{
+		meshID.meshID = m_geometryPool->AddMesh(MeshGenerator::CreateBox());
+	}
+	else
+	{
+		// the tessellated shapes use the compact vertex format, which
+		// roughly halves the bytes fetched per vertex, and are built at
+		// several levels of detail so distant shapes cost fewer vertices
+		int lodMeshes[LodSelector::MAX_LOD_LEVELS];
+		for (int level = 0; level < LodSelector::MAX_LOD_LEVELS; level++)
+		{
+			MeshGenerator::MESH_DATA mesh;
+			switch (sceneMesh.type)
+			{
+			case SceneFile::MESH_TYPE_CYLINDER:
+				mesh = MeshGenerator::CreateCylinder(LOD_CYLINDER_SLICES[level]);
+				break;
+			case SceneFile::MESH_TYPE_SPHERE:
+				mesh = MeshGenerator::CreateSphere(LOD_SPHERE_STACKS[level], LOD_SPHERE_SLICES[level]);
+				break;
+			case SceneFile::MESH_TYPE_HALF_SPHERE:
+				mesh = MeshGenerator::CreateHalfSphere(LOD_SPHERE_STACKS[level] / 2, LOD_SPHERE_SLICES[level]);
+				break;
+			default:
+				mesh = MeshGenerator::CreateTorus(sceneMesh.thickness,
+					LOD_TORUS_MAIN_SEGMENTS[level], LOD_TORUS_TUBE_SEGMENTS[level]);
+				break;
+			}
+			lodMeshes[level] = m_geometryPool->AddMesh(mesh, GeometryPool::VERTEX_FORMAT_COMPACT);
+		}
 
-	//set the texture for the mesh
-	SetShaderTexture("table_wood");
+		meshID.lodChainID = m_lodSelector->AddLodChain(
+			lodMeshes, LOD_SCREEN_SIZES, LodSelector::MAX_LOD_LEVELS);
+	}
 
-	// set the material for the mesh
-	SetShaderMaterial("table");
+	return(meshID);
+}
 
-	// draw the mesh
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  LoadObjectTransforms()
+ *
+ *  This method is used for copying the transforms of the
+ *  scene objects into the transform store.  The store only
+ *  composes the objects whose transform changed, so this is
+ *  cheap after a reload that moved a few objects.
+ ***********************************************************/
+void SceneManager::LoadObjectTransforms()
+{
+	if (m_transformStore->GetObjectCount() != m_sceneFile->GetObjectCount())
+	{
+		m_transformStore->SetObjectCount(m_sceneFile->GetObjectCount());
+	}
 
-	/****************************************************************/
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile->GetObjects();
+	for (int i = 0; i < m_sceneFile->GetObjectCount(); i++)
+	{
+		m_transformStore->SetTransform(i, pObjects[i].scale, pObjects[i].rotation, pObjects[i].position);
+	}
+}
 
-	//set the rotation on the X axis
-	XrotationDegrees = 90;
+/***********************************************************
+ *  SetObjectTransform()
+ *
+ *  This method is used for moving an object of the scene
+ *  file, such as for animation.  The new world matrix is
+ *  composed at the start of the next frame, and the object
+ *  should be marked dynamic in the scene file so the cached
+ *  shadows are not rendered again each time it moves.
+ ***********************************************************/
+void SceneManager::SetObjectTransform(
+	int objectIndex,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	m_transformStore->SetTransform(objectIndex, scaleXYZ, rotationDegrees, positionXYZ);
+}
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(6.82f, 6.82f, 6.82f);
+/***********************************************************
+ *  WatchSceneFiles()
+ *
+ *  This method is used for watching the scene file and the
+ *  image files of its textures for edits.
+ ***********************************************************/
+void SceneManager::WatchSceneFiles()
+{
+	if (NULL == m_sceneWatcher)
+	{
+		m_sceneWatcher = new FileWatcher();
+	}
 
-	//set the position for the mesh
-	positionXYZ = glm::vec3(0.0f, 1.1f, 0.0f);
+	m_sceneWatcher->AddFile(m_sceneFilename.c_str());
 
-	//set the tansformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	const SceneFile::SCENE_TEXTURE* pTextures = m_sceneFile->GetTextures();
+	for (int i = 0; i < m_sceneFile->GetTextureCount(); i++)
+	{
+		m_sceneWatcher->AddFile(pTextures[i].filename);
+	}
+}
 
-	// reload the mesh with thickness of 0.03
-	m_basicMeshes->LoadTorusMesh(0.03);
+/***********************************************************
+ *  ReloadScene()
+ *
+ *  This method is used for loading the edited scene file
+ *  and applying only what differs from the loaded scene.
+ *  The objects are read from the scene file every frame, so
+ *  their new transforms take effect by swapping the file.
+ *  The meshes, materials, lights and textures that did not
+ *  change keep their GPU resources.  When the file cannot be
+ *  loaded, the current scene stays in place.
+ ***********************************************************/
+bool SceneManager::ReloadScene()
+{
+	SceneFile* pSceneFile = new SceneFile();
+	if (pSceneFile->Load(m_sceneFilename.c_str()) == false)
+	{
+		std::cout << "INFO: keeping the loaded scene until the scene file is fixed" << std::endl;
+		delete pSceneFile;
+		return(false);
+	}
 
-	// draw the mesh
-	m_basicMeshes->DrawTorusMesh();
+	// the materials and lights are compared as a whole, since
+	// each of them is a single buffer on the GPU
+	bool bMaterialsChanged = (pSceneFile->GetMaterialCount() != m_sceneFile->GetMaterialCount()) ||
+		((pSceneFile->GetMaterialCount() > 0) &&
+		(memcmp(pSceneFile->GetMaterials(), m_sceneFile->GetMaterials(),
+			pSceneFile->GetMaterialCount() * sizeof(SceneFile::SCENE_MATERIAL)) != 0));
+	bool bLightsChanged = (pSceneFile->GetLightCount() != m_sceneFile->GetLightCount()) ||
+		((pSceneFile->GetLightCount() > 0) &&
+		(memcmp(pSceneFile->GetLights(), m_sceneFile->GetLights(),
+			pSceneFile->GetLightCount() * sizeof(SceneFile::SCENE_LIGHT)) != 0));
+
+	// a mesh that matches one of the built meshes is reused,
+	// wherever it moved in the list
+	std::vector<SCENE_MESH_ID> sceneMeshes;
+	int createdMeshes = 0;
+	for (int i = 0; i < pSceneFile->GetMeshCount(); i++)
+	{
+		const SceneFile::SCENE_MESH& mesh = pSceneFile->GetMeshes()[i];
+		int reusedIndex = -1;
+		for (int j = 0; (j < m_sceneFile->GetMeshCount()) && (reusedIndex < 0); j++)
+		{
+			const SceneFile::SCENE_MESH& builtMesh = m_sceneFile->GetMeshes()[j];
+			if ((builtMesh.type == mesh.type) &&
+				((mesh.type != SceneFile::MESH_TYPE_TORUS) || (builtMesh.thickness == mesh.thickness)))
+			{
+				reusedIndex = j;
+			}
+		}
 
+		if (reusedIndex >= 0)
+		{
+			sceneMeshes.push_back(m_sceneMeshes[reusedIndex]);
+		}
+		else
+		{
+			sceneMeshes.push_back(CreateSceneMesh(mesh));
+			createdMeshes++;
+		}
+	}
 
-	/****************************************************************/
-	//**					  Drawing Butter Dish				  **//
-	/****************************************************************/
-	
-	
-	//reset the roation on X & Y axis
-	XrotationDegrees = 0;
-	YrotationDegrees = 140.0f;
+	// the old file is only released once nothing refers to it
+	SceneFile* pLoadedFile = m_sceneFile;
+	m_sceneFile = pSceneFile;
+	delete pLoadedFile;
+	m_sceneMeshes.swap(sceneMeshes);
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(1.5f, 2.0f, 3.0f);
+	// the pool, the LOD chains and the texture units only keep
+	// what the new file refers to
+	ReleaseSceneMeshes(sceneMeshes);
+	ReleaseSceneTextures();
 
-	//set the position for the mesh
-	positionXYZ = glm::vec3(0.0f, 1.3f, 3.3f);
+	LoadObjectTransforms();
+	ReserveFrameArena();
+	LoadSceneTextures();
 
-	//set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (bMaterialsChanged == true)
+	{
+		m_objectMaterials.clear();
+		DefineObjectMaterials();
+		UploadMaterialTable();
+	}
 
-	//Set the scale for the texture
-	SetTextureUVScale(2.0, 2.0);
+	// the objects may have new colors even when the materials did not
+	// change, and new meshes or texture slots for the culling pass
+	UploadObjectData();
+	CreateCullObjects();
 
-	//set the texture for the shader
-	SetShaderTexture("butter_tray");
+	if (bLightsChanged == true)
+	{
+		m_lightManager->ClearLights();
+		m_shadowManager->ClearShadowLights();
+		SetupSceneLights();
+	}
 
-	//set the material for the shader
-	SetShaderMaterial("design");
+	// new image files are watched as well
+	WatchSceneFiles();
 
-	// draw the mesh
-	m_basicMeshes->DrawHalfSphereMesh();
+	std::cout << "INFO: reloaded scene file:" << m_sceneFilename
+		<< ", objects:" << m_sceneFile->GetObjectCount()
+		<< ", new meshes:" << createdMeshes
+		<< ", materials changed:" << bMaterialsChanged
+		<< ", lights changed:" << bLightsChanged << std::endl;
 
-	/****************************************************************/
+	return(true);
+}
 
-	//set the rotation on the X axis
-	XrotationDegrees = 90;
-	YrotationDegrees = 0;
-	ZrotationDegrees = 40;
+/***********************************************************
+ *  ReleaseSceneMeshes()
+ *
+ *  This method is used for removing the meshes that were
+ *  built for the previous scene file and are not reused by
+ *  the current one, together with their LOD chains, so
+ *  repeated edits do not fill up the geometry pool.
+ ***********************************************************/
+void SceneManager::ReleaseSceneMeshes(const std::vector<SCENE_MESH_ID>& oldMeshes)
+{
+	for (size_t i = 0; i < oldMeshes.size(); i++)
+	{
+		const SCENE_MESH_ID& oldMesh = oldMeshes[i];
 
-	//set the scale for the mesh
-	scaleXYZ = glm::vec3(1.7f, 3.2f, 3.5f);
+		bool bReused = false;
+		for (size_t j = 0; (j < m_sceneMeshes.size()) && (bReused == false); j++)
+		{
+			bReused = (m_sceneMeshes[j].meshID == oldMesh.meshID) &&
+				(m_sceneMeshes[j].lodChainID == oldMesh.lodChainID);
+		}
+		if (bReused == true)
+		{
+			continue;
+		}
 
-	//set the position for the mesh
-	//positionXYZ = glm::vec3(0.0f, 2.0f, 6.0f);
+		// a mesh listed twice is already gone the second time, which
+		// the pool and the selector both ignore
+		if (oldMesh.lodChainID >= 0)
+		{
+			for (int level = 0; level < LodSelector::MAX_LOD_LEVELS; level++)
+			{
+				m_geometryPool->RemoveMesh(m_lodSelector->GetLodMesh(oldMesh.lodChainID, level));
+			}
+			m_lodSelector->RemoveLodChain(oldMesh.lodChainID);
+		}
+		else
+		{
+			m_geometryPool->RemoveMesh(oldMesh.meshID);
+		}
+	}
+}
 
-	//set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  ReleaseSceneTextures()
+ *
+ *  This method is used for deleting the loaded textures whose
+ *  tags are not listed by the current scene file.  The ones
+ *  left are moved down to fill the freed slots, so their
+ *  texture units change and LoadSceneTextures() binds them
+ *  and maps the scene textures to them again.
+ ***********************************************************/
+void SceneManager::ReleaseSceneTextures()
+{
+	const SceneFile::SCENE_TEXTURE* pTextures = m_sceneFile->GetTextures();
 
-	//set the scale for the texture
-	SetTextureUVScale(4.0f, 3.0);
+	int keptTextures = 0;
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		bool bListed = false;
+		for (int j = 0; (j < m_sceneFile->GetTextureCount()) && (bListed == false); j++)
+		{
+			bListed = (m_textureIDs[i].tag.compare(pTextures[j].tag) == 0);
+		}
 
-	//set the texture for the shader
-	SetShaderTexture("customTexture2");
+		if (bListed == false)
+		{
+			glDeleteTextures(1, &m_textureIDs[i].ID);
+			continue;
+		}
 
-	//set the material for the shader
-	SetShaderMaterial("brown");
-	// reload the mesh with thickness 0.11
-	m_basicMeshes->LoadTorusMesh(0.11f);
-	// draw the mesh
-	m_basicMeshes->DrawTorusMesh();
+		if (keptTextures != i)
+		{
+			m_textureIDs[keptTextures] = m_textureIDs[i];
+		}
+		keptTextures++;
+	}
 
-	/****************************************************************/
-	//**				  Drawing the Napkin Holder				  **//
-	/****************************************************************/
+	for (int i = keptTextures; i < m_loadedTextures; i++)
+	{
+		m_textureIDs[i].ID = 0;
+		m_textureIDs[i].tag.clear();
+		m_textureIDs[i].contentHash = 0;
+	}
+	m_loadedTextures = keptTextures;
+}
 
-	/******************************************/
-	//**	Starting with Disign Segments	**//
-	/******************************************/
+/***********************************************************
+ *  UpdateScene()
+ *
+ *  This method is used for reloading the scene when the
+ *  scene file or one of its image files was written since
+ *  the last call.  It is called once per frame and returns
+ *  without touching the disk when nothing has changed.
+ ***********************************************************/
+bool SceneManager::UpdateScene()
+{
+	if (NULL == m_sceneWatcher)
+	{
+		return(false);
+	}
 
-	// Reset the rotation on x and z axis
-	XrotationDegrees = 0;
-	YrotationDegrees = 20;
-	ZrotationDegrees = 0;
+	std::vector<std::string> changedFiles;
+	if (m_sceneWatcher->Poll(changedFiles) == false)
+	{
+		return(false);
+	}
 
-	// set the scale for the mesh
-	scaleXYZ = glm::vec3(5.0f, 5.0f, 0.5f);
+	return(ReloadScene());
+}
 
-	// set the position for the mesh
-	positionXYZ = glm::vec3(-1.7279404685f, 3.4f, -2.0f);
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// everything below is described by the scene file, and an
+	// empty scene is drawn when it cannot be loaded
+	m_sceneFile->Load(m_sceneFilename.c_str());
 
-	//set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+	LoadSceneTextures();
 
-	// set the scale for the texture
-	SetTextureUVScale(1.0f, 1.0f);
+	// define the materials for objects in the scene
+	DefineObjectMaterials();
+	UploadMaterialTable();
 
-	// set the texture for the shader
-	SetShaderTexture("napkin_holder");
+	// the shadow casting lights share the atlas, so it is
+	// created before the lights are added
+	m_shadowManager->Initialize(SHADOW_ATLAS_SIZE);
+	m_shadowManager->SetPcfQuality(ShadowManager::PCF_QUALITY_MEDIUM);
 
-	//set the material for the shader
-	SetShaderMaterial("design");
+	// add and define the light sources for the scene
+	m_lightManager->Initialize();
+	SetupSceneLights();
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	// all of the basic shapes share one set of buffers and one
+	// VAO, so the draw calls only differ by their offsets
+	m_geometryPool->Create(16384, 65536);
+	CreateSceneMeshes();
 
-	//****************************************************************/
+	// the world matrices are composed in blocks of objects and
+	// written straight into the instance buffer
+	m_transformStore->Initialize();
+	LoadObjectTransforms();
+	ReserveFrameArena();
 
-	// set the position for the mesh
-	positionXYZ = glm::vec3(-1.0f, 3.4f, 0.0f);
+	// the visible objects are picked and drawn on the GPU when it
+	// can read their world matrices by the index of each object
+	m_bGpuCulling = (m_cullingManager->Initialize() == true) && (m_transformStore->HasInstanceBuffer() == true);
+	UploadObjectData();
+	CreateCullObjects();
 
-	//set the transformations into memory
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// edits of the scene file are applied while the scene is shown
+	WatchSceneFiles();
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	// the views share their draws when the vertex shader can pick
+	// the viewport of each instance
+	m_bViewportArray = (GLEW_ARB_shader_viewport_layer_array != 0);
 
-	//****************************************************************/
+}
 
-	// Set the scale for the mesh
-	scaleXYZ = glm::vec3(5.0f, 0.5f, 2.0f);
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	// compose the world matrices of the objects that moved
+	m_transformStore->ComposeTransforms(TRANSFORM_BINDING, NORMAL_MATRIX_BINDING, m_pJobSystem);
 
-	// set the position for the mesh
-	positionXYZ = glm::vec3(-1.3639702343, 1.15f, -1.0f);
+	// every basic shape is drawn out of the shared geometry pool,
+	// which only switches the VAO when the vertex format changes
+	m_geometryPool->Bind();
+	// the LOD selection remembers the level of each scene object
+	// by its index, so the objects can be selected in any order
+	m_lodSelector->BeginFrame();
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// the cached shadows are checked against the transforms of
+	// this frame, so they are rebuilt before they are used
+	UpdateStaticChecksum();
 
-	// reset the texture
-	SetShaderTexture("");
-	// set the color for the shader
-	SetShaderColor(0.596f, 0.708f, 0.780f, 1);
+	// refresh the shadows before the lights are used
+	RenderShadowMaps();
 
-	// Draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	// bin the lights into the clusters of the current view, their
+	// values are set when the queued draws are submitted
+	m_lightManager->CullLights();
 
-	/******************************************/
-	//**	Starting with napkins Segments	**//
-	/******************************************/
-	// Set the rotation on the X and Z axis
-	XrotationDegrees = 90;
-	YrotationDegrees = 0;
-	ZrotationDegrees = -20;
+	// the deferred path draws the scene into the G-buffer first
+	if (NULL != m_deferredRenderer)
+	{
+		m_deferredRenderer->BeginGeometryPass();
+	}
 
-	// set the scale for the mesh
-	scaleXYZ = glm::vec3(3.0f, 3.0f, 2.5f);
+	// the objects are culled and drawn on the GPU, or their draws
+	// are built on the workers and submitted from this thread
+	// sorted by program when there is no culling pass
+	if (m_bGpuCulling == true)
+	{
+		DrawCulledObjects();
+	}
+	else
+	{
+		BeginRenderQueue();
+		BuildDrawPackets();
+		FlushRenderQueue();
+	}
 
-	//set the color for the shader
-	SetShaderColor(0.85f, 0.85f, 0.85f, 1.0f);
+	// the occlusion test of the next frame reads this depth
+	if ((m_bGpuCulling == true) && (m_viewCount == 1))
+	{
+		m_cullingManager->UpdateDepthPyramid(m_targetWidth, m_targetHeight, m_projectionMatrix * m_viewMatrix);
+	}
 
-	//set the material for the shader
-	SetShaderMaterial("napkin");
+	// light the G-buffer into the window
+	if (NULL != m_deferredRenderer)
+	{
+		m_deferredRenderer->RenderLighting(m_lightManager, m_shadowManager, m_views, m_viewCount);
+	}
 
-	for (int i = 1; i <= 10; i++) {
+	// the region of the instance buffer read by this frame is
+	// not written again until the GPU is done with it
+	m_transformStore->EndFrame();
+}
 
-		// Calculate the X and Z positions
-		double Zpos = i / 6.0;
-		double Xpos = -1.0 + (tan(ZrotationDegrees * 3.14159 / 180) * Zpos);
+/***********************************************************
+ *  DrawSceneObjects()
+ *
+ *  This method is used for drawing the basic 3D shapes of
+ *  the scene into the shadow atlas.  It is called once per
+ *  light for each shadow pass, while the camera view is
+ *  drawn by the GPU culling pass or the render queue.
+ ***********************************************************/
+void SceneManager::DrawSceneObjects()
+{
+	const SceneFile::SCENE_OBJECT* pObjects = m_sceneFile->GetObjects();
 
-		// set the position for the mesh
-		positionXYZ = glm::vec3(Xpos, 4.0f, -Zpos);
+	for (int i = 0; i < m_sceneFile->GetObjectCount(); i++)
+	{
+		const SceneFile::SCENE_OBJECT& object = pObjects[i];
 
-		SetTransformations(
-			scaleXYZ,
-			XrotationDegrees,
-			YrotationDegrees,
-			ZrotationDegrees,
-			positionXYZ);
+		// the world matrices were composed at the start of the frame
+		m_modelMatrix = m_transformStore->GetWorldMatrix(i);
+		SetDynamicObject(object.bDynamic != 0);
 
-		// draw the mesh
-		m_basicMeshes->DrawPlaneMesh();
+		const SCENE_MESH_ID& sceneMesh = m_sceneMeshes[object.meshIndex];
+		if (sceneMesh.lodChainID >= 0)
+		{
+			DrawLodMesh(sceneMesh.lodChainID);
+		}
+		else
+		{
+			DrawSceneMesh(sceneMesh.meshID);
+		}
 	}
 
-	///****************************************************************/
+	SetDynamicObject(false);
 }
@@ -10,7 +10,21 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "GeometryPool.h"
+#include "CullingManager.h"
+#include "LodSelector.h"
+#include "LightManager.h"
+#include "DeferredRenderer.h"
+#include "ShadowManager.h"
+#include "ShaderCompiler.h"
+#include "ShaderPermutations.h"
+#include "SceneFile.h"
+#include "FileWatcher.h"
+#include "TransformStore.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "SceneView.h"
+#include "TextureUnits.h"
 
 #include <string>
 #include <vector>
@@ -34,6 +48,9 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// hash of the image file, so an unchanged image is not
+		// decoded again when the scene is reloaded
+		uint64_t contentHash;
 	};
 
 	struct OBJECT_MATERIAL
@@ -47,28 +64,167 @@ public:
 	};
 
 private:
+	// pass the scene objects are currently drawn for
+	enum RENDER_PASS
+	{
+		// no shadow pass, the camera view is drawn by the culling
+		// pass or the render queue
+		RENDER_PASS_SCENE = 0,
+		// only the static objects into the cached shadow atlas
+		RENDER_PASS_STATIC_SHADOW,
+		// only the dynamic objects on top of the cached shadows
+		RENDER_PASS_DYNAMIC_SHADOW
+	};
+
+	// one draw of the scene pass, queued so the draws can be
+	// sorted by the program they need
+	struct DRAW_ITEM
+	{
+		GLuint programID;
+		int meshID;
+		glm::mat4 modelMatrix;
+		bool bUseTexture;
+		int textureSlot;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		int materialID;
+		// index of the world matrix in the instance buffer, -1
+		// when the model matrix is set as a uniform
+		int objectIndex;
+	};
+
+	// values of a scene object read by the shaders when it is drawn
+	// by the GPU culling pass - this must match the std430 layout
+	// of ObjectData in the scene fragment shaders
+	struct OBJECT_DATA
+	{
+		glm::vec4 color;
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float shininess;
+		glm::vec3 specularColor;
+		int materialID;
+		glm::vec2 UVscale;
+		glm::vec2 padding;
+	};
+
+	// objects drawn by one indirect call of the GPU culling pass,
+	// which share their vertex array and their texture, so also
+	// their program, the index of each matches its draw group
+	struct CULL_GROUP
+	{
+		GeometryPool::VERTEX_FORMAT vertexFormat;
+		GLenum indexType;
+		// texture slot of the objects, -1 when they are not textured
+		int textureSlot;
+	};
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
+	// pointer to the background shader compiler, owned by the caller
+	ShaderCompiler* m_pShaderCompiler;
+	// pointer to the variants of the scene program
+	ShaderPermutations* m_shaderPermutations;
+	// draws of the scene pass waiting to be sorted and submitted,
+	// allocated from the frame arena each frame
+	DRAW_ITEM* m_renderQueue;
+	int m_renderQueueCount;
+	int m_renderQueueCapacity;
+	// pointer to the transient memory of each frame
+	FrameArena* m_frameArena;
+	// pointer to the worker threads, owned by the caller
+	JobSystem* m_pJobSystem;
+	// shader values set for the next queued draw
+	DRAW_ITEM m_drawState;
+	// true when the scene objects are lit
+	bool m_bUseLighting;
+	// pointer to the shared buffers holding the basic shapes
+	GeometryPool* m_geometryPool;
+	// pointer to the level of detail selection for the shapes
+	LodSelector* m_lodSelector;
+	// pointer to the GPU culling pass that decides which objects
+	// of the scene pass are drawn
+	CullingManager* m_cullingManager;
+	// draw groups of the culling pass, and whether the scene pass
+	// is drawn through it or, when the context cannot run it,
+	// with one draw call per object
+	std::vector<CULL_GROUP> m_cullGroups;
+	bool m_bGpuCulling;
+	// buffer holding the OBJECT_DATA of every scene object
+	GLuint m_objectDataBuffer;
+	// pointer to the light sources and their cluster lists
+	LightManager* m_lightManager;
+	// pointer to the deferred render path, NULL when rendering forward
+	DeferredRenderer* m_deferredRenderer;
+	// pointer to the shadow maps of the shadow casting lights
+	ShadowManager* m_shadowManager;
+	RENDER_PASS m_renderPass;
+	// true while drawing objects that move between frames
+	bool m_bDynamicObject;
+	// checksum of the static transforms of this frame and of
+	// the ones the cached shadows were rendered with
+	uint32_t m_staticChecksum;
+	uint32_t m_shadowChecksum;
+	// number of dynamic objects in this frame
+	int m_dynamicDrawCount;
+	// camera view of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// every view of the current frame, the camera view first,
+	// and the size of the target they are drawn into
+	SCENE_VIEW m_views[MAX_SCENE_VIEWS];
+	int m_viewCount;
+	int m_targetWidth;
+	int m_targetHeight;
+	// true when one instanced draw can fill every viewport
+	bool m_bViewportArray;
+	// IDs of a mesh of the scene file, the tessellated shapes
+	// are drawn through a LOD chain and the flat shapes are not
+	struct SCENE_MESH_ID
+	{
+		int meshID;
+		int lodChainID;
+	};
+
+	// path of the scene description
+	std::string m_sceneFilename;
+	// pointer to the loaded scene description
+	SceneFile* m_sceneFile;
+	// IDs of the meshes, in the order of the scene file
+	std::vector<SCENE_MESH_ID> m_sceneMeshes;
+	// texture slots, in the order of the scene file
+	std::vector<int> m_textureSlots;
+	// pointer to the watcher of the scene file and its images
+	FileWatcher* m_sceneWatcher;
+	// pointer to the transforms of the scene objects
+	TransformStore* m_transformStore;
+	// model matrix of the current draw
+	glm::mat4 m_modelMatrix;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	TEXTURE_INFO m_textureIDs[MAX_SCENE_TEXTURES];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// decode an image file into an existing OpenGL texture
+	bool LoadGLTextureImage(GLuint textureID, const char* filename);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const char* tag);
+	int FindTextureSlot(const char* tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const char* tag, OBJECT_MATERIAL& material);
+	// find the index of a defined material by tag
+	int FindMaterialID(const char* tag);
+	// upload the defined materials into the deferred material table
+	void UploadMaterialTable();
 
 	// set the transformation values 
 	// into the transform buffer
@@ -88,7 +244,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -96,15 +252,121 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+
+	// draw the shadow level of a LOD chain into the shadow atlas
+	void DrawLodMesh(int lodChainID);
+	// draw a mesh into the shadow atlas of the current pass
+	void DrawSceneMesh(int meshID);
+	// mark the following objects as moving between frames
+	void SetDynamicObject(bool bDynamic);
+	// draw the shadow casters into the shadow atlas
+	void RenderShadowMaps();
+	// set the values shared by every draw into the current program
+	void SetFrameShaderValues();
+	// allocate the queue of this frame's draws from the arena
+	void BeginRenderQueue();
+	// fill the queue with the draws of the scene objects when there
+	// is no culling pass, split over the worker threads
+	void BuildDrawPackets();
+	// sort the queued draws by program and submit them
+	void FlushRenderQueue();
+	// grow the frame arena for the objects of the loaded scene
+	void ReserveFrameArena();
+	// fold the static transforms into the checksum of the frame
+	void UpdateStaticChecksum();
+	// get the program features shared by every draw of the frame
+	int GetSharedFeatures() const;
+	// find or add the culling draw group of a mesh and a texture slot
+	int FindCullGroup(const GeometryPool::MESH_RANGE* pMesh, int textureSlot);
+	// hand the levels and the bounds of every object to the culling pass
+	void CreateCullObjects();
+	// cull the objects on the GPU and draw the visible ones
+	void DrawCulledObjects();
+	// copy the values of the scene objects into the object buffer
+	void UploadObjectData();
+	// submit the sorted draws for a range of the views
+	void SubmitRenderQueue(const uint64_t* pSortKeys, int firstView, int instanceCount);
+	// build the meshes listed in the scene file
+	void CreateSceneMeshes();
+	SCENE_MESH_ID CreateSceneMesh(const SceneFile::SCENE_MESH& mesh);
+	// copy the object transforms of the scene file into the store
+	void LoadObjectTransforms();
+	// watch the scene file and the images it uses
+	void WatchSceneFiles();
+	// load the edited scene file and apply what changed
+	bool ReloadScene();
+	// free the meshes and LOD chains that the scene no longer uses
+	void ReleaseSceneMeshes(const std::vector<SCENE_MESH_ID>& oldMeshes);
+	// free the textures whose tags the scene file no longer lists
+	void ReleaseSceneTextures();
+	// draw every object of the scene into the shadow atlas
+	void DrawSceneObjects();
 
 public:
 
+	// get the arena of per-frame data, reset by the main loop
+	FrameArena* GetFrameArena();
+
+	// set the compiler used for building programs in the background
+	void SetShaderCompiler(ShaderCompiler* pShaderCompiler);
+	// set the worker threads that the per-frame work is split over
+	void SetJobSystem(JobSystem* pJobSystem);
+	// build variants of the loaded scene program for each draw
+	void EnableShaderPermutations(
+		const char* vertexShaderFile,
+		const char* fragmentShaderFile);
+	// build the variants again after the scene program was reloaded
+	void ResetShaderPermutations();
+	// rebuild the programs of the render passes when edited
+	void WatchShaders(ShaderHotReload* pHotReload);
+	// set the values of the frame into a rebuilt scene program
+	void ApplyProgramValues(GLuint programID);
+
+	// set the scene description loaded by PrepareScene(), either
+	// the JSON text form or the binary form
+	void SetSceneFilename(const char* filename);
+	// switch the prepared scene to another scene file, reusing
+	// the loaded meshes and textures it shares
+	bool LoadScene(const char* filename);
+
+	// apply the edits of the scene file made since the last
+	// call, true when the scene was reloaded
+	bool UpdateScene();
+	// move an object of the scene file, used for animation
+	void SetObjectTransform(
+		int objectIndex,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// switch to the deferred render path, before PrepareScene()
+	bool EnableDeferredShading(int width, int height);
+	// also skip the objects hidden behind the depth of the last frame
+	void SetOcclusionCulling(bool bEnable);
+	// allocate the render targets again for a new framebuffer size
+	void ResizeRenderTargets(int width, int height);
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
 	void RenderScene();
 
+	// set the view used for choosing the levels of detail
+	// and for binning the lights into clusters
+	void SetViewParameters(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int viewportWidth,
+		int viewportHeight);
+	// set several views drawn into parts of the target from the
+	// same culled draws, the first one being the camera view
+	void SetViewParameters(
+		const SCENE_VIEW* pViews,
+		int viewCount,
+		int targetWidth,
+		int targetHeight);
+
 	//Loads textures from image files
 	void LoadSceneTextures();
 
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneview.h
+// ============
+// describe a view of the scene and the part of the render target it is
+// drawn into, shared by the view, scene and deferred managers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+// most views drawn from one traversal of the scene, this must
+// match the size of the view arrays in the scene shaders
+const int MAX_SCENE_VIEWS = 4;
+
+/***********************************************************
+ *  SCENE_VIEW
+ *
+ *  A camera and the rectangle of the render target it is
+ *  drawn into.  The rectangle is kept as fractions of the
+ *  target size, so it stays valid when the target is drawn
+ *  at a scaled resolution.  The first view of a frame is
+ *  the camera view, and it is always placed in the lower
+ *  left corner, since the light clusters are laid out from
+ *  that corner.
+ ***********************************************************/
+struct SCENE_VIEW
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	// lower left corner and size, as fractions of the target
+	glm::vec4 viewport;
+};
+
+// get the rectangle of a view in pixels of a target with the
+// passed in size, rounded the same way wherever it is used
+inline glm::ivec4 GetViewportPixels(const SCENE_VIEW& view, int width, int height)
+{
+	int left = (int)(view.viewport.x * width + 0.5f);
+	int bottom = (int)(view.viewport.y * height + 0.5f);
+	int right = (int)((view.viewport.x + view.viewport.z) * width + 0.5f);
+	int top = (int)((view.viewport.y + view.viewport.w) * height + 0.5f);
+
+	return(glm::ivec4(left, bottom, std::max(right - left, 1), std::max(top - bottom, 1)));
+}
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercompiler.cpp
+// ============
+// compile shader programs on a worker thread with its own OpenGL context,
+// shared with the main window, so new programs do not stall the frames
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderCompiler.h"
+#include "ShaderLoader.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  ShaderCompiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderCompiler::ShaderCompiler()
+{
+	m_workerWindow = NULL;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  ~ShaderCompiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderCompiler::~ShaderCompiler()
+{
+	if (m_workerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStopping = true;
+		}
+		m_condition.notify_all();
+		m_workerThread.join();
+	}
+
+	if (NULL != m_workerWindow)
+	{
+		glfwDestroyWindow(m_workerWindow);
+		m_workerWindow = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating a hidden window whose
+ *  context shares its objects with the main window, and
+ *  starting the worker thread on it.  It must be called on
+ *  the main thread, since GLFW only creates windows there.
+ ***********************************************************/
+bool ShaderCompiler::Initialize(GLFWwindow* sharedWindow)
+{
+	if (NULL == sharedWindow)
+	{
+		return(false);
+	}
+
+	// the context version hints set for the main window still apply
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_workerWindow = glfwCreateWindow(1, 1, "", NULL, sharedWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (NULL == m_workerWindow)
+	{
+		std::cout << "INFO: shared context unavailable, shaders are compiled on the main thread" << std::endl;
+		return(false);
+	}
+
+	m_workerThread = std::thread(&ShaderCompiler::WorkerLoop, this);
+
+	return(true);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for building the queued programs on
+ *  the worker context.  Each program is finished before it
+ *  is reported, so the main context never uses a program
+ *  that the driver is still linking.
+ ***********************************************************/
+void ShaderCompiler::WorkerLoop()
+{
+	glfwMakeContextCurrent(m_workerWindow);
+
+	while (true)
+	{
+		COMPILE_REQUEST request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return((m_bStopping == true) || (m_requests.size() > 0)); });
+			if (m_bStopping == true)
+			{
+				break;
+			}
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		GLuint programID = ShaderLoader::LoadProgram(
+			request.vertexShaderFile.c_str(),
+			request.fragmentShaderFile.c_str(),
+			request.defines);
+		glFinish();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_results[request.requestID].bFinished = true;
+		m_results[request.requestID].programID = programID;
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *  RequestProgram()
+ *
+ *  This method is used for queueing a program built from
+ *  the passed in files and defines.  The returned ID is
+ *  polled until the program is ready.
+ ***********************************************************/
+int ShaderCompiler::RequestProgram(
+	const char* vertexShaderFile,
+	const char* fragmentShaderFile,
+	const std::string& defines)
+{
+	COMPILE_REQUEST request;
+	request.vertexShaderFile = vertexShaderFile;
+	request.fragmentShaderFile = fragmentShaderFile;
+	request.defines = defines;
+
+	COMPILE_RESULT result;
+	result.bFinished = false;
+	result.programID = 0;
+
+	// without a worker the program is built right away
+	if (NULL == m_workerWindow)
+	{
+		result.bFinished = true;
+		result.programID = ShaderLoader::LoadProgram(vertexShaderFile, fragmentShaderFile, defines);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		request.requestID = (int)m_results.size();
+		m_results.push_back(result);
+		if (NULL != m_workerWindow)
+		{
+			m_requests.push_back(request);
+		}
+	}
+	m_condition.notify_one();
+
+	return(request.requestID);
+}
+
+/***********************************************************
+ *  PollProgram()
+ *
+ *  This method is used for checking whether a requested
+ *  program has been built.  The program ID is zero when
+ *  the build failed.
+ ***********************************************************/
+bool ShaderCompiler::PollProgram(int requestID, GLuint& programID)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if ((requestID < 0) || (requestID >= (int)m_results.size()) ||
+		(m_results[requestID].bFinished == false))
+	{
+		return(false);
+	}
+
+	programID = m_results[requestID].programID;
+	return(true);
+}
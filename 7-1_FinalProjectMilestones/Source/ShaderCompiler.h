@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercompiler.h
+// ============
+// compile shader programs on a worker thread with its own OpenGL context,
+// shared with the main window, so new programs do not stall the frames
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include "GLFW/glfw3.h"     // GLFW library
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/***********************************************************
+ *  ShaderCompiler
+ *
+ *  This class contains the code for building programs in
+ *  the background.  A request is queued on the main thread
+ *  and polled every frame until the worker has linked it.
+ *  When the shared context cannot be created, the programs
+ *  are built right away on the calling thread instead.
+ ***********************************************************/
+class ShaderCompiler
+{
+public:
+	// constructor
+	ShaderCompiler();
+	// destructor
+	~ShaderCompiler();
+
+private:
+	// one program waiting to be built
+	struct COMPILE_REQUEST
+	{
+		int requestID;
+		std::string vertexShaderFile;
+		std::string fragmentShaderFile;
+		std::string defines;
+	};
+
+	// state of every request, indexed by its ID
+	struct COMPILE_RESULT
+	{
+		bool bFinished;
+		GLuint programID;
+	};
+
+	// hidden window owning the context of the worker
+	GLFWwindow* m_workerWindow;
+	std::thread m_workerThread;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<COMPILE_REQUEST> m_requests;
+	std::vector<COMPILE_RESULT> m_results;
+	bool m_bStopping;
+
+	// build the queued programs until the compiler is destroyed
+	void WorkerLoop();
+
+public:
+	// create the shared context and start the worker
+	bool Initialize(GLFWwindow* sharedWindow);
+
+	// queue a program built from GLSL files and defines
+	int RequestProgram(
+		const char* vertexShaderFile,
+		const char* fragmentShaderFile,
+		const std::string& defines);
+
+	// true once the request is built, zero if it failed
+	bool PollProgram(int requestID, GLuint& programID);
+};
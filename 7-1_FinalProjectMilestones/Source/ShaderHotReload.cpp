@@ -0,0 +1,188 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderhotreload.cpp
+// ============
+// rebuild the shader programs whose GLSL files were edited while the
+// application is running
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderHotReload.h"
+#include "ShaderLoader.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  ShaderHotReload()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderHotReload::ShaderHotReload()
+{
+}
+
+/***********************************************************
+ *  ~ShaderHotReload()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderHotReload::~ShaderHotReload()
+{
+	m_programs.clear();
+}
+
+/***********************************************************
+ *  WatchProgram()
+ *
+ *  This method is used for watching the files of a vertex
+ *  and fragment program.  The passed in member must stay
+ *  valid for as long as Update() is called.  The apply
+ *  function, when there is one, is called after each
+ *  swap with the context passed in here.
+ ***********************************************************/
+void ShaderHotReload::WatchProgram(
+	GLuint* pProgramID,
+	const char* vertexShaderFile,
+	const char* fragmentShaderFile,
+	APPLY_FUNCTION applyFunction,
+	void* pContext)
+{
+	if ((NULL == pProgramID) || (NULL == vertexShaderFile) || (NULL == fragmentShaderFile))
+	{
+		return;
+	}
+
+	WATCHED_PROGRAM program;
+	program.pProgramID = pProgramID;
+	program.vertexShaderFile = vertexShaderFile;
+	program.fragmentShaderFile = fragmentShaderFile;
+	program.applyFunction = applyFunction;
+	program.pContext = pContext;
+	m_programs.push_back(program);
+
+	m_fileWatcher.AddFile(vertexShaderFile);
+	m_fileWatcher.AddFile(fragmentShaderFile);
+}
+
+/***********************************************************
+ *  WatchComputeProgram()
+ *
+ *  This method is used for watching the file of a compute
+ *  program.
+ ***********************************************************/
+void ShaderHotReload::WatchComputeProgram(
+	GLuint* pProgramID,
+	const char* computeShaderFile)
+{
+	if ((NULL == pProgramID) || (NULL == computeShaderFile))
+	{
+		return;
+	}
+
+	WATCHED_PROGRAM program;
+	program.pProgramID = pProgramID;
+	program.computeShaderFile = computeShaderFile;
+	program.applyFunction = NULL;
+	program.pContext = NULL;
+	m_programs.push_back(program);
+
+	m_fileWatcher.AddFile(computeShaderFile);
+}
+
+/***********************************************************
+ *  ReloadProgram()
+ *
+ *  This method is used for building a program again from
+ *  its files.  The owner's member only changes when the
+ *  new program links, so a broken edit keeps rendering
+ *  with the old program.  The new program starts with its
+ *  uniforms at their defaults, so the owner's apply
+ *  function sets them again before the next draw.
+ ***********************************************************/
+bool ShaderHotReload::ReloadProgram(const WATCHED_PROGRAM& program)
+{
+	GLuint programID = 0;
+	if (program.computeShaderFile.empty() == false)
+	{
+		programID = ShaderLoader::LoadComputeProgram(program.computeShaderFile.c_str());
+	}
+	else
+	{
+		programID = ShaderLoader::LoadProgram(
+			program.vertexShaderFile.c_str(),
+			program.fragmentShaderFile.c_str());
+	}
+
+	if (programID == 0)
+	{
+		std::cout << "INFO: keeping the previous program after the failed reload" << std::endl;
+		return(false);
+	}
+
+	// the program in use must not be deleted from under the pipeline
+	GLint currentProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+	if ((GLuint)currentProgram == *program.pProgramID)
+	{
+		glUseProgram(programID);
+	}
+
+	if (*program.pProgramID != 0)
+	{
+		glDeleteProgram(*program.pProgramID);
+	}
+	*program.pProgramID = programID;
+
+	if (NULL != program.applyFunction)
+	{
+		glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+		glUseProgram(programID);
+		program.applyFunction(program.pContext, programID);
+		glUseProgram((GLuint)currentProgram);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for rebuilding every program that
+ *  uses an edited file.  It is called between frames on
+ *  the main thread.
+ ***********************************************************/
+int ShaderHotReload::Update()
+{
+	if (m_fileWatcher.Poll(m_changedFiles) == false)
+	{
+		return(0);
+	}
+
+	int reloadCount = 0;
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		const WATCHED_PROGRAM& program = m_programs[i];
+		bool bChanged = false;
+
+		for (size_t j = 0; j < m_changedFiles.size(); j++)
+		{
+			const std::string& file = m_changedFiles[j];
+			if ((file == program.vertexShaderFile) ||
+				(file == program.fragmentShaderFile) ||
+				(file == program.computeShaderFile))
+			{
+				bChanged = true;
+			}
+		}
+
+		if (bChanged == true)
+		{
+			std::cout << "INFO: reloading shader program:" << (program.computeShaderFile.empty() ?
+				program.fragmentShaderFile : program.computeShaderFile) << std::endl;
+			if (ReloadProgram(program) == true)
+			{
+				reloadCount++;
+			}
+		}
+	}
+
+	return(reloadCount);
+}
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderhotreload.h
+// ============
+// rebuild the shader programs whose GLSL files were edited while the
+// application is running
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FileWatcher.h"
+
+#include <GL/glew.h>        // GLEW library
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderHotReload
+ *
+ *  This class contains the code for swapping in programs
+ *  built from edited shader files.  The owners register
+ *  the member holding each program ID, which is replaced
+ *  between frames once the new program has linked.  When
+ *  the edit does not compile, the old program is kept.  An
+ *  owner that only sets some uniforms once registers a
+ *  function that sets them again into the new program.
+ ***********************************************************/
+class ShaderHotReload
+{
+public:
+	// constructor
+	ShaderHotReload();
+	// destructor
+	~ShaderHotReload();
+
+	// function setting the uniforms of an owner into a rebuilt
+	// program, which is in use while it is called
+	typedef void (*APPLY_FUNCTION)(void* pContext, GLuint programID);
+
+private:
+	// one program built from watched files
+	struct WATCHED_PROGRAM
+	{
+		// member of the owner holding the program ID
+		GLuint* pProgramID;
+		std::string vertexShaderFile;
+		std::string fragmentShaderFile;
+		// set instead of the two files above for compute programs
+		std::string computeShaderFile;
+		// called with the new program once it is swapped in
+		APPLY_FUNCTION applyFunction;
+		void* pContext;
+	};
+
+	FileWatcher m_fileWatcher;
+	std::vector<WATCHED_PROGRAM> m_programs;
+	std::vector<std::string> m_changedFiles;
+
+	// rebuild one program, keeping the old one on failure
+	bool ReloadProgram(const WATCHED_PROGRAM& program);
+
+public:
+	// watch the files of a vertex and fragment program, whose
+	// uniforms are set again by the passed in function
+	void WatchProgram(
+		GLuint* pProgramID,
+		const char* vertexShaderFile,
+		const char* fragmentShaderFile,
+		APPLY_FUNCTION applyFunction = NULL,
+		void* pContext = NULL);
+	// watch the file of a compute program
+	void WatchComputeProgram(
+		GLuint* pProgramID,
+		const char* computeShaderFile);
+	// rebuild the programs of the edited files, returning the
+	// number of programs that were replaced
+	int Update();
+};
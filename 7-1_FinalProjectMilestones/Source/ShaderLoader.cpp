@@ -0,0 +1,460 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderloader.cpp
+// ============
+// load, compile and link the GLSL programs of the rendering passes,
+// reusing the linked program binaries of earlier runs when possible
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderLoader.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// folder of the cached program binaries, empty when disabled
+	std::string g_CacheDirectory;
+	// hash of the vendor, renderer and version strings, since a
+	// binary is only valid for the driver that produced it
+	uint64_t g_DriverHash = 0;
+
+	// first bytes of every cached program binary
+	const uint32_t PROGRAM_BINARY_MAGIC = 0x42505347;
+	const uint64_t HASH_OFFSET_BASIS = 14695981039346656037ull;
+	const uint64_t HASH_PRIME = 1099511628211ull;
+
+	// header written in front of the binary of a cached program
+	struct PROGRAM_BINARY_HEADER
+	{
+		uint32_t magic;
+		uint32_t binaryFormat;
+		uint64_t sourceHash;
+		uint64_t driverHash;
+		uint32_t binaryLength;
+		uint32_t padding;
+	};
+
+	// the cache file of a program is named after its source hash
+	std::string GetCacheFileName(uint64_t sourceHash)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)sourceHash);
+		return(g_CacheDirectory + "/" + name);
+	}
+}
+
+/***********************************************************
+ *  EnableBinaryCache()
+ *
+ *  This method is used for saving the linked programs into
+ *  the passed in folder and reusing them on later runs.  It
+ *  must be called on the main thread once the OpenGL
+ *  context is created, before any program is loaded.
+ ***********************************************************/
+bool ShaderLoader::EnableBinaryCache(const char* directory)
+{
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	// some drivers do not support retrieving program binaries
+	if (formatCount <= 0)
+	{
+		std::cout << "INFO: program binary cache disabled, no binary formats are supported" << std::endl;
+		return(false);
+	}
+
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+
+	std::string driver;
+	driver += (const char*)glGetString(GL_VENDOR);
+	driver += (const char*)glGetString(GL_RENDERER);
+	driver += (const char*)glGetString(GL_VERSION);
+
+	g_DriverHash = HashString(driver, HASH_OFFSET_BASIS);
+	g_CacheDirectory = directory;
+
+	return(true);
+}
+
+/***********************************************************
+ *  HashString()
+ *
+ *  This method is used for hashing the passed in text with
+ *  the 64-bit FNV-1a hash, continuing from an earlier hash
+ *  so several strings can be combined.
+ ***********************************************************/
+uint64_t ShaderLoader::HashString(const std::string& text, uint64_t hash)
+{
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		hash = (hash ^ (unsigned char)text[i]) * HASH_PRIME;
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  ReadShaderFile()
+ *
+ *  This method is used for reading the GLSL source code
+ *  from the passed in file into the source string.
+ ***********************************************************/
+bool ShaderLoader::ReadShaderFile(const char* filename, std::string& source)
+{
+	std::ifstream shaderFile(filename, std::ios::in | std::ios::binary);
+
+	// if the shader file could not be opened
+	if (!shaderFile.is_open())
+	{
+		std::cout << "Could not open shader file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream shaderStream;
+	shaderStream << shaderFile.rdbuf();
+	source = shaderStream.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for compiling a single shader stage
+ *  and reporting any compile errors to the console.  Zero
+ *  is returned if the compile failed.
+ ***********************************************************/
+GLuint ShaderLoader::CompileShader(
+	GLenum shaderType,
+	const std::string& source,
+	const char* sourceName)
+{
+	GLuint shaderID = glCreateShader(shaderType);
+	const char* sourceText = source.c_str();
+	GLint success = GL_FALSE;
+
+	glShaderSource(shaderID, 1, &sourceText, NULL);
+	glCompileShader(shaderID);
+
+	// check the compile status and print the log on failure
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		GLchar infoLog[1024];
+		glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Failed to compile shader:" << sourceName << std::endl << infoLog << std::endl;
+		glDeleteShader(shaderID);
+		return(0);
+	}
+
+	return(shaderID);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method is used for linking the passed in shader
+ *  stages into a program.  The stages are always released
+ *  and zero is returned if the link failed.
+ ***********************************************************/
+GLuint ShaderLoader::LinkProgram(const std::vector<GLuint>& shaders)
+{
+	GLuint programID = 0;
+	GLint success = GL_FALSE;
+	bool bValid = (shaders.size() > 0);
+
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		if (shaders[i] == 0)
+		{
+			bValid = false;
+		}
+	}
+
+	if (bValid == true)
+	{
+		programID = glCreateProgram();
+		for (size_t i = 0; i < shaders.size(); i++)
+		{
+			glAttachShader(programID, shaders[i]);
+		}
+		// the binary can only be read back when asked for before linking
+		if (g_CacheDirectory.empty() == false)
+		{
+			glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glLinkProgram(programID);
+
+		// check the link status and print the log on failure
+		glGetProgramiv(programID, GL_LINK_STATUS, &success);
+		if (success == GL_FALSE)
+		{
+			GLchar infoLog[1024];
+			glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "Failed to link shader program" << std::endl << infoLog << std::endl;
+			glDeleteProgram(programID);
+			programID = 0;
+		}
+	}
+
+	// the stages are no longer needed once the program is linked
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		if (shaders[i] != 0)
+		{
+			glDeleteShader(shaders[i]);
+		}
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  InsertDefines()
+ *
+ *  This method is used for adding the passed in #define
+ *  lines to the source.  They must follow the #version
+ *  line, and a #line directive keeps the line numbers of
+ *  the compile errors matching the file.
+ ***********************************************************/
+std::string ShaderLoader::InsertDefines(
+	const std::string& source,
+	const std::string& defines)
+{
+	if (defines.empty() == true)
+	{
+		return(source);
+	}
+
+	size_t versionStart = source.find("#version");
+	size_t insertPosition = 0;
+	if (versionStart != std::string::npos)
+	{
+		size_t versionEnd = source.find('\n', versionStart);
+		insertPosition = (versionEnd == std::string::npos) ? source.size() : versionEnd + 1;
+	}
+
+	int nextLine = 1;
+	for (size_t i = 0; i < insertPosition; i++)
+	{
+		if (source[i] == '\n')
+		{
+			nextLine++;
+		}
+	}
+
+	std::string result = source.substr(0, insertPosition);
+	if ((insertPosition > 0) && (source[insertPosition - 1] != '\n'))
+	{
+		result += "\n";
+	}
+	result += defines;
+	result += "#line " + std::to_string(nextLine) + "\n";
+	result += source.substr(insertPosition);
+
+	return(result);
+}
+
+/***********************************************************
+ *  LoadProgramBinary()
+ *
+ *  This method is used for loading a program from the
+ *  binary cache.  Zero is returned when there is no cached
+ *  binary, when it was saved by another driver, when its
+ *  length is empty or longer than the file, or when the
+ *  driver rejects it, so the program is compiled instead.
+ ***********************************************************/
+GLuint ShaderLoader::LoadProgramBinary(uint64_t sourceHash)
+{
+	std::ifstream binaryFile(GetCacheFileName(sourceHash).c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!binaryFile.is_open())
+	{
+		return(0);
+	}
+	uint64_t fileLength = (uint64_t)binaryFile.tellg();
+	binaryFile.seekg(0, std::ios::beg);
+
+	PROGRAM_BINARY_HEADER header;
+	binaryFile.read((char*)&header, sizeof(header));
+	if ((!binaryFile) ||
+		(header.magic != PROGRAM_BINARY_MAGIC) ||
+		(header.sourceHash != sourceHash) ||
+		(header.driverHash != g_DriverHash))
+	{
+		return(0);
+	}
+
+	// an empty or cut off binary is a miss, so the program is
+	// compiled again and the cache entry is replaced
+	if ((header.binaryLength == 0) ||
+		((uint64_t)header.binaryLength > fileLength - sizeof(header)))
+	{
+		return(0);
+	}
+
+	std::vector<char> binary(header.binaryLength);
+	binaryFile.read(&binary[0], header.binaryLength);
+	if (!binaryFile)
+	{
+		return(0);
+	}
+
+	GLuint programID = glCreateProgram();
+	GLint success = GL_FALSE;
+	glProgramBinary(programID, header.binaryFormat, &binary[0], (GLsizei)header.binaryLength);
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  SaveProgramBinary()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program into the cache, replacing a stale one.
+ ***********************************************************/
+void ShaderLoader::SaveProgramBinary(GLuint programID, uint64_t sourceHash)
+{
+	GLint binaryLength = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(binaryLength);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(programID, binaryLength, NULL, &binaryFormat, &binary[0]);
+
+	PROGRAM_BINARY_HEADER header;
+	header.magic = PROGRAM_BINARY_MAGIC;
+	header.binaryFormat = binaryFormat;
+	header.sourceHash = sourceHash;
+	header.driverHash = g_DriverHash;
+	header.binaryLength = (uint32_t)binaryLength;
+	header.padding = 0;
+
+	std::ofstream binaryFile(GetCacheFileName(sourceHash).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!binaryFile.is_open())
+	{
+		std::cout << "Could not write program binary:" << GetCacheFileName(sourceHash) << std::endl;
+		return;
+	}
+
+	binaryFile.write((const char*)&header, sizeof(header));
+	binaryFile.write(&binary[0], binaryLength);
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for building a program from the
+ *  passed in stages.  The cache is tried first, and the
+ *  stages are only compiled when it has no valid binary.
+ ***********************************************************/
+GLuint ShaderLoader::BuildProgram(const std::vector<SHADER_STAGE>& stages)
+{
+	uint64_t sourceHash = HASH_OFFSET_BASIS;
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		sourceHash = HashString(std::to_string(stages[i].type), sourceHash);
+		sourceHash = HashString(stages[i].source, sourceHash);
+	}
+
+	if (g_CacheDirectory.empty() == false)
+	{
+		GLuint programID = LoadProgramBinary(sourceHash);
+		if (programID != 0)
+		{
+			return(programID);
+		}
+	}
+
+	std::vector<GLuint> shaders;
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		shaders.push_back(CompileShader(stages[i].type, stages[i].source, stages[i].sourceName.c_str()));
+	}
+
+	GLuint programID = LinkProgram(shaders);
+	if ((programID != 0) && (g_CacheDirectory.empty() == false))
+	{
+		SaveProgramBinary(programID, sourceHash);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  LoadComputeProgram()
+ *
+ *  This method is used for loading, compiling and linking
+ *  a compute shader program from the passed in file.
+ ***********************************************************/
+GLuint ShaderLoader::LoadComputeProgram(const char* computeShaderFile)
+{
+	std::string computeSource;
+
+	if (ReadShaderFile(computeShaderFile, computeSource) == false)
+	{
+		return(0);
+	}
+
+	std::vector<SHADER_STAGE> stages(1);
+	stages[0].type = GL_COMPUTE_SHADER;
+	stages[0].source = computeSource;
+	stages[0].sourceName = computeShaderFile;
+
+	return(BuildProgram(stages));
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for loading, compiling and linking
+ *  a vertex and fragment shader program from the passed in
+ *  files.  The defines are added to both stages, so one
+ *  file can be built into several permutations.
+ ***********************************************************/
+GLuint ShaderLoader::LoadProgram(
+	const char* vertexShaderFile,
+	const char* fragmentShaderFile,
+	const std::string& defines)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+
+	if ((ReadShaderFile(vertexShaderFile, vertexSource) == false) ||
+		(ReadShaderFile(fragmentShaderFile, fragmentSource) == false))
+	{
+		return(0);
+	}
+
+	std::vector<SHADER_STAGE> stages(2);
+	stages[0].type = GL_VERTEX_SHADER;
+	stages[0].source = InsertDefines(vertexSource, defines);
+	stages[0].sourceName = vertexShaderFile;
+	stages[1].type = GL_FRAGMENT_SHADER;
+	stages[1].source = InsertDefines(fragmentSource, defines);
+	stages[1].sourceName = fragmentShaderFile;
+
+	return(BuildProgram(stages));
+}
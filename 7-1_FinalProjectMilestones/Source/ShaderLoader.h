@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderloader.h
+// ============
+// load, compile and link the GLSL programs of the rendering passes,
+// reusing the linked program binaries of earlier runs when possible
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/***********************************************************
+ *  ShaderLoader
+ *
+ *  This class contains the helper methods for building the
+ *  shader programs.  When the binary cache is enabled, the
+ *  linked programs are saved to disk, keyed by a hash of
+ *  their source and of the driver, and loaded back on the
+ *  next run instead of being compiled again.
+ ***********************************************************/
+class ShaderLoader
+{
+public:
+	// one stage of a program and the name used in its errors
+	struct SHADER_STAGE
+	{
+		GLenum type;
+		std::string source;
+		std::string sourceName;
+	};
+
+	// save and reuse the linked programs in the passed in folder
+	static bool EnableBinaryCache(const char* directory);
+
+	// read the contents of a GLSL source file into a string
+	static bool ReadShaderFile(const char* filename, std::string& source);
+
+	// compile a single shader stage from source code
+	static GLuint CompileShader(
+		GLenum shaderType,
+		const std::string& source,
+		const char* sourceName);
+
+	// link the compiled shader stages into a program
+	static GLuint LinkProgram(const std::vector<GLuint>& shaders);
+
+	// add #define lines to the source, right after its #version line
+	static std::string InsertDefines(
+		const std::string& source,
+		const std::string& defines);
+
+	// build a program from its stages, through the binary cache
+	static GLuint BuildProgram(const std::vector<SHADER_STAGE>& stages);
+
+	// load a compute program from a GLSL file
+	static GLuint LoadComputeProgram(const char* computeShaderFile);
+
+	// load a vertex and fragment program from GLSL files
+	static GLuint LoadProgram(
+		const char* vertexShaderFile,
+		const char* fragmentShaderFile,
+		const std::string& defines = std::string());
+
+private:
+	// hash the passed in text, continuing from an earlier hash
+	static uint64_t HashString(const std::string& text, uint64_t hash);
+	// load a cached program binary, zero when it is missing or stale
+	static GLuint LoadProgramBinary(uint64_t sourceHash);
+	// save the binary of a linked program into the cache
+	static void SaveProgramBinary(GLuint programID, uint64_t sourceHash);
+};
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.cpp
+// ============
+// build variants of the scene program with the features of each draw fixed
+// at compile time, so the shaders do not branch on uniforms
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderPermutations.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  ShaderPermutations()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderPermutations::ShaderPermutations()
+{
+	m_pShaderCompiler = NULL;
+	m_fallbackProgramID = 0;
+}
+
+/***********************************************************
+ *  ~ShaderPermutations()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderPermutations::~ShaderPermutations()
+{
+	// a variant still building is released with its context
+	for (size_t i = 0; i < m_permutations.size(); i++)
+	{
+		if (m_permutations[i].programID != 0)
+		{
+			glDeleteProgram(m_permutations[i].programID);
+		}
+	}
+	m_permutations.clear();
+	m_pShaderCompiler = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for setting the files that the
+ *  variants are built from and the program that is used
+ *  while a variant is not ready yet.
+ ***********************************************************/
+void ShaderPermutations::Initialize(
+	ShaderCompiler* pShaderCompiler,
+	const char* vertexShaderFile,
+	const char* fragmentShaderFile,
+	GLuint fallbackProgramID)
+{
+	m_pShaderCompiler = pShaderCompiler;
+	m_vertexShaderFile = vertexShaderFile;
+	m_fragmentShaderFile = fragmentShaderFile;
+	m_fallbackProgramID = fallbackProgramID;
+}
+
+/***********************************************************
+ *  BuildDefines()
+ *
+ *  This method is used for building the #define lines that
+ *  fix the passed in features in the shaders.  A light
+ *  count of zero reads the lights from the clusters.
+ ***********************************************************/
+std::string ShaderPermutations::BuildDefines(int features, int lightCount)
+{
+	std::string defines = "#define PERMUTATION\n";
+
+	if ((features & FEATURE_TEXTURE) != 0)
+	{
+		defines += "#define USE_TEXTURE\n";
+	}
+	if ((features & FEATURE_LIGHTING) != 0)
+	{
+		defines += "#define USE_LIGHTING\n";
+	}
+	if ((features & FEATURE_SHADOWS) != 0)
+	{
+		defines += "#define USE_SHADOWS\n";
+	}
+	if (lightCount > 0)
+	{
+		defines += "#define LIGHT_COUNT " + std::to_string(lightCount) + "\n";
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the program that draws
+ *  the passed in features.  The variant is requested the
+ *  first time it is asked for, and the fallback program is
+ *  returned until it has been built.
+ ***********************************************************/
+GLuint ShaderPermutations::GetProgram(int features, int lightCount)
+{
+	if (NULL == m_pShaderCompiler)
+	{
+		return(m_fallbackProgramID);
+	}
+
+	// the variants replaced by a reload are released as they finish
+	for (size_t i = 0; i < m_retiredRequests.size();)
+	{
+		GLuint programID = 0;
+		if (m_pShaderCompiler->PollProgram(m_retiredRequests[i], programID) == true)
+		{
+			if (programID != 0)
+			{
+				glDeleteProgram(programID);
+			}
+			m_retiredRequests.erase(m_retiredRequests.begin() + i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	// scenes with many lights all share the clustered variants
+	if ((lightCount > MAX_LIGHT_COUNT) || ((features & FEATURE_LIGHTING) == 0))
+	{
+		lightCount = 0;
+	}
+	// shadows are only sampled by the lit variants
+	if ((features & FEATURE_LIGHTING) == 0)
+	{
+		features &= ~FEATURE_SHADOWS;
+	}
+
+	for (size_t i = 0; i < m_permutations.size(); i++)
+	{
+		PERMUTATION& permutation = m_permutations[i];
+		if ((permutation.features == features) && (permutation.lightCount == lightCount))
+		{
+			if (permutation.bFinished == false)
+			{
+				permutation.bFinished = m_pShaderCompiler->PollProgram(permutation.requestID, permutation.programID);
+				if ((permutation.bFinished == true) && (permutation.programID == 0))
+				{
+					std::cout << "Could not build shader permutation:" << std::endl << BuildDefines(features, lightCount);
+				}
+			}
+
+			if ((permutation.bFinished == true) && (permutation.programID != 0))
+			{
+				return(permutation.programID);
+			}
+			return(m_fallbackProgramID);
+		}
+	}
+
+	PERMUTATION permutation;
+	permutation.features = features;
+	permutation.lightCount = lightCount;
+	permutation.bFinished = false;
+	permutation.programID = 0;
+	permutation.requestID = m_pShaderCompiler->RequestProgram(
+		m_vertexShaderFile.c_str(),
+		m_fragmentShaderFile.c_str(),
+		BuildDefines(features, lightCount));
+	m_permutations.push_back(permutation);
+
+	return(m_fallbackProgramID);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for dropping every variant after
+ *  the shader files were edited.  The passed in program,
+ *  built from the edited files, is used until the variants
+ *  are built again.
+ ***********************************************************/
+void ShaderPermutations::Reset(GLuint fallbackProgramID)
+{
+	for (size_t i = 0; i < m_permutations.size(); i++)
+	{
+		if (m_permutations[i].bFinished == false)
+		{
+			m_retiredRequests.push_back(m_permutations[i].requestID);
+		}
+		else if (m_permutations[i].programID != 0)
+		{
+			glDeleteProgram(m_permutations[i].programID);
+		}
+	}
+
+	m_permutations.clear();
+	m_fallbackProgramID = fallbackProgramID;
+}
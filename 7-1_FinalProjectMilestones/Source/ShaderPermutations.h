@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.h
+// ============
+// build variants of the scene program with the features of each draw fixed
+// at compile time, so the shaders do not branch on uniforms
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderCompiler.h"
+
+#include <GL/glew.h>        // GLEW library
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderPermutations
+ *
+ *  This class contains the code for choosing the smallest
+ *  program that can draw a set of features.  Each program
+ *  is requested from the background compiler the first time
+ *  it is needed, and the fallback program, which still
+ *  branches on the uniforms, is used until it is ready.
+ ***********************************************************/
+class ShaderPermutations
+{
+public:
+	// constructor
+	ShaderPermutations();
+	// destructor
+	~ShaderPermutations();
+
+	// features a draw can need, combined into a mask
+	enum FEATURE_FLAGS
+	{
+		FEATURE_TEXTURE = 0x1,
+		FEATURE_LIGHTING = 0x2,
+		FEATURE_SHADOWS = 0x4
+	};
+
+	// highest light count that gets a permutation with its own
+	// loop, above it the lights are read from the clusters
+	static const int MAX_LIGHT_COUNT = 4;
+
+private:
+	// one variant of the program
+	struct PERMUTATION
+	{
+		int features;
+		int lightCount;
+		int requestID;
+		bool bFinished;
+		GLuint programID;
+	};
+
+	// pointer to the background compiler, owned by the caller
+	ShaderCompiler* m_pShaderCompiler;
+	std::string m_vertexShaderFile;
+	std::string m_fragmentShaderFile;
+	// program without defines, used while a variant is building
+	GLuint m_fallbackProgramID;
+	std::vector<PERMUTATION> m_permutations;
+	// requests of replaced variants, deleted once they finish
+	std::vector<int> m_retiredRequests;
+
+	// build the #define lines of a variant
+	static std::string BuildDefines(int features, int lightCount);
+
+public:
+	// set the files the variants are built from
+	void Initialize(
+		ShaderCompiler* pShaderCompiler,
+		const char* vertexShaderFile,
+		const char* fragmentShaderFile,
+		GLuint fallbackProgramID);
+
+	// get the program for the features, zero before Initialize()
+	GLuint GetProgram(int features, int lightCount);
+	// drop the variants after the shader files were edited
+	void Reset(GLuint fallbackProgramID);
+};
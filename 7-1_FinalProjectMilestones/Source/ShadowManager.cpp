@@ -0,0 +1,647 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.cpp
+// ============
+// manage the shadow map atlas of the shadow casting lights, caching the
+// shadows of the static geometry between frames
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowManager.h"
+#include "ShaderLoader.h"
+#include "RenderStats.h"
+#include "TextureUnits.h"
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	const char* g_DepthVertexFile = "shaders/shadowDepthVertex.glsl";
+	const char* g_DepthFragmentFile = "shaders/shadowDepthFragment.glsl";
+
+	// shader storage binding point of the shadow data
+	const GLuint SHADOW_BINDING = 7;
+
+	// smallest square a light budget can be reduced to
+	const int MIN_SHADOW_RESOLUTION = 64;
+	// near plane of the spot light projections
+	const float SHADOW_NEAR_PLANE = 0.1f;
+
+	// create a depth atlas with hardware depth comparison
+	void CreateAtlas(int atlasSize, GLuint& atlas, GLuint& frameBuffer)
+	{
+		glGenTextures(1, &atlas);
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &frameBuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+}
+
+/***********************************************************
+ *  ShadowManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowManager::ShadowManager()
+{
+	m_depthProgramID = 0;
+	m_staticAtlas = 0;
+	m_staticFrameBuffer = 0;
+	m_dynamicAtlas = 0;
+	m_dynamicFrameBuffer = 0;
+	m_shadowBuffer = 0;
+	m_atlasSize = 0;
+	m_pcfQuality = PCF_QUALITY_MEDIUM;
+	m_bStaticDirty = true;
+	m_bLayoutDirty = false;
+	m_bUseDynamicAtlas = false;
+	m_savedProgram = 0;
+	m_savedFrameBuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_savedViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~ShadowManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowManager::~ShadowManager()
+{
+	if (m_depthProgramID != 0)
+	{
+		glDeleteProgram(m_depthProgramID);
+		m_depthProgramID = 0;
+	}
+	if (m_staticAtlas != 0)
+	{
+		glDeleteFramebuffers(1, &m_staticFrameBuffer);
+		glDeleteFramebuffers(1, &m_dynamicFrameBuffer);
+		glDeleteTextures(1, &m_staticAtlas);
+		glDeleteTextures(1, &m_dynamicAtlas);
+		m_staticFrameBuffer = 0;
+		m_dynamicFrameBuffer = 0;
+		m_staticAtlas = 0;
+		m_dynamicAtlas = 0;
+	}
+	if (m_shadowBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_shadowBuffer);
+		m_shadowBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the depth program and
+ *  creating the static and dynamic atlases.  The size of
+ *  the atlas is the total shadow budget of all the lights.
+ ***********************************************************/
+bool ShadowManager::Initialize(int atlasSize)
+{
+	// the atlas copy and the shadow data buffer need OpenGL 4.3
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "INFO: shadows disabled, OpenGL 4.3 is not available" << std::endl;
+		return(false);
+	}
+
+	m_depthProgramID = ShaderLoader::LoadProgram(g_DepthVertexFile, g_DepthFragmentFile);
+	if (m_depthProgramID == 0)
+	{
+		std::cout << "INFO: shadows disabled, depth program failed to load" << std::endl;
+		return(false);
+	}
+
+	m_atlasSize = atlasSize;
+	CreateAtlas(m_atlasSize, m_staticAtlas, m_staticFrameBuffer);
+	CreateAtlas(m_atlasSize, m_dynamicAtlas, m_dynamicFrameBuffer);
+	SetAtlasFilter(m_staticAtlas);
+	SetAtlasFilter(m_dynamicAtlas);
+
+	glGenBuffers(1, &m_shadowBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_shadowBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(SHADOW_DATA), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddShadowLight()
+ *
+ *  This method is used for giving a light a spot shadow
+ *  that looks from the light position at the passed in
+ *  target.  The resolution budget is the requested size of
+ *  its square in the atlas, which is reduced when all of
+ *  the budgets do not fit.
+ ***********************************************************/
+int ShadowManager::AddShadowLight(
+	LightManager* pLightManager,
+	int lightIndex,
+	glm::vec3 target,
+	float fieldOfView,
+	float farPlane,
+	int resolutionBudget)
+{
+	if ((m_depthProgramID == 0) || (NULL == pLightManager))
+	{
+		return(-1);
+	}
+
+	const LightManager::LIGHT_SOURCE* pLight = pLightManager->GetLight(lightIndex);
+	if (NULL == pLight)
+	{
+		return(-1);
+	}
+
+	SHADOW_LIGHT shadow;
+	shadow.lightIndex = lightIndex;
+	shadow.position = pLight->position;
+	shadow.target = target;
+	shadow.fieldOfView = fieldOfView;
+	shadow.farPlane = farPlane;
+	shadow.resolutionBudget = glm::clamp(resolutionBudget, MIN_SHADOW_RESOLUTION, m_atlasSize);
+	shadow.atlasX = 0;
+	shadow.atlasY = 0;
+	shadow.atlasSize = 0;
+	shadow.viewProjection = glm::mat4(1.0f);
+	m_lights.push_back(shadow);
+
+	int shadowIndex = (int)m_lights.size() - 1;
+	pLightManager->SetLightShadow(lightIndex, shadowIndex);
+
+	m_bLayoutDirty = true;
+	m_bStaticDirty = true;
+
+	return(shadowIndex);
+}
+
+/***********************************************************
+ *  ClearShadowLights()
+ *
+ *  This method is used for removing all of the shadow
+ *  casting lights, before the lights are added again.
+ ***********************************************************/
+void ShadowManager::ClearShadowLights()
+{
+	m_lights.clear();
+
+	m_bLayoutDirty = true;
+	m_bStaticDirty = true;
+}
+
+/***********************************************************
+ *  GetShadowCount()
+ *
+ *  This method is used for getting the number of shadow
+ *  casting lights.
+ ***********************************************************/
+int ShadowManager::GetShadowCount() const
+{
+	return((int)m_lights.size());
+}
+
+/***********************************************************
+ *  LayoutAtlas()
+ *
+ *  This method is used for placing the light squares in
+ *  rows, from the largest to the smallest.  While they do
+ *  not fit, the largest square is halved and the layout is
+ *  tried again.
+ ***********************************************************/
+void ShadowManager::LayoutAtlas()
+{
+	std::vector<int> sizes;
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		sizes.push_back(m_lights[i].resolutionBudget);
+	}
+
+	bool bFits = false;
+	while (bFits == false)
+	{
+		std::vector<int> order;
+		for (size_t i = 0; i < sizes.size(); i++)
+		{
+			order.push_back((int)i);
+		}
+		std::stable_sort(order.begin(), order.end(),
+			[&sizes](int first, int second) { return(sizes[first] > sizes[second]); });
+
+		int x = 0;
+		int y = 0;
+		int rowHeight = 0;
+		bFits = true;
+		for (size_t i = 0; (i < order.size()) && (bFits == true); i++)
+		{
+			SHADOW_LIGHT& shadow = m_lights[order[i]];
+			int size = sizes[order[i]];
+
+			if (x + size > m_atlasSize)
+			{
+				x = 0;
+				y += rowHeight;
+				rowHeight = 0;
+			}
+			if (y + size > m_atlasSize)
+			{
+				bFits = false;
+			}
+			else
+			{
+				shadow.atlasX = x;
+				shadow.atlasY = y;
+				shadow.atlasSize = size;
+				x += size;
+				rowHeight = std::max(rowHeight, size);
+			}
+		}
+
+		if (bFits == false)
+		{
+			int largest = order[0];
+			if (sizes[largest] <= MIN_SHADOW_RESOLUTION)
+			{
+				std::cout << "Could not fit all of the shadow maps into the atlas" << std::endl;
+				break;
+			}
+			sizes[largest] = sizes[largest] / 2;
+			std::cout << "INFO: shadow map of light " << m_lights[largest].lightIndex
+				<< " reduced to " << sizes[largest] << " texels to fit the atlas" << std::endl;
+		}
+	}
+
+	m_bLayoutDirty = false;
+}
+
+/***********************************************************
+ *  UploadShadowData()
+ *
+ *  This method is used for copying the view projection and
+ *  the atlas square of every light into the shadow buffer.
+ ***********************************************************/
+void ShadowManager::UploadShadowData()
+{
+	if (m_lights.size() == 0)
+	{
+		return;
+	}
+
+	std::vector<SHADOW_DATA> shadowData;
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		SHADOW_DATA data;
+		data.viewProjection = m_lights[i].viewProjection;
+		data.atlasRect = glm::vec4(
+			(float)m_lights[i].atlasX,
+			(float)m_lights[i].atlasY,
+			(float)m_lights[i].atlasSize,
+			(float)m_lights[i].atlasSize) / (float)m_atlasSize;
+		shadowData.push_back(data);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_shadowBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, shadowData.size() * sizeof(SHADOW_DATA), &shadowData[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetAtlasFilter()
+ *
+ *  This method is used for setting the filtering of an
+ *  atlas.  Every level above off uses bilinear comparison,
+ *  which already blends the result of 2x2 texels per tap.
+ ***********************************************************/
+void ShadowManager::SetAtlasFilter(GLuint atlas)
+{
+	GLint filter = (m_pcfQuality == PCF_QUALITY_OFF) ? GL_NEAREST : GL_LINEAR;
+
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  SetPcfQuality()
+ *
+ *  This method is used for setting the filtering of the
+ *  shadow edges.  The lower levels keep the shadows cheap
+ *  on software rasterizers.
+ ***********************************************************/
+void ShadowManager::SetPcfQuality(PCF_QUALITY quality)
+{
+	m_pcfQuality = quality;
+
+	if (m_staticAtlas != 0)
+	{
+		SetAtlasFilter(m_staticAtlas);
+		SetAtlasFilter(m_dynamicAtlas);
+	}
+}
+
+/***********************************************************
+ *  InvalidateStaticShadows()
+ *
+ *  This method is used for forcing the static shadows to be
+ *  rendered again, after a static object has moved.
+ ***********************************************************/
+void ShadowManager::InvalidateStaticShadows()
+{
+	m_bStaticDirty = true;
+}
+
+/***********************************************************
+ *  UpdateLights()
+ *
+ *  This method is used for following the positions of the
+ *  shadow casting lights.  A light that has moved needs a
+ *  new view projection, which invalidates the static atlas.
+ ***********************************************************/
+void ShadowManager::UpdateLights(const LightManager* pLightManager)
+{
+	if ((m_depthProgramID == 0) || (NULL == pLightManager))
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		const LightManager::LIGHT_SOURCE* pLight = pLightManager->GetLight(m_lights[i].lightIndex);
+		if ((NULL != pLight) && (pLight->position != m_lights[i].position))
+		{
+			m_lights[i].position = pLight->position;
+			m_bStaticDirty = true;
+		}
+	}
+
+	if (m_bLayoutDirty == true)
+	{
+		LayoutAtlas();
+	}
+
+	if (m_bStaticDirty == true)
+	{
+		for (size_t i = 0; i < m_lights.size(); i++)
+		{
+			SHADOW_LIGHT& shadow = m_lights[i];
+			glm::vec3 direction = glm::normalize(shadow.target - shadow.position);
+			glm::vec3 up = (std::abs(direction.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+			glm::mat4 view = glm::lookAt(shadow.position, shadow.target, up);
+			glm::mat4 projection = glm::perspective(glm::radians(shadow.fieldOfView), 1.0f, SHADOW_NEAR_PLANE, shadow.farPlane);
+			shadow.viewProjection = projection * view;
+		}
+		UploadShadowData();
+	}
+}
+
+/***********************************************************
+ *  IsStaticPassNeeded()
+ *
+ *  This method is used for checking whether the cached
+ *  static shadows are out of date.
+ ***********************************************************/
+bool ShadowManager::IsStaticPassNeeded() const
+{
+	return((m_depthProgramID != 0) && (m_bStaticDirty == true) && (m_lights.size() > 0));
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method is used for binding an atlas framebuffer and
+ *  restricting the drawing to the square of one light.  The
+ *  slope scaled offset keeps the surfaces from shadowing
+ *  themselves.
+ ***********************************************************/
+void ShadowManager::BeginPass(GLuint frameBuffer, int shadowIndex, bool bClear)
+{
+	const SHADOW_LIGHT& shadow = m_lights[shadowIndex];
+
+	glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &m_savedProgram);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_savedFrameBuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+	glViewport(shadow.atlasX, shadow.atlasY, shadow.atlasSize, shadow.atlasSize);
+
+	if (bClear == true)
+	{
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(shadow.atlasX, shadow.atlasY, shadow.atlasSize, shadow.atlasSize);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glDisable(GL_SCISSOR_TEST);
+	}
+
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	glUseProgram(m_depthProgramID);
+	glUniformMatrix4fv(glGetUniformLocation(m_depthProgramID, "lightViewProjection"), 1, GL_FALSE, glm::value_ptr(shadow.viewProjection));
+}
+
+/***********************************************************
+ *  BeginStaticPass()
+ *
+ *  This method is used for clearing the square of one light
+ *  in the static atlas and starting to draw its casters.
+ ***********************************************************/
+void ShadowManager::BeginStaticPass(int shadowIndex)
+{
+	if ((shadowIndex < 0) || (shadowIndex >= (int)m_lights.size()))
+	{
+		return;
+	}
+
+	BeginPass(m_staticFrameBuffer, shadowIndex, true);
+}
+
+/***********************************************************
+ *  EndStaticPasses()
+ *
+ *  This method is used for marking the static atlas as up
+ *  to date once every light has been drawn into it.
+ ***********************************************************/
+void ShadowManager::EndStaticPasses()
+{
+	m_bStaticDirty = false;
+}
+
+/***********************************************************
+ *  PrepareDynamicPasses()
+ *
+ *  This method is used for copying the cached static atlas
+ *  into the dynamic atlas, which the dynamic casters are
+ *  then drawn on top of.
+ ***********************************************************/
+void ShadowManager::PrepareDynamicPasses()
+{
+	if (m_depthProgramID == 0)
+	{
+		return;
+	}
+
+	glCopyImageSubData(
+		m_staticAtlas, GL_TEXTURE_2D, 0, 0, 0, 0,
+		m_dynamicAtlas, GL_TEXTURE_2D, 0, 0, 0, 0,
+		m_atlasSize, m_atlasSize, 1);
+
+	m_bUseDynamicAtlas = true;
+}
+
+/***********************************************************
+ *  BeginDynamicPass()
+ *
+ *  This method is used for starting to draw the dynamic
+ *  casters of one light on top of its static shadows.
+ ***********************************************************/
+void ShadowManager::BeginDynamicPass(int shadowIndex)
+{
+	if ((shadowIndex < 0) || (shadowIndex >= (int)m_lights.size()))
+	{
+		return;
+	}
+
+	BeginPass(m_dynamicFrameBuffer, shadowIndex, false);
+}
+
+/***********************************************************
+ *  SkipDynamicPasses()
+ *
+ *  This method is used for sampling the static atlas
+ *  directly when there are no dynamic casters to draw.
+ ***********************************************************/
+void ShadowManager::SkipDynamicPasses()
+{
+	m_bUseDynamicAtlas = false;
+}
+
+/***********************************************************
+ *  SetModelMatrix()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next caster drawn in a shadow pass.
+ ***********************************************************/
+void ShadowManager::SetModelMatrix(const glm::mat4& model)
+{
+	glUniformMatrix4fv(glGetUniformLocation(m_depthProgramID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for restoring the framebuffer, the
+ *  viewport and the program that were used by the scene.
+ ***********************************************************/
+void ShadowManager::EndPass()
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_savedFrameBuffer);
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+	glUseProgram((GLuint)m_savedProgram);
+}
+
+/***********************************************************
+ *  SetShaderValues()
+ *
+ *  This method is used for binding the atlas and the shadow
+ *  data, and setting the filtering values into the shader.
+ ***********************************************************/
+void ShadowManager::SetShaderValues(ShaderManager* pShaderManager)
+{
+	if (NULL == pShaderManager)
+	{
+		return;
+	}
+
+	bool bUseShadows = (m_depthProgramID != 0) && (m_lights.size() > 0);
+	pShaderManager->setBoolValue("bUseShadows", bUseShadows);
+	if (bUseShadows == false)
+	{
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, (m_bUseDynamicAtlas == true) ? m_dynamicAtlas : m_staticAtlas);
+	glActiveTexture(GL_TEXTURE0);
+	RenderStats::CountTextureBinds(1);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_BINDING, m_shadowBuffer);
+
+	// off and low both take a single tap
+	int pcfRadius = std::max((int)m_pcfQuality - 1, 0);
+
+	pShaderManager->setIntValue("shadowAtlas", SHADOW_TEXTURE_UNIT);
+	pShaderManager->setIntValue("shadowPcfRadius", pcfRadius);
+	pShaderManager->setFloatValue("shadowTexelSize", 1.0f / (float)m_atlasSize);
+}
+
+/***********************************************************
+ *  SetProgramValues()
+ *
+ *  This method is used for binding the atlas and the shadow
+ *  data, and setting the filtering values into a program
+ *  that is currently in use, such as the deferred lighting
+ *  pass.
+ ***********************************************************/
+void ShadowManager::SetProgramValues(GLuint programID)
+{
+	if (programID == 0)
+	{
+		return;
+	}
+
+	bool bUseShadows = (m_depthProgramID != 0) && (m_lights.size() > 0);
+	glUniform1i(glGetUniformLocation(programID, "bUseShadows"), bUseShadows);
+	if (bUseShadows == false)
+	{
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, (m_bUseDynamicAtlas == true) ? m_dynamicAtlas : m_staticAtlas);
+	glActiveTexture(GL_TEXTURE0);
+	RenderStats::CountTextureBinds(1);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_BINDING, m_shadowBuffer);
+
+	int pcfRadius = std::max((int)m_pcfQuality - 1, 0);
+
+	glUniform1i(glGetUniformLocation(programID, "shadowAtlas"), SHADOW_TEXTURE_UNIT);
+	glUniform1i(glGetUniformLocation(programID, "shadowPcfRadius"), pcfRadius);
+	glUniform1f(glGetUniformLocation(programID, "shadowTexelSize"), 1.0f / (float)m_atlasSize);
+}
+
+/***********************************************************
+ *  WatchShaders()
+ *
+ *  This method is used for rebuilding the depth program
+ *  when its files are edited.
+ ***********************************************************/
+void ShadowManager::WatchShaders(ShaderHotReload* pHotReload)
+{
+	if ((NULL == pHotReload) || (m_depthProgramID == 0))
+	{
+		return;
+	}
+
+	pHotReload->WatchProgram(&m_depthProgramID, g_DepthVertexFile, g_DepthFragmentFile);
+}
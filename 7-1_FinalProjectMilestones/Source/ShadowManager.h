@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.h
+// ============
+// manage the shadow map atlas of the shadow casting lights, caching the
+// shadows of the static geometry between frames
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "LightManager.h"
+#include "ShaderHotReload.h"
+
+#include <GL/glew.h>        // GLEW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ShadowManager
+ *
+ *  This class contains the code for rendering spot light
+ *  shadow maps into one depth atlas.  Every light gets a
+ *  square of the atlas sized by its resolution budget.  The
+ *  static geometry is rendered into a cached atlas that is
+ *  only redrawn when a light or a static object moves, and
+ *  the dynamic casters are drawn on top of a copy of it.
+ ***********************************************************/
+class ShadowManager
+{
+public:
+	// constructor
+	ShadowManager();
+	// destructor
+	~ShadowManager();
+
+	// filtering of the shadow edges, from the cheapest up
+	enum PCF_QUALITY
+	{
+		// one nearest tap, hard edges
+		PCF_QUALITY_OFF = 0,
+		// one bilinear tap, which compares 2x2 texels
+		PCF_QUALITY_LOW,
+		// 3x3 bilinear taps
+		PCF_QUALITY_MEDIUM,
+		// 5x5 bilinear taps
+		PCF_QUALITY_HIGH
+	};
+
+	// per-light data read by the shaders - this must match the
+	// std430 layout of ShadowData in the shaders
+	struct SHADOW_DATA
+	{
+		glm::mat4 viewProjection;
+		// offset and size of the light's square in atlas UVs
+		glm::vec4 atlasRect;
+	};
+
+private:
+	// one shadow casting light
+	struct SHADOW_LIGHT
+	{
+		int lightIndex;
+		glm::vec3 position;
+		glm::vec3 target;
+		float fieldOfView;
+		float farPlane;
+		// requested size of the shadow map in texels
+		int resolutionBudget;
+		// placement inside the atlas in texels
+		int atlasX;
+		int atlasY;
+		int atlasSize;
+		glm::mat4 viewProjection;
+	};
+
+	// program that only writes the depth of the casters
+	GLuint m_depthProgramID;
+	// atlas holding the shadows of the static geometry
+	GLuint m_staticAtlas;
+	GLuint m_staticFrameBuffer;
+	// copy of the static atlas with the dynamic casters on top
+	GLuint m_dynamicAtlas;
+	GLuint m_dynamicFrameBuffer;
+	// buffer holding the SHADOW_DATA entries
+	GLuint m_shadowBuffer;
+	// width and height of the atlas in texels
+	int m_atlasSize;
+	PCF_QUALITY m_pcfQuality;
+	// true when the static atlas must be rendered again
+	bool m_bStaticDirty;
+	// true when the light squares must be placed again
+	bool m_bLayoutDirty;
+	// true when the dynamic atlas holds this frame's casters
+	bool m_bUseDynamicAtlas;
+	// viewport, program and framebuffer saved by the current pass
+	GLint m_savedViewport[4];
+	GLint m_savedProgram;
+	GLint m_savedFrameBuffer;
+	std::vector<SHADOW_LIGHT> m_lights;
+
+	// place the light squares inside the atlas
+	void LayoutAtlas();
+	// upload the view projections and the atlas squares
+	void UploadShadowData();
+	// set the filtering of an atlas for the PCF quality
+	void SetAtlasFilter(GLuint atlas);
+	// bind an atlas framebuffer and the square of one light
+	void BeginPass(GLuint frameBuffer, int shadowIndex, bool bClear);
+
+public:
+	// load the depth program and create the atlases
+	bool Initialize(int atlasSize);
+
+	// add a spot light shadow aimed at the passed in target
+	int AddShadowLight(
+		LightManager* pLightManager,
+		int lightIndex,
+		glm::vec3 target,
+		float fieldOfView,
+		float farPlane,
+		int resolutionBudget);
+	// remove all of the shadow casting lights
+	void ClearShadowLights();
+	// get the number of shadow casting lights
+	int GetShadowCount() const;
+
+	// set the filtering of the shadow edges
+	void SetPcfQuality(PCF_QUALITY quality);
+	// force the static shadows to be rendered again
+	void InvalidateStaticShadows();
+	// follow the lights, invalidating the static shadows if one moved
+	void UpdateLights(const LightManager* pLightManager);
+
+	// true when the static shadows must be rendered this frame
+	bool IsStaticPassNeeded() const;
+	// start drawing the static casters of one light
+	void BeginStaticPass(int shadowIndex);
+	// copy the static shadows before the dynamic casters are drawn
+	void PrepareDynamicPasses();
+	// start drawing the dynamic casters of one light
+	void BeginDynamicPass(int shadowIndex);
+	// set the model matrix of the next caster
+	void SetModelMatrix(const glm::mat4& model);
+	// restore the framebuffer, viewport and program of the scene
+	void EndPass();
+	// mark the static shadows as up to date
+	void EndStaticPasses();
+	// sample the static atlas when there are no dynamic casters
+	void SkipDynamicPasses();
+
+	// bind the atlas and set the shadow values into the shader
+	void SetShaderValues(ShaderManager* pShaderManager);
+	// same as above for a program outside of the shader manager
+	void SetProgramValues(GLuint programID);
+	// rebuild the depth program when its files are edited
+	void WatchShaders(ShaderHotReload* pHotReload);
+};
@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// statsoverlay.cpp
+// ============
+// draw the counts and times of the recent frames in a corner of the window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StatsOverlay.h"
+#include "ShaderLoader.h"
+#include "TextureUnits.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+
+// declaration of global variables
+namespace
+{
+	const char* g_OverlayVertexFile = "shaders/fullscreenVertex.glsl";
+	const char* g_OverlayFragmentFile = "shaders/statsOverlay.glsl";
+
+	// lines and characters of the text, the size of a character
+	// cell and the border around the text, in texels
+	const int TEXT_ROWS = 8;
+	const int TEXT_COLUMNS = 24;
+	const int CELL_WIDTH = 6;
+	const int CELL_HEIGHT = 9;
+	const int TEXT_BORDER = 3;
+	const int TEXTURE_WIDTH = TEXT_COLUMNS * CELL_WIDTH + TEXT_BORDER * 2;
+	const int TEXTURE_HEIGHT = TEXT_ROWS * CELL_HEIGHT + TEXT_BORDER * 2;
+	// pixels of the window per texel, and the distance of the
+	// overlay from the corner of the window
+	const int OVERLAY_SCALE = 2;
+	const int OVERLAY_MARGIN = 8;
+	// seconds over which the numbers are averaged
+	const float REFRESH_INTERVAL = 0.5f;
+
+	// the characters of the font and their rows of 5 pixels, with
+	// the leftmost pixel in bit 4
+	const char* GLYPH_CHARACTERS = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/-%";
+	const unsigned char GLYPH_ROWS[][7] =
+	{
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },	// 0
+		{ 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },	// 1
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },	// 2
+		{ 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },	// 3
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },	// 4
+		{ 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },	// 5
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },	// 6
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },	// 7
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },	// 8
+		{ 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },	// 9
+		{ 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 },	// A
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },	// B
+		{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },	// C
+		{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },	// D
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },	// E
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },	// F
+		{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },	// G
+		{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },	// H
+		{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },	// I
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },	// J
+		{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },	// K
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },	// L
+		{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },	// M
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },	// N
+		{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },	// O
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },	// P
+		{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },	// Q
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },	// R
+		{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },	// S
+		{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },	// T
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },	// U
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },	// V
+		{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },	// W
+		{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },	// X
+		{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },	// Y
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },	// Z
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },	// .
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },	// :
+		{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },	// /
+		{ 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },	// -
+		{ 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }	// %
+	};
+}
+
+/***********************************************************
+ *  StatsOverlay()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StatsOverlay::StatsOverlay()
+{
+	m_programID = 0;
+	m_textTexture = 0;
+	m_emptyVertexArray = 0;
+	m_totals = RenderStats::FRAME_STATS();
+	m_frameCount = 0;
+	m_intervalStartTime = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  ~StatsOverlay()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StatsOverlay::~StatsOverlay()
+{
+	if (m_programID != 0)
+	{
+		glDeleteProgram(m_programID);
+		m_programID = 0;
+	}
+	if (m_textTexture != 0)
+	{
+		glDeleteTextures(1, &m_textTexture);
+		m_textTexture = 0;
+	}
+	if (m_emptyVertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArray);
+		m_emptyVertexArray = 0;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the overlay program and
+ *  creating the text texture.  The overlay is drawn with
+ *  the full-screen triangle restricted to its corner.
+ ***********************************************************/
+bool StatsOverlay::Initialize()
+{
+	m_programID = ShaderLoader::LoadProgram(g_OverlayVertexFile, g_OverlayFragmentFile);
+	if (m_programID == 0)
+	{
+		std::cout << "INFO: statistics overlay disabled, overlay program failed to load" << std::endl;
+		return(false);
+	}
+
+	m_textPixels.assign(TEXTURE_WIDTH * TEXTURE_HEIGHT, 0);
+
+	glGenTextures(1, &m_textTexture);
+	glBindTexture(GL_TEXTURE_2D, m_textTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, TEXTURE_WIDTH, TEXTURE_HEIGHT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, &m_textPixels[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenVertexArrays(1, &m_emptyVertexArray);
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriteLine()
+ *
+ *  This method is used for writing a line of text into the
+ *  texture pixels with the bitmap font.  Lowercase letters
+ *  are drawn as uppercase, and characters missing from the
+ *  font are left blank.
+ ***********************************************************/
+void StatsOverlay::WriteLine(int row, const char* text)
+{
+	int top = TEXT_BORDER + row * CELL_HEIGHT + 1;
+	for (int column = 0; (column < TEXT_COLUMNS) && (text[column] != '\0'); column++)
+	{
+		char character = (char)toupper((unsigned char)text[column]);
+		const char* pGlyph = (character != ' ') ? strchr(GLYPH_CHARACTERS, character) : NULL;
+		if ((NULL == pGlyph) || (*pGlyph == '\0'))
+		{
+			continue;
+		}
+
+		const unsigned char* pRows = GLYPH_ROWS[pGlyph - GLYPH_CHARACTERS];
+		int left = TEXT_BORDER + column * CELL_WIDTH;
+		for (int y = 0; y < 7; y++)
+		{
+			for (int x = 0; x < 5; x++)
+			{
+				if (pRows[y] & (0x10 >> x))
+				{
+					m_textPixels[(top + y) * TEXTURE_WIDTH + left + x] = 255;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateText()
+ *
+ *  This method is used for writing the averages of the
+ *  frames of the interval into the text texture.  The mesh
+ *  builds are the total of the interval, since they only
+ *  happen on some frames.
+ ***********************************************************/
+void StatsOverlay::UpdateText(float seconds)
+{
+	float frames = (float)((m_frameCount > 0) ? m_frameCount : 1);
+	char line[TEXT_COLUMNS + 1];
+
+	m_textPixels.assign(TEXTURE_WIDTH * TEXTURE_HEIGHT, 0);
+
+	snprintf(line, sizeof(line), "FPS %14.1f", m_frameCount / seconds);
+	WriteLine(0, line);
+	snprintf(line, sizeof(line), "CPU MS %11.2f", m_totals.cpuTime / frames);
+	WriteLine(1, line);
+	snprintf(line, sizeof(line), "GPU MS %11.2f", m_totals.gpuTime / frames);
+	WriteLine(2, line);
+	snprintf(line, sizeof(line), "DRAWS %12.0f", m_totals.drawCalls / frames);
+	WriteLine(3, line);
+	snprintf(line, sizeof(line), "UNIFORMS %9.0f", m_totals.uniformUploads / frames);
+	WriteLine(4, line);
+	snprintf(line, sizeof(line), "TEXTURE BINDS %4.0f", m_totals.textureBinds / frames);
+	WriteLine(5, line);
+	snprintf(line, sizeof(line), "TRIANGLES %8.0f", m_totals.triangles / frames);
+	WriteLine(6, line);
+	snprintf(line, sizeof(line), "MESH BUILDS %6d", m_totals.meshRegenerations);
+	WriteLine(7, line);
+
+	glBindTexture(GL_TEXTURE_2D, m_textTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, &m_textPixels[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for adding the last finished frame
+ *  to the totals, writing the text again once the interval
+ *  is over, and drawing the overlay into the top left
+ *  corner of the window framebuffer.
+ ***********************************************************/
+void StatsOverlay::Draw(int windowWidth, int windowHeight)
+{
+	if (m_programID == 0)
+	{
+		return;
+	}
+
+	RenderStats::FRAME_STATS stats = RenderStats::GetFrameStats();
+	m_totals.drawCalls += stats.drawCalls;
+	m_totals.uniformUploads += stats.uniformUploads;
+	m_totals.textureBinds += stats.textureBinds;
+	m_totals.triangles += stats.triangles;
+	m_totals.meshRegenerations += stats.meshRegenerations;
+	m_totals.cpuTime += stats.cpuTime;
+	m_totals.gpuTime += stats.gpuTime;
+	m_frameCount++;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	float seconds = std::chrono::duration<float>(now - m_intervalStartTime).count();
+	if (seconds >= REFRESH_INTERVAL)
+	{
+		UpdateText(seconds);
+		m_totals = RenderStats::FRAME_STATS();
+		m_frameCount = 0;
+		m_intervalStartTime = now;
+	}
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	// blending is enabled for the whole application
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(
+		OVERLAY_MARGIN,
+		windowHeight - OVERLAY_MARGIN - TEXTURE_HEIGHT * OVERLAY_SCALE,
+		TEXTURE_WIDTH * OVERLAY_SCALE,
+		TEXTURE_HEIGHT * OVERLAY_SCALE);
+	glDisable(GL_DEPTH_TEST);
+
+	glUseProgram(m_programID);
+	glActiveTexture(GL_TEXTURE0 + OVERLAY_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_textTexture);
+	glBindVertexArray(m_emptyVertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+	glEnable(GL_DEPTH_TEST);
+	glViewport(0, 0, windowWidth, windowHeight);
+	glUseProgram((GLuint)previousProgram);
+}
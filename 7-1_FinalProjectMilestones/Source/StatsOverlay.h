@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// statsoverlay.h
+// ============
+// draw the counts and times of the recent frames in a corner of the window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "RenderStats.h"
+
+#include <vector>
+#include <chrono>
+
+/***********************************************************
+ *  StatsOverlay
+ *
+ *  This class contains the statistics HUD.  The numbers of
+ *  RenderStats are averaged over a short interval, so they
+ *  can be read, and written into a small texture with a
+ *  built in bitmap font whenever the interval ends.  The
+ *  texture is drawn over the top left corner of the window
+ *  after the frame was measured, so the overlay does not
+ *  show up in its own counts.
+ ***********************************************************/
+class StatsOverlay
+{
+public:
+	// constructor
+	StatsOverlay();
+	// destructor
+	~StatsOverlay();
+
+private:
+	GLuint m_programID;
+	GLuint m_textTexture;
+	GLuint m_emptyVertexArray;
+	// coverage of the text, one byte per texel, first row at the top
+	std::vector<unsigned char> m_textPixels;
+	// totals of the frames since the text was last written
+	RenderStats::FRAME_STATS m_totals;
+	int m_frameCount;
+	std::chrono::steady_clock::time_point m_intervalStartTime;
+
+	// write a line of text into the texture pixels
+	void WriteLine(int row, const char* text);
+	// write the averages of the interval into the texture
+	void UpdateText(float seconds);
+
+public:
+	// load the program and create the texture
+	bool Initialize();
+
+	// add the last finished frame to the averages and draw the
+	// overlay into the window of the passed in size
+	void Draw(int windowWidth, int windowHeight);
+};
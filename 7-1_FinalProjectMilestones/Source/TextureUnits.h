@@ -0,0 +1,28 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureunits.h
+// ==============
+// reserve the texture units of the renderers, shared by every manager that
+// binds a texture, so none of them binds over the textures of another
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// texture units that every shader stage can sample from, the
+// reserved units are counted down from the last of them
+const int TEXTURE_UNIT_COUNT = 16;
+
+// depth pyramid of the occlusion test of the culling pass
+const int PYRAMID_TEXTURE_UNIT = TEXTURE_UNIT_COUNT - 1;
+// text of the statistics overlay, this must match the binding
+// of the text mask in the overlay shader
+const int OVERLAY_TEXTURE_UNIT = TEXTURE_UNIT_COUNT - 2;
+// shadow atlas of the lights
+const int SHADOW_TEXTURE_UNIT = TEXTURE_UNIT_COUNT - 3;
+// targets of the G-buffer read by the deferred lighting pass
+const int DEPTH_TEXTURE_UNIT = TEXTURE_UNIT_COUNT - 4;
+const int MATERIAL_TEXTURE_UNIT = TEXTURE_UNIT_COUNT - 5;
+const int NORMAL_TEXTURE_UNIT = TEXTURE_UNIT_COUNT - 6;
+const int ALBEDO_TEXTURE_UNIT = TEXTURE_UNIT_COUNT - 7;
+
+// the scene textures are bound to the units below the reserved ones
+const int MAX_SCENE_TEXTURES = ALBEDO_TEXTURE_UNIT;
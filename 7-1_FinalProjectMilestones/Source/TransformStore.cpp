@@ -0,0 +1,776 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.cpp
+// ============
+// keep the object transforms in structure-of-arrays form and compose the
+// world matrices of the changed objects into a mapped instance buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformStore.h"
+#include "JobSystem.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_STORE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// the AVX2 kernel is built for its instruction set without
+// raising the baseline of the whole project, and only runs
+// after the processor was checked
+#if defined(TRANSFORM_STORE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE __attribute__((target("sse2")))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// longest wait for the GPU to release a buffer region
+	const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+	typedef TransformStore::TRANSFORM_ARRAYS TRANSFORM_ARRAYS;
+
+	// floats of one normal matrix in the buffer, a std430 mat3
+	// with each column padded to four floats
+	const int NORMAL_MATRIX_FLOATS = 12;
+
+	// one over the square of a scale, zero for a zero scale
+	inline float InverseSquare(float scale)
+	{
+		return((scale != 0.0f) ? 1.0f / (scale * scale) : 0.0f);
+	}
+
+	// store one composed matrix into the CPU copy and the buffer
+	inline void StoreMatrix(const float* pMatrix, int objectIndex, float* pWorld, float* pMapped)
+	{
+		memcpy(pWorld + objectIndex * 16, pMatrix, 16 * sizeof(float));
+		if (NULL != pMapped)
+		{
+			memcpy(pMapped + objectIndex * 16, pMatrix, 16 * sizeof(float));
+		}
+	}
+
+	// compose the matrices one object at a time - the matrix is
+	// translation * rotationX * rotationY * rotationZ * scale, the
+	// same order as SceneManager::SetTransformations().  The normal
+	// matrix, the inverse transpose of rotation * scale, is the
+	// rotation divided by the scale, so each of its columns is the
+	// column of the world matrix divided by the scale squared
+	void ComposeScalar(const TRANSFORM_ARRAYS& arrays, const int* pBlocks, int blockCount, float* pWorld, float* pMapped, float* pNormals)
+	{
+		for (int block = 0; block < blockCount; block++)
+		{
+			int first = pBlocks[block] * TransformStore::BLOCK_SIZE;
+			for (int i = first; i < first + TransformStore::BLOCK_SIZE; i++)
+			{
+				float sx = arrays.sinX[i], cx = arrays.cosX[i];
+				float sy = arrays.sinY[i], cy = arrays.cosY[i];
+				float sz = arrays.sinZ[i], cz = arrays.cosZ[i];
+				float scaleX = arrays.scaleX[i], scaleY = arrays.scaleY[i], scaleZ = arrays.scaleZ[i];
+
+				float matrix[16] =
+				{
+					cy * cz * scaleX, (cx * sz + sx * sy * cz) * scaleX, (sx * sz - cx * sy * cz) * scaleX, 0.0f,
+					-cy * sz * scaleY, (cx * cz - sx * sy * sz) * scaleY, (sx * cz + cx * sy * sz) * scaleY, 0.0f,
+					sy * scaleZ, -sx * cy * scaleZ, cx * cy * scaleZ, 0.0f,
+					arrays.positionX[i], arrays.positionY[i], arrays.positionZ[i], 1.0f
+				};
+				StoreMatrix(matrix, i, pWorld, pMapped);
+
+				if (NULL != pNormals)
+				{
+					float inverseX = InverseSquare(scaleX);
+					float inverseY = InverseSquare(scaleY);
+					float inverseZ = InverseSquare(scaleZ);
+					float normal[NORMAL_MATRIX_FLOATS] =
+					{
+						matrix[0] * inverseX, matrix[1] * inverseX, matrix[2] * inverseX, 0.0f,
+						matrix[4] * inverseY, matrix[5] * inverseY, matrix[6] * inverseY, 0.0f,
+						matrix[8] * inverseZ, matrix[9] * inverseZ, matrix[10] * inverseZ, 0.0f
+					};
+					memcpy(pNormals + i * NORMAL_MATRIX_FLOATS, normal, sizeof(normal));
+				}
+			}
+		}
+	}
+
+#ifdef TRANSFORM_STORE_X86
+	// one over the square of four scales, zero for a zero scale
+	TARGET_SSE
+	inline __m128 InverseSquareSSE(__m128 scale)
+	{
+		__m128 square = _mm_mul_ps(scale, scale);
+		__m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), square);
+		return(_mm_and_ps(inverse, _mm_cmpneq_ps(square, _mm_setzero_ps())));
+	}
+
+	// compose the matrices four objects at a time, transposing each
+	// column from one value per lane into one object per register
+	TARGET_SSE
+	void ComposeSSE(const TRANSFORM_ARRAYS& arrays, const int* pBlocks, int blockCount, float* pWorld, float* pMapped, float* pNormals)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		for (int block = 0; block < blockCount; block++)
+		{
+			int first = pBlocks[block] * TransformStore::BLOCK_SIZE;
+			for (int i = first; i < first + TransformStore::BLOCK_SIZE; i += 4)
+			{
+				__m128 sx = _mm_loadu_ps(arrays.sinX + i), cx = _mm_loadu_ps(arrays.cosX + i);
+				__m128 sy = _mm_loadu_ps(arrays.sinY + i), cy = _mm_loadu_ps(arrays.cosY + i);
+				__m128 sz = _mm_loadu_ps(arrays.sinZ + i), cz = _mm_loadu_ps(arrays.cosZ + i);
+				__m128 scaleX = _mm_loadu_ps(arrays.scaleX + i);
+				__m128 scaleY = _mm_loadu_ps(arrays.scaleY + i);
+				__m128 scaleZ = _mm_loadu_ps(arrays.scaleZ + i);
+				__m128 sxsy = _mm_mul_ps(sx, sy);
+				__m128 cxsy = _mm_mul_ps(cx, sy);
+
+				__m128 c0x = _mm_mul_ps(_mm_mul_ps(cy, cz), scaleX);
+				__m128 c0y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, sz), _mm_mul_ps(sxsy, cz)), scaleX);
+				__m128 c0z = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz)), scaleX);
+				__m128 c0w = zero;
+				__m128 c1x = _mm_sub_ps(zero, _mm_mul_ps(_mm_mul_ps(cy, sz), scaleY));
+				__m128 c1y = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz)), scaleY);
+				__m128 c1z = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sx, cz), _mm_mul_ps(cxsy, sz)), scaleY);
+				__m128 c1w = zero;
+				__m128 c2x = _mm_mul_ps(sy, scaleZ);
+				__m128 c2y = _mm_sub_ps(zero, _mm_mul_ps(_mm_mul_ps(sx, cy), scaleZ));
+				__m128 c2z = _mm_mul_ps(_mm_mul_ps(cx, cy), scaleZ);
+				__m128 c2w = zero;
+				__m128 c3x = _mm_loadu_ps(arrays.positionX + i);
+				__m128 c3y = _mm_loadu_ps(arrays.positionY + i);
+				__m128 c3z = _mm_loadu_ps(arrays.positionZ + i);
+				__m128 c3w = one;
+
+				// the normal columns are taken before the world columns
+				// are transposed in place
+				if (NULL != pNormals)
+				{
+					__m128 inverseX = InverseSquareSSE(scaleX);
+					__m128 inverseY = InverseSquareSSE(scaleY);
+					__m128 inverseZ = InverseSquareSSE(scaleZ);
+					__m128 normalColumns[3][4] =
+					{
+						{ _mm_mul_ps(c0x, inverseX), _mm_mul_ps(c0y, inverseX), _mm_mul_ps(c0z, inverseX), zero },
+						{ _mm_mul_ps(c1x, inverseY), _mm_mul_ps(c1y, inverseY), _mm_mul_ps(c1z, inverseY), zero },
+						{ _mm_mul_ps(c2x, inverseZ), _mm_mul_ps(c2y, inverseZ), _mm_mul_ps(c2z, inverseZ), zero }
+					};
+
+					float normals[4 * NORMAL_MATRIX_FLOATS];
+					for (int column = 0; column < 3; column++)
+					{
+						__m128* pColumn = normalColumns[column];
+						_MM_TRANSPOSE4_PS(pColumn[0], pColumn[1], pColumn[2], pColumn[3]);
+						for (int j = 0; j < 4; j++)
+						{
+							_mm_storeu_ps(normals + j * NORMAL_MATRIX_FLOATS + column * 4, pColumn[j]);
+						}
+					}
+					memcpy(pNormals + i * NORMAL_MATRIX_FLOATS, normals, sizeof(normals));
+				}
+
+				_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+				_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+				_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+				_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+				// after the transpose, register j of each column holds object i + j
+				const __m128 columns[4][4] =
+				{
+					{ c0x, c1x, c2x, c3x },
+					{ c0y, c1y, c2y, c3y },
+					{ c0z, c1z, c2z, c3z },
+					{ c0w, c1w, c2w, c3w }
+				};
+				for (int j = 0; j < 4; j++)
+				{
+					float* pDestination = pWorld + (i + j) * 16;
+					for (int column = 0; column < 4; column++)
+					{
+						_mm_storeu_ps(pDestination + column * 4, columns[j][column]);
+					}
+					if (NULL != pMapped)
+					{
+						memcpy(pMapped + (i + j) * 16, pDestination, 16 * sizeof(float));
+					}
+				}
+			}
+		}
+	}
+
+	// transpose four columns of eight objects, leaving objects 0-3 in
+	// the low halves and objects 4-7 in the high halves
+	TARGET_AVX2
+	inline void Transpose8(__m256 x, __m256 y, __m256 z, __m256 w, __m256 result[4])
+	{
+		__m256 t0 = _mm256_unpacklo_ps(x, y);
+		__m256 t1 = _mm256_unpackhi_ps(x, y);
+		__m256 t2 = _mm256_unpacklo_ps(z, w);
+		__m256 t3 = _mm256_unpackhi_ps(z, w);
+		result[0] = _mm256_shuffle_ps(t0, t2, 0x44);
+		result[1] = _mm256_shuffle_ps(t0, t2, 0xEE);
+		result[2] = _mm256_shuffle_ps(t1, t3, 0x44);
+		result[3] = _mm256_shuffle_ps(t1, t3, 0xEE);
+	}
+
+	// one over the square of eight scales, zero for a zero scale
+	TARGET_AVX2
+	inline __m256 InverseSquareAVX2(__m256 scale)
+	{
+		__m256 square = _mm256_mul_ps(scale, scale);
+		__m256 inverse = _mm256_div_ps(_mm256_set1_ps(1.0f), square);
+		return(_mm256_and_ps(inverse, _mm256_cmp_ps(square, _mm256_setzero_ps(), _CMP_NEQ_OQ)));
+	}
+
+	// compose the matrices of a whole block of eight objects at once
+	TARGET_AVX2
+	void ComposeAVX2(const TRANSFORM_ARRAYS& arrays, const int* pBlocks, int blockCount, float* pWorld, float* pMapped, float* pNormals)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		for (int block = 0; block < blockCount; block++)
+		{
+			int i = pBlocks[block] * TransformStore::BLOCK_SIZE;
+
+			__m256 sx = _mm256_loadu_ps(arrays.sinX + i), cx = _mm256_loadu_ps(arrays.cosX + i);
+			__m256 sy = _mm256_loadu_ps(arrays.sinY + i), cy = _mm256_loadu_ps(arrays.cosY + i);
+			__m256 sz = _mm256_loadu_ps(arrays.sinZ + i), cz = _mm256_loadu_ps(arrays.cosZ + i);
+			__m256 scaleX = _mm256_loadu_ps(arrays.scaleX + i);
+			__m256 scaleY = _mm256_loadu_ps(arrays.scaleY + i);
+			__m256 scaleZ = _mm256_loadu_ps(arrays.scaleZ + i);
+			__m256 sxsy = _mm256_mul_ps(sx, sy);
+			__m256 cxsy = _mm256_mul_ps(cx, sy);
+
+			__m256 c0x = _mm256_mul_ps(_mm256_mul_ps(cy, cz), scaleX);
+			__m256 c0y = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cx, sz), _mm256_mul_ps(sxsy, cz)), scaleX);
+			__m256 c0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sx, sz), _mm256_mul_ps(cxsy, cz)), scaleX);
+			__m256 c1x = _mm256_sub_ps(zero, _mm256_mul_ps(_mm256_mul_ps(cy, sz), scaleY));
+			__m256 c1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cx, cz), _mm256_mul_ps(sxsy, sz)), scaleY);
+			__m256 c1z = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sx, cz), _mm256_mul_ps(cxsy, sz)), scaleY);
+			__m256 c2x = _mm256_mul_ps(sy, scaleZ);
+			__m256 c2y = _mm256_sub_ps(zero, _mm256_mul_ps(_mm256_mul_ps(sx, cy), scaleZ));
+			__m256 c2z = _mm256_mul_ps(_mm256_mul_ps(cx, cy), scaleZ);
+
+			__m256 columns[4][4];
+			Transpose8(c0x, c0y, c0z, zero, columns[0]);
+			Transpose8(c1x, c1y, c1z, zero, columns[1]);
+			Transpose8(c2x, c2y, c2z, zero, columns[2]);
+			Transpose8(
+				_mm256_loadu_ps(arrays.positionX + i),
+				_mm256_loadu_ps(arrays.positionY + i),
+				_mm256_loadu_ps(arrays.positionZ + i),
+				one,
+				columns[3]);
+
+			for (int j = 0; j < 4; j++)
+			{
+				float* pLow = pWorld + (i + j) * 16;
+				float* pHigh = pWorld + (i + j + 4) * 16;
+				for (int column = 0; column < 4; column++)
+				{
+					_mm_storeu_ps(pLow + column * 4, _mm256_castps256_ps128(columns[column][j]));
+					_mm_storeu_ps(pHigh + column * 4, _mm256_extractf128_ps(columns[column][j], 1));
+				}
+			}
+
+			// the mapped memory is write-combined, so each block is
+			// copied as one contiguous run
+			if (NULL != pMapped)
+			{
+				memcpy(pMapped + i * 16, pWorld + i * 16, TransformStore::BLOCK_SIZE * 16 * sizeof(float));
+			}
+
+			if (NULL != pNormals)
+			{
+				__m256 inverseX = InverseSquareAVX2(scaleX);
+				__m256 inverseY = InverseSquareAVX2(scaleY);
+				__m256 inverseZ = InverseSquareAVX2(scaleZ);
+
+				__m256 normalColumns[3][4];
+				Transpose8(_mm256_mul_ps(c0x, inverseX), _mm256_mul_ps(c0y, inverseX), _mm256_mul_ps(c0z, inverseX), zero, normalColumns[0]);
+				Transpose8(_mm256_mul_ps(c1x, inverseY), _mm256_mul_ps(c1y, inverseY), _mm256_mul_ps(c1z, inverseY), zero, normalColumns[1]);
+				Transpose8(_mm256_mul_ps(c2x, inverseZ), _mm256_mul_ps(c2y, inverseZ), _mm256_mul_ps(c2z, inverseZ), zero, normalColumns[2]);
+
+				float normals[TransformStore::BLOCK_SIZE * NORMAL_MATRIX_FLOATS];
+				for (int j = 0; j < 4; j++)
+				{
+					for (int column = 0; column < 3; column++)
+					{
+						_mm_storeu_ps(normals + j * NORMAL_MATRIX_FLOATS + column * 4,
+							_mm256_castps256_ps128(normalColumns[column][j]));
+						_mm_storeu_ps(normals + (j + 4) * NORMAL_MATRIX_FLOATS + column * 4,
+							_mm256_extractf128_ps(normalColumns[column][j], 1));
+					}
+				}
+				memcpy(pNormals + i * NORMAL_MATRIX_FLOATS, normals, sizeof(normals));
+			}
+		}
+	}
+
+	// check that the processor and the operating system support AVX2
+	bool IsAVX2Supported()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return(false);
+		}
+		__cpuid(info, 1);
+		// the OS must save the AVX registers on a context switch
+		bool bOSSupport = ((info[2] & (1 << 27)) != 0) && ((info[2] & (1 << 28)) != 0) &&
+			((_xgetbv(0) & 6) == 6);
+		__cpuidex(info, 7, 0);
+		return(bOSSupport && ((info[1] & (1 << 5)) != 0));
+#else
+		__builtin_cpu_init();
+		return(__builtin_cpu_supports("avx2") != 0);
+#endif
+	}
+#endif
+}
+
+/***********************************************************
+ *  TransformStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformStore::TransformStore()
+{
+	m_objectCount = 0;
+	m_kernelType = KERNEL_SCALAR;
+	m_instanceBuffer = 0;
+	m_pMappedBuffer = NULL;
+	m_bufferCapacity = 0;
+	m_regionSize = 0;
+	m_normalOffset = 0;
+	m_region = 0;
+	for (int i = 0; i < BUFFERED_FRAMES; i++)
+	{
+		m_regionFences[i] = 0;
+	}
+	m_bUseInstanceBuffer = false;
+}
+
+/***********************************************************
+ *  ~TransformStore()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TransformStore::~TransformStore()
+{
+	DestroyInstanceBuffer();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for choosing the widest kernel the
+ *  processor supports and checking that the instance buffer
+ *  can be persistently mapped.  Without the buffer, the
+ *  matrices are only composed into the CPU copy.
+ ***********************************************************/
+bool TransformStore::Initialize()
+{
+	m_kernelType = KERNEL_SCALAR;
+#ifdef TRANSFORM_STORE_X86
+	// every x86 processor able to run OpenGL 4.6 has SSE2
+	m_kernelType = IsAVX2Supported() ? KERNEL_AVX2 : KERNEL_SSE;
+#endif
+
+	// glBufferStorage() needs OpenGL 4.4
+	m_bUseInstanceBuffer = (GLEW_VERSION_4_4 != 0);
+
+	const char* kernelNames[] = { "scalar", "SSE", "AVX2" };
+	std::cout << "INFO: composing transforms with the " << kernelNames[m_kernelType]
+		<< " kernel" << (m_bUseInstanceBuffer ? " into a mapped instance buffer" : "") << std::endl;
+
+	return(m_bUseInstanceBuffer);
+}
+
+/***********************************************************
+ *  CreateInstanceBuffer()
+ *
+ *  This method is used for creating the persistently mapped
+ *  buffer, with one region per frame in flight.  Each
+ *  region holds the world matrices followed by the normal
+ *  matrices, and both start on the storage buffer offset
+ *  alignment so they can be bound on their own.
+ ***********************************************************/
+void TransformStore::CreateInstanceBuffer(int capacity)
+{
+	DestroyInstanceBuffer();
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment <= 0)
+	{
+		alignment = 256;
+	}
+
+	GLsizeiptr normalSize = (GLsizeiptr)capacity * NORMAL_MATRIX_FLOATS * sizeof(float);
+	m_normalOffset = (GLsizeiptr)capacity * sizeof(glm::mat4);
+	m_normalOffset = ((m_normalOffset + alignment - 1) / alignment) * alignment;
+	m_regionSize = m_normalOffset + ((normalSize + alignment - 1) / alignment) * alignment;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &m_instanceBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, m_regionSize * BUFFERED_FRAMES, NULL, flags);
+	m_pMappedBuffer = (unsigned char*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_regionSize * BUFFERED_FRAMES, flags);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	if (NULL == m_pMappedBuffer)
+	{
+		std::cout << "INFO: instance buffer could not be mapped, using the model uniform instead" << std::endl;
+		DestroyInstanceBuffer();
+		m_bUseInstanceBuffer = false;
+		return;
+	}
+
+	m_bufferCapacity = capacity;
+	m_region = 0;
+}
+
+/***********************************************************
+ *  DestroyInstanceBuffer()
+ *
+ *  This method is used for freeing the instance buffer and
+ *  the fences of its regions.
+ ***********************************************************/
+void TransformStore::DestroyInstanceBuffer()
+{
+	for (int i = 0; i < BUFFERED_FRAMES; i++)
+	{
+		if (m_regionFences[i] != 0)
+		{
+			glDeleteSync(m_regionFences[i]);
+			m_regionFences[i] = 0;
+		}
+	}
+
+	if (m_instanceBuffer != 0)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+		glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+
+	m_pMappedBuffer = NULL;
+	m_bufferCapacity = 0;
+	m_regionSize = 0;
+	m_normalOffset = 0;
+}
+
+/***********************************************************
+ *  SetObjectCount()
+ *
+ *  This method is used for setting the number of objects.
+ *  The arrays are padded to whole blocks with identity
+ *  transforms, so the kernels never need a partial block.
+ ***********************************************************/
+void TransformStore::SetObjectCount(int objectCount)
+{
+	if (objectCount < 0)
+	{
+		objectCount = 0;
+	}
+
+	int paddedCount = ((objectCount + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE;
+	int blockCount = paddedCount / BLOCK_SIZE;
+
+	m_objectCount = objectCount;
+	m_scaleX.assign(paddedCount, 1.0f);
+	m_scaleY.assign(paddedCount, 1.0f);
+	m_scaleZ.assign(paddedCount, 1.0f);
+	m_rotationX.assign(paddedCount, 0.0f);
+	m_rotationY.assign(paddedCount, 0.0f);
+	m_rotationZ.assign(paddedCount, 0.0f);
+	m_sinX.assign(paddedCount, 0.0f);
+	m_cosX.assign(paddedCount, 1.0f);
+	m_sinY.assign(paddedCount, 0.0f);
+	m_cosY.assign(paddedCount, 1.0f);
+	m_sinZ.assign(paddedCount, 0.0f);
+	m_cosZ.assign(paddedCount, 1.0f);
+	m_positionX.assign(paddedCount, 0.0f);
+	m_positionY.assign(paddedCount, 0.0f);
+	m_positionZ.assign(paddedCount, 0.0f);
+	m_worldMatrices.assign(paddedCount, glm::mat4(1.0f));
+	m_blockDirty.assign(blockCount, 1);
+	m_blockPendingRegions.assign(blockCount, BUFFERED_FRAMES);
+
+	// the buffer grows by doubling, so a growing scene is not
+	// reallocated on every added object
+	if ((m_bUseInstanceBuffer == true) && (paddedCount > m_bufferCapacity))
+	{
+		int capacity = (m_bufferCapacity > 0) ? m_bufferCapacity : BLOCK_SIZE;
+		while (capacity < paddedCount)
+		{
+			capacity *= 2;
+		}
+		CreateInstanceBuffer(capacity);
+	}
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects.
+ ***********************************************************/
+int TransformStore::GetObjectCount() const
+{
+	return(m_objectCount);
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for setting the transform of an
+ *  object.  The sine and cosine of a changed rotation are
+ *  found here, so the kernels only multiply and add, and an
+ *  unchanged transform leaves its block untouched.
+ ***********************************************************/
+void TransformStore::SetTransform(
+	int objectIndex,
+	const glm::vec3& scaleXYZ,
+	const glm::vec3& rotationDegrees,
+	const glm::vec3& positionXYZ)
+{
+	if ((objectIndex < 0) || (objectIndex >= m_objectCount))
+	{
+		return;
+	}
+
+	bool bChanged = false;
+
+	if ((m_rotationX[objectIndex] != rotationDegrees.x) ||
+		(m_rotationY[objectIndex] != rotationDegrees.y) ||
+		(m_rotationZ[objectIndex] != rotationDegrees.z))
+	{
+		m_rotationX[objectIndex] = rotationDegrees.x;
+		m_rotationY[objectIndex] = rotationDegrees.y;
+		m_rotationZ[objectIndex] = rotationDegrees.z;
+		m_sinX[objectIndex] = std::sin(glm::radians(rotationDegrees.x));
+		m_cosX[objectIndex] = std::cos(glm::radians(rotationDegrees.x));
+		m_sinY[objectIndex] = std::sin(glm::radians(rotationDegrees.y));
+		m_cosY[objectIndex] = std::cos(glm::radians(rotationDegrees.y));
+		m_sinZ[objectIndex] = std::sin(glm::radians(rotationDegrees.z));
+		m_cosZ[objectIndex] = std::cos(glm::radians(rotationDegrees.z));
+		bChanged = true;
+	}
+
+	if ((m_scaleX[objectIndex] != scaleXYZ.x) ||
+		(m_scaleY[objectIndex] != scaleXYZ.y) ||
+		(m_scaleZ[objectIndex] != scaleXYZ.z) ||
+		(m_positionX[objectIndex] != positionXYZ.x) ||
+		(m_positionY[objectIndex] != positionXYZ.y) ||
+		(m_positionZ[objectIndex] != positionXYZ.z))
+	{
+		m_scaleX[objectIndex] = scaleXYZ.x;
+		m_scaleY[objectIndex] = scaleXYZ.y;
+		m_scaleZ[objectIndex] = scaleXYZ.z;
+		m_positionX[objectIndex] = positionXYZ.x;
+		m_positionY[objectIndex] = positionXYZ.y;
+		m_positionZ[objectIndex] = positionXYZ.z;
+		bChanged = true;
+	}
+
+	if (bChanged == true)
+	{
+		int block = objectIndex / BLOCK_SIZE;
+		m_blockDirty[block] = 1;
+		m_blockPendingRegions[block] = BUFFERED_FRAMES;
+	}
+}
+
+/***********************************************************
+ *  RunKernel()
+ *
+ *  This method is used for composing the passed in blocks
+ *  with the kernel chosen at startup.
+ ***********************************************************/
+void TransformStore::RunKernel(const int* pBlocks, int blockCount, float* pMappedMatrices, float* pMappedNormals)
+{
+	if (blockCount == 0)
+	{
+		return;
+	}
+
+	TRANSFORM_ARRAYS arrays;
+	arrays.scaleX = &m_scaleX[0];
+	arrays.scaleY = &m_scaleY[0];
+	arrays.scaleZ = &m_scaleZ[0];
+	arrays.sinX = &m_sinX[0];
+	arrays.cosX = &m_cosX[0];
+	arrays.sinY = &m_sinY[0];
+	arrays.cosY = &m_cosY[0];
+	arrays.sinZ = &m_sinZ[0];
+	arrays.cosZ = &m_cosZ[0];
+	arrays.positionX = &m_positionX[0];
+	arrays.positionY = &m_positionY[0];
+	arrays.positionZ = &m_positionZ[0];
+
+	float* pWorld = &m_worldMatrices[0][0][0];
+
+	switch (m_kernelType)
+	{
+#ifdef TRANSFORM_STORE_X86
+	case KERNEL_AVX2:
+		ComposeAVX2(arrays, pBlocks, blockCount, pWorld, pMappedMatrices, pMappedNormals);
+		break;
+	case KERNEL_SSE:
+		ComposeSSE(arrays, pBlocks, blockCount, pWorld, pMappedMatrices, pMappedNormals);
+		break;
+#endif
+	default:
+		ComposeScalar(arrays, pBlocks, blockCount, pWorld, pMappedMatrices, pMappedNormals);
+		break;
+	}
+}
+
+/***********************************************************
+ *  ComposeTransforms()
+ *
+ *  This method is used for composing the world and normal
+ *  matrices of the changed objects and binding them from
+ *  this frame's region of the instance buffer to the passed
+ *  in storage bindings.  A changed block is written to each
+ *  region in turn, so every region is up to date once it is
+ *  used again.  The number of composed blocks is returned.
+ ***********************************************************/
+int TransformStore::ComposeTransforms(GLuint binding, GLuint normalBinding, JobSystem* pJobSystem)
+{
+	std::vector<int>& blocks = m_composeBlocks;
+	float* pMappedMatrices = NULL;
+	float* pMappedNormals = NULL;
+
+	blocks.clear();
+
+	if (m_pMappedBuffer != NULL)
+	{
+		// wait until the GPU has finished the frame that last read
+		// this region, which is normally long done
+		if (m_regionFences[m_region] != 0)
+		{
+			glClientWaitSync(m_regionFences[m_region], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+			glDeleteSync(m_regionFences[m_region]);
+			m_regionFences[m_region] = 0;
+		}
+		pMappedMatrices = (float*)(m_pMappedBuffer + m_region * m_regionSize);
+		pMappedNormals = (float*)(m_pMappedBuffer + m_region * m_regionSize + m_normalOffset);
+	}
+
+	for (size_t block = 0; block < m_blockDirty.size(); block++)
+	{
+		bool bPending = (NULL != pMappedMatrices) && (m_blockPendingRegions[block] > 0);
+		if ((m_blockDirty[block] != 0) || (bPending == true))
+		{
+			blocks.push_back((int)block);
+			m_blockDirty[block] = 0;
+			if (m_blockPendingRegions[block] > 0)
+			{
+				m_blockPendingRegions[block]--;
+			}
+		}
+	}
+
+	// each block writes its own matrices, so the chunks of the list
+	// can be composed on different threads
+	if ((NULL != pJobSystem) && ((int)blocks.size() > JOB_BLOCK_COUNT))
+	{
+		const int* pBlocks = &blocks[0];
+		pJobSystem->ParallelFor((int)blocks.size(), JOB_BLOCK_COUNT,
+			[this, pBlocks, pMappedMatrices, pMappedNormals](int begin, int end)
+		{
+			RunKernel(pBlocks + begin, end - begin, pMappedMatrices, pMappedNormals);
+		});
+	}
+	else if (blocks.size() > 0)
+	{
+		RunKernel(&blocks[0], (int)blocks.size(), pMappedMatrices, pMappedNormals);
+	}
+
+	if (m_pMappedBuffer != NULL)
+	{
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, m_instanceBuffer,
+			m_region * m_regionSize, m_normalOffset);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, normalBinding, m_instanceBuffer,
+			m_region * m_regionSize + m_normalOffset, m_regionSize - m_normalOffset);
+	}
+
+	return((int)blocks.size());
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the region read by the
+ *  frame that was just drawn and moving on to the next.
+ ***********************************************************/
+void TransformStore::EndFrame()
+{
+	if (m_pMappedBuffer == NULL)
+	{
+		return;
+	}
+
+	if (m_regionFences[m_region] != 0)
+	{
+		glDeleteSync(m_regionFences[m_region]);
+	}
+	m_regionFences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_region = (m_region + 1) % BUFFERED_FRAMES;
+}
+
+/***********************************************************
+ *  GetWorldMatrix()
+ *
+ *  This method is used for getting the composed world
+ *  matrix of an object from the CPU copy.
+ ***********************************************************/
+const glm::mat4& TransformStore::GetWorldMatrix(int objectIndex) const
+{
+	static const glm::mat4 identity(1.0f);
+	if ((objectIndex < 0) || (objectIndex >= m_objectCount))
+	{
+		return(identity);
+	}
+
+	return(m_worldMatrices[objectIndex]);
+}
+
+/***********************************************************
+ *  HasInstanceBuffer()
+ *
+ *  This method is used for checking whether the shaders can
+ *  read the world matrices from the instance buffer.
+ ***********************************************************/
+bool TransformStore::HasInstanceBuffer() const
+{
+	return(m_pMappedBuffer != NULL);
+}
+
+/***********************************************************
+ *  GetKernelType()
+ *
+ *  This method is used for getting the kernel chosen for
+ *  the processor.
+ ***********************************************************/
+TransformStore::KERNEL_TYPE TransformStore::GetKernelType() const
+{
+	return(m_kernelType);
+}
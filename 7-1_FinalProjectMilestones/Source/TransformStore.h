@@ -0,0 +1,150 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.h
+// ============
+// keep the object transforms in structure-of-arrays form and compose the
+// world matrices of the changed objects into a mapped instance buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  TransformStore
+ *
+ *  This class contains the scale, rotation and position of
+ *  every object in separate arrays, so the world matrices
+ *  of eight objects are composed at once by the AVX2 kernel,
+ *  or four by the SSE kernel, with a scalar kernel for the
+ *  other processors.  Only the blocks of objects that
+ *  changed are composed.  The matrices are written into a
+ *  CPU copy and straight into a persistently mapped shader
+ *  storage buffer, together with the normal matrices, so
+ *  the vertex shader never inverts a matrix.  The buffer is
+ *  split into one region per frame in flight so the GPU
+ *  never reads a region that is being written.
+ ***********************************************************/
+class TransformStore
+{
+public:
+	// constructor
+	TransformStore();
+	// destructor
+	~TransformStore();
+
+	// objects composed together by the widest kernel
+	static const int BLOCK_SIZE = 8;
+	// blocks composed by one job of the job system
+	static const int JOB_BLOCK_COUNT = 32;
+	// regions of the instance buffer, one per frame in flight
+	static const int BUFFERED_FRAMES = 3;
+
+	// kernel chosen for the processor at startup
+	enum KERNEL_TYPE
+	{
+		KERNEL_SCALAR = 0,
+		KERNEL_SSE,
+		KERNEL_AVX2
+	};
+
+	// inputs of the kernels, one float per object in each array
+	struct TRANSFORM_ARRAYS
+	{
+		const float* scaleX;
+		const float* scaleY;
+		const float* scaleZ;
+		const float* sinX;
+		const float* cosX;
+		const float* sinY;
+		const float* cosY;
+		const float* sinZ;
+		const float* cosZ;
+		const float* positionX;
+		const float* positionY;
+		const float* positionZ;
+	};
+
+private:
+	// transform arrays, padded to a whole number of blocks
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	// rotation in degrees, kept to detect unchanged rotations
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	// sine and cosine of the rotation, read by the kernels
+	std::vector<float> m_sinX;
+	std::vector<float> m_cosX;
+	std::vector<float> m_sinY;
+	std::vector<float> m_cosY;
+	std::vector<float> m_sinZ;
+	std::vector<float> m_cosZ;
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	// composed world matrices
+	std::vector<glm::mat4> m_worldMatrices;
+	// number of buffer regions each block must still be written to,
+	// and whether the CPU copy of the block is out of date
+	std::vector<unsigned char> m_blockPendingRegions;
+	std::vector<unsigned char> m_blockDirty;
+	// blocks composed this frame, kept so its storage is reused
+	std::vector<int> m_composeBlocks;
+	int m_objectCount;
+	KERNEL_TYPE m_kernelType;
+
+	// persistently mapped buffer holding BUFFERED_FRAMES regions
+	GLuint m_instanceBuffer;
+	unsigned char* m_pMappedBuffer;
+	// capacity and size of one region, and the offset of the
+	// normal matrices in it
+	int m_bufferCapacity;
+	GLsizeiptr m_regionSize;
+	GLsizeiptr m_normalOffset;
+	int m_region;
+	GLsync m_regionFences[BUFFERED_FRAMES];
+	bool m_bUseInstanceBuffer;
+
+	// create the instance buffer for the passed in object count
+	void CreateInstanceBuffer(int capacity);
+	// free the instance buffer and its fences
+	void DestroyInstanceBuffer();
+	// compose the passed in blocks with the chosen kernel
+	void RunKernel(const int* pBlocks, int blockCount, float* pMappedMatrices, float* pMappedNormals);
+
+public:
+	// choose the kernel and create the instance buffer
+	bool Initialize();
+
+	// set the number of objects, which become identity transforms
+	void SetObjectCount(int objectCount);
+	int GetObjectCount() const;
+	// set the transform of an object, only marking it changed
+	// when a value differs
+	void SetTransform(
+		int objectIndex,
+		const glm::vec3& scaleXYZ,
+		const glm::vec3& rotationDegrees,
+		const glm::vec3& positionXYZ);
+
+	// compose the changed objects and bind the world and normal
+	// matrices of this frame's region, split over the workers of
+	// the job system when one is passed
+	int ComposeTransforms(GLuint binding, GLuint normalBinding, JobSystem* pJobSystem = NULL);
+	// fence the region used by the frame that was just drawn
+	void EndFrame();
+
+	// get the composed world matrix of an object
+	const glm::mat4& GetWorldMatrix(int objectIndex) const;
+	// true when the shaders can read the matrices from the buffer
+	bool HasInstanceBuffer() const;
+	KERNEL_TYPE GetKernelType() const;
+};
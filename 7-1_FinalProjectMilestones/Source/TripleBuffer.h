@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// hand the latest copy of a value from one thread to another without locks
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This class contains three copies of a value, one for the
+ *  writing thread, one for the reading thread and one in
+ *  between.  Publishing swaps the written copy with the one
+ *  in between, and the reader swaps its copy with the one
+ *  in between when a newer one was published, so neither
+ *  thread ever waits for the other.  The reader always gets
+ *  the latest complete copy, and copies it missed are
+ *  simply overwritten.
+ ***********************************************************/
+template <typename TYPE>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer()
+	{
+		m_writeIndex = 0;
+		m_middleIndex = 1;
+		m_readIndex = 2;
+	}
+
+	// copy written by the writing thread, sent by Publish()
+	TYPE& GetWriteBuffer()
+	{
+		return(m_buffers[m_writeIndex]);
+	}
+
+	// hand the written copy to the reader, called by the writing
+	// thread after it finished the copy
+	void Publish()
+	{
+		int previous = m_middleIndex.exchange(m_writeIndex | NEW_DATA_FLAG, std::memory_order_acq_rel);
+		m_writeIndex = previous & INDEX_MASK;
+	}
+
+	// take the latest published copy, called by the reading thread,
+	// false when nothing was published since the last call
+	bool Update()
+	{
+		if ((m_middleIndex.load(std::memory_order_relaxed) & NEW_DATA_FLAG) == 0)
+		{
+			return(false);
+		}
+
+		// only the reader clears the flag, so the copy is still new
+		int previous = m_middleIndex.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & INDEX_MASK;
+
+		return(true);
+	}
+
+	// copy last taken by Update(), owned by the reading thread
+	const TYPE& GetReadBuffer() const
+	{
+		return(m_buffers[m_readIndex]);
+	}
+
+private:
+	// the index in between carries a flag for a copy not read yet
+	static const int INDEX_MASK = 3;
+	static const int NEW_DATA_FLAG = 4;
+
+	TYPE m_buffers[3];
+	// copy owned by each thread and the one in between
+	int m_writeIndex;
+	std::atomic<int> m_middleIndex;
+	int m_readIndex;
+};
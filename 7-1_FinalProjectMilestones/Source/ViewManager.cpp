@@ -14,14 +14,27 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <iostream>
+#include <cstring>
+
 // declaration of the global variables and defines
 namespace
 {
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
+	// half the height of the orthographic view volume
+	const float ORTHOGRAPHIC_HALF_HEIGHT = 25.0f;
+	// part of the window width kept by the camera view when the
+	// top and front views are shown in the column beside it
+	const float LAYOUT_CAMERA_WIDTH = 2.0f / 3.0f;
+	// half the height of the top and front views, which frame
+	// the scene around the origin
+	const float LAYOUT_HALF_HEIGHT = 10.0f;
+	const float LAYOUT_DISTANCE = 50.0f;
 	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
+	const char* g_ViewProjectionName = "viewProjections[0]";
+	const char* g_ViewPositionName = "viewPositions[0]";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -32,9 +45,23 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	// mouse movement and scrolling since the last camera tick,
+	// applied by the tick so the camera step stays deterministic
+	float gMouseXOffset = 0.0f;
+	float gMouseYOffset = 0.0f;
+	float gScrollOffset = 0.0f;
+
+	// size of the framebuffer of the window in pixels, which
+	// differs from the window size on high-DPI displays
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
+
+	// true when two camera states give the same view
+	bool IsSameCameraState(const ViewManager::CAMERA_STATE& a, const ViewManager::CAMERA_STATE& b)
+	{
+		return((a.position == b.position) && (a.front == b.front) && (a.up == b.up) &&
+			(a.zoom == b.zoom) && (a.bOrthographic == b.bOrthographic));
+	}
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
@@ -52,6 +79,34 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_sceneViewCount = 0;
+	m_viewportWidth = WINDOW_WIDTH;
+	m_viewportHeight = WINDOW_HEIGHT;
+	m_cachedViews[0].view = glm::mat4(1.0f);
+	m_cachedViews[0].projection = glm::mat4(1.0f);
+	m_cachedViews[0].viewport = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	m_cachedViewCount = 1;
+	m_projectionState = CAMERA_STATE();
+	m_bProjectionLayout = false;
+	m_projectionWidth = 0;
+	m_projectionHeight = 0;
+	m_bLayoutViews = false;
+	m_bLayoutKeyDown = false;
+	m_screenshotCount = 0;
+	m_bCaptureSequence = false;
+	m_bScreenshotKeyDown = false;
+	m_bSequenceKeyDown = false;
+	m_frameScreenshotCount = 0;
+	m_bFrameCaptureSequence = false;
+	m_bShowStats = false;
+	m_bStatsKeyDown = false;
+	m_bFrameShowStats = false;
+	m_tick = 0;
+	m_bRecording = false;
+	m_bReplaying = false;
+	m_replayTick = 0;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	//g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -68,6 +123,9 @@ ViewManager::ViewManager(
 	// Defaults for movement speed and sensitivity
 	g_pCamera->MovementSpeed = 1.0f;
 	g_pCamera->MouseSensitivity = 0.01f;
+
+	// the render thread starts from the initial camera
+	PublishSnapshot(GetCameraState(), 0.0, 0.0f);
 }
 
 /***********************************************************
@@ -77,6 +135,9 @@ ViewManager::ViewManager(
  ***********************************************************/
 ViewManager::~ViewManager()
 {
+	// a recording still running is saved
+	StopCameraRecording();
+
 	// free up allocated memory
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
@@ -119,12 +180,22 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// this callback is used to recieve scroll wheel events
 	glfwSetScrollCallback(window, &ViewManager::Scroll_Callback);
 
+	// this callback is used to receive the new size of the framebuffer
+	// when the window is resized or moved to another monitor
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwGetFramebufferSize(window, &gFramebufferWidth, &gFramebufferHeight);
+	m_viewportWidth = gFramebufferWidth;
+	m_viewportHeight = gFramebufferHeight;
+
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	m_pWindow = window;
 
+	// the first frame uses the real framebuffer size
+	PublishSnapshot(GetCameraState(), 0.0, 0.0f);
+
 	return(window);
 }
 
@@ -152,8 +223,22 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	//move the camera to the offsets accordingly
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	//move the camera to the offsets accordingly at the next tick
+	gMouseXOffset += xOffset;
+	gMouseYOffset += yOffset;
+}
+
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the size of the framebuffer of the window changes.  The
+ *  projection is rebuilt by the next camera tick.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
 }
 
 /***********************************************************
@@ -163,41 +248,35 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  ***********************************************************/
 void ViewManager::Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset) {
 
-
-	//I had to make changes to this function
-	//Instead of updating the value directly, I needed to make copies to compute value comparisons.
-	//I had issues with the system letting negative values pass through, this only occured when user scrolled quickly downward.
-
-	
-	// will take update the movement speed and sensitivity, if the value is less than zero than the update is ignored
-	// making copies of the values
-	double movement = g_pCamera->MovementSpeed;
-	double sens = g_pCamera->MouseSensitivity;
-
-	//updating values
-	movement += yOffset;
-	sens += yOffset / 100;
-
-	// checking validity
-	if (movement < 0 || sens < 0) {
-		movement = 0;
-		sens = 0;
-	}
-
-	// making changes
-	g_pCamera->MovementSpeed = movement;
-	g_pCamera->MouseSensitivity = sens;
-
+	// the scrolling is applied to the camera at the next tick
+	gScrollOffset += (float)yOffset;
 }
 
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
  *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  that may be waiting in the event queue.  The keys held
+ *  down are returned as the input of the next camera tick,
+ *  together with the mouse movement since the last tick.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+CameraRecording::CAMERA_INPUT ViewManager::ProcessKeyboardEvents()
 {
+	CameraRecording::CAMERA_INPUT input;
+	input.keys = 0;
+	input.mouseX = gMouseXOffset;
+	input.mouseY = gMouseYOffset;
+	input.scroll = gScrollOffset;
+	gMouseXOffset = 0.0f;
+	gMouseYOffset = 0.0f;
+	gScrollOffset = 0.0f;
+
+	// there is no window before CreateDisplayWindow()
+	if (NULL == m_pWindow)
+	{
+		return(input);
+	}
+
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
@@ -206,61 +285,421 @@ void ViewManager::ProcessKeyboardEvents()
 
 	// process camera zoom
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS) {
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		input.keys |= CameraRecording::INPUT_FORWARD;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS) {
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		input.keys |= CameraRecording::INPUT_BACKWARD;
 	}
 
 	// process camera panning
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS) {
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		input.keys |= CameraRecording::INPUT_LEFT;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS) {
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		input.keys |= CameraRecording::INPUT_RIGHT;
 	}
 
 	// proccess camera veritcal
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS) {
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		input.keys |= CameraRecording::INPUT_DOWN;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS) {
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		input.keys |= CameraRecording::INPUT_UP;
 	}
 
 	// proccess viewing mode
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS) {
-		bOrthographicProjection = false;
+		input.keys |= CameraRecording::INPUT_PERSPECTIVE;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS) {
+		input.keys |= CameraRecording::INPUT_ORTHOGRAPHIC;
+	}
+
+	// toggle the layout views once per press, which does not move
+	// the camera and so is not part of the recorded input
+	bool bLayoutKeyDown = (glfwGetKey(m_pWindow, GLFW_KEY_V) == GLFW_PRESS);
+	if ((bLayoutKeyDown == true) && (m_bLayoutKeyDown == false)) {
+		m_bLayoutViews = !m_bLayoutViews;
+	}
+	m_bLayoutKeyDown = bLayoutKeyDown;
+
+	// the capture keys work the same way, once per press
+	bool bScreenshotKeyDown = (glfwGetKey(m_pWindow, GLFW_KEY_F12) == GLFW_PRESS);
+	if ((bScreenshotKeyDown == true) && (m_bScreenshotKeyDown == false)) {
+		m_screenshotCount++;
+	}
+	m_bScreenshotKeyDown = bScreenshotKeyDown;
+
+	bool bSequenceKeyDown = (glfwGetKey(m_pWindow, GLFW_KEY_F10) == GLFW_PRESS);
+	if ((bSequenceKeyDown == true) && (m_bSequenceKeyDown == false)) {
+		m_bCaptureSequence = !m_bCaptureSequence;
+	}
+	m_bSequenceKeyDown = bSequenceKeyDown;
+
+	// and so does the key toggling the statistics overlay
+	bool bStatsKeyDown = (glfwGetKey(m_pWindow, GLFW_KEY_F1) == GLFW_PRESS);
+	if ((bStatsKeyDown == true) && (m_bStatsKeyDown == false)) {
+		m_bShowStats = !m_bShowStats;
+	}
+	m_bStatsKeyDown = bStatsKeyDown;
+
+	return(input);
+}
+
+/***********************************************************
+ *  ApplyCameraInput()
+ *
+ *  This method is used for moving the camera by the input
+ *  of one tick.  Nothing but the input and the tick length
+ *  is used, so a replayed tick moves the camera the same
+ *  way as the recorded one.
+ ***********************************************************/
+void ViewManager::ApplyCameraInput(const CameraRecording::CAMERA_INPUT& input, float deltaTime)
+{
+	if (input.keys & CameraRecording::INPUT_FORWARD) {
+		g_pCamera->ProcessKeyboard(FORWARD, deltaTime);
+	}
+	if (input.keys & CameraRecording::INPUT_BACKWARD) {
+		g_pCamera->ProcessKeyboard(BACKWARD, deltaTime);
+	}
+	if (input.keys & CameraRecording::INPUT_LEFT) {
+		g_pCamera->ProcessKeyboard(LEFT, deltaTime);
+	}
+	if (input.keys & CameraRecording::INPUT_RIGHT) {
+		g_pCamera->ProcessKeyboard(RIGHT, deltaTime);
+	}
+	if (input.keys & CameraRecording::INPUT_DOWN) {
+		g_pCamera->ProcessKeyboard(DOWN, deltaTime);
+	}
+	if (input.keys & CameraRecording::INPUT_UP) {
+		g_pCamera->ProcessKeyboard(UP, deltaTime);
+	}
+	if (input.keys & CameraRecording::INPUT_PERSPECTIVE) {
+		bOrthographicProjection = false;
+	}
+	if (input.keys & CameraRecording::INPUT_ORTHOGRAPHIC) {
 		bOrthographicProjection = true;
 	}
+
+	if ((input.mouseX != 0.0f) || (input.mouseY != 0.0f))
+	{
+		g_pCamera->ProcessMouseMovement(input.mouseX, input.mouseY);
+	}
+
+	if (input.scroll != 0.0f)
+	{
+		//I had to make changes to this function
+		//Instead of updating the value directly, I needed to make copies to compute value comparisons.
+		//I had issues with the system letting negative values pass through, this only occured when user scrolled quickly downward.
+
+		// will take update the movement speed and sensitivity, if the value is less than zero than the update is ignored
+		// making copies of the values
+		double movement = g_pCamera->MovementSpeed;
+		double sens = g_pCamera->MouseSensitivity;
+
+		//updating values
+		movement += input.scroll;
+		sens += input.scroll / 100;
+
+		// checking validity
+		if (movement < 0 || sens < 0) {
+			movement = 0;
+			sens = 0;
+		}
+
+		// making changes
+		g_pCamera->MovementSpeed = movement;
+		g_pCamera->MouseSensitivity = sens;
+	}
 }
 
+/***********************************************************
+ *  GetCameraState()
+ *
+ *  This method is used for getting the current values of
+ *  the camera, which are handed to the render thread.
+ ***********************************************************/
+ViewManager::CAMERA_STATE ViewManager::GetCameraState() const
+{
+	CAMERA_STATE state;
+	state.position = g_pCamera->Position;
+	state.front = g_pCamera->Front;
+	state.up = g_pCamera->Up;
+	state.zoom = g_pCamera->Zoom;
+	state.bOrthographic = bOrthographicProjection;
+
+	return(state);
+}
 
 /***********************************************************
  *  UpdateProjectionMatrix
  *
  *  This method is called for updating the projection matrix
- *  'p' for perspective 'o' for orthogonal
+ *  'p' for perspective 'o' for orthogonal.  The matrices of
+ *  the views are only rebuilt when the zoom, the mode, the
+ *  layout or the framebuffer size changed since the last
+ *  time, and true is returned when they were.  With the
+ *  layout views the camera keeps the left part of the
+ *  window, and fixed orthographic views from the top and
+ *  the front share the column to its right.
  ***********************************************************/
-void ViewManager::UpdateProjectionMatrix() {
-	glm::mat4 projection;
+bool ViewManager::UpdateProjectionMatrix(const CAMERA_STATE& state) {
+
+	// a minimized window has no size, so the last projection is kept
+	if ((gFramebufferWidth <= 0) || (gFramebufferHeight <= 0)) {
+		return(false);
+	}
+
+	if ((m_projectionWidth == gFramebufferWidth) && (m_projectionHeight == gFramebufferHeight) &&
+		(m_projectionState.zoom == state.zoom) && (m_projectionState.bOrthographic == state.bOrthographic) &&
+		(m_bProjectionLayout == m_bLayoutViews)) {
+		return(false);
+	}
+
+	float cameraWidth = (m_bLayoutViews == true) ? LAYOUT_CAMERA_WIDTH : 1.0f;
+	float aspectRatio = (cameraWidth * gFramebufferWidth) / (float)gFramebufferHeight;
+
+	// the view matrix of the camera is set on the render thread
+	SCENE_VIEW& camera = m_cachedViews[0];
+	camera.view = glm::mat4(1.0f);
+	camera.viewport = glm::vec4(0.0f, 0.0f, cameraWidth, 1.0f);
 
 	//If the view is Ortho
-	if (bOrthographicProjection) {
-		projection = glm::ortho(-25.0f, 25.0f, -25.0f, 25.0f, -250.0f, 250.0f);
+	if (state.bOrthographic) {
+		float halfWidth = ORTHOGRAPHIC_HALF_HEIGHT * aspectRatio;
+		camera.projection = glm::ortho(-halfWidth, halfWidth, -ORTHOGRAPHIC_HALF_HEIGHT, ORTHOGRAPHIC_HALF_HEIGHT, -250.0f, 250.0f);
 	}
 	// else set it to projeciton
 	else  {
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+		camera.projection = glm::perspective(glm::radians(state.zoom), aspectRatio, 0.1f, 100.0f);
+	}
+	m_cachedViewCount = 1;
+
+	if (m_bLayoutViews == true) {
+		float columnWidth = 1.0f - LAYOUT_CAMERA_WIDTH;
+		float halfWidth = LAYOUT_HALF_HEIGHT * (columnWidth * gFramebufferWidth) / (0.5f * gFramebufferHeight);
+		glm::mat4 projection = glm::ortho(-halfWidth, halfWidth, -LAYOUT_HALF_HEIGHT, LAYOUT_HALF_HEIGHT, -250.0f, 250.0f);
+
+		// the top view looks down with the back of the scene up
+		SCENE_VIEW& top = m_cachedViews[m_cachedViewCount++];
+		top.view = glm::lookAt(glm::vec3(0.0f, LAYOUT_DISTANCE, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+		top.projection = projection;
+		top.viewport = glm::vec4(LAYOUT_CAMERA_WIDTH, 0.5f, columnWidth, 0.5f);
+
+		SCENE_VIEW& front = m_cachedViews[m_cachedViewCount++];
+		front.view = glm::lookAt(glm::vec3(0.0f, 0.0f, LAYOUT_DISTANCE), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		front.projection = projection;
+		front.viewport = glm::vec4(LAYOUT_CAMERA_WIDTH, 0.0f, columnWidth, 0.5f);
+	}
+
+	m_projectionState = state;
+	m_bProjectionLayout = m_bLayoutViews;
+	m_projectionWidth = gFramebufferWidth;
+	m_projectionHeight = gFramebufferHeight;
+
+	return(true);
+}
+
+/***********************************************************
+ *  PublishSnapshot()
+ *
+ *  This method is used for handing the camera of the
+ *  passed in previous tick and of the current tick to the
+ *  render thread, with the views for the current layout and
+ *  framebuffer size.  True is returned when the views had
+ *  to be rebuilt.
+ ***********************************************************/
+bool ViewManager::PublishSnapshot(const CAMERA_STATE& previous, double tickTime, float tickLength)
+{
+	VIEW_SNAPSHOT& snapshot = m_snapshots.GetWriteBuffer();
+	snapshot.previous = previous;
+	snapshot.current = GetCameraState();
+	bool bProjectionChanged = UpdateProjectionMatrix(snapshot.current);
+	for (int i = 0; i < m_cachedViewCount; i++)
+	{
+		snapshot.views[i] = m_cachedViews[i];
+	}
+	snapshot.viewCount = m_cachedViewCount;
+	snapshot.width = m_projectionWidth;
+	snapshot.height = m_projectionHeight;
+	snapshot.tickTime = tickTime;
+	snapshot.tickLength = tickLength;
+	snapshot.tick = m_tick;
+	snapshot.screenshotCount = m_screenshotCount;
+	snapshot.bCaptureSequence = m_bCaptureSequence;
+	snapshot.bShowStats = m_bShowStats;
+	m_snapshots.Publish();
+
+	return(bProjectionChanged);
+}
+
+/***********************************************************
+ *  UpdateCamera()
+ *
+ *  This method is used for moving the camera by one fixed
+ *  tick on the thread that handles the input, and
+ *  publishing the camera of this and the previous tick.
+ *  The render thread picks them up without either thread
+ *  waiting.  While a recording is replayed, its ticks are
+ *  used instead of the live input.  True is returned when
+ *  the camera moved, the projection changed, a capture
+ *  was asked for or the statistics overlay was toggled, so
+ *  a still view needs no new frame.
+ ***********************************************************/
+bool ViewManager::UpdateCamera(float deltaTime, double tickTime)
+{
+	unsigned int screenshotCount = m_screenshotCount;
+	bool bCaptureSequence = m_bCaptureSequence;
+	bool bShowStats = m_bShowStats;
+
+	// the events are still processed, so the escape key works
+	CameraRecording::CAMERA_INPUT input = ProcessKeyboardEvents();
+	float stepLength = deltaTime;
+
+	if (m_bReplaying == true)
+	{
+		if (m_replayTick < m_recording.GetInputCount())
+		{
+			// the ticks are applied with their recorded length, so
+			// the path is the same when the tick rate was changed
+			input = m_recording.GetInput(m_replayTick++);
+			stepLength = m_recording.GetTickLength();
+		}
+		else
+		{
+			std::cout << "INFO: camera replay finished after " << m_replayTick << " ticks" << std::endl;
+			memset(&input, 0, sizeof(input));
+			m_bReplaying = false;
+			if (NULL != m_pWindow)
+			{
+				glfwSetWindowShouldClose(m_pWindow, true);
+			}
+		}
+	}
+	else if (m_bRecording == true)
+	{
+		m_recording.AddInput(input);
+	}
+
+	CAMERA_STATE previous = GetCameraState();
+	ApplyCameraInput(input, stepLength);
+	m_tick++;
+	bool bProjectionChanged = PublishSnapshot(previous, tickTime, deltaTime);
+	bool bCaptureChanged = (screenshotCount != m_screenshotCount) || (bCaptureSequence != m_bCaptureSequence);
+	bool bStatsChanged = (bShowStats != m_bShowStats);
+
+	return((bProjectionChanged == true) || (bCaptureChanged == true) || (bStatsChanged == true) ||
+		(IsSameCameraState(previous, GetCameraState()) == false));
+}
+
+/***********************************************************
+ *  StartCameraRecording()
+ *
+ *  This method is used for recording the input of every
+ *  following tick, which is saved to the passed in file by
+ *  StopCameraRecording().  The recording starts from the
+ *  initial camera, so it is started before the first tick,
+ *  with the length of the ticks that will be recorded.
+ ***********************************************************/
+bool ViewManager::StartCameraRecording(const char* filename, float tickLength)
+{
+	if ((NULL == filename) || (m_bReplaying == true))
+	{
+		return(false);
+	}
+
+	m_recording.Clear(tickLength);
+	m_recordingFilename = filename;
+	m_bRecording = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopCameraRecording()
+ *
+ *  This method is used for stopping the recording and
+ *  saving the recorded ticks.
+ ***********************************************************/
+void ViewManager::StopCameraRecording()
+{
+	if (m_bRecording == false)
+	{
+		return;
 	}
 
-	//if the shaderManager is valid
-	if (m_pShaderManager) {
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+	m_bRecording = false;
+	m_recording.Save(m_recordingFilename.c_str());
+}
+
+/***********************************************************
+ *  StartCameraReplay()
+ *
+ *  This method is used for moving the camera by the ticks
+ *  of a recording file instead of the live input.  The
+ *  replay starts from the initial camera, like the
+ *  recording did.
+ ***********************************************************/
+bool ViewManager::StartCameraReplay(const char* filename)
+{
+	if ((NULL == filename) || (m_bRecording == true) ||
+		(m_recording.Load(filename) == false))
+	{
+		return(false);
 	}
+
+	m_bReplaying = true;
+	m_replayTick = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsReplaying()
+ *
+ *  This method is used for checking whether the camera is
+ *  moved by a recording, which has to run in real time.
+ ***********************************************************/
+bool ViewManager::IsReplaying() const
+{
+	return(m_bReplaying);
+}
+
+/***********************************************************
+ *  SetLayoutViews()
+ *
+ *  This method is used for showing fixed orthographic views
+ *  from the top and the front beside the camera view, which
+ *  are drawn from the same culled draws as the camera.  It
+ *  takes effect with the next camera tick.
+ ***********************************************************/
+void ViewManager::SetLayoutViews(bool bLayoutViews)
+{
+	m_bLayoutViews = bLayoutViews;
+}
+
+/***********************************************************
+ *  SetCaptureSequence()
+ *
+ *  This method is used for starting or stopping the capture
+ *  of every drawn frame into an image sequence.  It takes
+ *  effect with the next camera tick.
+ ***********************************************************/
+void ViewManager::SetCaptureSequence(bool bCaptureSequence)
+{
+	m_bCaptureSequence = bCaptureSequence;
+}
+
+/***********************************************************
+ *  SetShowStats()
+ *
+ *  This method is used for showing or hiding the overlay
+ *  with the counts and times of the recent frames.  It
+ *  takes effect with the next camera tick.
+ ***********************************************************/
+void ViewManager::SetShowStats(bool bShowStats)
+{
+	m_bShowStats = bShowStats;
 }
 
 /***********************************************************
@@ -268,34 +707,152 @@ void ViewManager::UpdateProjectionMatrix() {
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  The camera is interpolated between the last
+ *  two ticks by the time passed since the latest one, so
+ *  the motion is smooth at any frame rate while the view
+ *  trails the input by at most one tick.
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
-	glm::mat4 view;
-	glm::mat4 projection;
+	m_snapshots.Update();
+	const VIEW_SNAPSHOT& snapshot = m_snapshots.GetReadBuffer();
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
-
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	float blend = 1.0f;
+	if (snapshot.tickLength > 0.0f)
+	{
+		blend = (float)((glfwGetTime() - snapshot.tickTime) / snapshot.tickLength);
+		blend = glm::clamp(blend, 0.0f, 1.0f);
+	}
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	CAMERA_STATE state = snapshot.current;
+	state.position = glm::mix(snapshot.previous.position, snapshot.current.position, blend);
+	state.front = glm::normalize(glm::mix(snapshot.previous.front, snapshot.current.front, blend));
+	state.up = glm::normalize(glm::mix(snapshot.previous.up, snapshot.current.up, blend));
 
-	// update the current projection matrix
-	UpdateProjectionMatrix();
+	// the projections were built once for the framebuffer size,
+	// not per frame, and are not blended
+	for (int i = 0; i < snapshot.viewCount; i++)
+	{
+		m_sceneViews[i] = snapshot.views[i];
+	}
+	m_sceneViewCount = snapshot.viewCount;
+	m_viewMatrix = glm::lookAt(state.position, state.position + state.front, state.up);
+	m_projectionMatrix = snapshot.views[0].projection;
+	m_sceneViews[0].view = m_viewMatrix;
+	m_viewportWidth = snapshot.width;
+	m_viewportHeight = snapshot.height;
+	m_frameScreenshotCount = snapshot.screenshotCount;
+	m_bFrameCaptureSequence = snapshot.bCaptureSequence;
+	m_bFrameShowStats = snapshot.bShowStats;
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
+		// set the view and projection matrices into the shader for proper rendering
+		m_pShaderManager->setMat4Value(g_ViewName, m_viewMatrix);
+		m_pShaderManager->setMat4Value(g_ViewProjectionName, m_projectionMatrix * m_viewMatrix);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pShaderManager->setVec3Value(g_ViewPositionName, state.position);
+	}
+}
+
+/***********************************************************
+ *  GetViewMatrix()
+ *
+ *  This method is used for getting the view matrix that was
+ *  set into the shader for the current frame.
+ ***********************************************************/
+glm::mat4 ViewManager::GetViewMatrix() const
+{
+	return(m_viewMatrix);
+}
+
+/***********************************************************
+ *  GetProjectionMatrix()
+ *
+ *  This method is used for getting the projection matrix
+ *  that was set into the shader for the current frame.
+ ***********************************************************/
+glm::mat4 ViewManager::GetProjectionMatrix() const
+{
+	return(m_projectionMatrix);
+}
+
+/***********************************************************
+ *  GetSceneViews()
+ *
+ *  This method is used for getting every view set by the
+ *  last call to PrepareSceneView, the camera view first,
+ *  and returns how many there are.  The passed in array
+ *  holds MAX_SCENE_VIEWS views.
+ ***********************************************************/
+int ViewManager::GetSceneViews(SCENE_VIEW* pViews) const
+{
+	if (NULL == pViews)
+	{
+		return(0);
 	}
-}
\ No newline at end of file
+
+	for (int i = 0; i < m_sceneViewCount; i++)
+	{
+		pViews[i] = m_sceneViews[i];
+	}
+
+	return(m_sceneViewCount);
+}
+
+/***********************************************************
+ *  GetViewportWidth()
+ *
+ *  This method is used for getting the width of the
+ *  framebuffer of the display window in pixels.
+ ***********************************************************/
+int ViewManager::GetViewportWidth() const
+{
+	return(m_viewportWidth);
+}
+
+/***********************************************************
+ *  GetViewportHeight()
+ *
+ *  This method is used for getting the height of the
+ *  framebuffer of the display window in pixels.
+ ***********************************************************/
+int ViewManager::GetViewportHeight() const
+{
+	return(m_viewportHeight);
+}
+
+/***********************************************************
+ *  GetScreenshotCount()
+ *
+ *  This method is used for getting the number of
+ *  screenshots asked for so far, so the render thread
+ *  takes one whenever the count went up.
+ ***********************************************************/
+unsigned int ViewManager::GetScreenshotCount() const
+{
+	return(m_frameScreenshotCount);
+}
+
+/***********************************************************
+ *  IsCapturingSequence()
+ *
+ *  This method is used for checking whether the frames are
+ *  captured into an image sequence.
+ ***********************************************************/
+bool ViewManager::IsCapturingSequence() const
+{
+	return(m_bFrameCaptureSequence);
+}
+
+/***********************************************************
+ *  IsShowingStats()
+ *
+ *  This method is used for checking whether the statistics
+ *  overlay is drawn over the frame.
+ ***********************************************************/
+bool ViewManager::IsShowingStats() const
+{
+	return(m_bFrameShowStats);
+}
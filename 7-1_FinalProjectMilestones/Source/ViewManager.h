@@ -11,6 +11,11 @@
 
 #include "ShaderManager.h"
 #include "camera.h"
+#include "TripleBuffer.h"
+#include "CameraRecording.h"
+#include "SceneView.h"
+
+#include <string>
 
 // GLFW library
 #include "GLFW/glfw3.h" 
@@ -30,22 +35,158 @@ public:
 	// mouse position callback for mouse interaction with the 3D scene
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
 
+	// framebuffer size callback for adapting the view to the window
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+
+	// camera values at the end of one tick
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+		bool bOrthographic;
+	};
+
+	// camera of the last two ticks, handed from the thread that
+	// handles the input to the thread that renders
+	struct VIEW_SNAPSHOT
+	{
+		CAMERA_STATE previous;
+		CAMERA_STATE current;
+		// views of the current tick and the size of the framebuffer
+		// their projections were built for, in pixels - the view
+		// matrix of the first view is blended from the camera
+		SCENE_VIEW views[MAX_SCENE_VIEWS];
+		int viewCount;
+		int width;
+		int height;
+		// time the current tick stands for and the tick length,
+		// in seconds of glfwGetTime()
+		double tickTime;
+		float tickLength;
+		// number of camera ticks so far
+		unsigned int tick;
+		// screenshots asked for so far, and whether every frame
+		// is captured into a sequence
+		unsigned int screenshotCount;
+		bool bCaptureSequence;
+		// true when the statistics overlay is shown
+		bool bShowStats;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// every view of the current frame, the first being the camera
+	SCENE_VIEW m_sceneViews[MAX_SCENE_VIEWS];
+	int m_sceneViewCount;
+	// framebuffer size of the current frame
+	int m_viewportWidth;
+	int m_viewportHeight;
+	// views built by the input thread and the camera values, the
+	// layout and the framebuffer size they were built for
+	SCENE_VIEW m_cachedViews[MAX_SCENE_VIEWS];
+	int m_cachedViewCount;
+	CAMERA_STATE m_projectionState;
+	bool m_bProjectionLayout;
+	int m_projectionWidth;
+	int m_projectionHeight;
+	// true when the top and front views are shown beside the
+	// camera, and whether the key toggling them is held
+	bool m_bLayoutViews;
+	bool m_bLayoutKeyDown;
+	// captures asked for on the input thread, whether the keys
+	// asking for them are held, and the captures of the frame
+	// as of the last call to PrepareSceneView
+	unsigned int m_screenshotCount;
+	bool m_bCaptureSequence;
+	bool m_bScreenshotKeyDown;
+	bool m_bSequenceKeyDown;
+	unsigned int m_frameScreenshotCount;
+	bool m_bFrameCaptureSequence;
+	// true when the statistics overlay is shown, whether the key
+	// toggling it is held, and the value of the current frame
+	bool m_bShowStats;
+	bool m_bStatsKeyDown;
+	bool m_bFrameShowStats;
+	// camera snapshots written by the input thread and read by
+	// the render thread
+	TripleBuffer<VIEW_SNAPSHOT> m_snapshots;
+	unsigned int m_tick;
+	// camera input saved or replayed, one entry per tick
+	CameraRecording m_recording;
+	std::string m_recordingFilename;
+	bool m_bRecording;
+	bool m_bReplaying;
+	int m_replayTick;
 
-	//updates the projection matrix
-	void UpdateProjectionMatrix();
+	//updates the projection matrices when the zoom, the projection
+	//mode, the layout or the framebuffer size changed, true when it did
+	bool UpdateProjectionMatrix(const CAMERA_STATE& state);
 
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	// process keyboard events for interaction with the 3D scene,
+	// collected with the mouse movement since the last tick
+	CameraRecording::CAMERA_INPUT ProcessKeyboardEvents();
+	// move the camera by the input of one tick
+	void ApplyCameraInput(const CameraRecording::CAMERA_INPUT& input, float deltaTime);
+	// get the current values of the camera
+	CAMERA_STATE GetCameraState() const;
+	// hand the camera of the passed in and the current tick to
+	// the render thread, true when the projection changed
+	bool PublishSnapshot(const CAMERA_STATE& previous, double tickTime, float tickLength);
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
 	
-	// prepare the conversion from 3D object display to 2D scene display
+	// move the camera by one fixed tick of the input thread and
+	// publish the resulting view to the render thread, true when
+	// the camera moved
+	bool UpdateCamera(float deltaTime, double tickTime);
+
+	// save the input of every following tick to a file when the
+	// recording is stopped
+	bool StartCameraRecording(const char* filename, float tickLength);
+	void StopCameraRecording();
+	// move the camera by the ticks of a recording instead of the
+	// live input, closing the window at its end
+	bool StartCameraReplay(const char* filename);
+	bool IsReplaying() const;
+
+	// show the fixed top and front views beside the camera view,
+	// which the V key toggles as well
+	void SetLayoutViews(bool bLayoutViews);
+	// capture every frame into an image sequence, which the F10
+	// key toggles as well, while F12 asks for one screenshot
+	void SetCaptureSequence(bool bCaptureSequence);
+	// show the statistics overlay, which the F1 key toggles as well
+	void SetShowStats(bool bShowStats);
+
+	// prepare the conversion from 3D object display to 2D scene
+	// display from the latest published view, on the render thread
 	void PrepareSceneView();
+
+	// get the matrices set by the last call to PrepareSceneView
+	glm::mat4 GetViewMatrix() const;
+	glm::mat4 GetProjectionMatrix() const;
+	// get every view of the frame, the camera view first, and
+	// return the number of views
+	int GetSceneViews(SCENE_VIEW* pViews) const;
+	// get the size of the framebuffer of the display window in
+	// pixels, as of the last call to PrepareSceneView
+	int GetViewportWidth() const;
+	int GetViewportHeight() const;
+	// get the number of screenshots asked for and whether the
+	// frames are captured, as of the last call to PrepareSceneView
+	unsigned int GetScreenshotCount() const;
+	bool IsCapturingSequence() const;
+	// check whether the statistics overlay is shown, as of the
+	// last call to PrepareSceneView
+	bool IsShowingStats() const;
 };
\ No newline at end of file
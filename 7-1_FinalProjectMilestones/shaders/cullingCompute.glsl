@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+// cullingCompute.glsl
+// ============
+// move the object bounds by their world matrices, test them against the
+// view frustum and the depth pyramid, pick the level of detail and
+// append the visible objects to the indirect command buffer
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+layout(local_size_x = 64) in;
+
+// must match CullingManager::CULL_OBJECT
+struct CullObject
+{
+	// bounds in the space of the mesh
+	vec4 boundingSphere;
+	// one entry per level of detail
+	uvec4 indexCounts;
+	uvec4 firstIndices;
+	ivec4 baseVertices;
+	vec4 minScreenSizes;
+	uvec4 drawGroups;
+	uvec4 commandOffsets;
+	uint levelCount;
+	// level drawn last time, LOD_LEVEL_UNKNOWN before the first draw
+	uint lodLevel;
+	uint padding0;
+	uint padding1;
+};
+
+// must match CullingManager::DRAW_COMMAND
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// must match CullingManager::LOD_LEVEL_UNKNOWN
+const uint LOD_LEVEL_UNKNOWN = 0xFFFFFFFFu;
+
+// the level of each object is written back for the next frame
+layout(std430, binding = 0) buffer ObjectBuffer
+{
+	CullObject objects[];
+};
+
+layout(std430, binding = 1) writeonly buffer CommandBuffer
+{
+	DrawCommand commands[];
+};
+
+layout(std430, binding = 2) buffer CountBuffer
+{
+	uint drawCounts[];
+};
+
+// triangles of the kept commands, read back by the statistics
+layout(std430, binding = 10) buffer StatsBuffer
+{
+	uint triangleCount;
+};
+
+// world matrices of the scene objects, this must match the
+// transform binding of the scene manager
+layout(std430, binding = 8) readonly buffer TransformBuffer
+{
+	mat4 objectMatrices[];
+};
+
+uniform uint objectCount;
+// six planes for each view, this must match MAX_SCENE_VIEWS
+uniform int viewCount;
+uniform vec4 frustumPlanes[24];
+// instances of each command, one per view that a draw fills at once
+uniform uint instanceCount;
+
+// view that the levels of detail are chosen against, the same
+// way LodSelector chooses them
+uniform mat4 lodView;
+uniform float lodPixelScale;
+uniform float lodHysteresis;
+uniform bool bLodOrthographic;
+
+uniform bool bUseOcclusion;
+uniform sampler2D depthPyramid;
+uniform mat4 pyramidViewProjection;
+uniform vec2 pyramidSize;
+uniform int pyramidLevels;
+
+// a sphere is outside of a view when it is fully behind any of its planes
+bool IsInsideFrustum(int view, vec3 center, float radius)
+{
+	for (int i = view * 6; i < view * 6 + 6; i++)
+	{
+		if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// compare the nearest depth of the bounds with the farthest depth
+// stored in the pyramid level that covers the bounds in 2x2 texels
+bool IsOccluded(vec3 center, float radius)
+{
+	vec2 uvMin = vec2(1.0);
+	vec2 uvMax = vec2(0.0);
+	float nearestDepth = 1.0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = center + radius * vec3(
+			((i & 1) != 0) ? 1.0 : -1.0,
+			((i & 2) != 0) ? 1.0 : -1.0,
+			((i & 4) != 0) ? 1.0 : -1.0);
+		vec4 clipPosition = pyramidViewProjection * vec4(corner, 1.0);
+
+		// bounds that cross the near plane are always kept
+		if (clipPosition.w <= 0.0)
+		{
+			return false;
+		}
+
+		vec3 ndcPosition = clipPosition.xyz / clipPosition.w;
+		uvMin = min(uvMin, ndcPosition.xy * 0.5 + 0.5);
+		uvMax = max(uvMax, ndcPosition.xy * 0.5 + 0.5);
+		nearestDepth = min(nearestDepth, ndcPosition.z * 0.5 + 0.5);
+	}
+
+	uvMin = clamp(uvMin, vec2(0.0), vec2(1.0));
+	uvMax = clamp(uvMax, vec2(0.0), vec2(1.0));
+
+	vec2 extent = (uvMax - uvMin) * pyramidSize;
+	float level = ceil(log2(max(max(extent.x, extent.y), 1.0)));
+	level = min(level, float(pyramidLevels - 1));
+
+	float farthestDepth = max(
+		max(textureLod(depthPyramid, uvMin, level).r,
+			textureLod(depthPyramid, vec2(uvMax.x, uvMin.y), level).r),
+		max(textureLod(depthPyramid, vec2(uvMin.x, uvMax.y), level).r,
+			textureLod(depthPyramid, uvMax, level).r));
+
+	return nearestDepth > farthestDepth;
+}
+
+// projected diameter in pixels of a world space bounding sphere
+float GetScreenSize(vec3 center, float radius)
+{
+	float diameter = 2.0 * radius * lodPixelScale;
+	if (bLodOrthographic)
+	{
+		return diameter;
+	}
+
+	// the camera is inside the sphere, so it covers the screen
+	float distance = length((lodView * vec4(center, 1.0)).xyz);
+	if (distance <= radius)
+	{
+		return 3.4e38;
+	}
+	return diameter / distance;
+}
+
+// pick the level for the projected size, only moving away from the
+// level of the last draw once the size passes its threshold by the
+// hysteresis, so a size near a threshold does not flicker
+uint SelectLevel(CullObject object, float screenSize)
+{
+	uint lastLevel = object.levelCount - 1u;
+	uint level = 0u;
+
+	if (object.lodLevel <= lastLevel)
+	{
+		level = object.lodLevel;
+		while ((level > 0u) &&
+			(screenSize >= object.minScreenSizes[level - 1u] * (1.0 + lodHysteresis)))
+		{
+			level--;
+		}
+		while ((level < lastLevel) &&
+			(screenSize < object.minScreenSizes[level] * (1.0 - lodHysteresis)))
+		{
+			level++;
+		}
+	}
+	else
+	{
+		// a new draw takes the level of its size directly
+		while ((level < lastLevel) && (screenSize < object.minScreenSizes[level]))
+		{
+			level++;
+		}
+	}
+
+	return level;
+}
+
+void main()
+{
+	uint objectIndex = gl_GlobalInvocationID.x;
+	if (objectIndex >= objectCount)
+	{
+		return;
+	}
+
+	// objects without levels have nothing to draw
+	CullObject object = objects[objectIndex];
+	if (object.levelCount == 0u)
+	{
+		return;
+	}
+
+	// the largest axis scale keeps the moved sphere around the mesh
+	mat4 worldMatrix = objectMatrices[objectIndex];
+	vec3 center = (worldMatrix * vec4(object.boundingSphere.xyz, 1.0)).xyz;
+	float radius = object.boundingSphere.w * max(length(worldMatrix[0].xyz),
+		max(length(worldMatrix[1].xyz), length(worldMatrix[2].xyz)));
+
+	bool bVisible = false;
+	for (int view = 0; (view < viewCount) && !bVisible; view++)
+	{
+		bVisible = IsInsideFrustum(view, center, radius);
+	}
+	if (bVisible && bUseOcclusion)
+	{
+		bVisible = !IsOccluded(center, radius);
+	}
+
+	if (bVisible)
+	{
+		uint level = SelectLevel(object, GetScreenSize(center, radius));
+		objects[objectIndex].lodLevel = level;
+
+		// the base instance carries the object index to the vertex shader
+		uint drawGroup = object.drawGroups[level];
+		uint slot = atomicAdd(drawCounts[drawGroup], 1u);
+		atomicAdd(triangleCount, object.indexCounts[level] / 3u);
+		commands[object.commandOffsets[level] + slot] = DrawCommand(
+			object.indexCounts[level],
+			instanceCount,
+			object.firstIndices[level],
+			object.baseVertices[level],
+			objectIndex);
+	}
+}
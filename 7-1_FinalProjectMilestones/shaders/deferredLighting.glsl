@@ -0,0 +1,247 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredLighting.glsl
+// ============
+// light the G-buffer with the clustered light lists, reading the material
+// parameters out of the material table
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+// must match DeferredRenderer::MATERIAL_ENTRY
+struct MaterialEntry
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	float shininess;
+	vec3 specularColor;
+	float padding;
+};
+
+// must match LightManager::LIGHT_SOURCE
+struct LightSource
+{
+	vec3 position;
+	float range;
+	vec3 ambientColor;
+	float focalStrength;
+	vec3 diffuseColor;
+	float specularIntensity;
+	vec3 specularColor;
+	// index into the shadow data, -1 when the light casts no shadows
+	int shadowIndex;
+};
+
+layout(std430, binding = 3) readonly buffer LightBuffer
+{
+	LightSource lights[];
+};
+
+layout(std430, binding = 4) readonly buffer ClusterBuffer
+{
+	uvec2 clusterLights[];
+};
+
+layout(std430, binding = 5) readonly buffer LightIndexBuffer
+{
+	uint lightIndexCount;
+	uint lightIndices[];
+};
+
+layout(std430, binding = 6) readonly buffer MaterialBuffer
+{
+	MaterialEntry materials[];
+};
+
+// must match ShadowManager::SHADOW_DATA
+struct ShadowData
+{
+	mat4 viewProjection;
+	vec4 atlasRect;
+};
+
+layout(std430, binding = 7) readonly buffer ShadowBuffer
+{
+	ShadowData shadows[];
+};
+
+out vec4 outFragmentColor;
+
+uniform sampler2D albedoTexture;
+uniform sampler2D normalTexture;
+uniform usampler2D materialTexture;
+uniform sampler2D depthTexture;
+
+uniform mat4 view;
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPosition;
+uniform uint materialCount;
+// rectangle of the view being lit, in pixels of the G-buffer
+uniform vec4 viewRect;
+// true for the camera view, which the light clusters are built for
+uniform bool bClusterLights = true;
+
+// number of lights and layout of the cluster grid set by LightManager
+uniform int lightCount;
+uniform int clusterColumns;
+uniform int clusterRows;
+uniform int clusterSlices;
+uniform vec2 clusterTileSize;
+uniform float clusterDepthScale;
+uniform float clusterDepthBias;
+uniform bool bClusterLogDepth;
+
+// shadow atlas and filtering set by ShadowManager
+uniform bool bUseShadows = false;
+uniform sampler2DShadow shadowAtlas;
+uniform int shadowPcfRadius = 0;
+uniform float shadowTexelSize;
+
+// find the cluster from the screen position and the view depth -
+// this must match GetClusterIndex() in fragmentShader.glsl
+uint GetClusterIndex(vec3 worldPosition)
+{
+	float depth = -(view * vec4(worldPosition, 1.0f)).z;
+	if (bClusterLogDepth == true)
+	{
+		depth = log(max(depth, 0.0001f));
+	}
+
+	int slice = clamp(int(floor(depth * clusterDepthScale + clusterDepthBias)), 0, clusterSlices - 1);
+	int column = clamp(int(gl_FragCoord.x / clusterTileSize.x), 0, clusterColumns - 1);
+	int row = clamp(int(gl_FragCoord.y / clusterTileSize.y), 0, clusterRows - 1);
+
+	return(uint(column + row * clusterColumns + slice * clusterColumns * clusterRows));
+}
+
+// fraction of the light that reaches the surface - this must match
+// CalcShadow() in fragmentShader.glsl
+float CalcShadow(int shadowIndex, vec3 worldPosition, vec3 lightNormal, vec3 lightDirection)
+{
+	if ((bUseShadows == false) || (shadowIndex < 0))
+	{
+		return(1.0f);
+	}
+
+	ShadowData shadow = shadows[shadowIndex];
+	vec4 lightPosition = shadow.viewProjection * vec4(worldPosition, 1.0f);
+	vec3 projected = lightPosition.xyz / lightPosition.w;
+
+	// outside of the spot cone there is nothing to compare against
+	if ((lightPosition.w <= 0.0f) || any(greaterThan(abs(projected), vec3(1.0f))))
+	{
+		return(1.0f);
+	}
+
+	projected = projected * 0.5f + 0.5f;
+
+	// surfaces facing away from the light need a larger bias
+	float bias = max(0.0025f * (1.0f - dot(lightNormal, lightDirection)), 0.0005f);
+	float reference = projected.z - bias;
+
+	// keep the taps inside the light's square of the atlas
+	vec2 rectMin = shadow.atlasRect.xy + vec2(shadowTexelSize * 0.5f);
+	vec2 rectMax = shadow.atlasRect.xy + shadow.atlasRect.zw - vec2(shadowTexelSize * 0.5f);
+	vec2 center = shadow.atlasRect.xy + projected.xy * shadow.atlasRect.zw;
+
+	float lit = 0.0f;
+	for (int y = -shadowPcfRadius; y <= shadowPcfRadius; y++)
+	{
+		for (int x = -shadowPcfRadius; x <= shadowPcfRadius; x++)
+		{
+			vec2 uv = clamp(center + vec2(x, y) * shadowTexelSize, rectMin, rectMax);
+			lit += texture(shadowAtlas, vec3(uv, reference));
+		}
+	}
+
+	float taps = float((2 * shadowPcfRadius + 1) * (2 * shadowPcfRadius + 1));
+	return(lit / taps);
+}
+
+// Phong lighting from one light source - this must match
+// CalcLightSource() in fragmentShader.glsl
+vec3 CalcLightSource(LightSource light, MaterialEntry material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	vec3 lightOffset = light.position - vertexPosition;
+	vec3 lightDirection = normalize(lightOffset);
+
+	float attenuation = 1.0f;
+	if (light.range > 0.0f)
+	{
+		float falloff = clamp(1.0f - pow(length(lightOffset) / light.range, 4.0f), 0.0f, 1.0f);
+		attenuation = falloff * falloff;
+	}
+
+	ambient = light.ambientColor * material.ambientColor;
+
+	float impact = max(dot(lightNormal, lightDirection), 0.0f);
+	diffuse = impact * light.diffuseColor;
+
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+	specular = light.specularIntensity * specularComponent * light.specularColor * material.specularColor;
+
+	// shadows only block the direct light, the ambient term stays
+	float shadow = CalcShadow(light.shadowIndex, vertexPosition, lightNormal, lightDirection);
+
+	return((ambient + (diffuse + specular) * shadow) * attenuation);
+}
+
+void main()
+{
+	// the views share the G-buffer, so it is addressed by pixel
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(depthTexture, pixel, 0).r;
+
+	// nothing was drawn here, so keep the cleared background
+	if (depth >= 1.0f)
+	{
+		discard;
+	}
+
+	vec4 albedo = texelFetch(albedoTexture, pixel, 0);
+	vec4 normal = texelFetch(normalTexture, pixel, 0);
+
+	if (normal.w < 0.5f)
+	{
+		outFragmentColor = albedo;
+		return;
+	}
+
+	// rebuild the world position from the depth buffer and the
+	// position of the pixel within its view
+	vec2 screenPosition = (gl_FragCoord.xy - viewRect.xy) / viewRect.zw;
+	vec4 clipPosition = vec4(screenPosition * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+	vec4 worldPosition = inverseViewProjection * clipPosition;
+	vec3 fragmentPosition = worldPosition.xyz / worldPosition.w;
+
+	uint materialID = min(texelFetch(materialTexture, pixel, 0).r, max(materialCount, 1u) - 1u);
+	MaterialEntry material = materials[materialID];
+
+	vec3 lightNormal = normalize(normal.xyz);
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+	vec3 phongResult = vec3(0.0f);
+
+	if (bClusterLights == true)
+	{
+		uvec2 cluster = clusterLights[GetClusterIndex(fragmentPosition)];
+		for (uint i = 0; i < cluster.y; i++)
+		{
+			phongResult += CalcLightSource(lights[lightIndices[cluster.x + i]], material, lightNormal, fragmentPosition, viewDirection);
+		}
+	}
+	else
+	{
+		// the clusters only cover the camera view, so the other
+		// views loop over every light
+		for (int i = 0; i < lightCount; i++)
+		{
+			phongResult += CalcLightSource(lights[i], material, lightNormal, fragmentPosition, viewDirection);
+		}
+	}
+
+	outFragmentColor = vec4(phongResult * albedo.xyz, albedo.w);
+}
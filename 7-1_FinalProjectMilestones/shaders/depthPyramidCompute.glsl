@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthPyramidCompute.glsl
+// ============
+// reduce the depth buffer into a mip chain that keeps the farthest depth
+// of every 2x2 block, used for the occlusion test of the culling pass
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// the copied depth buffer, only read for the first level
+uniform sampler2D depthTexture;
+uniform bool bCopyDepth;
+
+uniform ivec2 sourceSize;
+uniform ivec2 destinationSize;
+
+layout(r32f, binding = 0) uniform writeonly image2D destinationLevel;
+layout(r32f, binding = 1) uniform readonly image2D sourceLevel;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(texel, destinationSize)))
+	{
+		return;
+	}
+
+	if (bCopyDepth)
+	{
+		imageStore(destinationLevel, texel, vec4(texelFetch(depthTexture, texel, 0).r));
+		return;
+	}
+
+	// the last row and column also take the leftover texel of odd sizes
+	ivec2 footprint = ivec2(2);
+	if (((sourceSize.x & 1) != 0) && (texel.x == destinationSize.x - 1))
+	{
+		footprint.x = 3;
+	}
+	if (((sourceSize.y & 1) != 0) && (texel.y == destinationSize.y - 1))
+	{
+		footprint.y = 3;
+	}
+
+	float farthestDepth = 0.0;
+	for (int y = 0; y < footprint.y; y++)
+	{
+		for (int x = 0; x < footprint.x; x++)
+		{
+			ivec2 sourceTexel = min(texel * 2 + ivec2(x, y), sourceSize - 1);
+			farthestDepth = max(farthestDepth, imageLoad(sourceLevel, sourceTexel).r);
+		}
+	}
+
+	imageStore(destinationLevel, texel, vec4(farthestDepth));
+}
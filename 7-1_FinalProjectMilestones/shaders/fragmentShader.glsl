@@ -0,0 +1,292 @@
+///////////////////////////////////////////////////////////////////////////////
+// fragmentShader.glsl
+// ============
+// shade the scene with Phong lighting, looping only over the lights that
+// were binned into the cluster containing the fragment
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+// must match LightManager::LIGHT_SOURCE
+struct LightSource
+{
+	vec3 position;
+	float range;
+	vec3 ambientColor;
+	float focalStrength;
+	vec3 diffuseColor;
+	float specularIntensity;
+	vec3 specularColor;
+	// index into the shadow data, -1 when the light casts no shadows
+	int shadowIndex;
+};
+
+layout(std430, binding = 3) readonly buffer LightBuffer
+{
+	LightSource lights[];
+};
+
+// offset into the light index list and light count of each cluster
+layout(std430, binding = 4) readonly buffer ClusterBuffer
+{
+	uvec2 clusterLights[];
+};
+
+layout(std430, binding = 5) readonly buffer LightIndexBuffer
+{
+	uint lightIndexCount;
+	uint lightIndices[];
+};
+
+// must match ShadowManager::SHADOW_DATA
+struct ShadowData
+{
+	mat4 viewProjection;
+	vec4 atlasRect;
+};
+
+layout(std430, binding = 7) readonly buffer ShadowBuffer
+{
+	ShadowData shadows[];
+};
+
+// must match SceneManager::OBJECT_DATA
+struct ObjectData
+{
+	vec4 color;
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	float shininess;
+	vec3 specularColor;
+	int materialID;
+	vec2 UVscale;
+	vec2 padding;
+};
+
+// values of the objects drawn by the GPU culling pass
+layout(std430, binding = 9) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in int fragmentViewIndex;
+flat in int fragmentObjectIndex;
+
+out vec4 outFragmentColor;
+
+uniform bool bUseTexture = false;
+uniform bool bUseLighting = false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform sampler2D objectTexture;
+// camera position of each view, this must match MAX_SCENE_VIEWS
+uniform vec3 viewPositions[4];
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform Material material;
+// view of the camera, which the light clusters are built for
+uniform mat4 view;
+
+// material of the fragment, from the uniform or the object buffer
+Material surfaceMaterial;
+
+// number of lights and layout of the cluster grid set by LightManager
+uniform int lightCount;
+uniform int clusterColumns;
+uniform int clusterRows;
+uniform int clusterSlices;
+uniform vec2 clusterTileSize;
+uniform float clusterDepthScale;
+uniform float clusterDepthBias;
+uniform bool bClusterLogDepth;
+
+// shadow atlas and filtering set by ShadowManager
+uniform bool bUseShadows = false;
+uniform sampler2DShadow shadowAtlas;
+uniform int shadowPcfRadius = 0;
+uniform float shadowTexelSize;
+
+// the permutations fix the features of a draw at compile time, while
+// the fallback program still branches on the uniforms
+#ifdef PERMUTATION
+	#ifdef USE_TEXTURE
+		#define TEXTURED true
+	#else
+		#define TEXTURED false
+	#endif
+	#ifdef USE_LIGHTING
+		#define LIT true
+	#else
+		#define LIT false
+	#endif
+	#ifdef USE_SHADOWS
+		#define SHADOWED true
+	#else
+		#define SHADOWED false
+	#endif
+#else
+	#define TEXTURED bUseTexture
+	#define LIT bUseLighting
+	#define SHADOWED bUseShadows
+#endif
+
+// find the cluster from the screen position and the view depth
+uint GetClusterIndex()
+{
+	float depth = -(view * vec4(fragmentPosition, 1.0f)).z;
+	if (bClusterLogDepth == true)
+	{
+		depth = log(max(depth, 0.0001f));
+	}
+
+	int slice = clamp(int(floor(depth * clusterDepthScale + clusterDepthBias)), 0, clusterSlices - 1);
+	int column = clamp(int(gl_FragCoord.x / clusterTileSize.x), 0, clusterColumns - 1);
+	int row = clamp(int(gl_FragCoord.y / clusterTileSize.y), 0, clusterRows - 1);
+
+	return(uint(column + row * clusterColumns + slice * clusterColumns * clusterRows));
+}
+
+// fraction of the light that reaches the surface
+float CalcShadow(int shadowIndex, vec3 worldPosition, vec3 lightNormal, vec3 lightDirection)
+{
+	if ((SHADOWED == false) || (shadowIndex < 0))
+	{
+		return(1.0f);
+	}
+
+	ShadowData shadow = shadows[shadowIndex];
+	vec4 lightPosition = shadow.viewProjection * vec4(worldPosition, 1.0f);
+	vec3 projected = lightPosition.xyz / lightPosition.w;
+
+	// outside of the spot cone there is nothing to compare against
+	if ((lightPosition.w <= 0.0f) || any(greaterThan(abs(projected), vec3(1.0f))))
+	{
+		return(1.0f);
+	}
+
+	projected = projected * 0.5f + 0.5f;
+
+	// surfaces facing away from the light need a larger bias
+	float bias = max(0.0025f * (1.0f - dot(lightNormal, lightDirection)), 0.0005f);
+	float reference = projected.z - bias;
+
+	// keep the taps inside the light's square of the atlas
+	vec2 rectMin = shadow.atlasRect.xy + vec2(shadowTexelSize * 0.5f);
+	vec2 rectMax = shadow.atlasRect.xy + shadow.atlasRect.zw - vec2(shadowTexelSize * 0.5f);
+	vec2 center = shadow.atlasRect.xy + projected.xy * shadow.atlasRect.zw;
+
+	float lit = 0.0f;
+	for (int y = -shadowPcfRadius; y <= shadowPcfRadius; y++)
+	{
+		for (int x = -shadowPcfRadius; x <= shadowPcfRadius; x++)
+		{
+			vec2 uv = clamp(center + vec2(x, y) * shadowTexelSize, rectMin, rectMax);
+			lit += texture(shadowAtlas, vec3(uv, reference));
+		}
+	}
+
+	float taps = float((2 * shadowPcfRadius + 1) * (2 * shadowPcfRadius + 1));
+	return(lit / taps);
+}
+
+// Phong lighting from one light source
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	vec3 lightOffset = light.position - vertexPosition;
+	vec3 lightDirection = normalize(lightOffset);
+
+	// lights with a range fade out smoothly at the edge of their range
+	float attenuation = 1.0f;
+	if (light.range > 0.0f)
+	{
+		float falloff = clamp(1.0f - pow(length(lightOffset) / light.range, 4.0f), 0.0f, 1.0f);
+		attenuation = falloff * falloff;
+	}
+
+	ambient = light.ambientColor * surfaceMaterial.ambientColor;
+
+	float impact = max(dot(lightNormal, lightDirection), 0.0f);
+	diffuse = impact * light.diffuseColor;
+
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+	specular = light.specularIntensity * specularComponent * light.specularColor * surfaceMaterial.specularColor;
+
+	// shadows only block the direct light, the ambient term stays
+	float shadow = CalcShadow(light.shadowIndex, vertexPosition, lightNormal, lightDirection);
+
+	return((ambient + (diffuse + specular) * shadow) * attenuation);
+}
+
+void main()
+{
+	vec4 baseColor = objectColor;
+	vec2 textureScale = UVscale;
+	surfaceMaterial = material;
+	if (fragmentObjectIndex >= 0)
+	{
+		ObjectData object = objects[fragmentObjectIndex];
+		baseColor = object.color;
+		textureScale = object.UVscale;
+		surfaceMaterial = Material(object.ambientColor, object.ambientStrength,
+			object.diffuseColor, object.specularColor, object.shininess);
+	}
+
+	if (TEXTURED)
+	{
+		baseColor = vec4(texture(objectTexture, fragmentTextureCoordinate * textureScale).xyz, 1.0f);
+	}
+
+	if (LIT)
+	{
+		vec3 lightNormal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPositions[fragmentViewIndex] - fragmentPosition);
+		vec3 phongResult = vec3(0.0f);
+
+#ifdef LIGHT_COUNT
+		// with only a few lights a fixed loop is cheaper than the cluster lookup
+		for (int i = 0; i < LIGHT_COUNT; i++)
+		{
+			phongResult += CalcLightSource(lights[i], lightNormal, fragmentPosition, viewDirection);
+		}
+#else
+		if (fragmentViewIndex == 0)
+		{
+			uvec2 cluster = clusterLights[GetClusterIndex()];
+			for (uint i = 0; i < cluster.y; i++)
+			{
+				phongResult += CalcLightSource(lights[lightIndices[cluster.x + i]], lightNormal, fragmentPosition, viewDirection);
+			}
+		}
+		else
+		{
+			// the clusters only cover the camera view, so the other
+			// views loop over every light
+			for (int i = 0; i < lightCount; i++)
+			{
+				phongResult += CalcLightSource(lights[i], lightNormal, fragmentPosition, viewDirection);
+			}
+		}
+#endif
+
+		outFragmentColor = vec4(phongResult * baseColor.xyz, baseColor.w);
+	}
+	else
+	{
+		outFragmentColor = baseColor;
+	}
+}
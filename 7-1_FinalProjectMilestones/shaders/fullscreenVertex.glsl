@@ -0,0 +1,17 @@
+///////////////////////////////////////////////////////////////////////////////
+// fullscreenVertex.glsl
+// ============
+// generate a triangle that covers the whole viewport from the vertex ID,
+// so no vertex buffer is needed for the full-screen passes
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+out vec2 fragmentTextureCoordinate;
+
+void main()
+{
+	vec2 position = vec2((gl_VertexID == 1) ? 3.0f : -1.0f, (gl_VertexID == 2) ? 3.0f : -1.0f);
+
+	fragmentTextureCoordinate = position * 0.5f + 0.5f;
+	gl_Position = vec4(position, 0.0f, 1.0f);
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// gBufferFragment.glsl
+// ============
+// write the surface attributes of the scene into the G-buffer for the
+// deferred lighting pass
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in int fragmentObjectIndex;
+
+// must match the attachments created by DeferredRenderer
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+layout(location = 2) out uint outMaterialID;
+
+// must match SceneManager::OBJECT_DATA
+struct ObjectData
+{
+	vec4 color;
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	float shininess;
+	vec3 specularColor;
+	int materialID;
+	vec2 UVscale;
+	vec2 padding;
+};
+
+// values of the objects drawn by the GPU culling pass
+layout(std430, binding = 9) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+uniform bool bUseTexture = false;
+uniform bool bUseLighting = false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform sampler2D objectTexture;
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+// index of the current material in the material table
+uniform int materialID = 0;
+
+// the permutations fix the features of a draw at compile time, while
+// the fallback program still branches on the uniforms - this must
+// match fragmentShader.glsl
+#ifdef PERMUTATION
+	#ifdef USE_TEXTURE
+		#define TEXTURED true
+	#else
+		#define TEXTURED false
+	#endif
+	#ifdef USE_LIGHTING
+		#define LIT true
+	#else
+		#define LIT false
+	#endif
+#else
+	#define TEXTURED bUseTexture
+	#define LIT bUseLighting
+#endif
+
+void main()
+{
+	vec4 baseColor = objectColor;
+	vec2 textureScale = UVscale;
+	int surfaceMaterialID = materialID;
+	if (fragmentObjectIndex >= 0)
+	{
+		baseColor = objects[fragmentObjectIndex].color;
+		textureScale = objects[fragmentObjectIndex].UVscale;
+		surfaceMaterialID = objects[fragmentObjectIndex].materialID;
+	}
+
+	if (TEXTURED)
+	{
+		baseColor = vec4(texture(objectTexture, fragmentTextureCoordinate * textureScale).xyz, 1.0f);
+	}
+
+	outAlbedo = baseColor;
+	// the alpha channel tells the lighting pass to skip unlit surfaces
+	outNormal = vec4(normalize(fragmentVertexNormal), LIT ? 1.0f : 0.0f);
+	outMaterialID = uint(surfaceMaterialID);
+}
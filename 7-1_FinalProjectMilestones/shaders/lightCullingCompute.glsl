@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightCullingCompute.glsl
+// ============
+// bin the scene lights into the screen space and depth clusters that
+// the fragment shader loops over
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+layout(local_size_x = 64) in;
+
+// must match LightManager::MAX_LIGHTS_PER_CLUSTER
+const uint MAX_LIGHTS_PER_CLUSTER = 64;
+
+// must match LightManager::LIGHT_SOURCE
+struct LightSource
+{
+	vec3 position;
+	float range;
+	vec3 ambientColor;
+	float focalStrength;
+	vec3 diffuseColor;
+	float specularIntensity;
+	vec3 specularColor;
+	// index into the shadow data, -1 when the light casts no shadows
+	int shadowIndex;
+};
+
+layout(std430, binding = 3) readonly buffer LightBuffer
+{
+	LightSource lights[];
+};
+
+layout(std430, binding = 4) writeonly buffer ClusterBuffer
+{
+	uvec2 clusterLights[];
+};
+
+// the count is cleared to zero before every dispatch
+layout(std430, binding = 5) buffer LightIndexBuffer
+{
+	uint lightIndexCount;
+	uint lightIndices[];
+};
+
+uniform uint lightCount;
+uniform mat4 view;
+uniform mat4 inverseProjection;
+uniform ivec3 clusterGridSize;
+uniform float clusterNear;
+uniform float clusterFar;
+uniform bool bClusterLogDepth;
+
+// view distance where a depth slice begins
+float GetSliceDepth(int slice)
+{
+	float t = float(slice) / float(clusterGridSize.z);
+	if (bClusterLogDepth == true)
+	{
+		return(clusterNear * pow(clusterFar / clusterNear, t));
+	}
+	return(mix(clusterNear, clusterFar, t));
+}
+
+// point on the line through a tile corner at the passed in view distance
+vec3 GetCornerAtDepth(vec2 ndcCorner, float depth)
+{
+	vec4 nearPoint = inverseProjection * vec4(ndcCorner, -1.0f, 1.0f);
+	vec4 farPoint = inverseProjection * vec4(ndcCorner, 1.0f, 1.0f);
+	vec3 start = nearPoint.xyz / nearPoint.w;
+	vec3 end = farPoint.xyz / farPoint.w;
+
+	float t = (-depth - start.z) / (end.z - start.z);
+	return(mix(start, end, t));
+}
+
+void main()
+{
+	uint clusterIndex = gl_GlobalInvocationID.x;
+	uint clusterCount = uint(clusterGridSize.x * clusterGridSize.y * clusterGridSize.z);
+	if (clusterIndex >= clusterCount)
+	{
+		return;
+	}
+
+	int column = int(clusterIndex) % clusterGridSize.x;
+	int row = (int(clusterIndex) / clusterGridSize.x) % clusterGridSize.y;
+	int slice = int(clusterIndex) / (clusterGridSize.x * clusterGridSize.y);
+
+	// view space bounds of the cluster from its 8 corners
+	vec2 ndcMinimum = vec2(column, row) / vec2(clusterGridSize.xy) * 2.0f - 1.0f;
+	vec2 ndcMaximum = vec2(column + 1, row + 1) / vec2(clusterGridSize.xy) * 2.0f - 1.0f;
+	float depths[2] = float[2](GetSliceDepth(slice), GetSliceDepth(slice + 1));
+
+	vec3 boundsMinimum = vec3(1.0e30f);
+	vec3 boundsMaximum = vec3(-1.0e30f);
+	for (int i = 0; i < 8; i++)
+	{
+		vec2 ndcCorner = vec2(((i & 1) != 0) ? ndcMaximum.x : ndcMinimum.x, ((i & 2) != 0) ? ndcMaximum.y : ndcMinimum.y);
+		vec3 corner = GetCornerAtDepth(ndcCorner, depths[i >> 2]);
+		boundsMinimum = min(boundsMinimum, corner);
+		boundsMaximum = max(boundsMaximum, corner);
+	}
+
+	uint clusterIndices[MAX_LIGHTS_PER_CLUSTER];
+	uint clusterLightCount = 0;
+
+	for (uint i = 0; (i < lightCount) && (clusterLightCount < MAX_LIGHTS_PER_CLUSTER); i++)
+	{
+		// lights without a range reach every cluster
+		bool bInside = (lights[i].range <= 0.0f);
+		if (bInside == false)
+		{
+			vec3 lightPosition = vec3(view * vec4(lights[i].position, 1.0f));
+			vec3 closestPoint = clamp(lightPosition, boundsMinimum, boundsMaximum);
+			vec3 offset = closestPoint - lightPosition;
+			bInside = (dot(offset, offset) <= lights[i].range * lights[i].range);
+		}
+
+		if (bInside == true)
+		{
+			clusterIndices[clusterLightCount] = i;
+			clusterLightCount++;
+		}
+	}
+
+	uint offset = atomicAdd(lightIndexCount, clusterLightCount);
+	for (uint i = 0; i < clusterLightCount; i++)
+	{
+		lightIndices[offset + i] = clusterIndices[i];
+	}
+
+	clusterLights[clusterIndex] = uvec2(offset, clusterLightCount);
+}
@@ -0,0 +1,10 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowDepthFragment.glsl
+// ============
+// the shadow passes only write depth, so there is no color output
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+void main()
+{
+}
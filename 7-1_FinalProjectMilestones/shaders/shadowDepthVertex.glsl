@@ -0,0 +1,16 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowDepthVertex.glsl
+// ============
+// transform the shadow casters into the view of a shadow casting light
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+layout(location = 0) in vec3 inVertexPosition;
+
+uniform mat4 model;
+uniform mat4 lightViewProjection;
+
+void main()
+{
+	gl_Position = lightViewProjection * model * vec4(inVertexPosition, 1.0f);
+}
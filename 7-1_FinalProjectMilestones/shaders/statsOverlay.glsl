@@ -0,0 +1,22 @@
+///////////////////////////////////////////////////////////////////////////////
+// statsOverlay.glsl
+// ============
+// draw the text of the statistics overlay over a dark translucent panel
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+// coverage of the text, written with its first row at the top and
+// bound to a fixed unit, so the overlay sets no uniforms, this must
+// match OVERLAY_TEXTURE_UNIT in TextureUnits.h
+layout(binding = 14) uniform sampler2D textMask;
+
+void main()
+{
+	float text = texture(textMask, vec2(fragmentTextureCoordinate.x, 1.0f - fragmentTextureCoordinate.y)).r;
+
+	outFragmentColor = vec4(vec3(text), mix(0.6f, 1.0f, text));
+}
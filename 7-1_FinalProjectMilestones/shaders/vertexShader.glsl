@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexShader.glsl
+// ============
+// transform the scene vertices and pass the world space position, normal
+// and texture coordinate on to the fragment shader
+///////////////////////////////////////////////////////////////////////////////
+#version 460 core
+// lets one instanced draw route each instance to its own viewport
+#extension GL_ARB_shader_viewport_layer_array : enable
+
+layout(location = 0) in vec3 inVertexPosition;
+layout(location = 1) in vec3 inVertexNormal;
+layout(location = 2) in vec2 inTextureCoordinate;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentViewIndex;
+// object whose values the fragment shader reads from the object
+// buffer, -1 when they are set as uniforms
+flat out int fragmentObjectIndex;
+
+// world matrices of the scene objects, composed on the CPU each frame
+layout(std430, binding = 8) readonly buffer TransformBuffer
+{
+	mat4 objectMatrices[];
+};
+
+// inverse transpose of each world matrix, composed along with it,
+// which keeps the normals correct under non-uniform scale
+layout(std430, binding = 11) readonly buffer NormalMatrixBuffer
+{
+	mat3 normalMatrices[];
+};
+
+uniform mat4 model;
+uniform mat3 normalMatrix;
+// views drawn from the same draws, this must match MAX_SCENE_VIEWS
+uniform mat4 viewProjections[4];
+// view of the first instance, each further instance draws the next
+// view into its own viewport
+uniform int firstView = 0;
+// index into the world matrices, -1 to use the model uniform
+uniform int objectIndex = -1;
+// set for the draws of the GPU culling pass, whose commands carry
+// the index of their object as the base instance
+uniform bool bIndirectDraw = false;
+
+void main()
+{
+	int drawObjectIndex = bIndirectDraw ? gl_BaseInstance : objectIndex;
+	mat4 worldMatrix = (drawObjectIndex >= 0) ? objectMatrices[drawObjectIndex] : model;
+	mat3 worldNormalMatrix = (drawObjectIndex >= 0) ? normalMatrices[drawObjectIndex] : normalMatrix;
+	vec4 worldPosition = worldMatrix * vec4(inVertexPosition, 1.0f);
+
+	int viewIndex = firstView + gl_InstanceID;
+	gl_Position = viewProjections[viewIndex] * worldPosition;
+#ifdef GL_ARB_shader_viewport_layer_array
+	gl_ViewportIndex = viewIndex;
+#endif
+	fragmentViewIndex = viewIndex;
+	fragmentObjectIndex = bIndirectDraw ? gl_BaseInstance : -1;
+
+	fragmentPosition = vec3(worldPosition);
+	fragmentVertexNormal = worldNormalMatrix * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+}